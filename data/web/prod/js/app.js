@@ -2,6 +2,7 @@ let selectedValve = null;
 let isSequentialRunning = false;
 let currentSequenceIndex = 0;
 let sequenceValves = [];
+let valveCount = 0;
 
 function formatLampStatus(plantLight) {
   if (!plantLight) {
@@ -13,6 +14,29 @@ function formatLampStatus(plantLight) {
   return `${state} (${mode})`;
 }
 
+// Valve buttons and sequence checkboxes follow the valve count the firmware
+// reports, so the same page serves every zone topology.
+function renderValveControls(count) {
+  if (count === valveCount) return;
+  valveCount = count;
+  const single = document.getElementById('singleValveControls');
+  const seq = document.getElementById('seqValveControls');
+  single.innerHTML = '';
+  seq.innerHTML = '';
+  for (let i = 1; i <= count; i++) {
+    const btn = document.createElement('button');
+    btn.className = 'valve-btn';
+    btn.textContent = `Valve ${i}`;
+    btn.onclick = () => selectValve(i, btn);
+    single.appendChild(btn);
+
+    const label = document.createElement('label');
+    label.style.cssText = 'display: flex; align-items: center; gap: 10px; cursor: pointer;';
+    label.innerHTML = `<input type="checkbox" id="seq-valve-${i}" checked> Valve ${i}`;
+    seq.appendChild(label);
+  }
+}
+
 function selectValve(valveNum, button) {
   // Clear previous selection
   document.querySelectorAll('.valve-btn').forEach(btn => btn.classList.remove('selected'));
@@ -60,7 +84,7 @@ function stopWateringOne() {
 
 function startSequentialWatering() {
   sequenceValves = [];
-  for (let i = 1; i <= 6; i++) {
+  for (let i = 1; i <= valveCount; i++) {
     if (document.getElementById(`seq-valve-${i}`).checked) {
       sequenceValves.push(i);
     }
@@ -168,6 +192,8 @@ function updateStatus() {
   fetch('/api/status')
     .then(r => r.json())
     .then(data => {
+      renderValveControls(data.valves.length);
+
       // Update pump status
       const pumpStatus = document.getElementById('pumpStatus');
       const pumpText = document.getElementById('pumpStatusText');
@@ -0,0 +1,139 @@
+#ifndef BINARY_LOG_H
+#define BINARY_LOG_H
+
+#include <Arduino.h>
+#include <esp_ota_ops.h>
+#include <freertos/FreeRTOS.h>
+#include "config.h"
+#include "BinaryLogFormat.h"
+
+// ============================================
+// Binary Log - format-string IDs + raw arguments for Loki
+// Header-only static class (same pattern as DebugHelper)
+//
+//   BLOG_INFO("Valve %d: closing, duration=%lus%s", i, secs, timeout ? " TIMEOUT" : "");
+//
+// The format string stays in flash and its address is the record's format
+// ID, so a call costs an argument copy and a short critical section - no
+// String, no heap, no text formatting. MetricsPusher ships the raw ring to
+// the proxy, which expands it with tools/binlog_decode.py before forwarding
+// to Loki. Arguments are checked against the format at compile time; pass
+// String values as .c_str().
+// ============================================
+class BinaryLog {
+private:
+    static uint8_t ring[BINARY_LOG_RING_BYTES];
+    static uint32_t head;       // Absolute byte positions; index = pos % size
+    static uint32_t tail;
+    static uint32_t recordCount;
+    static uint32_t dropped;    // Records overwritten before they were pushed
+    static portMUX_TYPE lock;
+
+    static void copyIn(uint32_t pos, const uint8_t* data, size_t len) {
+        uint32_t index = pos % BINARY_LOG_RING_BYTES;
+        size_t first = BINARY_LOG_RING_BYTES - index;
+        if (first > len) first = len;
+        memcpy(ring + index, data, first);
+        memcpy(ring, data + first, len - first);
+    }
+
+    static void copyOut(uint32_t pos, uint8_t* out, size_t len) {
+        uint32_t index = pos % BINARY_LOG_RING_BYTES;
+        size_t first = BINARY_LOG_RING_BYTES - index;
+        if (first > len) first = len;
+        memcpy(out, ring + index, first);
+        memcpy(out + first, ring, len - first);
+    }
+
+public:
+    static void commit(const uint8_t* record, size_t len) {
+        portENTER_CRITICAL(&lock);
+        while (head + len - tail > BINARY_LOG_RING_BYTES) {
+            tail += ring[tail % BINARY_LOG_RING_BYTES];  // Drop oldest
+            recordCount--;
+            dropped++;
+        }
+        copyIn(head, record, len);
+        head += len;
+        recordCount++;
+        portEXIT_CRITICAL(&lock);
+    }
+
+    template <typename... Args>
+    static void write(uint8_t level, const char* format, Args... args) {
+        uint8_t record[BinaryLogFormat::MAX_RECORD_SIZE];
+        size_t len = BinaryLogFormat::encodeRecord(record, level, (uint32_t)format,
+                                                   (uint32_t)millis(), args...);
+        commit(record, len);
+    }
+
+    // Copies the unsent records out (at most maxBytes, whole records only).
+    // `endPos` is what acknowledge() takes once the copy has been delivered.
+    static size_t snapshot(uint8_t* out, size_t maxBytes, uint16_t& records, uint32_t& endPos) {
+        portENTER_CRITICAL(&lock);
+        size_t used = 0;
+        records = 0;
+        uint32_t pos = tail;
+        while (pos != head) {
+            uint8_t len = ring[pos % BINARY_LOG_RING_BYTES];
+            if (used + len > maxBytes || records == 0xFFFF) break;
+            pos += len;
+            used += len;
+            records++;
+        }
+        copyOut(tail, out, used);
+        endPos = pos;
+        portEXIT_CRITICAL(&lock);
+        return used;
+    }
+
+    static void acknowledge(uint32_t endPos) {
+        portENTER_CRITICAL(&lock);
+        // Records overwritten while the push was in flight already moved tail
+        while ((int32_t)(endPos - tail) > 0) {
+            tail += ring[tail % BINARY_LOG_RING_BYTES];
+            recordCount--;
+        }
+        portEXIT_CRITICAL(&lock);
+    }
+
+    static uint32_t pendingBytes() { return head - tail; }
+    static uint32_t getRecordCount() { return recordCount; }
+    static uint32_t getDroppedCount() { return dropped; }
+
+    // First bytes of the ELF SHA-256: format IDs are addresses, so the proxy
+    // keys its format cache per build.
+    static void getBuildId(uint8_t* out) {
+        const esp_app_desc_t* desc = esp_ota_get_app_description();
+        memcpy(out, desc->app_elf_sha256, BinaryLogFormat::BUILD_ID_SIZE);
+    }
+};
+
+// ============================================
+// Static Member Initialization
+// ============================================
+uint8_t BinaryLog::ring[BINARY_LOG_RING_BYTES];
+uint32_t BinaryLog::head = 0;
+uint32_t BinaryLog::tail = 0;
+uint32_t BinaryLog::recordCount = 0;
+uint32_t BinaryLog::dropped = 0;
+portMUX_TYPE BinaryLog::lock = portMUX_INITIALIZER_UNLOCKED;
+
+// ============================================
+// Logging macros
+// ============================================
+// The static array gives each call site one flash-resident format whose
+// address is stable for the build.
+#define BLOG(level, fmt, ...)                                          \
+    do {                                                               \
+        static const char blogFormat_[] = fmt;                         \
+        if (false) BinaryLogFormat::checkFormat(fmt, ##__VA_ARGS__);   \
+        BinaryLog::write(level, blogFormat_, ##__VA_ARGS__);           \
+    } while (0)
+
+#define BLOG_DEBUG(fmt, ...) BLOG(BinaryLogFormat::LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#define BLOG_INFO(fmt, ...) BLOG(BinaryLogFormat::LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define BLOG_WARN(fmt, ...) BLOG(BinaryLogFormat::LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define BLOG_ERROR(fmt, ...) BLOG(BinaryLogFormat::LEVEL_ERROR, fmt, ##__VA_ARGS__)
+
+#endif // BINARY_LOG_H
@@ -0,0 +1,332 @@
+#ifndef BINARY_LOG_FORMAT_H
+#define BINARY_LOG_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Wire format of the BLOG_* log records, shared by the firmware
+// (BinaryLog.h), the native tests and the host decoder
+// (tools/binlog_decode.py). Hardware-free; all fields little-endian.
+//
+// Record (also the in-RAM ring entry):
+//   len u8 (whole record) | level u8 | format id u32 | millis u32 | args
+//
+// Arguments carry no type tags - the format string says how to read them:
+//   %d %i %u %x %X %o %c %p and h/hh/l/z/j/t variants   4 bytes
+//   %lld %llu %llx (ll modifier)                           8 bytes
+//   %f %e %g %a (any case)                                 float32
+//   %s                                                     u8 length + bytes
+// Width and precision are kept; '*' is not supported. `long` is encoded as
+// 4 bytes everywhere so the native build decodes what the ESP32 writes.
+//
+// Batch (body of POST /v1/logs/push-binary):
+//   "WLB1" | build id [8] | epoch seconds u32 | millis now u32 | dropped u32 |
+//   format count u16 | record count u16 |
+//   formats: format count x (id u32, length u16, text)
+//   records: record count x record
+// The format table only carries formats the proxy has not seen from this
+// build yet; record timestamps are epoch - (millis now - record millis).
+namespace BinaryLogFormat {
+
+const uint8_t LEVEL_DEBUG = 0;
+const uint8_t LEVEL_INFO = 1;
+const uint8_t LEVEL_WARN = 2;
+const uint8_t LEVEL_ERROR = 3;
+
+const size_t RECORD_HEADER_SIZE = 10;
+const size_t MAX_RECORD_SIZE = 255;
+const size_t MAX_STRING_ARG = 32;  // %s arguments are truncated to this
+const uint8_t BATCH_MAGIC[4] = {'W', 'L', 'B', '1'};
+const size_t BUILD_ID_SIZE = 8;
+const size_t BATCH_HEADER_SIZE = 28;
+
+inline const char *levelName(uint8_t level) {
+  switch (level) {
+  case LEVEL_DEBUG: return "debug";
+  case LEVEL_WARN: return "warn";
+  case LEVEL_ERROR: return "error";
+  default: return "info";
+  }
+}
+
+inline void putU16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+inline void putU32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+inline uint16_t getU16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+inline uint32_t getU32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+// ============================================
+// Encoding
+// ============================================
+// Arguments that do not fit are dropped whole; the decoder prints "<?>" for
+// them rather than misreading the bytes that follow.
+struct Writer {
+  uint8_t *buf;
+  size_t capacity;
+  size_t len;
+  bool full;  // Set by the first argument that did not fit
+};
+
+inline void putBytes(Writer &w, const void *data, size_t n) {
+  if (w.full || w.len + n > w.capacity) {
+    w.full = true;
+    return;
+  }
+  memcpy(w.buf + w.len, data, n);
+  w.len += n;
+}
+
+inline void putWord(Writer &w, uint32_t v) {
+  uint8_t b[4];
+  putU32(b, v);
+  putBytes(w, b, 4);
+}
+
+inline void putArg(Writer &w, int v) { putWord(w, (uint32_t)v); }
+inline void putArg(Writer &w, unsigned int v) { putWord(w, v); }
+inline void putArg(Writer &w, long v) { putWord(w, (uint32_t)v); }
+inline void putArg(Writer &w, unsigned long v) { putWord(w, (uint32_t)v); }
+inline void putArg(Writer &w, const void *v) { putWord(w, (uint32_t)(uintptr_t)v); }
+
+inline void putArg(Writer &w, long long v) {
+  uint8_t b[8];
+  putU32(b, (uint32_t)v);
+  putU32(b + 4, (uint32_t)((unsigned long long)v >> 32));
+  putBytes(w, b, 8);
+}
+
+inline void putArg(Writer &w, unsigned long long v) { putArg(w, (long long)v); }
+
+inline void putArg(Writer &w, double v) {
+  float f = (float)v;
+  uint32_t bits;
+  memcpy(&bits, &f, 4);
+  putWord(w, bits);
+}
+
+inline void putArg(Writer &w, const char *s) {
+  size_t n = s ? strlen(s) : 0;
+  if (n > MAX_STRING_ARG) n = MAX_STRING_ARG;
+  uint8_t len = (uint8_t)n;
+  if (w.len + 1 + n > w.capacity) {
+    w.full = true;
+    return;
+  }
+  putBytes(w, &len, 1);
+  putBytes(w, s, n);
+}
+
+inline void putArgs(Writer &) {}
+
+template <typename T, typename... Rest>
+inline void putArgs(Writer &w, T first, Rest... rest) {
+  putArg(w, first);
+  putArgs(w, rest...);
+}
+
+// Returns the record length (RECORD_HEADER_SIZE + encoded arguments).
+template <typename... Args>
+inline size_t encodeRecord(uint8_t *out, uint8_t level, uint32_t formatId,
+                           uint32_t millisNow, Args... args) {
+  Writer w = {out, MAX_RECORD_SIZE, RECORD_HEADER_SIZE, false};
+  putArgs(w, args...);
+  out[0] = (uint8_t)w.len;
+  out[1] = level;
+  putU32(out + 2, formatId);
+  putU32(out + 6, millisNow);
+  return w.len;
+}
+
+// Never called: lets the compiler check BLOG_* arguments against the format.
+inline void checkFormat(const char *, ...) __attribute__((format(printf, 1, 2)));
+inline void checkFormat(const char *, ...) {}
+
+// ============================================
+// Decoding
+// ============================================
+// Appends with truncation; `used` never passes outSize - 1.
+inline void appendText(char *out, size_t outSize, size_t &used, const char *text, size_t n) {
+  if (n > outSize - 1 - used) n = outSize - 1 - used;
+  memcpy(out + used, text, n);
+  used += n;
+  out[used] = '\0';
+}
+
+// printf-compatible rendering of one record's arguments. Used on the device
+// only as a fallback when the proxy predates the binary endpoint.
+inline size_t formatRecord(const char *format, const uint8_t *args, size_t argLen,
+                           char *out, size_t outSize) {
+  if (outSize == 0) return 0;
+  size_t used = 0;
+  size_t pos = 0;
+  out[0] = '\0';
+
+  const char *p = format;
+  while (*p) {
+    if (*p != '%') {
+      const char *next = strchr(p, '%');
+      size_t n = next ? (size_t)(next - p) : strlen(p);
+      appendText(out, outSize, used, p, n);
+      p += n;
+      continue;
+    }
+    if (p[1] == '%') {
+      appendText(out, outSize, used, "%", 1);
+      p += 2;
+      continue;
+    }
+
+    // %[flags][width][.precision][length]conversion
+    char spec[20];
+    size_t specLen = 0;
+    spec[specLen++] = *p++;
+    while (*p && strchr("-+ #0", *p) && specLen < 8) spec[specLen++] = *p++;
+    while (*p >= '0' && *p <= '9' && specLen < 10) spec[specLen++] = *p++;
+    if (*p == '.') {
+      spec[specLen++] = *p++;
+      while (*p >= '0' && *p <= '9' && specLen < 13) spec[specLen++] = *p++;
+    }
+    int longs = 0;
+    while (*p && strchr("hlzjtL", *p)) {
+      if (*p == 'l') longs++;
+      p++;
+    }
+    char conv = *p;
+    if (conv == '\0') break;
+    p++;
+
+    char piece[64];
+    int n = -1;
+    if (strchr("diuxXoc", conv)) {
+      if (longs >= 2) {
+        if (pos + 8 <= argLen) {
+          unsigned long long v = (unsigned long long)getU32(args + pos) |
+                                 ((unsigned long long)getU32(args + pos + 4) << 32);
+          spec[specLen++] = 'l';
+          spec[specLen++] = 'l';
+          spec[specLen++] = conv;
+          spec[specLen] = '\0';
+          n = (conv == 'd' || conv == 'i') ? snprintf(piece, sizeof(piece), spec, (long long)v)
+                                            : snprintf(piece, sizeof(piece), spec, v);
+        }
+        pos += 8;
+      } else {
+        if (pos + 4 <= argLen) {
+          uint32_t v = getU32(args + pos);
+          spec[specLen++] = conv;
+          spec[specLen] = '\0';
+          n = (conv == 'd' || conv == 'i' || conv == 'c')
+                  ? snprintf(piece, sizeof(piece), spec, (int)(int32_t)v)
+                  : snprintf(piece, sizeof(piece), spec, (unsigned int)v);
+        }
+        pos += 4;
+      }
+    } else if (conv == 'p') {
+      if (pos + 4 <= argLen) n = snprintf(piece, sizeof(piece), "0x%08x", (unsigned int)getU32(args + pos));
+      pos += 4;
+    } else if (strchr("fFeEgGaA", conv)) {
+      if (pos + 4 <= argLen) {
+        uint32_t bits = getU32(args + pos);
+        float f;
+        memcpy(&f, &bits, 4);
+        spec[specLen++] = conv;
+        spec[specLen] = '\0';
+        n = snprintf(piece, sizeof(piece), spec, (double)f);
+      }
+      pos += 4;
+    } else if (conv == 's') {
+      if (pos < argLen && pos + 1 + args[pos] <= argLen) {
+        char text[MAX_STRING_ARG + 1];
+        size_t len = args[pos] > MAX_STRING_ARG ? MAX_STRING_ARG : args[pos];
+        memcpy(text, args + pos + 1, len);
+        text[len] = '\0';
+        spec[specLen++] = 's';
+        spec[specLen] = '\0';
+        n = snprintf(piece, sizeof(piece), spec, text);
+        pos += 1 + args[pos];
+      } else {
+        pos = argLen + 1;
+      }
+    } else {
+      // Unknown conversion: print it verbatim, consume nothing
+      appendText(out, outSize, used, p - 1, 1);
+      continue;
+    }
+
+    if (n < 0) {
+      appendText(out, outSize, used, "<?>", 3);
+    } else {
+      appendText(out, outSize, used, piece, (size_t)n < sizeof(piece) ? (size_t)n : sizeof(piece) - 1);
+    }
+  }
+  return used;
+}
+
+// ============================================
+// Batch
+// ============================================
+struct BatchHeader {
+  uint8_t buildId[BUILD_ID_SIZE];
+  uint32_t epochSeconds;
+  uint32_t millisNow;
+  uint32_t dropped;
+  uint16_t formatCount;
+  uint16_t recordCount;
+};
+
+inline void writeBatchHeader(const BatchHeader &h, uint8_t *out) {
+  memcpy(out, BATCH_MAGIC, 4);
+  memcpy(out + 4, h.buildId, BUILD_ID_SIZE);
+  putU32(out + 12, h.epochSeconds);
+  putU32(out + 16, h.millisNow);
+  putU32(out + 20, h.dropped);
+  putU16(out + 24, h.formatCount);
+  putU16(out + 26, h.recordCount);
+}
+
+// Bytes a format table entry takes (id u32, length u16, text).
+inline size_t formatEntrySize(const char *format) { return 6 + strlen(format); }
+
+// Distinct format IDs used by `records` that are not in `known`, in first-use
+// order. Stops at a malformed record length.
+inline int collectNewFormats(const uint8_t *records, size_t len, const uint32_t *known,
+                             int knownCount, uint32_t *out, int maxOut) {
+  int count = 0;
+  size_t pos = 0;
+  while (pos + RECORD_HEADER_SIZE <= len && records[pos] >= RECORD_HEADER_SIZE) {
+    uint32_t id = getU32(records + pos + 2);
+    bool seen = false;
+    for (int i = 0; i < knownCount && !seen; i++) seen = known[i] == id;
+    for (int i = 0; i < count && !seen; i++) seen = out[i] == id;
+    if (!seen && count < maxOut) out[count++] = id;
+    pos += records[pos];
+  }
+  return count;
+}
+
+inline size_t writeFormatEntry(uint32_t id, const char *format, uint8_t *out) {
+  size_t n = strlen(format);
+  putU32(out, id);
+  putU16(out + 4, (uint16_t)n);
+  memcpy(out + 6, format, n);
+  return 6 + n;
+}
+
+} // namespace BinaryLogFormat
+
+#endif // BINARY_LOG_FORMAT_H
@@ -0,0 +1,128 @@
+#ifndef CPU_PROFILE_FORMAT_H
+#define CPU_PROFILE_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Dump format of GET /profiler/download, shared by the firmware
+// (CpuProfiler.h), the native tests and the host symbolizer
+// (tools/profile_fold.py). Hardware-free; all fields little-endian.
+//
+//   header   PROFILE_HEADER_SIZE bytes (see ProfileHeader)
+//   tasks    taskCount x PROFILE_TASK_ENTRY_SIZE  (handle u32, name[16])
+//   samples  sampleCount x PROFILE_SAMPLE_SIZE    (see ProfileSample)
+//
+// pc[0] is the interrupted PC, pc[1..depth-1] are return addresses walking
+// outwards. A sample taken while another ISR was running has depth 0 and the
+// PROFILE_SAMPLE_IN_ISR flag.
+namespace CpuProfileFormat {
+
+const uint8_t PROFILE_MAGIC[4] = {'W', 'P', 'R', 'F'};
+const uint16_t PROFILE_VERSION = 1;
+const int PROFILE_MAX_DEPTH = 8;
+const int PROFILE_TASK_NAME_LEN = 16;
+const size_t PROFILE_HEADER_SIZE = 32;
+const size_t PROFILE_TASK_ENTRY_SIZE = 4 + PROFILE_TASK_NAME_LEN;
+const size_t PROFILE_SAMPLE_SIZE = 8 + 4 * PROFILE_MAX_DEPTH;
+const uint16_t PROFILE_SAMPLE_IN_ISR = 0x0001;
+
+struct ProfileHeader {
+  uint16_t version;
+  uint16_t maxDepth;
+  uint32_t sampleHz;
+  uint32_t sampleCount;
+  uint32_t droppedSamples;  // Ring full before the run ended
+  uint32_t taskCount;
+  uint32_t durationMs;
+};
+
+struct ProfileSample {
+  uint32_t task;  // TCB address, resolved through the task table
+  uint8_t core;
+  uint8_t depth;
+  uint16_t flags;
+  uint32_t pc[PROFILE_MAX_DEPTH];
+};
+
+inline void putU16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+inline void putU32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+inline uint16_t getU16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+inline uint32_t getU32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+inline void writeHeader(const ProfileHeader &h, uint8_t *out) {
+  memset(out, 0, PROFILE_HEADER_SIZE);
+  memcpy(out, PROFILE_MAGIC, 4);
+  putU16(out + 4, h.version);
+  putU16(out + 6, h.maxDepth);
+  putU32(out + 8, h.sampleHz);
+  putU32(out + 12, h.sampleCount);
+  putU32(out + 16, h.droppedSamples);
+  putU32(out + 20, h.taskCount);
+  putU32(out + 24, h.durationMs);
+}
+
+// Validates magic, version and that the declared tables fit in `len`.
+inline bool readHeader(const uint8_t *in, size_t len, ProfileHeader &h) {
+  if (len < PROFILE_HEADER_SIZE || memcmp(in, PROFILE_MAGIC, 4) != 0) return false;
+  h.version = getU16(in + 4);
+  h.maxDepth = getU16(in + 6);
+  h.sampleHz = getU32(in + 8);
+  h.sampleCount = getU32(in + 12);
+  h.droppedSamples = getU32(in + 16);
+  h.taskCount = getU32(in + 20);
+  h.durationMs = getU32(in + 24);
+  if (h.version != PROFILE_VERSION || h.maxDepth != PROFILE_MAX_DEPTH) return false;
+  uint64_t need = PROFILE_HEADER_SIZE +
+                  (uint64_t)h.taskCount * PROFILE_TASK_ENTRY_SIZE +
+                  (uint64_t)h.sampleCount * PROFILE_SAMPLE_SIZE;
+  return need <= len;
+}
+
+inline void writeTask(uint32_t handle, const char *name, uint8_t *out) {
+  putU32(out, handle);
+  memset(out + 4, 0, PROFILE_TASK_NAME_LEN);
+  if (name) {
+    size_t n = strlen(name);
+    if (n > (size_t)PROFILE_TASK_NAME_LEN - 1) n = PROFILE_TASK_NAME_LEN - 1;
+    memcpy(out + 4, name, n);
+  }
+}
+
+inline void writeSample(const ProfileSample &s, uint8_t *out) {
+  putU32(out, s.task);
+  out[4] = s.core;
+  out[5] = s.depth;
+  putU16(out + 6, s.flags);
+  for (int i = 0; i < PROFILE_MAX_DEPTH; i++) {
+    putU32(out + 8 + 4 * i, s.pc[i]);
+  }
+}
+
+inline void readSample(const uint8_t *in, ProfileSample &s) {
+  s.task = getU32(in);
+  s.core = in[4];
+  s.depth = in[5] > PROFILE_MAX_DEPTH ? PROFILE_MAX_DEPTH : in[5];
+  s.flags = getU16(in + 6);
+  for (int i = 0; i < PROFILE_MAX_DEPTH; i++) {
+    s.pc[i] = getU32(in + 8 + 4 * i);
+  }
+}
+
+} // namespace CpuProfileFormat
+
+#endif // CPU_PROFILE_FORMAT_H
@@ -0,0 +1,305 @@
+#ifndef CPU_PROFILER_H
+#define CPU_PROFILER_H
+
+#include <Arduino.h>
+#include <WebServer.h>
+#include <esp_ipc.h>
+#include <esp_debug_helpers.h>
+#include <soc/cpu.h>
+#include <soc/soc_memory_layout.h>
+#include <freertos/xtensa_context.h>
+#include "config.h"
+#include "CpuProfileFormat.h"
+#include "DebugHelper.h"
+#include "LoopDeadlineMonitor.h"
+#include <secret.h>
+
+extern WebServer httpServer;
+
+// ============================================
+// CpuProfiler - timer-interrupt sampling profiler for both cores
+// Header-only static class (same pattern as DebugHelper)
+//
+//   POST /profiler/start?hz=250&seconds=30
+//   POST /profiler/stop
+//   GET  /profiler/status
+//   GET  /profiler/download      binary dump, see CpuProfileFormat.h
+//
+// Each core gets its own hardware timer whose ISR is allocated on that core,
+// so every tick samples the task the core was running. The interrupted PC is
+// read from the exception frame FreeRTOS saved at the top of that task's
+// stack (pxTopOfStack, the first TCB member); the backtrace is walked from
+// there and stops at the first implausible frame. The timer ISRs are not
+// IRAM-safe, so nothing is sampled while the caches are off for a flash
+// write - which is also what lets them write the PSRAM ring.
+//
+// Symbolize on the host: tools/profile_fold.py turns the dump plus the
+// firmware ELF into folded stacks for flamegraph.pl / speedscope.
+// ============================================
+class CpuProfiler {
+private:
+    static CpuProfileFormat::ProfileSample* samples;
+    static hw_timer_t* timers[2];
+    static volatile uint32_t writeIndex;
+    static volatile uint32_t droppedSamples;
+    static volatile bool running;
+    static uint32_t sampleHz;
+    static unsigned long startMs;
+    static unsigned long durationMs;
+    static unsigned long stopAtMs;
+
+    static void IRAM_ATTR onSampleTimer() {
+        if (!running) return;
+        uint32_t index = __atomic_fetch_add(&writeIndex, 1, __ATOMIC_RELAXED);
+        if (index >= PROFILER_MAX_SAMPLES) {
+            __atomic_fetch_add(&droppedSamples, 1, __ATOMIC_RELAXED);
+            return;
+        }
+
+        int core = xPortGetCoreID();
+        CpuProfileFormat::ProfileSample& s = samples[index];
+        TaskHandle_t task = xTaskGetCurrentTaskHandleForCPU(core);
+        s.task = (uint32_t)task;
+        s.core = (uint8_t)core;
+        s.depth = 0;
+        s.flags = 0;
+
+        // Nested interrupt: pxTopOfStack still describes whatever the task
+        // was doing before the outer ISR, not what we interrupted.
+        if (task == NULL || xPortInterruptedFromISRContext()) {
+            s.flags = CpuProfileFormat::PROFILE_SAMPLE_IN_ISR;
+            return;
+        }
+
+        XtExcFrame* frame = *(XtExcFrame**)task;
+        if (!esp_ptr_internal(frame) && !esp_ptr_external_ram(frame)) return;
+        s.pc[0] = frame->pc;
+        s.depth = 1;
+
+        esp_backtrace_frame_t bt;
+        bt.pc = frame->pc;
+        bt.sp = frame->a1;
+        bt.next_pc = frame->a0;
+        while (s.depth < CpuProfileFormat::PROFILE_MAX_DEPTH && bt.next_pc != 0) {
+            if (!esp_stack_ptr_is_sane(bt.sp)) break;
+            uint32_t pc = esp_cpu_process_stack_pc(bt.next_pc);
+            if (!esp_ptr_executable((void*)pc)) break;
+            s.pc[s.depth++] = pc;
+            if (!esp_backtrace_get_next_frame(&bt)) break;
+        }
+    }
+
+    // Runs on the core the timer should interrupt (the ISR is bound to the
+    // core that allocates it).
+    static void attachTimerOnThisCore(void* arg) {
+        int core = (int)(intptr_t)arg;
+        timers[core] = timerBegin(PROFILER_TIMER_NUM[core], 80, true);  // 1 MHz tick
+        if (timers[core]) timerAttachInterrupt(timers[core], onSampleTimer, true);
+    }
+
+    static bool ensureResources() {
+        if (samples == nullptr) {
+            samples = (CpuProfileFormat::ProfileSample*)ps_malloc(
+                PROFILER_MAX_SAMPLES * sizeof(CpuProfileFormat::ProfileSample));
+            if (samples == nullptr) return false;
+        }
+        for (int core = 0; core < 2; core++) {
+            if (timers[core] != nullptr) continue;
+            if (core == xPortGetCoreID()) {
+                attachTimerOnThisCore((void*)(intptr_t)core);
+            } else {
+                esp_ipc_call_blocking(core, attachTimerOnThisCore, (void*)(intptr_t)core);
+            }
+            if (timers[core] == nullptr) return false;
+        }
+        return true;
+    }
+
+    static bool isAuthorized() {
+        if (!httpServer.authenticate(OTA_USER, OTA_PASSWORD)) {
+            httpServer.requestAuthentication();
+            return false;
+        }
+        return true;
+    }
+
+    static uint32_t recordedSamples() {
+        uint32_t n = writeIndex;
+        return n > PROFILER_MAX_SAMPLES ? PROFILER_MAX_SAMPLES : n;
+    }
+
+    // Distinct task handles seen in the samples, in first-seen order.
+    static uint32_t collectTasks(uint32_t* handles, uint32_t maxHandles) {
+        uint32_t count = 0;
+        uint32_t n = recordedSamples();
+        for (uint32_t i = 0; i < n; i++) {
+            uint32_t task = samples[i].task;
+            bool known = false;
+            for (uint32_t j = 0; j < count && !known; j++) known = handles[j] == task;
+            if (!known && count < maxHandles) handles[count++] = task;
+        }
+        return count;
+    }
+
+public:
+    static bool isRunning() { return running; }
+
+    static bool start(uint32_t hz, uint32_t seconds) {
+        if (running) return false;
+        if (!ensureResources()) {
+            DebugHelper::debugImportant("❌ Profiler: cannot allocate sample buffer/timers");
+            return false;
+        }
+        sampleHz = constrain(hz, (uint32_t)1, PROFILER_MAX_HZ);
+        seconds = constrain(seconds, (uint32_t)1, PROFILER_MAX_DURATION_S);
+        writeIndex = 0;
+        droppedSamples = 0;
+        startMs = millis();
+        durationMs = 0;
+        stopAtMs = startMs + seconds * 1000UL;
+        running = true;
+        for (int core = 0; core < 2; core++) {
+            timerWrite(timers[core], 0);
+            timerAlarmWrite(timers[core], 1000000UL / sampleHz, true);
+            timerAlarmEnable(timers[core]);
+        }
+        DebugHelper::debug("🔬 Profiler started: " + String(sampleHz) + " Hz x 2 cores, " +
+                           String(seconds) + "s");
+        return true;
+    }
+
+    static void stop() {
+        if (!running) return;
+        for (int core = 0; core < 2; core++) {
+            timerAlarmDisable(timers[core]);
+        }
+        running = false;
+        durationMs = millis() - startMs;
+        DebugHelper::debug("🔬 Profiler stopped: " + String(recordedSamples()) + " samples, " +
+                           String(droppedSamples) + " dropped");
+    }
+
+    // Network task: end the run on its deadline or when the ring is full.
+    static void loop() {
+        if (!running) return;
+        if ((long)(millis() - stopAtMs) >= 0 || writeIndex >= PROFILER_MAX_SAMPLES) {
+            stop();
+        }
+    }
+
+    static String statusJson() {
+        String json = "{\"running\":" + String(running ? "true" : "false");
+        json += ",\"hz\":" + String(sampleHz);
+        json += ",\"samples\":" + String(recordedSamples());
+        json += ",\"capacity\":" + String(PROFILER_MAX_SAMPLES);
+        json += ",\"dropped\":" + String(droppedSamples);
+        json += ",\"duration_ms\":" + String(running ? millis() - startMs : durationMs);
+        json += "}";
+        return json;
+    }
+
+    static void handleStart() {
+        if (!isAuthorized()) return;
+        uint32_t hz = httpServer.hasArg("hz") ? httpServer.arg("hz").toInt() : PROFILER_DEFAULT_HZ;
+        uint32_t seconds = httpServer.hasArg("seconds") ? httpServer.arg("seconds").toInt() : 30;
+        if (running) {
+            httpServer.send(409, "application/json", statusJson());
+            return;
+        }
+        if (!start(hz, seconds)) {
+            httpServer.send(500, "text/plain", "profiler unavailable (PSRAM/timers)");
+            return;
+        }
+        httpServer.send(200, "application/json", statusJson());
+    }
+
+    static void handleStop() {
+        if (!isAuthorized()) return;
+        stop();
+        httpServer.send(200, "application/json", statusJson());
+    }
+
+    static void handleStatus() {
+        if (!isAuthorized()) return;
+        httpServer.send(200, "application/json", statusJson());
+    }
+
+    static void handleDownload() {
+        if (!isAuthorized()) return;
+        if (running) {
+            httpServer.send(409, "text/plain", "profiler running - stop it first");
+            return;
+        }
+        if (samples == nullptr || recordedSamples() == 0) {
+            httpServer.send(404, "text/plain", "no samples recorded");
+            return;
+        }
+
+        const uint32_t MAX_TASKS = 32;
+        uint32_t handles[MAX_TASKS];
+        uint32_t taskCount = collectTasks(handles, MAX_TASKS);
+        uint32_t sampleCount = recordedSamples();
+
+        CpuProfileFormat::ProfileHeader header;
+        header.version = CpuProfileFormat::PROFILE_VERSION;
+        header.maxDepth = CpuProfileFormat::PROFILE_MAX_DEPTH;
+        header.sampleHz = sampleHz;
+        header.sampleCount = sampleCount;
+        header.droppedSamples = droppedSamples;
+        header.taskCount = taskCount;
+        header.durationMs = durationMs;
+
+        size_t total = CpuProfileFormat::PROFILE_HEADER_SIZE +
+                       taskCount * CpuProfileFormat::PROFILE_TASK_ENTRY_SIZE +
+                       sampleCount * CpuProfileFormat::PROFILE_SAMPLE_SIZE;
+        httpServer.setContentLength(total);
+        httpServer.sendHeader("Content-Disposition", "attachment; filename=\"profile.wprf\"");
+        httpServer.send(200, "application/octet-stream", "");
+
+        uint8_t chunk[1024];
+        CpuProfileFormat::writeHeader(header, chunk);
+        httpServer.sendContent((const char*)chunk, CpuProfileFormat::PROFILE_HEADER_SIZE);
+
+        for (uint32_t t = 0; t < taskCount; t++) {
+            // Names are read at download time: every task in this firmware
+            // lives for the whole uptime, so the handles are still valid.
+            const char* name = handles[t] == 0 ? "(none)"
+                             : pcTaskGetName((TaskHandle_t)handles[t]);
+            CpuProfileFormat::writeTask(handles[t], name, chunk);
+            httpServer.sendContent((const char*)chunk, CpuProfileFormat::PROFILE_TASK_ENTRY_SIZE);
+        }
+
+        const uint32_t perChunk = sizeof(chunk) / CpuProfileFormat::PROFILE_SAMPLE_SIZE;
+        for (uint32_t i = 0; i < sampleCount; i += perChunk) {
+            uint32_t n = (sampleCount - i) < perChunk ? (sampleCount - i) : perChunk;
+            for (uint32_t k = 0; k < n; k++) {
+                CpuProfileFormat::writeSample(samples[i + k],
+                                              chunk + k * CpuProfileFormat::PROFILE_SAMPLE_SIZE);
+            }
+            httpServer.sendContent((const char*)chunk, n * CpuProfileFormat::PROFILE_SAMPLE_SIZE);
+            LoopDeadlineMonitor::heartbeat(DEADLINE_TASK_NETWORK);
+        }
+    }
+
+    static void registerHandlers() {
+        httpServer.on("/profiler/start", HTTP_POST, handleStart);
+        httpServer.on("/profiler/stop", HTTP_POST, handleStop);
+        httpServer.on("/profiler/status", HTTP_GET, handleStatus);
+        httpServer.on("/profiler/download", HTTP_GET, handleDownload);
+    }
+};
+
+// ============================================
+// Static Member Initialization
+// ============================================
+CpuProfileFormat::ProfileSample* CpuProfiler::samples = nullptr;
+hw_timer_t* CpuProfiler::timers[2] = {nullptr, nullptr};
+volatile uint32_t CpuProfiler::writeIndex = 0;
+volatile uint32_t CpuProfiler::droppedSamples = 0;
+volatile bool CpuProfiler::running = false;
+uint32_t CpuProfiler::sampleHz = PROFILER_DEFAULT_HZ;
+unsigned long CpuProfiler::startMs = 0;
+unsigned long CpuProfiler::durationMs = 0;
+unsigned long CpuProfiler::stopAtMs = 0;
+
+#endif // CPU_PROFILER_H
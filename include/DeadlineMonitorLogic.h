@@ -0,0 +1,180 @@
+#ifndef DEADLINE_MONITOR_LOGIC_H
+#define DEADLINE_MONITOR_LOGIC_H
+
+#include <stdint.h>
+
+// Pure, hardware-free deadline bookkeeping shared by the firmware
+// (LoopDeadlineMonitor.h) and the native test suite.
+//
+// globalSafetyWatchdog() only protects against a valve staying open too long.
+// It cannot help when the control loop itself stops running -- a LittleFS write
+// stuck in garbage collection, an I2C transaction that never completes -- because
+// the watchdog lives inside that same loop. Each task therefore marks the stage
+// it is in; a cycle that runs past its soft deadline is counted against the
+// slowest stage of that cycle, and a task that stops checking in for longer than
+// its hard deadline is treated as stalled in whatever stage it last entered.
+
+// Loop stages, in the order they run. Control-loop stages mirror
+// WateringSystem::processWateringLoop(); network stages mirror networkTask().
+enum LoopStage {
+  STAGE_IDLE = 0,           // Between cycles (delay / vTaskDelay)
+  STAGE_OVERFLOW_SENSOR,    // checkMasterOverflowSensor
+  STAGE_WATER_LEVEL,        // checkWaterLevelSensor
+  STAGE_SAFETY_WATCHDOG,    // globalSafetyWatchdog
+  STAGE_PLANT_LIGHT,        // updatePlantLightSchedule
+  STAGE_AUTO_WATERING,      // checkAutoWatering
+  STAGE_QUEUE,              // processQueue
+  STAGE_VALVES,             // processValve x NUM_VALVES
+  STAGE_PUBLISH,            // publishCurrentState
+  STAGE_NET_HTTP,           // loopOta (web UI / API / OTA upload)
+  STAGE_NET_WIFI,           // NetworkManager::loopWiFi
+  STAGE_NET_TELEGRAM,       // checkTelegramCommands
+  STAGE_NET_NOTIFICATIONS,  // processPendingNotifications
+  STAGE_NET_DEBUG,          // DebugHelper::loop
+  STAGE_NET_METRICS,        // MetricsPusher::loop
+  STAGE_NET_HISTORY,        // HistoryStore::loop (sampling + checkpoints)
+  STAGE_NET_MOISTURE,       // MoistureSensors::loop (ADC oversampling)
+  STAGE_NET_DNS,            // DnsCache::loop (background refresh)
+  LOOP_STAGE_COUNT
+};
+
+inline const char *loopStageToString(int stage) {
+  switch (stage) {
+  case STAGE_IDLE: return "idle";
+  case STAGE_OVERFLOW_SENSOR: return "overflow_sensor";
+  case STAGE_WATER_LEVEL: return "water_level";
+  case STAGE_SAFETY_WATCHDOG: return "safety_watchdog";
+  case STAGE_PLANT_LIGHT: return "plant_light";
+  case STAGE_AUTO_WATERING: return "auto_watering";
+  case STAGE_QUEUE: return "queue";
+  case STAGE_VALVES: return "valves";
+  case STAGE_PUBLISH: return "publish";
+  case STAGE_NET_HTTP: return "net_http";
+  case STAGE_NET_WIFI: return "net_wifi";
+  case STAGE_NET_TELEGRAM: return "net_telegram";
+  case STAGE_NET_NOTIFICATIONS: return "net_notifications";
+  case STAGE_NET_DEBUG: return "net_debug";
+  case STAGE_NET_METRICS: return "net_metrics";
+  case STAGE_NET_HISTORY: return "net_history";
+  case STAGE_NET_MOISTURE: return "net_moisture";
+  case STAGE_NET_DNS: return "net_dns";
+  default: return "unknown";
+  }
+}
+
+enum DeadlineVerdict { DEADLINE_OK = 0, DEADLINE_SOFT_MISS, DEADLINE_HARD_MISS };
+
+namespace DeadlineMonitorLogic {
+
+// Per-task bookkeeping. Written only by the owning task; read by the peer task
+// and the task-watchdog ISR, hence the volatile stage/heartbeat.
+struct TaskDeadlineState {
+  unsigned long softDeadlineMs;
+  unsigned long hardDeadlineMs;
+  unsigned long cycleStart;
+  unsigned long stageStart;
+  volatile unsigned long lastHeartbeat;
+  volatile int currentStage;
+  int slowestStage;
+  unsigned long slowestStageMs;
+  unsigned long lastCycleMs;
+  unsigned long maxCycleMs;
+  unsigned long windowMaxCycleMs; // Worst pass since the last takeWindowMax()
+  uint32_t cycles;
+  uint32_t softMisses;
+  uint32_t missesByStage[LOOP_STAGE_COUNT];
+};
+
+// Classify how long a cycle (or a silent task) took against its deadlines.
+inline DeadlineVerdict classifyElapsed(unsigned long elapsedMs,
+                                       unsigned long softMs,
+                                       unsigned long hardMs) {
+  if (elapsedMs > hardMs) return DEADLINE_HARD_MISS;
+  if (elapsedMs > softMs) return DEADLINE_SOFT_MISS;
+  return DEADLINE_OK;
+}
+
+inline void reset(TaskDeadlineState &s, unsigned long softMs,
+                  unsigned long hardMs, unsigned long now) {
+  s.softDeadlineMs = softMs;
+  s.hardDeadlineMs = hardMs;
+  s.cycleStart = now;
+  s.stageStart = now;
+  s.lastHeartbeat = now;
+  s.currentStage = STAGE_IDLE;
+  s.slowestStage = STAGE_IDLE;
+  s.slowestStageMs = 0;
+  s.lastCycleMs = 0;
+  s.maxCycleMs = 0;
+  s.windowMaxCycleMs = 0;
+  s.cycles = 0;
+  s.softMisses = 0;
+  for (int i = 0; i < LOOP_STAGE_COUNT; i++) {
+    s.missesByStage[i] = 0;
+  }
+}
+
+// Close the running stage and remember it if it is the slowest this cycle.
+inline void closeStage(TaskDeadlineState &s, unsigned long now) {
+  unsigned long spent = now - s.stageStart;
+  if (s.currentStage != STAGE_IDLE && spent >= s.slowestStageMs) {
+    s.slowestStageMs = spent;
+    s.slowestStage = s.currentStage;
+  }
+}
+
+inline void beginCycle(TaskDeadlineState &s, unsigned long now) {
+  s.cycleStart = now;
+  s.stageStart = now;
+  s.lastHeartbeat = now;
+  s.currentStage = STAGE_IDLE;
+  s.slowestStage = STAGE_IDLE;
+  s.slowestStageMs = 0;
+}
+
+inline void enterStage(TaskDeadlineState &s, int stage, unsigned long now) {
+  closeStage(s, now);
+  s.stageStart = now;
+  s.currentStage = stage;
+  s.lastHeartbeat = now;
+}
+
+// End of one pass through the task body. Returns the verdict for the cycle;
+// a soft (or worse) miss is charged to the slowest stage of the cycle.
+inline DeadlineVerdict endCycle(TaskDeadlineState &s, unsigned long now) {
+  closeStage(s, now);
+  unsigned long elapsed = now - s.cycleStart;
+  s.lastCycleMs = elapsed;
+  if (elapsed > s.maxCycleMs) s.maxCycleMs = elapsed;
+  if (elapsed > s.windowMaxCycleMs) s.windowMaxCycleMs = elapsed;
+  // Read from the other core (RuntimeConfig waits for a control pass to end)
+  __atomic_store_n(&s.cycles, s.cycles + 1, __ATOMIC_RELEASE);
+  s.currentStage = STAGE_IDLE;
+  s.stageStart = now;
+  s.lastHeartbeat = now;
+
+  DeadlineVerdict verdict =
+      classifyElapsed(elapsed, s.softDeadlineMs, s.hardDeadlineMs);
+  if (verdict != DEADLINE_OK) {
+    s.softMisses++;
+    s.missesByStage[s.slowestStage]++;
+  }
+  return verdict;
+}
+
+// Worst pass since the previous call (used for periodic loop-latency samples).
+inline unsigned long takeWindowMax(TaskDeadlineState &s) {
+  unsigned long worst = s.windowMaxCycleMs;
+  s.windowMaxCycleMs = 0;
+  return worst;
+}
+
+// True when the task has not checked in for longer than its hard deadline.
+// Unsigned subtraction keeps this correct across the millis() rollover.
+inline bool isStalled(const TaskDeadlineState &s, unsigned long now) {
+  return (now - s.lastHeartbeat) > s.hardDeadlineMs;
+}
+
+} // namespace DeadlineMonitorLogic
+
+#endif // DEADLINE_MONITOR_LOGIC_H
@@ -6,6 +6,7 @@
 #include "config.h"
 #include "secret.h"
 #include "DS3231RTC.h"
+#include "LogLevelLogic.h"
 
 // Forward declaration
 extern bool sendTelegramDebug(const String& msg);
@@ -42,6 +43,9 @@ private:
     static unsigned long lastGroupMessageTime;
     static unsigned long firstGroupMessageTime;  // Track when group started (for max age)
 
+    // Runtime level per LogSubsystem (written by API/Telegram, read by DLOG_*)
+    static uint8_t logLevels[LOG_SYS_COUNT];
+
 public:
     // Get current timestamp with milliseconds (using system time)
     static String getCurrentTimestamp() {
@@ -183,6 +187,69 @@ public:
         if (g_metricsLog) g_metricsLog("warn", message);
     }
 
+    // ============================================
+    // Level-gated logging (DLOG_* macros)
+    // ============================================
+
+    // True if a line at this level would reach at least one sink. Checked by
+    // the macros BEFORE the message expression is built.
+    static inline bool isEnabled(LogSubsystem subsystem, LogLevel level) {
+        if (level < logLevels[subsystem]) return false;
+        #if IS_DEBUG_TO_SERIAL_ENABLED
+        return true;
+        #else
+        // Below warn only Loki consumes the line
+        return level >= LOG_LEVEL_WARN || g_metricsLog != nullptr;
+        #endif
+    }
+
+    // warn/error keep the debugImportant() route (Telegram + Loki)
+    static void log(LogLevel level, const String& message, uint32_t suppressed = 0) {
+        if (suppressed == 0) {
+            if (level >= LOG_LEVEL_WARN) debugImportant(message);
+            else debug(message);
+            return;
+        }
+        String line = message + " (+" + String(suppressed) + " suppressed)";
+        if (level >= LOG_LEVEL_WARN) debugImportant(line);
+        else debug(line);
+    }
+
+    static LogLevel getLogLevel(LogSubsystem subsystem) {
+        return (LogLevel)logLevels[subsystem];
+    }
+
+    // subsystem == LOG_SYS_COUNT sets every subsystem
+    static void setLogLevel(int subsystem, LogLevel level) {
+        if (subsystem == LOG_SYS_COUNT) {
+            for (int s = 0; s < LOG_SYS_COUNT; s++) logLevels[s] = level;
+        } else if (subsystem >= 0 && subsystem < LOG_SYS_COUNT) {
+            logLevels[subsystem] = level;
+        }
+    }
+
+    // One "subsystem = level" per line (Telegram /loglevel)
+    static String getLogLevelsText() {
+        String text;
+        for (int s = 0; s < LOG_SYS_COUNT; s++) {
+            if (s > 0) text += "\n";
+            text += String(LogLevelLogic::subsystemName(s)) + " = " +
+                    LogLevelLogic::levelName(logLevels[s]);
+        }
+        return text;
+    }
+
+    static String getLogLevelsJson() {
+        String json = "{";
+        for (int s = 0; s < LOG_SYS_COUNT; s++) {
+            if (s > 0) json += ",";
+            json += "\"" + String(LogLevelLogic::subsystemName(s)) + "\":\"" +
+                    LogLevelLogic::levelName(logLevels[s]) + "\"";
+        }
+        json += "}";
+        return json;
+    }
+
     // Process queue - call this in main loop
     static void loop() {
         #if !IS_DEBUG_TO_TELEGRAM_ENABLED
@@ -331,5 +398,39 @@ unsigned long DebugHelper::lastProcessTime = 0;
 String DebugHelper::groupingBuffer = "";
 unsigned long DebugHelper::lastGroupMessageTime = 0;
 unsigned long DebugHelper::firstGroupMessageTime = 0;
+uint8_t DebugHelper::logLevels[LOG_SYS_COUNT] = {
+    LOG_DEFAULT_LEVEL, LOG_DEFAULT_LEVEL, LOG_DEFAULT_LEVEL,
+    LOG_DEFAULT_LEVEL, LOG_DEFAULT_LEVEL, LOG_DEFAULT_LEVEL};
+
+// ============================================
+// Level-gated logging macros
+// ============================================
+// The message argument is only evaluated when the level is enabled, so
+// String concatenation and sensor formatting cost nothing when filtered:
+//   DLOG_DEBUG(LOG_SYS_VALVE, "Valve " + String(i) + ": " + String(t) + "s");
+#define DLOG_AT(subsystem, level, message)                                   \
+    do {                                                                     \
+        if (DebugHelper::isEnabled((subsystem), (level))) {                  \
+            DebugHelper::log((level), (message));                            \
+        }                                                                    \
+    } while (0)
+
+#define DLOG_DEBUG(subsystem, message) DLOG_AT(subsystem, LOG_LEVEL_DEBUG, message)
+#define DLOG_INFO(subsystem, message) DLOG_AT(subsystem, LOG_LEVEL_INFO, message)
+#define DLOG_WARN(subsystem, message) DLOG_AT(subsystem, LOG_LEVEL_WARN, message)
+
+// At most one line per intervalMs from this call site; the emitted line
+// reports how many were swallowed in between.
+#define DLOG_EVERY(subsystem, level, intervalMs, message)                    \
+    do {                                                                     \
+        if (DebugHelper::isEnabled((subsystem), (level))) {                  \
+            static LogLevelLogic::RateLimit dlogLimit_ = {0, 0, false};      \
+            uint32_t dlogSuppressed_ = 0;                                    \
+            if (LogLevelLogic::allow(dlogLimit_, millis(), (intervalMs),     \
+                                     dlogSuppressed_)) {                     \
+                DebugHelper::log((level), (message), dlogSuppressed_);       \
+            }                                                                \
+        }                                                                    \
+    } while (0)
 
 #endif // DEBUG_HELPER_H
@@ -0,0 +1,165 @@
+#ifndef DELTA_OTA_UPDATER_H
+#define DELTA_OTA_UPDATER_H
+
+#include <Arduino.h>
+#include <Update.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <mbedtls/sha256.h>
+#include "DeltaPatchLogic.h"
+
+// ============================================
+// DeltaOtaUpdater - applies a delta patch from the /firmware upload stream
+// Header-only static class (same pattern as DebugHelper)
+//
+// Source bytes come from the running app partition, the reconstructed image is
+// streamed through Update into the inactive OTA slot. The image only becomes
+// bootable when both the source hash (before writing) and the target hash
+// (after the last byte) match the patch header; otherwise the update is
+// aborted and the client is expected to fall back to the full image.
+// ============================================
+class DeltaOtaUpdater {
+private:
+    static DeltaPatchLogic::PatchDecoder decoder;
+    static mbedtls_sha256_context targetSha;
+    static const esp_partition_t* sourcePartition;
+    static bool active;
+    static bool updateStarted;
+    static String lastError;
+
+    static bool readSource(void* ctx, uint32_t offset, uint8_t* buf, size_t len) {
+        (void)ctx;
+        return esp_partition_read(sourcePartition, offset, buf, len) == ESP_OK;
+    }
+
+    static bool writeOutput(void* ctx, const uint8_t* buf, size_t len) {
+        (void)ctx;
+        mbedtls_sha256_update_ret(&targetSha, buf, len);
+        return Update.write(const_cast<uint8_t*>(buf), len) == len;
+    }
+
+    static bool verifySourceHash() {
+        uint8_t digest[32];
+        uint8_t buf[DeltaPatchLogic::PATCH_SCRATCH_SIZE];
+        mbedtls_sha256_context sha;
+        mbedtls_sha256_init(&sha);
+        mbedtls_sha256_starts_ret(&sha, 0);
+        uint32_t size = decoder.header.sourceSize;
+        bool ok = size <= sourcePartition->size;
+        for (uint32_t offset = 0; ok && offset < size; offset += sizeof(buf)) {
+            size_t n = (size - offset) < sizeof(buf) ? (size - offset) : sizeof(buf);
+            ok = esp_partition_read(sourcePartition, offset, buf, n) == ESP_OK;
+            if (ok) mbedtls_sha256_update_ret(&sha, buf, n);
+        }
+        mbedtls_sha256_finish_ret(&sha, digest);
+        mbedtls_sha256_free(&sha);
+        return ok && memcmp(digest, decoder.header.sourceSha256, 32) == 0;
+    }
+
+    static bool abortWith(const String& error) {
+        lastError = error;
+        if (updateStarted) Update.abort();
+        updateStarted = false;
+        active = false;
+        mbedtls_sha256_free(&targetSha);
+        Serial.println("Delta update failed: " + error);
+        return false;
+    }
+
+public:
+    static bool isPatch(const uint8_t* data, size_t len) {
+        return DeltaPatchLogic::hasPatchMagic(data, len);
+    }
+
+    static bool isActive() { return active; }
+    static const String& getLastError() { return lastError; }
+
+    static bool begin() {
+        lastError = "";
+        updateStarted = false;
+        sourcePartition = esp_ota_get_running_partition();
+        if (!sourcePartition) {
+            lastError = "running partition not found";
+            return false;
+        }
+        DeltaPatchLogic::begin(decoder, readSource, writeOutput, nullptr);
+        mbedtls_sha256_init(&targetSha);
+        mbedtls_sha256_starts_ret(&targetSha, 0);
+        active = true;
+        Serial.printf("Delta update: source partition %s\n", sourcePartition->label);
+        return true;
+    }
+
+    static bool write(const uint8_t* data, size_t len) {
+        if (!active) return false;
+        bool hadHeader = DeltaPatchLogic::headerReady(decoder);
+        size_t consumed = 0;
+
+        // The header must be validated before the first output byte is produced,
+        // so feed it on its own first.
+        if (!hadHeader) {
+            size_t need = DeltaPatchLogic::PATCH_HEADER_SIZE - decoder.headerFill;
+            consumed = need < len ? need : len;
+            if (!DeltaPatchLogic::feed(decoder, data, consumed)) {
+                return abortWith(decoder.error);
+            }
+            if (!DeltaPatchLogic::headerReady(decoder)) return true;
+
+            if (!verifySourceHash()) {
+                return abortWith("patch was built for a different running firmware");
+            }
+            if (!Update.begin(decoder.header.targetSize, U_FLASH)) {
+                return abortWith("Update.begin failed: " + String(Update.errorString()));
+            }
+            updateStarted = true;
+            Serial.printf("Delta update: %u -> %u bytes\n",
+                          (unsigned)decoder.header.sourceSize,
+                          (unsigned)decoder.header.targetSize);
+        }
+
+        if (consumed < len && !DeltaPatchLogic::feed(decoder, data + consumed, len - consumed)) {
+            return abortWith(decoder.error ? decoder.error : "patch decode failed");
+        }
+        return true;
+    }
+
+    // Finish after the last upload chunk: verify the reconstructed image and
+    // mark it bootable. Returns false (update aborted) on any mismatch.
+    static bool end() {
+        if (!active) return false;
+        if (!DeltaPatchLogic::isComplete(decoder)) {
+            return abortWith("patch truncated");
+        }
+        uint8_t digest[32];
+        mbedtls_sha256_finish_ret(&targetSha, digest);
+        if (memcmp(digest, decoder.header.targetSha256, 32) != 0) {
+            return abortWith("reconstructed image SHA-256 mismatch");
+        }
+        mbedtls_sha256_free(&targetSha);
+        active = false;
+        if (!Update.end(true)) {
+            updateStarted = false;
+            lastError = "Update.end failed: " + String(Update.errorString());
+            return false;
+        }
+        updateStarted = false;
+        Serial.printf("Delta update success: %u bytes verified\n", (unsigned)decoder.outCount);
+        return true;
+    }
+
+    static void abort() {
+        if (active) abortWith("upload aborted");
+    }
+};
+
+// ============================================
+// Static Member Initialization
+// ============================================
+DeltaPatchLogic::PatchDecoder DeltaOtaUpdater::decoder;
+mbedtls_sha256_context DeltaOtaUpdater::targetSha;
+const esp_partition_t* DeltaOtaUpdater::sourcePartition = nullptr;
+bool DeltaOtaUpdater::active = false;
+bool DeltaOtaUpdater::updateStarted = false;
+String DeltaOtaUpdater::lastError = "";
+
+#endif // DELTA_OTA_UPDATER_H
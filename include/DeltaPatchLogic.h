@@ -0,0 +1,283 @@
+#ifndef DELTA_PATCH_LOGIC_H
+#define DELTA_PATCH_LOGIC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Pure, hardware-free streaming decoder for firmware delta patches, shared by
+// the firmware (DeltaOtaUpdater.h) and the native test suite. Patches are
+// produced by tools/make_delta_patch.py.
+//
+// The format follows bsdiff's idea -- most of a new build is the old build with
+// a few bytes changed (relocated addresses, a bumped version string) -- but
+// replaces bsdiff's bzip2 stage with a sparse encoding of the diff bytes so the
+// decoder needs no decompressor and no RAM beyond a small scratch buffer:
+//
+//   header (80 bytes, little-endian)
+//     "WDP1" | targetSize u32 | sourceSize u32 | sourceSha256[32] |
+//     targetSha256[32] | reserved u32
+//   records, each starting with an opcode byte
+//     0x01 COPY   varint srcOffset, varint length, then diff runs covering
+//                 `length` output bytes: varint zeroRun (bytes copied from the
+//                 source unchanged), varint litCount, litCount bytes added
+//                 (mod 256) to the following source bytes
+//     0x02 INSERT varint length, then `length` raw bytes
+//     0x00 END
+//
+// The source is the running firmware partition; output goes to the inactive
+// OTA slot. Hash checks are left to the caller.
+namespace DeltaPatchLogic {
+
+const size_t PATCH_HEADER_SIZE = 80;
+const uint8_t PATCH_MAGIC[4] = {'W', 'D', 'P', '1'};
+const uint8_t OP_END = 0x00;
+const uint8_t OP_COPY = 0x01;
+const uint8_t OP_INSERT = 0x02;
+const size_t PATCH_SCRATCH_SIZE = 256;
+
+// Read `len` bytes of the running image at `offset`.
+typedef bool (*SourceReadFn)(void *ctx, uint32_t offset, uint8_t *buf, size_t len);
+// Append `len` reconstructed bytes to the new image.
+typedef bool (*OutputWriteFn)(void *ctx, const uint8_t *buf, size_t len);
+
+enum DecoderState {
+  DP_HEADER = 0,
+  DP_OPCODE,
+  DP_COPY_OFFSET,
+  DP_COPY_LENGTH,
+  DP_DIFF_ZERO_RUN,
+  DP_DIFF_LIT_COUNT,
+  DP_DIFF_LITERALS,
+  DP_INSERT_LENGTH,
+  DP_INSERT_DATA,
+  DP_DONE,
+  DP_ERROR
+};
+
+struct PatchHeader {
+  uint32_t targetSize;
+  uint32_t sourceSize;
+  uint8_t sourceSha256[32];
+  uint8_t targetSha256[32];
+};
+
+struct PatchDecoder {
+  DecoderState state;
+  const char *error;
+  uint8_t headerBuf[PATCH_HEADER_SIZE];
+  size_t headerFill;
+  PatchHeader header;
+
+  uint32_t varint;        // Varint being assembled
+  uint8_t varintShift;
+  uint32_t srcPos;        // Next source byte for the current COPY
+  uint32_t copyRemaining; // Output bytes left in the current COPY
+  uint32_t runRemaining;  // Bytes left in current zero run / literal run / INSERT
+  uint32_t outCount;      // Bytes written so far
+
+  SourceReadFn readSource;
+  OutputWriteFn writeOutput;
+  void *ctx;
+  uint8_t scratch[PATCH_SCRATCH_SIZE];
+};
+
+inline bool hasPatchMagic(const uint8_t *data, size_t len) {
+  return len >= 4 && memcmp(data, PATCH_MAGIC, 4) == 0;
+}
+
+inline uint32_t readLe32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+inline void begin(PatchDecoder &d, SourceReadFn readSource,
+                  OutputWriteFn writeOutput, void *ctx) {
+  memset(&d, 0, sizeof(d));
+  d.state = DP_HEADER;
+  d.readSource = readSource;
+  d.writeOutput = writeOutput;
+  d.ctx = ctx;
+}
+
+inline bool fail(PatchDecoder &d, const char *error) {
+  d.state = DP_ERROR;
+  d.error = error;
+  return false;
+}
+
+inline bool headerReady(const PatchDecoder &d) {
+  return d.state != DP_HEADER && d.state != DP_ERROR;
+}
+
+// Feed one varint byte. Returns true when the varint is complete.
+inline bool feedVarint(PatchDecoder &d, uint8_t byte) {
+  if (d.varintShift > 28) {
+    fail(d, "varint too long");
+    return false;
+  }
+  d.varint |= (uint32_t)(byte & 0x7F) << d.varintShift;
+  d.varintShift += 7;
+  if (byte & 0x80) return false;
+  d.varintShift = 0;
+  return true;
+}
+
+inline uint32_t takeVarint(PatchDecoder &d) {
+  uint32_t v = d.varint;
+  d.varint = 0;
+  return v;
+}
+
+inline bool emit(PatchDecoder &d, const uint8_t *buf, size_t len) {
+  if ((uint64_t)d.outCount + len > d.header.targetSize) {
+    return fail(d, "output exceeds target size");
+  }
+  if (!d.writeOutput(d.ctx, buf, len)) return fail(d, "output write failed");
+  d.outCount += len;
+  return true;
+}
+
+inline bool readSource(PatchDecoder &d, uint32_t offset, uint8_t *buf, size_t len) {
+  if ((uint64_t)offset + len > d.header.sourceSize) {
+    return fail(d, "copy outside source image");
+  }
+  if (!d.readSource(d.ctx, offset, buf, len)) return fail(d, "source read failed");
+  return true;
+}
+
+// Copy `len` unchanged source bytes to the output.
+inline bool copyZeroRun(PatchDecoder &d, uint32_t len) {
+  while (len > 0) {
+    size_t n = len < PATCH_SCRATCH_SIZE ? len : PATCH_SCRATCH_SIZE;
+    if (!readSource(d, d.srcPos, d.scratch, n)) return false;
+    if (!emit(d, d.scratch, n)) return false;
+    d.srcPos += n;
+    len -= n;
+  }
+  return true;
+}
+
+// After a COPY's diff run completes, pick the next state.
+inline void nextDiffRun(PatchDecoder &d) {
+  d.state = (d.copyRemaining == 0) ? DP_OPCODE : DP_DIFF_ZERO_RUN;
+}
+
+inline bool parseHeader(PatchDecoder &d) {
+  if (!hasPatchMagic(d.headerBuf, PATCH_HEADER_SIZE)) return fail(d, "bad patch magic");
+  d.header.targetSize = readLe32(d.headerBuf + 4);
+  d.header.sourceSize = readLe32(d.headerBuf + 8);
+  memcpy(d.header.sourceSha256, d.headerBuf + 12, 32);
+  memcpy(d.header.targetSha256, d.headerBuf + 44, 32);
+  if (d.header.targetSize == 0) return fail(d, "empty target");
+  d.state = DP_OPCODE;
+  return true;
+}
+
+// Consume the next chunk of patch bytes. Returns false on a malformed patch or
+// an I/O failure (see d.error). May be called with arbitrarily sized chunks.
+inline bool feed(PatchDecoder &d, const uint8_t *data, size_t len) {
+  size_t i = 0;
+  while (i < len) {
+    switch (d.state) {
+    case DP_HEADER: {
+      size_t n = PATCH_HEADER_SIZE - d.headerFill;
+      if (n > len - i) n = len - i;
+      memcpy(d.headerBuf + d.headerFill, data + i, n);
+      d.headerFill += n;
+      i += n;
+      if (d.headerFill == PATCH_HEADER_SIZE && !parseHeader(d)) return false;
+      break;
+    }
+    case DP_OPCODE: {
+      uint8_t op = data[i++];
+      if (op == OP_COPY) {
+        d.state = DP_COPY_OFFSET;
+      } else if (op == OP_INSERT) {
+        d.state = DP_INSERT_LENGTH;
+      } else if (op == OP_END) {
+        if (d.outCount != d.header.targetSize) return fail(d, "patch ended early");
+        d.state = DP_DONE;
+      } else {
+        return fail(d, "unknown opcode");
+      }
+      break;
+    }
+    case DP_COPY_OFFSET:
+      if (feedVarint(d, data[i++])) {
+        d.srcPos = takeVarint(d);
+        d.state = DP_COPY_LENGTH;
+      }
+      break;
+    case DP_COPY_LENGTH:
+      if (feedVarint(d, data[i++])) {
+        d.copyRemaining = takeVarint(d);
+        nextDiffRun(d);
+      }
+      break;
+    case DP_DIFF_ZERO_RUN:
+      if (feedVarint(d, data[i++])) {
+        uint32_t run = takeVarint(d);
+        if (run > d.copyRemaining) return fail(d, "diff run overflows copy");
+        if (!copyZeroRun(d, run)) return false;
+        d.copyRemaining -= run;
+        d.state = DP_DIFF_LIT_COUNT;
+      }
+      break;
+    case DP_DIFF_LIT_COUNT:
+      if (feedVarint(d, data[i++])) {
+        d.runRemaining = takeVarint(d);
+        if (d.runRemaining > d.copyRemaining) return fail(d, "diff run overflows copy");
+        if (d.runRemaining == 0) {
+          nextDiffRun(d);
+        } else {
+          d.state = DP_DIFF_LITERALS;
+        }
+      }
+      break;
+    case DP_DIFF_LITERALS: {
+      size_t n = d.runRemaining;
+      if (n > len - i) n = len - i;
+      if (n > PATCH_SCRATCH_SIZE) n = PATCH_SCRATCH_SIZE;
+      if (!readSource(d, d.srcPos, d.scratch, n)) return false;
+      for (size_t k = 0; k < n; k++) {
+        d.scratch[k] = (uint8_t)(d.scratch[k] + data[i + k]);
+      }
+      if (!emit(d, d.scratch, n)) return false;
+      i += n;
+      d.srcPos += n;
+      d.runRemaining -= n;
+      d.copyRemaining -= n;
+      if (d.runRemaining == 0) nextDiffRun(d);
+      break;
+    }
+    case DP_INSERT_LENGTH:
+      if (feedVarint(d, data[i++])) {
+        d.runRemaining = takeVarint(d);
+        d.state = (d.runRemaining == 0) ? DP_OPCODE : DP_INSERT_DATA;
+      }
+      break;
+    case DP_INSERT_DATA: {
+      size_t n = d.runRemaining;
+      if (n > len - i) n = len - i;
+      if (!emit(d, data + i, n)) return false;
+      i += n;
+      d.runRemaining -= n;
+      if (d.runRemaining == 0) d.state = DP_OPCODE;
+      break;
+    }
+    case DP_DONE:
+      return fail(d, "trailing data after END");
+    case DP_ERROR:
+      return false;
+    }
+    if (d.state == DP_ERROR) return false;
+  }
+  return true;
+}
+
+inline bool isComplete(const PatchDecoder &d) { return d.state == DP_DONE; }
+
+} // namespace DeltaPatchLogic
+
+#endif // DELTA_PATCH_LOGIC_H
@@ -0,0 +1,178 @@
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <WiFiClientSecure.h>
+#include <esp_system.h>
+#include "config.h"
+#include "DebugHelper.h"
+#include "BinaryLog.h"
+#include "DnsCacheLogic.h"
+
+// ============================================
+// DnsCache - shared TTL cache for outbound hostnames
+// Header-only static class (same pattern as DebugHelper)
+//
+// Telegram and the metrics proxy connect through DnsCachedClient /
+// DnsCachedSecureClient, which resolve the URL host here and connect to the
+// IP (TLS still gets the hostname for SNI, HTTP keeps its Host header). A
+// fresh entry costs nothing; loop() refreshes entries in their prefetch
+// window so the request path rarely queries; when the resolver is down the
+// last-known IP is served. Network task (Core 0) only, like its callers.
+// ============================================
+class DnsCache {
+private:
+    static DnsCacheLogic::Entry entries[DNS_CACHE_SIZE];
+    static const DnsCacheLogic::Policy policy;
+    static uint32_t hits;
+    static uint32_t misses;
+    static uint32_t prefetches;
+    static uint32_t staleServed;
+    static uint32_t failures;
+
+    // One UDP round trip to the DHCP/static resolver
+    static bool query(const char* host, uint32_t& ip, uint32_t& ttlS) {
+        IPAddress server = WiFi.dnsIP();
+        if ((uint32_t)server == 0) return false;
+
+        uint8_t buf[DnsCacheLogic::MAX_MESSAGE_SIZE];
+        uint16_t id = (uint16_t)esp_random();
+        int len = DnsCacheLogic::buildQuery(id, host, buf, sizeof(buf));
+        if (len == 0) return false;
+
+        WiFiUDP udp;
+        if (!udp.begin(0)) return false;
+        bool ok = false;
+        if (udp.beginPacket(server, 53) && udp.write(buf, len) == (size_t)len && udp.endPacket()) {
+            unsigned long start = millis();
+            while (millis() - start < DNS_QUERY_TIMEOUT_MS) {
+                int size = udp.parsePacket();
+                if (size > 0) {
+                    int n = udp.read(buf, sizeof(buf));
+                    DnsCacheLogic::ParseResult r = DnsCacheLogic::parseResponse(buf, n, id, ip, ttlS);
+                    if (r == DnsCacheLogic::PARSE_OK) ok = true;
+                    if (r != DnsCacheLogic::PARSE_BAD) break;  // Wrong id / junk: keep waiting
+                }
+                delay(5);
+            }
+        }
+        udp.stop();
+        return ok;
+    }
+
+    static bool refresh(DnsCacheLogic::Entry& e, unsigned long now) {
+        uint32_t ip = 0;
+        uint32_t ttlS = 0;
+        if (query(e.host, ip, ttlS)) {
+            DnsCacheLogic::onResolved(e, ip, ttlS, now, policy);
+            return true;
+        }
+        DnsCacheLogic::onFailed(e, millis());
+        failures++;
+        return false;
+    }
+
+public:
+    // Host (or dotted IP) -> address for a connect() about to happen.
+    static bool resolve(const char* host, IPAddress& out) {
+        if (out.fromString(host)) return true;
+
+        unsigned long now = millis();
+        int slot = DnsCacheLogic::find(entries, DNS_CACHE_SIZE, host);
+        if (slot >= 0) {
+            DnsCacheLogic::Entry& e = entries[slot];
+            e.lastUsedAt = now;
+            DnsCacheLogic::Freshness f = DnsCacheLogic::freshness(e, now, policy);
+            if (f == DnsCacheLogic::FRESH || f == DnsCacheLogic::PREFETCH) {
+                hits++;
+                out = IPAddress(e.ip);
+                return true;
+            }
+            if (f == DnsCacheLogic::STALE) {
+                // Expired and the background refresh has been failing: last-known IP
+                staleServed++;
+                out = IPAddress(e.ip);
+                return true;
+            }
+        }
+
+        misses++;
+        slot = DnsCacheLogic::slotFor(entries, DNS_CACHE_SIZE, host, now);
+        if (slot >= 0 && refresh(entries[slot], now)) {
+            out = IPAddress(entries[slot].ip);
+            return true;
+        }
+
+        // Our query failed (e.g. a truncated answer): let lwIP try once
+        if (WiFi.hostByName(host, out) == 1) {
+            if (slot >= 0) DnsCacheLogic::onResolved(entries[slot], (uint32_t)out, 0, millis(), policy);
+            return true;
+        }
+        BLOG_WARN("DNS: cannot resolve %s", host);
+        return false;
+    }
+
+    // Network task, every pass: refresh at most one entry before it expires.
+    static void loop() {
+        unsigned long now = millis();
+        for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+            DnsCacheLogic::Entry& e = entries[i];
+            if (!DnsCacheLogic::refreshDue(e, now, policy)) continue;
+            prefetches++;
+            if (!refresh(e, now) && e.failures == 1) {
+                DebugHelper::debug("⚠️ DNS refresh failed for " + String(e.host) + ", serving last-known " +
+                                   IPAddress(e.ip).toString());
+            }
+            return;
+        }
+    }
+
+    // ========== Metrics ==========
+    static uint32_t getHits() { return hits; }
+    static uint32_t getMisses() { return misses; }
+    static uint32_t getPrefetches() { return prefetches; }
+    static uint32_t getStaleServed() { return staleServed; }
+    static uint32_t getFailures() { return failures; }
+};
+
+// ============================================
+// Clients that resolve through DnsCache
+// HTTPClient::begin(client, url) connects with connect(host, port, timeout).
+// ============================================
+class DnsCachedClient : public WiFiClient {
+public:
+    using WiFiClient::connect;
+    int connect(const char* host, uint16_t port, int32_t timeout) override {
+        IPAddress ip;
+        if (!DnsCache::resolve(host, ip)) return 0;
+        return WiFiClient::connect(ip, port, timeout);
+    }
+};
+
+class DnsCachedSecureClient : public WiFiClientSecure {
+public:
+    using WiFiClientSecure::connect;
+    int connect(const char* host, uint16_t port, int32_t timeout) override {
+        IPAddress ip;
+        if (!DnsCache::resolve(host, ip)) return 0;
+        _timeout = timeout;
+        return WiFiClientSecure::connect(ip, port, host, _CA_cert, _cert, _private_key);  // host = SNI
+    }
+};
+
+// ============================================
+// Static Member Initialization
+// ============================================
+DnsCacheLogic::Entry DnsCache::entries[DNS_CACHE_SIZE] = {};
+const DnsCacheLogic::Policy DnsCache::policy = {
+    DNS_CACHE_MIN_TTL_S * 1000UL, DNS_CACHE_MAX_TTL_S * 1000UL, DNS_CACHE_PREFETCH_MS,
+    DNS_CACHE_STALE_MAX_S * 1000UL, DNS_RETRY_BASE_MS, DNS_RETRY_MAX_MS};
+uint32_t DnsCache::hits = 0;
+uint32_t DnsCache::misses = 0;
+uint32_t DnsCache::prefetches = 0;
+uint32_t DnsCache::staleServed = 0;
+uint32_t DnsCache::failures = 0;
+
+#endif // DNS_CACHE_H
@@ -0,0 +1,221 @@
+#ifndef DNS_CACHE_LOGIC_H
+#define DNS_CACHE_LOGIC_H
+
+#include <stdint.h>
+#include <string.h>
+
+// DNS A-record lookups and a small TTL cache, hardware-free. DnsCache.h sends
+// the queries over UDP to the DHCP-provided resolver and keeps the entries
+// that every outbound HTTP client resolves through.
+//
+// The lwIP resolver behind WiFi.hostByName() does not expose record TTLs and
+// forgets a name on expiry, so a resolver outage fails every request. Here an
+// entry is served from cache while fresh, refreshed in the background during
+// its last prefetch window, and, if the refresh keeps failing, served stale
+// (last-known IP) for up to staleMaxMs while retries back off.
+namespace DnsCacheLogic {
+
+// ============================================
+// Wire format (RFC 1035), one A question per message
+// ============================================
+static const uint16_t TYPE_A = 1;
+static const uint16_t CLASS_IN = 1;
+static const int HEADER_SIZE = 12;
+static const int MAX_MESSAGE_SIZE = 512;  // Plain UDP DNS
+
+inline void put16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)(v >> 8);
+  p[1] = (uint8_t)v;
+}
+
+inline uint16_t get16(const uint8_t *p) { return (uint16_t)((p[0] << 8) | p[1]); }
+
+inline uint32_t get32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+// Recursive query for host's A record. Returns the message length, or 0 if
+// the name is empty, has an empty or >63-byte label, or doesn't fit.
+inline int buildQuery(uint16_t id, const char *host, uint8_t *buf, int size) {
+  int hostLen = (int)strlen(host);
+  if (hostLen == 0 || hostLen > 253 || size < HEADER_SIZE + hostLen + 2 + 4) return 0;
+  memset(buf, 0, HEADER_SIZE);
+  put16(buf, id);
+  put16(buf + 2, 0x0100);  // RD
+  put16(buf + 4, 1);       // QDCOUNT
+  int pos = HEADER_SIZE;
+  const char *label = host;
+  while (true) {
+    const char *dot = strchr(label, '.');
+    int labelLen = dot ? (int)(dot - label) : (int)strlen(label);
+    if (labelLen == 0) {
+      if (dot == nullptr && label != host) break;  // Trailing dot
+      return 0;
+    }
+    if (labelLen > 63) return 0;
+    buf[pos++] = (uint8_t)labelLen;
+    memcpy(buf + pos, label, labelLen);
+    pos += labelLen;
+    if (dot == nullptr) break;
+    label = dot + 1;
+  }
+  buf[pos++] = 0;
+  put16(buf + pos, TYPE_A);
+  put16(buf + pos + 2, CLASS_IN);
+  return pos + 4;
+}
+
+// Position after the (possibly compressed) name at pos, or -1 if malformed.
+inline int skipName(const uint8_t *msg, int len, int pos) {
+  while (pos < len) {
+    uint8_t n = msg[pos];
+    if (n == 0) return pos + 1;
+    if ((n & 0xC0) == 0xC0) return pos + 2 <= len ? pos + 2 : -1;  // Pointer ends the name
+    if (n & 0xC0) return -1;
+    pos += 1 + n;
+  }
+  return -1;
+}
+
+enum ParseResult { PARSE_OK, PARSE_NO_ADDRESS, PARSE_BAD };
+
+// First A record of a response to query `id`. `ip` is in network byte order
+// as stored in memory (the lwIP / IPAddress(uint32_t) layout); `ttlS` is the
+// smallest TTL along the answer chain, so a short-lived CNAME limits it too.
+inline ParseResult parseResponse(const uint8_t *msg, int len, uint16_t id, uint32_t &ip, uint32_t &ttlS) {
+  if (len < HEADER_SIZE || get16(msg) != id) return PARSE_BAD;
+  uint16_t flags = get16(msg + 2);
+  if (!(flags & 0x8000) || (flags & 0x0200)) return PARSE_BAD;  // Not a response, or truncated
+  uint16_t rcode = flags & 0x000F;
+  if (rcode == 3) return PARSE_NO_ADDRESS;                       // NXDOMAIN
+  if (rcode != 0) return PARSE_BAD;
+
+  int pos = HEADER_SIZE;
+  for (uint16_t q = get16(msg + 4); q > 0; q--) {
+    pos = skipName(msg, len, pos);
+    if (pos < 0 || pos + 4 > len) return PARSE_BAD;
+    pos += 4;
+  }
+
+  uint32_t minTtl = 0xFFFFFFFFUL;
+  for (uint16_t a = get16(msg + 6); a > 0; a--) {
+    pos = skipName(msg, len, pos);
+    if (pos < 0 || pos + 10 > len) return PARSE_BAD;
+    uint16_t type = get16(msg + pos);
+    uint16_t klass = get16(msg + pos + 2);
+    uint32_t ttl = get32(msg + pos + 4);
+    uint16_t rdLen = get16(msg + pos + 8);
+    pos += 10;
+    if (pos + rdLen > len) return PARSE_BAD;
+    if (klass == CLASS_IN && ttl < minTtl) minTtl = ttl;
+    if (type == TYPE_A && klass == CLASS_IN && rdLen == 4) {
+      memcpy(&ip, msg + pos, 4);
+      ttlS = minTtl;
+      return PARSE_OK;
+    }
+    pos += rdLen;
+  }
+  return PARSE_NO_ADDRESS;
+}
+
+// ============================================
+// Cache policy
+// ============================================
+static const int MAX_HOST_LEN = 64;
+
+struct Entry {
+  char host[MAX_HOST_LEN];
+  uint32_t ip;                  // Network byte order, as IPAddress(uint32_t)
+  unsigned long resolvedAt;     // Last successful answer
+  unsigned long ttlMs;          // Clamped record TTL
+  unsigned long lastUsedAt;
+  unsigned long lastAttemptAt;  // Last failed refresh
+  uint16_t failures;            // Consecutive failed refreshes
+  bool valid;
+};
+
+struct Policy {
+  unsigned long minTtlMs;
+  unsigned long maxTtlMs;
+  unsigned long prefetchMs;  // Refresh in the background this long before expiry
+  unsigned long staleMaxMs;  // Serve the last-known IP this long past expiry
+  unsigned long retryBaseMs;
+  unsigned long retryMaxMs;
+};
+
+inline unsigned long clampTtlMs(uint32_t ttlS, const Policy &p) {
+  unsigned long ms = ttlS > 0xFFFFFFFFUL / 1000 ? 0xFFFFFFFFUL : ttlS * 1000UL;
+  if (ms < p.minTtlMs) return p.minTtlMs;
+  if (ms > p.maxTtlMs) return p.maxTtlMs;
+  return ms;
+}
+
+enum Freshness { FRESH, PREFETCH, STALE, DEAD };
+
+inline Freshness freshness(const Entry &e, unsigned long now, const Policy &p) {
+  if (!e.valid) return DEAD;
+  unsigned long age = now - e.resolvedAt;
+  unsigned long prefetchAt = e.ttlMs > p.prefetchMs ? e.ttlMs - p.prefetchMs : e.ttlMs / 2;
+  if (age < prefetchAt) return FRESH;
+  if (age < e.ttlMs) return PREFETCH;
+  if (age - e.ttlMs < p.staleMaxMs) return STALE;
+  return DEAD;
+}
+
+// Background refresh wanted: in the prefetch window or stale, recently used
+// (an entry nobody asks for is left to expire), and past the retry backoff.
+inline bool refreshDue(const Entry &e, unsigned long now, const Policy &p) {
+  Freshness f = freshness(e, now, p);
+  if (f != PREFETCH && f != STALE) return false;
+  if (now - e.lastUsedAt > e.ttlMs) return false;
+  if (e.failures == 0) return true;
+  unsigned long wait = p.retryBaseMs;
+  for (uint16_t i = 1; i < e.failures && wait < p.retryMaxMs; i++) wait *= 2;
+  if (wait > p.retryMaxMs) wait = p.retryMaxMs;
+  return now - e.lastAttemptAt >= wait;
+}
+
+inline void onResolved(Entry &e, uint32_t ip, uint32_t ttlS, unsigned long now, const Policy &p) {
+  e.ip = ip;
+  e.ttlMs = clampTtlMs(ttlS, p);
+  e.resolvedAt = now;
+  e.failures = 0;
+  e.valid = true;
+}
+
+inline void onFailed(Entry &e, unsigned long now) {
+  if (e.failures < 0xFFFF) e.failures++;
+  e.lastAttemptAt = now;
+}
+
+inline int find(const Entry *entries, int count, const char *host) {
+  for (int i = 0; i < count; i++) {
+    if (entries[i].host[0] != '\0' && strcmp(entries[i].host, host) == 0) return i;
+  }
+  return -1;
+}
+
+// Existing entry for host, else an empty slot, else the least recently used
+// one (reset for host). -1 if the name is too long to cache.
+inline int slotFor(Entry *entries, int count, const char *host, unsigned long now) {
+  if (strlen(host) >= (size_t)MAX_HOST_LEN) return -1;
+  int i = find(entries, count, host);
+  if (i >= 0) return i;
+  int victim = 0;
+  for (int k = 0; k < count; k++) {
+    if (entries[k].host[0] == '\0') {
+      victim = k;
+      break;
+    }
+    if (now - entries[k].lastUsedAt > now - entries[victim].lastUsedAt) victim = k;
+  }
+  Entry &e = entries[victim];
+  memset(&e, 0, sizeof(e));
+  strncpy(e.host, host, MAX_HOST_LEN - 1);
+  e.lastUsedAt = now;
+  return victim;
+}
+
+}  // namespace DnsCacheLogic
+
+#endif  // DNS_CACHE_LOGIC_H
@@ -0,0 +1,107 @@
+#ifndef FLOW_METER_H
+#define FLOW_METER_H
+
+#include <Arduino.h>
+#include <driver/pcnt.h>
+#include "config.h"
+#include "DebugHelper.h"
+#include "FlowMeterLogic.h"
+
+// ============================================
+// FlowMeter - pump line flow meter on the ESP32 pulse counter
+// Header-only static class (same pattern as DebugHelper)
+//
+// PCNT unit 0 counts rising edges of FLOW_METER_PIN with the glitch filter
+// on; nothing runs per pulse. The control loop (Core 1) owns the cycle: it
+// starts one when the pump starts for a valve, update() folds the new pulses
+// in on every pass of PHASE_WATERING, and the valve keeps the cycle's litres
+// when it closes. Metrics on Core 0 only read the finished 32-bit / float
+// results.
+// ============================================
+class FlowMeter {
+private:
+    struct PcntCounter {
+        int16_t read() {
+            int16_t count = 0;
+            pcnt_get_counter_value(PCNT_UNIT_0, &count);
+            return count;
+        }
+    };
+
+    static const int16_t COUNTER_LIMIT = 32767;
+    static const uint16_t GLITCH_FILTER_APB_CYCLES = 1023;  // ~12.8us at 80MHz
+
+    static PcntCounter counter;
+    static FlowMeterLogic::Meter meter;
+    static FlowMeterLogic::Cycle cycle;
+    static bool ready;
+
+public:
+    static bool present() { return FLOW_METER_PIN >= 0 && ready; }
+
+    static void init() {
+        if (FLOW_METER_PIN < 0) return;
+        pcnt_config_t config = {};
+        config.pulse_gpio_num = FLOW_METER_PIN;
+        config.ctrl_gpio_num = PCNT_PIN_NOT_USED;
+        config.channel = PCNT_CHANNEL_0;
+        config.unit = PCNT_UNIT_0;
+        config.pos_mode = PCNT_COUNT_INC;
+        config.neg_mode = PCNT_COUNT_DIS;
+        config.lctrl_mode = PCNT_MODE_KEEP;
+        config.hctrl_mode = PCNT_MODE_KEEP;
+        config.counter_h_lim = COUNTER_LIMIT;
+        config.counter_l_lim = 0;
+        if (pcnt_unit_config(&config) != ESP_OK) {
+            DebugHelper::debugImportant("❌ Flow meter: PCNT setup failed on GPIO " + String(FLOW_METER_PIN));
+            return;
+        }
+        pcnt_set_filter_value(PCNT_UNIT_0, GLITCH_FILTER_APB_CYCLES);
+        pcnt_filter_enable(PCNT_UNIT_0);
+        pcnt_counter_pause(PCNT_UNIT_0);
+        pcnt_counter_clear(PCNT_UNIT_0);
+        pcnt_counter_resume(PCNT_UNIT_0);
+
+        meter = FlowMeterLogic::makeMeter(COUNTER_LIMIT, counter.read());
+        cycle = FlowMeterLogic::startCycle(millis());
+        ready = true;
+        DebugHelper::debug("✓ Flow meter on GPIO " + String(FLOW_METER_PIN) + " (" +
+                           String(FLOW_METER_PULSES_PER_LITRE, 0) + " pulses/L)");
+    }
+
+    // Pump just started for a valve: pulses from here on belong to it.
+    static void startCycle(unsigned long now) {
+        if (!present()) return;
+        FlowMeterLogic::poll(counter, meter);  // Drop pulses from before the pump start
+        cycle = FlowMeterLogic::startCycle(now);
+    }
+
+    static void update(unsigned long now) {
+        if (!present()) return;
+        FlowMeterLogic::addPulses(cycle, FlowMeterLogic::poll(counter, meter), now,
+                                  FLOW_RATE_WINDOW_MS, FLOW_METER_PULSES_PER_LITRE);
+    }
+
+    static bool noFlow(unsigned long now) {
+        return present() &&
+               FlowMeterLogic::noFlow(cycle, now, FLOW_PRIME_GRACE_MS, FLOW_NO_FLOW_TIMEOUT_MS);
+    }
+
+    static float cycleLitres() {
+        return FlowMeterLogic::litres(cycle.pulses, FLOW_METER_PULSES_PER_LITRE);
+    }
+
+    static float rateLpm() { return cycle.rateLpm; }
+
+    static uint32_t totalPulses() { return meter.totalPulses; }
+};
+
+// ============================================
+// Static Member Initialization
+// ============================================
+FlowMeter::PcntCounter FlowMeter::counter;
+FlowMeterLogic::Meter FlowMeter::meter = FlowMeterLogic::makeMeter(FlowMeter::COUNTER_LIMIT, 0);
+FlowMeterLogic::Cycle FlowMeter::cycle = FlowMeterLogic::startCycle(0);
+bool FlowMeter::ready = false;
+
+#endif // FLOW_METER_H
@@ -0,0 +1,98 @@
+#ifndef FLOW_METER_LOGIC_H
+#define FLOW_METER_LOGIC_H
+
+#include <stdint.h>
+
+// Hall-effect flow meter on the pump line, hardware-free. FlowMeter.h runs it
+// over the ESP32 pulse counter (PCNT); the native tests run it over a
+// counter stub with the same wrap behaviour.
+//
+// The PCNT unit counts rising edges in hardware and wraps to 0 when it
+// reaches its high limit, so the firmware only reads the count register:
+// pulses since the last read are (now - before) modulo the limit, exact as
+// long as fewer than `limit` pulses arrive between two reads (32767 at
+// ~75 Hz full flow is minutes; the control loop reads every 10 ms).
+//
+// Counter concept:
+//   int16_t read();   // Current count, 0 .. limit-1
+namespace FlowMeterLogic {
+
+struct Meter {
+  int16_t limit;         // Count at which the hardware wraps to 0
+  int16_t lastCount;
+  uint32_t totalPulses;  // Since boot, for the counter metric
+};
+
+inline Meter makeMeter(int16_t limit, int16_t initialCount) {
+  Meter m;
+  m.limit = limit;
+  m.lastCount = initialCount;
+  m.totalPulses = 0;
+  return m;
+}
+
+inline uint32_t pulseDelta(int16_t before, int16_t now, int16_t limit) {
+  return now >= before ? (uint32_t)(now - before) : (uint32_t)(now + limit - before);
+}
+
+// New pulses since the previous poll
+template <class Counter>
+uint32_t poll(Counter &counter, Meter &meter) {
+  int16_t count = counter.read();
+  uint32_t delta = pulseDelta(meter.lastCount, count, meter.limit);
+  meter.lastCount = count;
+  meter.totalPulses += delta;
+  return delta;
+}
+
+// One pump run. The rate is re-computed once per window so single pulses at
+// low flow don't make it jitter.
+struct Cycle {
+  uint32_t pulses;
+  unsigned long startedAt;
+  unsigned long lastPulseAt;  // startedAt until the first pulse
+  uint32_t windowPulses;
+  unsigned long windowStart;
+  float rateLpm;
+};
+
+inline Cycle startCycle(unsigned long now) {
+  Cycle c;
+  c.pulses = 0;
+  c.startedAt = now;
+  c.lastPulseAt = now;
+  c.windowPulses = 0;
+  c.windowStart = now;
+  c.rateLpm = 0.0f;
+  return c;
+}
+
+inline float litres(uint32_t pulses, float pulsesPerLitre) {
+  return pulsesPerLitre > 0.0f ? (float)pulses / pulsesPerLitre : 0.0f;
+}
+
+inline void addPulses(Cycle &c, uint32_t pulses, unsigned long now, unsigned long windowMs,
+                      float pulsesPerLitre) {
+  if (pulses > 0) {
+    c.pulses += pulses;
+    c.windowPulses += pulses;
+    c.lastPulseAt = now;
+  }
+  unsigned long elapsed = now - c.windowStart;
+  if (elapsed >= windowMs && elapsed > 0) {
+    c.rateLpm = litres(c.windowPulses, pulsesPerLitre) * 60000.0f / (float)elapsed;
+    c.windowPulses = 0;
+    c.windowStart = now;
+  }
+}
+
+// Dry pump or blocked line: no pulse for timeoutMs once the pump has had
+// graceMs to prime the line.
+inline bool noFlow(const Cycle &c, unsigned long now, unsigned long graceMs,
+                   unsigned long timeoutMs) {
+  return now - c.startedAt >= graceMs && now - c.lastPulseAt >= timeoutMs;
+}
+
+}  // namespace FlowMeterLogic
+
+#endif  // FLOW_METER_LOGIC_H
@@ -0,0 +1,229 @@
+#ifndef GZIP_LOGIC_H
+#define GZIP_LOGIC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Streaming gzip (RFC 1951/1952) compressor with bounded memory,
+// hardware-free. MetricsPusher.h uses it for proxy uploads
+// (Content-Encoding: gzip); the native tests inflate its output.
+//
+// LZ77 over a WINDOW_SIZE sliding window (hash chains, greedy matching),
+// coded as one final deflate block with the fixed Huffman tables. Fixed codes
+// need no per-block statistics, so input is encoded as it arrives and the
+// whole state is one Compressor (~14 KB) whatever the body size. Log lines
+// ("Valve N: ...", repeated JSON keys) are mostly matches, which is where
+// nearly all of the saving comes from.
+namespace GzipLogic {
+
+const int WINDOW_SIZE = 2048;            // Longest match distance
+const int BUFFER_SIZE = 2 * WINDOW_SIZE; // Window + lookahead, slides by WINDOW_SIZE
+const int HASH_BITS = 10;
+const int HASH_SIZE = 1 << HASH_BITS;
+const int MIN_MATCH = 3;
+const int MAX_MATCH = 258;
+const int MAX_CHAIN = 32;                // Candidates tried per position
+const int16_t NIL = -1;
+const size_t HEADER_SIZE = 10;
+const size_t TRAILER_SIZE = 8;
+
+inline uint32_t crc32Update(uint32_t crc, const uint8_t *p, size_t n) {
+  static const uint32_t table[16] = {0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+                                     0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+                                     0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+  crc = ~crc;
+  for (size_t i = 0; i < n; i++) {
+    crc ^= p[i];
+    crc = (crc >> 4) ^ table[crc & 15];
+    crc = (crc >> 4) ^ table[crc & 15];
+  }
+  return ~crc;
+}
+
+struct Compressor {
+  uint8_t window[BUFFER_SIZE];
+  int16_t head[HASH_SIZE];    // Latest position per hash
+  int16_t prev[BUFFER_SIZE];  // Previous position with the same hash
+  int fill;                   // Bytes in window
+  int pos;                    // Next byte to encode
+  uint32_t bits;
+  int bitCount;
+  uint32_t crc;
+  uint32_t inputSize;
+  uint8_t *out;
+  size_t capacity;
+  size_t outLen;
+  bool overflow;
+};
+
+inline void putByte(Compressor &c, uint8_t b) {
+  if (c.outLen >= c.capacity) {
+    c.overflow = true;
+    return;
+  }
+  c.out[c.outLen++] = b;
+}
+
+inline void putBits(Compressor &c, uint32_t value, int count) {
+  c.bits |= value << c.bitCount;
+  c.bitCount += count;
+  while (c.bitCount >= 8) {
+    putByte(c, (uint8_t)c.bits);
+    c.bits >>= 8;
+    c.bitCount -= 8;
+  }
+}
+
+// Huffman codes go out most significant bit first
+inline void putCode(Compressor &c, uint32_t code, int length) {
+  uint32_t reversed = 0;
+  for (int i = 0; i < length; i++) reversed |= ((code >> i) & 1) << (length - 1 - i);
+  putBits(c, reversed, length);
+}
+
+inline void putSymbol(Compressor &c, int sym) {
+  if (sym < 144) {
+    putCode(c, 0x30 + sym, 8);
+  } else if (sym < 256) {
+    putCode(c, 0x190 + sym - 144, 9);
+  } else if (sym < 280) {
+    putCode(c, sym - 256, 7);
+  } else {
+    putCode(c, 0xC0 + sym - 280, 8);
+  }
+}
+
+inline void putMatch(Compressor &c, int length, int distance) {
+  static const uint16_t lengthBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                          31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+  static const uint8_t lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                          2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+  static const uint16_t distBase[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,
+                                        33,  49,  65,  97,  129, 193,  257,  385,  513,  769,
+                                        1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+  static const uint8_t distExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                        6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+  int l = 28;
+  while (lengthBase[l] > length) l--;
+  putSymbol(c, 257 + l);
+  putBits(c, (uint32_t)(length - lengthBase[l]), lengthExtra[l]);
+  int d = 29;
+  while (distBase[d] > distance) d--;
+  putCode(c, (uint32_t)d, 5);
+  putBits(c, (uint32_t)(distance - distBase[d]), distExtra[d]);
+}
+
+inline int hashAt(const uint8_t *p) {
+  uint32_t v = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+  return (int)((v * 2654435761UL) >> (32 - HASH_BITS)) & (HASH_SIZE - 1);
+}
+
+inline void insert(Compressor &c, int p) {
+  int h = hashAt(c.window + p);
+  c.prev[p] = c.head[h];
+  c.head[h] = (int16_t)p;
+}
+
+// Encode while a full match length is buffered ahead (everything when flushing)
+inline void encode(Compressor &c, bool flush) {
+  while (c.pos < c.fill && !c.overflow) {
+    int avail = c.fill - c.pos;
+    if (!flush && avail < MAX_MATCH) return;
+    int bestLen = 0;
+    int bestDist = 0;
+    if (avail >= MIN_MATCH) {
+      int maxLen = avail < MAX_MATCH ? avail : MAX_MATCH;
+      const uint8_t *here = c.window + c.pos;
+      int candidate = c.head[hashAt(here)];
+      for (int chain = MAX_CHAIN; candidate != NIL && chain > 0; chain--) {
+        int dist = c.pos - candidate;
+        if (dist > WINDOW_SIZE) break;
+        const uint8_t *there = c.window + candidate;
+        if (there[bestLen] == here[bestLen]) {
+          int len = 0;
+          while (len < maxLen && there[len] == here[len]) len++;
+          if (len > bestLen) {
+            bestLen = len;
+            bestDist = dist;
+            if (len == maxLen) break;
+          }
+        }
+        candidate = c.prev[candidate];
+      }
+      insert(c, c.pos);
+    }
+    if (bestLen >= MIN_MATCH) {
+      putMatch(c, bestLen, bestDist);
+      for (int k = 1; k < bestLen; k++) {
+        if (c.fill - (c.pos + k) >= MIN_MATCH) insert(c, c.pos + k);
+      }
+      c.pos += bestLen;
+    } else {
+      putSymbol(c, c.window[c.pos]);
+      c.pos++;
+    }
+  }
+}
+
+// Drop the oldest WINDOW_SIZE bytes; positions move down with them
+inline void slide(Compressor &c) {
+  memmove(c.window, c.window + WINDOW_SIZE, c.fill - WINDOW_SIZE);
+  c.fill -= WINDOW_SIZE;
+  c.pos -= WINDOW_SIZE;
+  for (int i = 0; i < HASH_SIZE; i++) {
+    c.head[i] = c.head[i] >= WINDOW_SIZE ? (int16_t)(c.head[i] - WINDOW_SIZE) : NIL;
+  }
+  for (int i = 0; i < WINDOW_SIZE; i++) {
+    int16_t v = c.prev[i + WINDOW_SIZE];
+    c.prev[i] = v >= WINDOW_SIZE ? (int16_t)(v - WINDOW_SIZE) : NIL;
+  }
+}
+
+// Output goes to out[0..capacity); finish() reports whether it fitted.
+inline void begin(Compressor &c, uint8_t *out, size_t capacity) {
+  c.fill = 0;
+  c.pos = 0;
+  c.bits = 0;
+  c.bitCount = 0;
+  c.crc = 0;
+  c.inputSize = 0;
+  c.out = out;
+  c.capacity = capacity;
+  c.outLen = 0;
+  c.overflow = false;
+  for (int i = 0; i < HASH_SIZE; i++) c.head[i] = NIL;
+  static const uint8_t header[HEADER_SIZE] = {0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF};  // deflate, no mtime, OS unknown
+  for (size_t i = 0; i < HEADER_SIZE; i++) putByte(c, header[i]);
+  putBits(c, 1, 1);  // BFINAL
+  putBits(c, 1, 2);  // BTYPE = fixed Huffman
+}
+
+inline void write(Compressor &c, const uint8_t *data, size_t len) {
+  c.crc = crc32Update(c.crc, data, len);
+  c.inputSize += (uint32_t)len;
+  while (len > 0 && !c.overflow) {
+    size_t chunk = (size_t)(BUFFER_SIZE - c.fill);
+    if (chunk > len) chunk = len;
+    memcpy(c.window + c.fill, data, chunk);
+    c.fill += (int)chunk;
+    data += chunk;
+    len -= chunk;
+    encode(c, false);
+    if (c.fill == BUFFER_SIZE) slide(c);
+  }
+}
+
+// Gzip member length, or 0 if it didn't fit in the output buffer
+inline size_t finish(Compressor &c) {
+  encode(c, true);
+  putSymbol(c, 256);  // End of block
+  if (c.bitCount > 0) putBits(c, 0, 8 - c.bitCount);
+  for (int i = 0; i < 4; i++) putByte(c, (uint8_t)(c.crc >> (8 * i)));
+  for (int i = 0; i < 4; i++) putByte(c, (uint8_t)(c.inputSize >> (8 * i)));
+  return c.overflow ? 0 : c.outLen;
+}
+
+}  // namespace GzipLogic
+
+#endif  // GZIP_LOGIC_H
@@ -0,0 +1,296 @@
+#ifndef HISTORY_STORE_H
+#define HISTORY_STORE_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <WiFi.h>
+#include <time.h>
+#include "config.h"
+#include "DebugHelper.h"
+#include "HistoryStoreLogic.h"
+#include "LoopDeadlineMonitor.h"
+#include "WateringSystem.h"
+#include "TraceRecorder.h"
+
+extern WateringSystem* g_wateringSystem_ptr;
+
+// Series layout: per-valve blocks first, then system-wide series.
+const int HISTORY_SERIES_WATER_LEVEL = 0;                    // + valve index, %
+const int HISTORY_SERIES_FILL = NUM_VALVES;                  // + valve index, 0.1s units
+const int HISTORY_SERIES_TANK = 2 * NUM_VALVES;              // 0 / 100 (% of time tank OK)
+const int HISTORY_SERIES_RSSI = 2 * NUM_VALVES + 1;          // dBm
+const int HISTORY_SERIES_HEAP = 2 * NUM_VALVES + 2;          // KB
+const int HISTORY_SERIES_LOOP = 2 * NUM_VALVES + 3;          // Worst control loop pass, ms
+const int HISTORY_SERIES_COUNT = 2 * NUM_VALVES + 4;
+
+// Checkpoint file header (followed by one HistoryFileArchive per archive, then
+// each archive's data block in order).
+struct HistoryFileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t seriesCount;
+    uint16_t archiveCount;
+    uint16_t reserved;
+};
+
+struct HistoryFileArchive {
+    uint32_t stepSec;
+    uint16_t rows;
+    uint16_t reserved;
+    uint32_t lastBucket;
+};
+
+const uint32_t HISTORY_FILE_MAGIC = 0x52524431;  // "RRD1"
+const uint16_t HISTORY_FILE_VERSION = 1;
+
+// ============================================
+// HistoryStore - multi-resolution time series for offline charts
+// Header-only static class (same pattern as DebugHelper)
+//
+// Runs entirely on the network task (sampling, checkpoints and /api/history),
+// so the archives need no locking. Row data lives in PSRAM; the 10s archive is
+// checkpointed together with the others so a reboot loses at most one
+// checkpoint interval.
+// ============================================
+class HistoryStore {
+private:
+    static HistoryStoreLogic::Archive archives[HISTORY_ARCHIVE_COUNT];
+    static int32_t sums[HISTORY_ARCHIVE_COUNT][HISTORY_SERIES_COUNT];
+    static uint16_t counts[HISTORY_ARCHIVE_COUNT][HISTORY_SERIES_COUNT];
+    static bool ready;
+    static unsigned long lastSampleTime;
+    static unsigned long lastCheckpointTime;
+
+    static size_t archiveBytes(int i) {
+        return (size_t)HISTORY_ARCHIVE_ROWS[i] * HISTORY_SERIES_COUNT * sizeof(int16_t);
+    }
+
+    // UTC epoch, or 0 while the clock is not set yet
+    static uint32_t nowEpoch() {
+        time_t now;
+        time(&now);
+        if (now < 1640000000) return 0;  // Jan 2022 - same sanity check as NTP sync
+        return (uint32_t)(now - RTC_TIMEZONE_OFFSET_SEC);
+    }
+
+    static int16_t clampToSeries(long value) {
+        if (value > 32767) return 32767;
+        if (value < -32767) return -32767;
+        return (int16_t)value;
+    }
+
+    static void collectSample(int16_t* values) {
+        for (int s = 0; s < HISTORY_SERIES_COUNT; s++) {
+            values[s] = HistoryStoreLogic::HISTORY_UNKNOWN;
+        }
+
+        if (g_wateringSystem_ptr) {
+            unsigned long currentTime = millis();
+            for (int i = 0; i < NUM_VALVES; i++) {
+                ValveController* v = g_wateringSystem_ptr->getValve(i);
+                if (!v) continue;
+                if (v->isCalibrated && hasLastWateringReference(v)) {
+                    values[HISTORY_SERIES_WATER_LEVEL + i] =
+                        clampToSeries((long)calculateCurrentWaterLevel(v, currentTime));
+                }
+                if (v->lastFillDuration > 0) {
+                    values[HISTORY_SERIES_FILL + i] = clampToSeries((long)(v->lastFillDuration / 100));
+                }
+            }
+            values[HISTORY_SERIES_TANK] = g_wateringSystem_ptr->isWaterLevelLow() ? 0 : 100;
+        }
+
+        if (WiFi.isConnected()) {
+            values[HISTORY_SERIES_RSSI] = clampToSeries(WiFi.RSSI());
+        }
+        values[HISTORY_SERIES_HEAP] = clampToSeries((long)(ESP.getFreeHeap() / 1024));
+        values[HISTORY_SERIES_LOOP] =
+            clampToSeries((long)LoopDeadlineMonitor::takeWindowMaxCycleMs(DEADLINE_TASK_CONTROL));
+    }
+
+public:
+    static void init() {
+        ready = false;
+        for (int i = 0; i < HISTORY_ARCHIVE_COUNT; i++) {
+            archives[i].stepSec = HISTORY_ARCHIVE_STEP_SEC[i];
+            archives[i].rows = HISTORY_ARCHIVE_ROWS[i];
+            archives[i].sums = sums[i];
+            archives[i].counts = counts[i];
+            archives[i].lastBucket = 0;
+            archives[i].data = (int16_t*)ps_malloc(archiveBytes(i));
+            if (!archives[i].data) {
+                DebugHelper::debugImportant("⚠️ History: PSRAM allocation failed - history disabled");
+                for (int j = 0; j < i; j++) {
+                    free(archives[j].data);
+                    archives[j].data = nullptr;
+                }
+                return;
+            }
+            HistoryStoreLogic::clearArchive(archives[i], HISTORY_SERIES_COUNT);
+        }
+        ready = true;
+
+        if (loadCheckpoint()) {
+            DebugHelper::debug("✓ History restored from " + String(HISTORY_CHECKPOINT_FILE));
+        } else {
+            DebugHelper::debug("History: starting empty");
+        }
+        lastCheckpointTime = millis();
+    }
+
+    static bool isReady() { return ready; }
+
+    // Called from networkTask: sample every HISTORY_SAMPLE_INTERVAL_MS,
+    // checkpoint every HISTORY_CHECKPOINT_INTERVAL_MS.
+    static void loop() {
+        if (!ready) return;
+        unsigned long now = millis();
+
+        if (lastSampleTime == 0 || now - lastSampleTime >= HISTORY_SAMPLE_INTERVAL_MS) {
+            lastSampleTime = now;
+            uint32_t epoch = nowEpoch();
+            if (epoch != 0) {
+                int16_t values[HISTORY_SERIES_COUNT];
+                collectSample(values);
+                for (int i = 0; i < HISTORY_ARCHIVE_COUNT; i++) {
+                    HistoryStoreLogic::addSample(archives[i], HISTORY_SERIES_COUNT, epoch, values);
+                }
+            }
+        }
+
+        if (now - lastCheckpointTime >= HISTORY_CHECKPOINT_INTERVAL_MS) {
+            lastCheckpointTime = now;
+            checkpoint();
+        }
+    }
+
+    // Write all archives to a temp file, then rename over the checkpoint so a
+    // power cut mid-write leaves the previous checkpoint intact.
+    static bool checkpoint() {
+        if (!ready) return false;
+        TRACE_SCOPE(TraceEventFormat::TRACE_CAT_FLASH, "history_checkpoint");
+
+        File f = LittleFS.open(HISTORY_CHECKPOINT_TMP_FILE, "w");
+        if (!f) {
+            DebugHelper::debug("⚠️ History: cannot open checkpoint file");
+            return false;
+        }
+
+        HistoryFileHeader header = {HISTORY_FILE_MAGIC, HISTORY_FILE_VERSION,
+                                    (uint16_t)HISTORY_SERIES_COUNT,
+                                    (uint16_t)HISTORY_ARCHIVE_COUNT, 0};
+        bool ok = f.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+        for (int i = 0; ok && i < HISTORY_ARCHIVE_COUNT; i++) {
+            HistoryFileArchive meta = {archives[i].stepSec, archives[i].rows, 0, archives[i].lastBucket};
+            ok = f.write((const uint8_t*)&meta, sizeof(meta)) == sizeof(meta);
+        }
+        for (int i = 0; ok && i < HISTORY_ARCHIVE_COUNT; i++) {
+            ok = f.write((const uint8_t*)archives[i].data, archiveBytes(i)) == archiveBytes(i);
+        }
+        f.close();
+
+        if (!ok) {
+            LittleFS.remove(HISTORY_CHECKPOINT_TMP_FILE);
+            DebugHelper::debug("⚠️ History: checkpoint write failed");
+            return false;
+        }
+
+        LittleFS.remove(HISTORY_CHECKPOINT_FILE);
+        if (!LittleFS.rename(HISTORY_CHECKPOINT_TMP_FILE, HISTORY_CHECKPOINT_FILE)) {
+            DebugHelper::debug("⚠️ History: checkpoint rename failed");
+            return false;
+        }
+        DebugHelper::debug("✓ History checkpoint saved");
+        return true;
+    }
+
+    static const HistoryStoreLogic::Archive* getArchives() { return archives; }
+
+    static String seriesName(int series) {
+        if (series >= HISTORY_SERIES_WATER_LEVEL && series < HISTORY_SERIES_FILL) {
+            return "water_level_" + String(series - HISTORY_SERIES_WATER_LEVEL + 1);
+        }
+        if (series >= HISTORY_SERIES_FILL && series < HISTORY_SERIES_TANK) {
+            return "fill_s_" + String(series - HISTORY_SERIES_FILL + 1);
+        }
+        switch (series) {
+            case HISTORY_SERIES_TANK: return "tank_ok_pct";
+            case HISTORY_SERIES_RSSI: return "wifi_rssi";
+            case HISTORY_SERIES_HEAP: return "free_heap_kb";
+            case HISTORY_SERIES_LOOP: return "loop_ms";
+            default: return "unknown";
+        }
+    }
+
+    static int seriesByName(const String& name) {
+        for (int s = 0; s < HISTORY_SERIES_COUNT; s++) {
+            if (seriesName(s) == name) return s;
+        }
+        return -1;
+    }
+
+    // JSON number for one stored value ("null" for gaps); fill durations are
+    // stored in 0.1s units.
+    static String formatValue(int series, int16_t value) {
+        if (value == HistoryStoreLogic::HISTORY_UNKNOWN) return "null";
+        if (series >= HISTORY_SERIES_FILL && series < HISTORY_SERIES_TANK) {
+            return String(value / 10.0f, 1);
+        }
+        return String(value);
+    }
+
+private:
+    static bool loadCheckpoint() {
+        // A power cut between remove() and rename() leaves only the temp file,
+        // which is complete at that point.
+        const char* path = HISTORY_CHECKPOINT_FILE;
+        if (!LittleFS.exists(path)) {
+            if (!LittleFS.exists(HISTORY_CHECKPOINT_TMP_FILE)) return false;
+            path = HISTORY_CHECKPOINT_TMP_FILE;
+        }
+        File f = LittleFS.open(path, "r");
+        if (!f) return false;
+
+        HistoryFileHeader header;
+        bool ok = f.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+                  header.magic == HISTORY_FILE_MAGIC &&
+                  header.version == HISTORY_FILE_VERSION &&
+                  header.seriesCount == HISTORY_SERIES_COUNT &&
+                  header.archiveCount == HISTORY_ARCHIVE_COUNT;
+
+        HistoryFileArchive meta[HISTORY_ARCHIVE_COUNT];
+        for (int i = 0; ok && i < HISTORY_ARCHIVE_COUNT; i++) {
+            ok = f.read((uint8_t*)&meta[i], sizeof(meta[i])) == sizeof(meta[i]) &&
+                 meta[i].stepSec == archives[i].stepSec &&
+                 meta[i].rows == archives[i].rows;
+        }
+        for (int i = 0; ok && i < HISTORY_ARCHIVE_COUNT; i++) {
+            ok = f.read((uint8_t*)archives[i].data, archiveBytes(i)) == archiveBytes(i);
+        }
+        f.close();
+
+        if (!ok) {
+            // Layout changed (e.g. NUM_VALVES) or truncated file: start empty
+            for (int i = 0; i < HISTORY_ARCHIVE_COUNT; i++) {
+                HistoryStoreLogic::clearArchive(archives[i], HISTORY_SERIES_COUNT);
+            }
+            return false;
+        }
+        for (int i = 0; i < HISTORY_ARCHIVE_COUNT; i++) {
+            archives[i].lastBucket = meta[i].lastBucket;
+        }
+        return true;
+    }
+};
+
+// ============================================
+// Static Member Initialization
+// ============================================
+HistoryStoreLogic::Archive HistoryStore::archives[HISTORY_ARCHIVE_COUNT];
+int32_t HistoryStore::sums[HISTORY_ARCHIVE_COUNT][HISTORY_SERIES_COUNT];
+uint16_t HistoryStore::counts[HISTORY_ARCHIVE_COUNT][HISTORY_SERIES_COUNT];
+bool HistoryStore::ready = false;
+unsigned long HistoryStore::lastSampleTime = 0;
+unsigned long HistoryStore::lastCheckpointTime = 0;
+
+#endif // HISTORY_STORE_H
@@ -0,0 +1,164 @@
+#ifndef HISTORY_STORE_LOGIC_H
+#define HISTORY_STORE_LOGIC_H
+
+#include <stdint.h>
+
+// Pure, hardware-free round-robin archive logic shared by the firmware
+// (HistoryStore.h) and the native test suite.
+//
+// Each archive is a fixed ring of `rows` rows, one row per `stepSec` bucket of
+// wall-clock time, each row holding one int16 value per series. A bucket's row
+// is addressed directly as (epoch / stepSec) % rows, so adding a sample is
+// O(series): the running sum/count of the current bucket is updated and the
+// row is rewritten with the running average. Rows for buckets that received no
+// samples (device off, clock jump) are cleared to HISTORY_UNKNOWN so a gap is
+// drawn as a gap rather than as stale data from the previous lap of the ring.
+namespace HistoryStoreLogic {
+
+const int16_t HISTORY_UNKNOWN = -32768;
+
+struct Archive {
+  uint32_t stepSec;    // Seconds per row
+  uint16_t rows;       // Ring length
+  int16_t *data;       // rows * seriesCount values, row-major
+  uint32_t lastBucket; // Bucket index (epoch / stepSec) of the newest row; 0 = empty
+  int32_t *sums;       // Running sum per series for lastBucket
+  uint16_t *counts;    // Running sample count per series for lastBucket
+};
+
+inline int16_t *rowFor(Archive &a, int seriesCount, uint32_t bucket) {
+  return a.data + (uint32_t)(bucket % a.rows) * seriesCount;
+}
+
+inline const int16_t *rowFor(const Archive &a, int seriesCount, uint32_t bucket) {
+  return a.data + (uint32_t)(bucket % a.rows) * seriesCount;
+}
+
+inline void clearRow(int16_t *row, int seriesCount) {
+  for (int s = 0; s < seriesCount; s++) {
+    row[s] = HISTORY_UNKNOWN;
+  }
+}
+
+inline void clearArchive(Archive &a, int seriesCount) {
+  for (uint32_t r = 0; r < a.rows; r++) {
+    clearRow(a.data + r * seriesCount, seriesCount);
+  }
+  for (int s = 0; s < seriesCount; s++) {
+    a.sums[s] = 0;
+    a.counts[s] = 0;
+  }
+  a.lastBucket = 0;
+}
+
+// Rounded integer average (sums may be negative, e.g. RSSI)
+inline int16_t averageOf(int32_t sum, uint16_t count) {
+  if (count == 0) return HISTORY_UNKNOWN;
+  int32_t half = count / 2;
+  return (int16_t)(sum >= 0 ? (sum + half) / count : (sum - half) / count);
+}
+
+// Feed one sample (one value per series, HISTORY_UNKNOWN = missing) taken at
+// `epoch`. Returns false when the sample was dropped (clock moved backwards
+// within the ring's span).
+inline bool addSample(Archive &a, int seriesCount, uint32_t epoch,
+                      const int16_t *values) {
+  uint32_t bucket = epoch / a.stepSec;
+  if (bucket == 0) return false;
+
+  if (a.lastBucket != 0 && bucket < a.lastBucket) {
+    if (a.lastBucket - bucket < a.rows) {
+      return false; // Small step back (NTP correction): keep existing rows
+    }
+    clearArchive(a, seriesCount); // Clock reset far into the past: start over
+  }
+
+  if (a.lastBucket == 0 || bucket > a.lastBucket) {
+    // Clear every row skipped since the last sample (at most one lap).
+    uint32_t gap = (a.lastBucket == 0) ? a.rows : bucket - a.lastBucket;
+    if (gap > a.rows) gap = a.rows;
+    for (uint32_t k = 0; k < gap; k++) {
+      clearRow(rowFor(a, seriesCount, bucket - k), seriesCount);
+    }
+    for (int s = 0; s < seriesCount; s++) {
+      a.sums[s] = 0;
+      a.counts[s] = 0;
+    }
+    a.lastBucket = bucket;
+  }
+
+  int16_t *row = rowFor(a, seriesCount, bucket);
+  for (int s = 0; s < seriesCount; s++) {
+    if (values[s] == HISTORY_UNKNOWN) continue;
+    a.sums[s] += values[s];
+    a.counts[s]++;
+    row[s] = averageOf(a.sums[s], a.counts[s]);
+  }
+  return true;
+}
+
+// Seconds of history an archive can hold.
+inline uint32_t spanSec(const Archive &a) { return a.stepSec * a.rows; }
+
+// Finest archive whose span covers `rangeSec` (coarsest one if none does).
+// Archives must be ordered finest first.
+inline int chooseArchive(const Archive *archives, int archiveCount,
+                         uint32_t rangeSec) {
+  for (int i = 0; i < archiveCount; i++) {
+    if (spanSec(archives[i]) >= rangeSec) return i;
+  }
+  return archiveCount - 1;
+}
+
+struct DownsampleWindow {
+  uint32_t startEpoch; // Epoch of the first output point
+  uint32_t stepSec;    // Seconds between output points
+  int points;          // Number of output points
+  int rowsPerPoint;    // Archive rows averaged into one point
+  uint32_t firstBucket;
+};
+
+// Plan a query over the last `rangeSec` seconds of archive `a`, returning at
+// most `maxPoints` points. points == 0 when the archive is empty.
+inline DownsampleWindow planWindow(const Archive &a, uint32_t rangeSec,
+                                   int maxPoints) {
+  DownsampleWindow w = {0, a.stepSec, 0, 1, 0};
+  if (a.lastBucket == 0 || maxPoints <= 0) return w;
+
+  uint32_t rowsWanted = (rangeSec + a.stepSec - 1) / a.stepSec;
+  if (rowsWanted < 1) rowsWanted = 1;
+  if (rowsWanted > a.rows) rowsWanted = a.rows;
+  if (rowsWanted > a.lastBucket) rowsWanted = a.lastBucket;
+
+  int group = (int)((rowsWanted + maxPoints - 1) / maxPoints);
+  w.rowsPerPoint = group;
+  w.points = (int)((rowsWanted + group - 1) / group);
+  w.stepSec = a.stepSec * group;
+  // Align groups so the newest group ends exactly at lastBucket.
+  w.firstBucket = a.lastBucket + 1 - (uint32_t)w.points * group;
+  w.startEpoch = w.firstBucket * a.stepSec;
+  return w;
+}
+
+// Average of one series over one output point (HISTORY_UNKNOWN if no data).
+// Buckets older than the ring (possible for the first, aligned group) are
+// treated as missing.
+inline int16_t downsamplePoint(const Archive &a, int seriesCount, int series,
+                               const DownsampleWindow &w, int point) {
+  int32_t sum = 0;
+  uint16_t count = 0;
+  uint32_t oldest = (a.lastBucket >= a.rows) ? a.lastBucket - a.rows + 1 : 1;
+  uint32_t b = w.firstBucket + (uint32_t)point * w.rowsPerPoint;
+  for (int k = 0; k < w.rowsPerPoint; k++, b++) {
+    if (b < oldest || b > a.lastBucket) continue;
+    int16_t v = rowFor(a, seriesCount, b)[series];
+    if (v == HISTORY_UNKNOWN) continue;
+    sum += v;
+    count++;
+  }
+  return averageOf(sum, count);
+}
+
+} // namespace HistoryStoreLogic
+
+#endif // HISTORY_STORE_LOGIC_H
@@ -0,0 +1,213 @@
+#ifndef IO_EXPANDER_LOGIC_H
+#define IO_EXPANDER_LOGIC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// MCP23017 16-bit I2C GPIO expander driver, hardware-free. ZoneIO.h runs it
+// over Wire; the native tests run it over a register-level chip stub.
+//
+// Zone tables address expander lines with pin numbers from
+// EXPANDER_PIN_BASE up: chip c, bit b (GPA0..7 = 0..7, GPB0..7 = 8..15) is
+// EXPANDER_PIN_BASE + 16 * c + b, and chip c answers at 0x20 + c (A2..A0
+// strapped to the chip number). Anything below the base is an ESP32 GPIO.
+//
+// The chip runs with IOCON.BANK = 0, so every A register sits next to its B
+// register and one sequential 2-byte transfer covers all 16 lines: a sample
+// of all 16 inputs is one read transaction, an output update one write.
+//
+// Bus concept (both return false on a NACK / short transfer):
+//   bool write(uint8_t address, uint8_t reg, const uint8_t *data, size_t n);
+//   bool read(uint8_t address, uint8_t reg, uint8_t *data, size_t n);
+namespace IoExpanderLogic {
+
+const int EXPANDER_PIN_BASE = 100;
+const int PINS_PER_CHIP = 16;
+const int MAX_CHIPS = 8;
+const uint8_t BASE_ADDRESS = 0x20;
+
+// IOCON.BANK = 0 register map (A register; B is +1)
+const uint8_t REG_IODIR = 0x00;    // 1 = input
+const uint8_t REG_IPOL = 0x02;
+const uint8_t REG_GPINTEN = 0x04;  // Interrupt-on-change enable
+const uint8_t REG_DEFVAL = 0x06;
+const uint8_t REG_INTCON = 0x08;   // 0 = compare against previous value
+const uint8_t REG_IOCON = 0x0A;
+const uint8_t REG_GPPU = 0x0C;     // 100k pull-up
+const uint8_t REG_INTF = 0x0E;
+const uint8_t REG_INTCAP = 0x10;
+const uint8_t REG_GPIO = 0x12;     // Reading clears the interrupt
+const uint8_t REG_OLAT = 0x14;
+
+// INTA/INTB mirrored and open-drain, so the INT lines of every chip can be
+// wired together to one ESP32 input with a pull-up. SEQOP = 0 (sequential).
+const uint8_t IOCON_MIRROR = 0x40;
+const uint8_t IOCON_ODR = 0x04;
+
+inline bool isExpanderPin(int pin) {
+  return pin >= EXPANDER_PIN_BASE && pin < EXPANDER_PIN_BASE + MAX_CHIPS * PINS_PER_CHIP;
+}
+inline int chipOf(int pin) { return (pin - EXPANDER_PIN_BASE) / PINS_PER_CHIP; }
+inline int bitOf(int pin) { return (pin - EXPANDER_PIN_BASE) % PINS_PER_CHIP; }
+inline uint8_t addressOf(int chip) { return (uint8_t)(BASE_ADDRESS + chip); }
+
+// Driver-side mirror of one chip. The registers the firmware writes are
+// cached, so re-asserting a pin mode or level that is already set costs no
+// bus traffic.
+struct Chip {
+  uint8_t address;
+  bool interrupts;       // GPINTEN on every input line
+  uint16_t direction;    // IODIR (1 = input)
+  uint16_t pullups;      // GPPU
+  uint16_t outputs;      // OLAT
+  uint16_t inputs;       // Last GPIO sample
+  uint32_t busErrors;
+};
+
+inline Chip makeChip(int index, bool interrupts) {
+  Chip chip;
+  chip.address = addressOf(index);
+  chip.interrupts = interrupts;
+  chip.direction = 0xFFFF;  // Power-on state: all inputs, no pull-ups
+  chip.pullups = 0;
+  chip.outputs = 0;
+  chip.inputs = 0xFFFF;
+  chip.busErrors = 0;
+  return chip;
+}
+
+// Chip states for a zone topology: valve lines become LOW outputs, rain
+// sensor lines pulled-up inputs, everything else stays an input.
+inline void planChips(const int *valvePins, const int *sensorPins, int zones, Chip *chips,
+                      int chipCount, bool interrupts) {
+  for (int c = 0; c < chipCount; c++) chips[c] = makeChip(c, interrupts);
+  for (int i = 0; i < zones; i++) {
+    if (isExpanderPin(valvePins[i]) && chipOf(valvePins[i]) < chipCount) {
+      chips[chipOf(valvePins[i])].direction &= (uint16_t)~(1u << bitOf(valvePins[i]));
+    }
+    if (isExpanderPin(sensorPins[i]) && chipOf(sensorPins[i]) < chipCount) {
+      chips[chipOf(sensorPins[i])].pullups |= (uint16_t)(1u << bitOf(sensorPins[i]));
+    }
+  }
+}
+
+template <class Bus>
+bool writePair(Bus &bus, Chip &chip, uint8_t reg, uint16_t value) {
+  uint8_t data[2] = {(uint8_t)(value & 0xFF), (uint8_t)(value >> 8)};
+  if (bus.write(chip.address, reg, data, 2)) return true;
+  chip.busErrors++;
+  return false;
+}
+
+template <class Bus>
+bool readPair(Bus &bus, Chip &chip, uint8_t reg, uint16_t &value) {
+  uint8_t data[2];
+  if (!bus.read(chip.address, reg, data, 2)) {
+    chip.busErrors++;
+    return false;
+  }
+  value = (uint16_t)(data[0] | (data[1] << 8));
+  return true;
+}
+
+// One read of GPIOA+GPIOB. On failure the previous sample is kept.
+template <class Bus>
+bool sample(Bus &bus, Chip &chip) {
+  uint16_t value;
+  if (!readPair(bus, chip, REG_GPIO, value)) return false;
+  chip.inputs = value;
+  return true;
+}
+
+inline uint8_t ioconOf(const Chip &chip) { return chip.interrupts ? (uint8_t)(IOCON_MIRROR | IOCON_ODR) : 0; }
+
+// Pushes the whole cached configuration to the chip: outputs are latched
+// before the direction changes so a relay line never glitches HIGH. Also the
+// recovery path once check() finds a chip that was reset behind our back.
+template <class Bus>
+bool configure(Bus &bus, Chip &chip) {
+  uint8_t iocon = ioconOf(chip);
+  if (!bus.write(chip.address, REG_IOCON, &iocon, 1)) {
+    chip.busErrors++;
+    return false;
+  }
+  bool ok = writePair(bus, chip, REG_OLAT, chip.outputs) &&
+            writePair(bus, chip, REG_IODIR, chip.direction) &&
+            writePair(bus, chip, REG_GPPU, chip.pullups) &&
+            writePair(bus, chip, REG_INTCON, 0) &&
+            writePair(bus, chip, REG_GPINTEN, chip.interrupts ? chip.direction : 0);
+  return ok && sample(bus, chip);
+}
+
+enum CheckResult { CHECK_OK, CHECK_MISMATCH, CHECK_BUS_ERROR };
+
+// Reads the configuration back (IODIR..GPPU in one transfer, OLAT in another;
+// GPIO is not touched, so pending interrupts survive) and compares it with
+// the cache. A brown-out or RESET glitch puts the chip back to power-on
+// defaults - all inputs, OLAT 0 - which shows up here as a mismatch.
+template <class Bus>
+CheckResult check(Bus &bus, Chip &chip) {
+  uint8_t regs[REG_GPPU + 2];
+  uint16_t outputs;
+  if (!bus.read(chip.address, REG_IODIR, regs, sizeof(regs))) {
+    chip.busErrors++;
+    return CHECK_BUS_ERROR;
+  }
+  if (!readPair(bus, chip, REG_OLAT, outputs)) return CHECK_BUS_ERROR;
+  uint16_t direction = (uint16_t)(regs[REG_IODIR] | (regs[REG_IODIR + 1] << 8));
+  uint16_t pullups = (uint16_t)(regs[REG_GPPU] | (regs[REG_GPPU + 1] << 8));
+  uint16_t enabled = (uint16_t)(regs[REG_GPINTEN] | (regs[REG_GPINTEN + 1] << 8));
+  bool same = direction == chip.direction && pullups == chip.pullups && outputs == chip.outputs &&
+              enabled == (chip.interrupts ? chip.direction : 0) && regs[REG_IOCON] == ioconOf(chip);
+  return same ? CHECK_OK : CHECK_MISMATCH;
+}
+
+template <class Bus>
+bool setMode(Bus &bus, Chip &chip, int bit, bool input, bool pullup) {
+  uint16_t mask = (uint16_t)(1u << bit);
+  uint16_t direction = input ? (chip.direction | mask) : (chip.direction & ~mask);
+  uint16_t pullups = (input && pullup) ? (chip.pullups | mask) : (chip.pullups & ~mask);
+  bool ok = true;
+  if (pullups != chip.pullups) {
+    ok = writePair(bus, chip, REG_GPPU, pullups) && ok;
+    if (ok) chip.pullups = pullups;
+  }
+  if (direction != chip.direction) {
+    bool changed = writePair(bus, chip, REG_IODIR, direction);
+    if (changed && chip.interrupts) changed = writePair(bus, chip, REG_GPINTEN, direction);
+    if (changed) chip.direction = direction;
+    ok = changed && ok;
+  }
+  return ok;
+}
+
+// `force` skips the cache shortcut and rewrites OLAT, then IODIR: a safety
+// stop must reach the line even if the chip lost its registers since the
+// last check().
+template <class Bus>
+bool writeBit(Bus &bus, Chip &chip, int bit, bool high, bool force = false) {
+  uint16_t mask = (uint16_t)(1u << bit);
+  uint16_t outputs = high ? (chip.outputs | mask) : (chip.outputs & ~mask);
+  if (outputs == chip.outputs && !force) return true;
+  if (!writePair(bus, chip, REG_OLAT, outputs)) return false;
+  chip.outputs = outputs;
+  return !force || writePair(bus, chip, REG_IODIR, chip.direction);
+}
+
+inline bool inputBit(const Chip &chip, int bit) { return (chip.inputs >> bit) & 1; }
+
+// Interrupt-driven sampling: with GPINTEN set a chip pulls INT low on any
+// input change, so cached samples stay exact until the shared line fires. The
+// pending flag must be cleared before re-sampling: a change during the reads
+// re-asserts INT and is picked up next time. maxAgeMs bounds the trust put in
+// the INT wiring. Without interrupts every read samples.
+inline bool needsSample(bool interruptsWired, bool interruptPending, unsigned long sampledAt,
+                        unsigned long now, unsigned long maxAgeMs) {
+  return !interruptsWired || interruptPending || now - sampledAt >= maxAgeMs;
+}
+
+inline bool hasInputs(const Chip &chip) { return chip.direction != 0; }
+
+}  // namespace IoExpanderLogic
+
+#endif  // IO_EXPANDER_LOGIC_H
@@ -72,6 +72,29 @@ inline float decrementMultiplierOnTimeout(float currentMultiplier) {
   return clampMultiplier(currentMultiplier - 0.25f);
 }
 
+// What a finished valve cycle teaches the learning algorithm, in priority
+// order. A stop by the moisture setpoint (rain sensor still dry) is not a
+// full tray: its fill time must not reach the baseline or the fill-duration
+// comparison, and a setpoint hit before the pump starts is not "already full".
+enum CycleOutcome {
+  CYCLE_NO_FLOW,      // Dry pump / blocked line - says nothing about the tray
+  CYCLE_TIMEOUT,      // Pump ran the full window, sensor never wet
+  CYCLE_SETPOINT,     // Moisture setpoint reached first - schedule only
+  CYCLE_ALREADY_FULL, // Rain sensor wet before the pump started
+  CYCLE_FILLED,       // Pump ran until the rain sensor went wet
+  CYCLE_NONE          // Stopped before either - nothing to learn
+};
+
+inline CycleOutcome classifyCycle(bool noFlowDetected, bool timeoutOccurred,
+                                  bool moistureStopped, bool pumpStarted,
+                                  bool rainDetected) {
+  if (noFlowDetected) return CYCLE_NO_FLOW;
+  if (timeoutOccurred) return CYCLE_TIMEOUT;
+  if (!rainDetected) return CYCLE_NONE;
+  if (moistureStopped) return CYCLE_SETPOINT;
+  return pumpStarted ? CYCLE_FILLED : CYCLE_ALREADY_FULL;
+}
+
 // Format time duration for display (ms to human-readable)
 inline String formatDuration(unsigned long milliseconds) {
   unsigned long seconds = milliseconds / 1000;
@@ -0,0 +1,288 @@
+#ifndef LIGHT_SCHEDULE_LOGIC_H
+#define LIGHT_SCHEDULE_LOGIC_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Plant-light schedule: up to LIGHT_MAX_WINDOWS on/off windows per day, each
+// edge either a clock time or an offset from sunrise/sunset at the configured
+// latitude/longitude. Hardware-free; PlantLightController evaluates it once
+// per transition and caches the result.
+//
+// Text form (API, status, persisted file):
+//   window[,window...]      window = EDGE..EDGE
+//   EDGE = HH:MM | sunrise[+-MIN] | sunset[+-MIN]
+//   "22:00..07:00", "sunset-30..23:00,05:30..sunrise+15", "off" (no windows)
+//
+// All minutes are relative to local midnight of "today" and may fall outside
+// [0, 1440): yesterday's overnight window ends today, tomorrow's sunrise-6h
+// window starts today.
+namespace LightScheduleLogic {
+
+const int LIGHT_MAX_WINDOWS = 4;
+const int MINUTES_PER_DAY = 1440;
+const int MAX_SUN_OFFSET_MIN = 720;
+
+enum Anchor {
+  ANCHOR_CLOCK = 0,   // minutes = minute of day
+  ANCHOR_SUNRISE,     // minutes = offset from sunrise
+  ANCHOR_SUNSET       // minutes = offset from sunset
+};
+
+struct Edge {
+  uint8_t anchor;
+  int16_t minutes;
+};
+
+struct Window {
+  Edge on;
+  Edge off;
+};
+
+struct Schedule {
+  uint8_t windowCount;
+  Window windows[LIGHT_MAX_WINDOWS];
+  float latitude;
+  float longitude;
+};
+
+// Local minutes from midnight. In polar night both equal solar noon; under
+// the midnight sun they are solar noon -/+ 12 h.
+struct SunTimes {
+  int16_t sunrise;
+  int16_t sunset;
+};
+
+// NOAA solar equations (zenith 90.833 deg: refraction + disc radius). Accurate
+// to a minute or two at moderate latitudes, which is all a lamp needs.
+// dayOfYear is 1..366; utcOffsetMin is the local offset east of UTC.
+inline SunTimes sunTimes(int dayOfYear, float latitude, float longitude,
+                         int utcOffsetMin) {
+  const double rad = M_PI / 180.0;
+  double gamma = 2.0 * M_PI / 365.0 * (dayOfYear - 1);
+  double eqTime = 229.18 * (0.000075 + 0.001868 * cos(gamma) - 0.032077 * sin(gamma) -
+                            0.014615 * cos(2 * gamma) - 0.040849 * sin(2 * gamma));
+  double decl = 0.006918 - 0.399912 * cos(gamma) + 0.070257 * sin(gamma) -
+                0.006758 * cos(2 * gamma) + 0.000907 * sin(2 * gamma) -
+                0.002697 * cos(3 * gamma) + 0.00148 * sin(3 * gamma);
+  double lat = latitude * rad;
+  double cosHa = cos(90.833 * rad) / (cos(lat) * cos(decl)) - tan(lat) * tan(decl);
+  double haDeg;
+  if (cosHa >= 1.0) {
+    haDeg = 0.0;          // Sun never rises
+  } else if (cosHa <= -1.0) {
+    haDeg = 180.0;        // Sun never sets
+  } else {
+    haDeg = acos(cosHa) / rad;
+  }
+  double noon = 720.0 - 4.0 * longitude - eqTime + utcOffsetMin;
+  SunTimes sun;
+  sun.sunrise = (int16_t)floor(noon - 4.0 * haDeg + 0.5);
+  sun.sunset = (int16_t)floor(noon + 4.0 * haDeg + 0.5);
+  return sun;
+}
+
+inline int resolve(const Edge &edge, const SunTimes &sun) {
+  switch (edge.anchor) {
+  case ANCHOR_SUNRISE: return sun.sunrise + edge.minutes;
+  case ANCHOR_SUNSET: return sun.sunset + edge.minutes;
+  default: return edge.minutes;
+  }
+}
+
+// A window's interval for the day starting at dayStart. off <= on wraps to
+// the next day (resolved with that day's sun); two equal clock edges mean all
+// day, two equal sun edges (polar night "sunrise..sunset") mean never.
+inline bool windowInterval(const Window &w, int dayStart, const SunTimes &sunDay,
+                           const SunTimes &sunNext, int &on, int &off) {
+  on = dayStart + resolve(w.on, sunDay);
+  off = dayStart + resolve(w.off, sunDay);
+  bool clockOnly = w.on.anchor == ANCHOR_CLOCK && w.off.anchor == ANCHOR_CLOCK;
+  if (off < on || (off == on && clockOnly)) {
+    off = dayStart + MINUTES_PER_DAY + resolve(w.off, sunNext);
+  }
+  return off > on;
+}
+
+// sun[0..3] = yesterday, today, tomorrow, the day after.
+inline bool isOnAt(const Schedule &s, const SunTimes sun[4], int minute) {
+  for (int d = -1; d <= 1; d++) {
+    for (int i = 0; i < s.windowCount; i++) {
+      int on, off;
+      if (windowInterval(s.windows[i], d * MINUTES_PER_DAY, sun[d + 1], sun[d + 2], on, off) &&
+          minute >= on && minute < off) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+struct Decision {
+  bool on;
+  bool changes;        // false: no transition before midnight
+  int nextMinute;      // Re-evaluate at this minute of today (<= 1440)
+};
+
+// State at `minute` (0..1439) and the next minute the state flips, capped at
+// midnight: sun times move daily, so the caller re-evaluates then anyway.
+inline Decision decide(const Schedule &s, const SunTimes sun[4], int minute) {
+  Decision decision;
+  decision.on = isOnAt(s, sun, minute);
+  decision.changes = false;
+  decision.nextMinute = MINUTES_PER_DAY;
+  for (int d = -1; d <= 1; d++) {
+    for (int i = 0; i < s.windowCount; i++) {
+      int on, off;
+      if (!windowInterval(s.windows[i], d * MINUTES_PER_DAY, sun[d + 1], sun[d + 2], on, off)) {
+        continue;
+      }
+      int edges[2] = {on, off};
+      for (int k = 0; k < 2; k++) {
+        int t = edges[k];
+        if (t <= minute || t >= decision.nextMinute) continue;
+        if (isOnAt(s, sun, t) != decision.on) {
+          decision.nextMinute = t;
+          decision.changes = true;
+        }
+      }
+    }
+  }
+  return decision;
+}
+
+// ============================================
+// Text form
+// ============================================
+
+inline const char *parseEdge(const char *p, Edge &edge) {
+  if (strncmp(p, "sunrise", 7) == 0 || strncmp(p, "sunset", 6) == 0) {
+    bool rise = p[3] == 'r';
+    edge.anchor = rise ? ANCHOR_SUNRISE : ANCHOR_SUNSET;
+    p += rise ? 7 : 6;
+    edge.minutes = 0;
+    if (*p == '+' || *p == '-') {
+      char *end;
+      long offset = strtol(p, &end, 10);
+      if (end == p + 1 || offset < -MAX_SUN_OFFSET_MIN || offset > MAX_SUN_OFFSET_MIN) return NULL;
+      edge.minutes = (int16_t)offset;
+      p = end;
+    }
+    return p;
+  }
+  if (p[0] < '0' || p[0] > '9' || p[1] < '0' || p[1] > '9' || p[2] != ':' ||
+      p[3] < '0' || p[3] > '9' || p[4] < '0' || p[4] > '9') {
+    return NULL;
+  }
+  int hour = (p[0] - '0') * 10 + (p[1] - '0');
+  int minute = (p[3] - '0') * 10 + (p[4] - '0');
+  if (hour > 23 || minute > 59) return NULL;
+  edge.anchor = ANCHOR_CLOCK;
+  edge.minutes = (int16_t)(hour * 60 + minute);
+  return p + 5;
+}
+
+// Parses the window list into `s` (latitude/longitude untouched). Spaces are
+// ignored. Returns false, leaving `s` unchanged, on any error.
+inline bool parse(const char *text, Schedule &s) {
+  char compact[128];
+  size_t n = 0;
+  for (const char *c = text; *c; c++) {
+    if (*c == ' ') continue;
+    if (n + 1 >= sizeof(compact)) return false;
+    compact[n++] = *c;
+  }
+  compact[n] = '\0';
+
+  Schedule parsed = s;
+  parsed.windowCount = 0;
+  if (strcmp(compact, "off") == 0 || n == 0) {
+    s = parsed;
+    return true;
+  }
+  const char *p = compact;
+  while (true) {
+    if (parsed.windowCount >= LIGHT_MAX_WINDOWS) return false;
+    Window &w = parsed.windows[parsed.windowCount];
+    p = parseEdge(p, w.on);
+    if (!p || p[0] != '.' || p[1] != '.') return false;
+    p = parseEdge(p + 2, w.off);
+    if (!p) return false;
+    parsed.windowCount++;
+    if (*p == '\0') break;
+    if (*p != ',') return false;
+    p++;
+  }
+  s = parsed;
+  return true;
+}
+
+inline int formatEdge(const Edge &edge, char *out, size_t outSize) {
+  if (edge.anchor == ANCHOR_CLOCK) {
+    return snprintf(out, outSize, "%02d:%02d", edge.minutes / 60, edge.minutes % 60);
+  }
+  const char *name = edge.anchor == ANCHOR_SUNRISE ? "sunrise" : "sunset";
+  if (edge.minutes == 0) return snprintf(out, outSize, "%s", name);
+  return snprintf(out, outSize, "%s%+d", name, (int)edge.minutes);
+}
+
+// Inverse of parse(); "off" for no windows.
+inline size_t format(const Schedule &s, char *out, size_t outSize) {
+  if (outSize == 0) return 0;
+  if (s.windowCount == 0) return (size_t)snprintf(out, outSize, "off");
+  size_t len = 0;
+  out[0] = '\0';
+  for (int i = 0; i < s.windowCount && len < outSize; i++) {
+    if (i > 0) len += snprintf(out + len, outSize - len, ",");
+    if (len >= outSize) break;
+    len += formatEdge(s.windows[i].on, out + len, outSize - len);
+    if (len >= outSize) break;
+    len += snprintf(out + len, outSize - len, "..");
+    if (len >= outSize) break;
+    len += formatEdge(s.windows[i].off, out + len, outSize - len);
+  }
+  return len < outSize ? len : outSize - 1;
+}
+
+inline bool usesSun(const Schedule &s) {
+  for (int i = 0; i < s.windowCount; i++) {
+    if (s.windows[i].on.anchor != ANCHOR_CLOCK || s.windows[i].off.anchor != ANCHOR_CLOCK) {
+      return true;
+    }
+  }
+  return false;
+}
+
+inline bool validLocation(float latitude, float longitude) {
+  return latitude >= -90.0f && latitude <= 90.0f && longitude >= -180.0f && longitude <= 180.0f;
+}
+
+// Minutes east of UTC, from the same instant broken down both ways (newlib
+// has no tm_gmtoff).
+inline int utcOffsetMinutes(int localYear, int localYday, int localMinuteOfDay,
+                            int utcYear, int utcYday, int utcMinuteOfDay) {
+  int dayDiff = localYday - utcYday;
+  if (localYear != utcYear) dayDiff = localYear > utcYear ? 1 : -1;
+  return dayDiff * MINUTES_PER_DAY + localMinuteOfDay - utcMinuteOfDay;
+}
+
+// Day of year (1..365) `delta` days from a 0-based tm_yday. Leap days are
+// folded into the neighbouring day; the sun moves < 1 min/day around then.
+inline int dayOfYear(int yday, int delta) {
+  return ((yday + delta) % 365 + 365) % 365 + 1;
+}
+
+inline void sunWindow(int yday, float latitude, float longitude, int utcOffsetMin,
+                      SunTimes sun[4]) {
+  for (int k = 0; k < 4; k++) {
+    sun[k] = sunTimes(dayOfYear(yday, k - 1), latitude, longitude, utcOffsetMin);
+  }
+}
+
+} // namespace LightScheduleLogic
+
+#endif // LIGHT_SCHEDULE_LOGIC_H
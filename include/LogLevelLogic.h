@@ -0,0 +1,101 @@
+#ifndef LOG_LEVEL_LOGIC_H
+#define LOG_LEVEL_LOGIC_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Pure, hardware-free log level bookkeeping shared by the firmware
+// (DebugHelper.h) and the native test suite.
+//
+// The DLOG_* macros compare a call site's subsystem and level against a small
+// runtime table before the message expression is evaluated, so a suppressed
+// line costs one byte compare instead of a chain of String concatenations.
+// DLOG_EVERY additionally keeps one RateLimit per call site for lines that sit
+// in a poll loop.
+
+enum LogSubsystem {
+  LOG_SYS_SYSTEM = 0,   // Boot, storage, OTA, misc
+  LOG_SYS_VALVE,        // Valve state machine
+  LOG_SYS_SENSOR,       // Rain, overflow, water level sensors
+  LOG_SYS_QUEUE,        // Valve queue / sequential batches
+  LOG_SYS_LEARNING,     // Interval learning
+  LOG_SYS_NETWORK,      // WiFi, Telegram, metrics
+  LOG_SYS_COUNT
+};
+
+enum LogLevel {
+  LOG_LEVEL_DEBUG = 0,
+  LOG_LEVEL_INFO,
+  LOG_LEVEL_WARN,
+  LOG_LEVEL_ERROR,
+  LOG_LEVEL_OFF
+};
+
+namespace LogLevelLogic {
+
+inline const char *subsystemName(int subsystem) {
+  switch (subsystem) {
+  case LOG_SYS_SYSTEM: return "system";
+  case LOG_SYS_VALVE: return "valve";
+  case LOG_SYS_SENSOR: return "sensor";
+  case LOG_SYS_QUEUE: return "queue";
+  case LOG_SYS_LEARNING: return "learning";
+  case LOG_SYS_NETWORK: return "network";
+  default: return "unknown";
+  }
+}
+
+inline const char *levelName(int level) {
+  switch (level) {
+  case LOG_LEVEL_DEBUG: return "debug";
+  case LOG_LEVEL_INFO: return "info";
+  case LOG_LEVEL_WARN: return "warn";
+  case LOG_LEVEL_ERROR: return "error";
+  case LOG_LEVEL_OFF: return "off";
+  default: return "unknown";
+  }
+}
+
+// Returns the subsystem, LOG_SYS_COUNT for "all", or -1.
+inline int parseSubsystem(const char *name) {
+  if (strcmp(name, "all") == 0) return LOG_SYS_COUNT;
+  for (int s = 0; s < LOG_SYS_COUNT; s++) {
+    if (strcmp(name, subsystemName(s)) == 0) return s;
+  }
+  return -1;
+}
+
+// Accepts the level names plus "warning"; returns -1 if unknown.
+inline int parseLevel(const char *name) {
+  if (strcmp(name, "warning") == 0) return LOG_LEVEL_WARN;
+  for (int l = LOG_LEVEL_DEBUG; l <= LOG_LEVEL_OFF; l++) {
+    if (strcmp(name, levelName(l)) == 0) return l;
+  }
+  return -1;
+}
+
+// One per call site (a function-local static in DLOG_EVERY).
+struct RateLimit {
+  unsigned long lastEmitMs;
+  uint32_t suppressed;
+  bool emitted;
+};
+
+// True if the call site may log now. `suppressedBefore` receives how many
+// calls were swallowed since the last emitted line (rollover-safe).
+inline bool allow(RateLimit &limit, unsigned long now, unsigned long intervalMs,
+                  uint32_t &suppressedBefore) {
+  if (limit.emitted && now - limit.lastEmitMs < intervalMs) {
+    limit.suppressed++;
+    return false;
+  }
+  suppressedBefore = limit.suppressed;
+  limit.suppressed = 0;
+  limit.lastEmitMs = now;
+  limit.emitted = true;
+  return true;
+}
+
+} // namespace LogLevelLogic
+
+#endif // LOG_LEVEL_LOGIC_H
@@ -0,0 +1,244 @@
+#ifndef LOOP_DEADLINE_MONITOR_H
+#define LOOP_DEADLINE_MONITOR_H
+
+#include <Arduino.h>
+#include <esp_task_wdt.h>
+#include <esp_system.h>
+#include <esp_attr.h>
+#include <soc/gpio_struct.h>
+#include "config.h"
+#include "DebugHelper.h"
+#include "BinaryLog.h"
+#include "DeadlineMonitorLogic.h"
+
+// Monitored tasks (index into LoopDeadlineMonitor::tasks)
+enum DeadlineTask {
+    DEADLINE_TASK_CONTROL = 0,   // loop() on Core 1 - watering control
+    DEADLINE_TASK_NETWORK = 1,   // networkTask on Core 0
+    DEADLINE_TASK_COUNT
+};
+
+// Survives a software/watchdog reset (not a power cycle). Written right before
+// the reset so the next boot can report which task/stage stalled.
+#define DEADLINE_RESET_MAGIC 0xDEAD1157UL
+RTC_NOINIT_ATTR uint32_t g_deadlineResetMagic;
+RTC_NOINIT_ATTR int32_t g_deadlineResetTask;
+RTC_NOINIT_ATTR int32_t g_deadlineResetStage;
+RTC_NOINIT_ATTR uint32_t g_deadlineResetElapsedMs;
+RTC_NOINIT_ATTR uint32_t g_deadlineHardResets;
+
+// ============================================
+// LoopDeadlineMonitor - per-task deadlines on top of the ESP-IDF task watchdog
+// Header-only static class (same pattern as DebugHelper)
+//
+// Two layers:
+//  1. Each task marks its stages and closes every pass with endCycle(). Passes
+//     over the soft deadline are counted per culprit stage (exported as metrics).
+//     Each task also checks its peer: a task silent for longer than its hard
+//     deadline gets a GPIO-level safe shutdown followed by esp_restart().
+//  2. Both tasks are subscribed to the IDF task watchdog (TASK_WDT_TIMEOUT_S)
+//     as a backstop for the case where both cores are stuck. Its ISR hook also
+//     drives pump and valves LOW before the panic reset.
+// ============================================
+class LoopDeadlineMonitor {
+private:
+    static DeadlineMonitorLogic::TaskDeadlineState tasks[DEADLINE_TASK_COUNT];
+    static bool subscribed[DEADLINE_TASK_COUNT];
+    static bool wdtReady;
+    static unsigned long lastMissLogTime;
+
+public:
+    static void init() {
+        unsigned long now = millis();
+        DeadlineMonitorLogic::reset(tasks[DEADLINE_TASK_CONTROL],
+                                    CONTROL_LOOP_SOFT_DEADLINE_MS,
+                                    CONTROL_LOOP_HARD_DEADLINE_MS, now);
+        DeadlineMonitorLogic::reset(tasks[DEADLINE_TASK_NETWORK],
+                                    NETWORK_TASK_SOFT_DEADLINE_MS,
+                                    NETWORK_TASK_HARD_DEADLINE_MS, now);
+
+        // Arduino core already initialises the TWDT (idle task watch); on IDF 4.x
+        // a second init just updates timeout and panic mode.
+        esp_err_t err = esp_task_wdt_init(TASK_WDT_TIMEOUT_S, true);
+        wdtReady = (err == ESP_OK);
+        if (!wdtReady) {
+            DebugHelper::debugImportant("⚠️ Task watchdog init failed: " + String((int)err));
+        }
+
+        reportPreviousReset();
+    }
+
+    // Subscribe the calling task to the IDF task watchdog and start its clock.
+    static void subscribeCurrentTask(DeadlineTask task) {
+        DeadlineMonitorLogic::beginCycle(tasks[task], millis());
+        if (!wdtReady || subscribed[task]) return;
+        if (esp_task_wdt_add(NULL) == ESP_OK) {
+            subscribed[task] = true;
+            DebugHelper::debug("✓ Task watchdog: " + String(taskName(task)) +
+                               " subscribed (hard deadline " +
+                               String(tasks[task].hardDeadlineMs) + "ms)");
+        } else {
+            DebugHelper::debugImportant("⚠️ Task watchdog: failed to subscribe " + String(taskName(task)));
+        }
+    }
+
+    static void beginCycle(DeadlineTask task) {
+        DeadlineMonitorLogic::beginCycle(tasks[task], millis());
+    }
+
+    static void enterStage(DeadlineTask task, LoopStage stage) {
+        DeadlineMonitorLogic::enterStage(tasks[task], stage, millis());
+    }
+
+    // Keep a long but healthy stage alive (e.g. per OTA upload chunk) without
+    // closing the cycle.
+    static void heartbeat(DeadlineTask task) {
+        tasks[task].lastHeartbeat = millis();
+        if (subscribed[task]) esp_task_wdt_reset();
+    }
+
+    // Close the pass: feed the TWDT, count a miss against the slowest stage,
+    // and make sure the peer task is still alive.
+    static void endCycle(DeadlineTask task) {
+        unsigned long now = millis();
+        DeadlineMonitorLogic::TaskDeadlineState &s = tasks[task];
+        DeadlineVerdict verdict = DeadlineMonitorLogic::endCycle(s, now);
+        if (subscribed[task]) esp_task_wdt_reset();
+
+        if (verdict != DEADLINE_OK &&
+            (lastMissLogTime == 0 || now - lastMissLogTime >= DEADLINE_MISS_LOG_INTERVAL_MS)) {
+            lastMissLogTime = now;
+            BLOG_WARN("Deadline miss: %s cycle %lums > %lums, culprit stage %s (%lums)",
+                      taskName(task), s.lastCycleMs, s.softDeadlineMs,
+                      loopStageToString(s.slowestStage), s.slowestStageMs);
+        }
+
+        checkPeer(task == DEADLINE_TASK_CONTROL ? DEADLINE_TASK_NETWORK : DEADLINE_TASK_CONTROL, now);
+    }
+
+    // Metrics accessors
+    static uint32_t getMissCount(DeadlineTask task, int stage) {
+        return tasks[task].missesByStage[stage];
+    }
+    static uint32_t getTotalMisses(DeadlineTask task) { return tasks[task].softMisses; }
+    static unsigned long getMaxCycleMs(DeadlineTask task) { return tasks[task].maxCycleMs; }
+    static unsigned long getLastCycleMs(DeadlineTask task) { return tasks[task].lastCycleMs; }
+    // Passes closed with endCycle(); safe to poll from the other core.
+    static uint32_t getCompletedCycles(DeadlineTask task) {
+        return __atomic_load_n(&tasks[task].cycles, __ATOMIC_ACQUIRE);
+    }
+    // Worst pass since the previous call; read from the other core, a lost
+    // update only drops one pass from one sample.
+    static unsigned long takeWindowMaxCycleMs(DeadlineTask task) {
+        return DeadlineMonitorLogic::takeWindowMax(tasks[task]);
+    }
+    static uint32_t getHardResetCount() {
+        return g_deadlineResetMagic == DEADLINE_RESET_MAGIC ? g_deadlineHardResets : 0;
+    }
+
+    static const char *taskName(int task) {
+        return task == DEADLINE_TASK_CONTROL ? "control" : "network";
+    }
+
+    // GPIO-level safe state: pump, valves and rain sensor power LOW via direct
+    // register writes. No locks, no flash access - callable from the TWDT ISR
+    // and from a task that is about to reset the chip. Valves on an I/O
+    // expander need the I2C bus and are skipped; the pump going LOW stops the
+    // water regardless.
+    static void IRAM_ATTR safeShutdownGpio() {
+        uint32_t lowMask = 0;
+        uint32_t highMask = 0;
+        addToMask(PUMP_PIN, lowMask, highMask);
+        addToMask(RAIN_SENSOR_POWER_PIN, lowMask, highMask);
+        for (int i = 0; i < NUM_VALVES; i++) {
+            if (VALVE_PINS[i] < IO_EXPANDER_PIN_BASE) addToMask(VALVE_PINS[i], lowMask, highMask);
+        }
+        GPIO.out_w1tc = lowMask;
+        GPIO.out1_w1tc.val = highMask;
+    }
+
+    // Record which stage stalled so the next boot can report it.
+    static void IRAM_ATTR recordHardMiss(int task, int stage, unsigned long elapsedMs) {
+        if (g_deadlineResetMagic != DEADLINE_RESET_MAGIC) {
+            g_deadlineHardResets = 0;
+        }
+        g_deadlineResetMagic = DEADLINE_RESET_MAGIC;
+        g_deadlineResetTask = task;
+        g_deadlineResetStage = stage;
+        g_deadlineResetElapsedMs = elapsedMs;
+        g_deadlineHardResets++;
+    }
+
+    // Called from the TWDT ISR: blame whichever task has been silent longest.
+    static void IRAM_ATTR onTaskWatchdog() {
+        safeShutdownGpio();
+        unsigned long now = millis();
+        unsigned long controlSilent = now - tasks[DEADLINE_TASK_CONTROL].lastHeartbeat;
+        unsigned long networkSilent = now - tasks[DEADLINE_TASK_NETWORK].lastHeartbeat;
+        int culprit = controlSilent >= networkSilent ? DEADLINE_TASK_CONTROL : DEADLINE_TASK_NETWORK;
+        recordHardMiss(culprit, tasks[culprit].currentStage,
+                       culprit == DEADLINE_TASK_CONTROL ? controlSilent : networkSilent);
+    }
+
+private:
+    static void IRAM_ATTR addToMask(int pin, uint32_t &lowMask, uint32_t &highMask) {
+        if (pin < 32) {
+            lowMask |= (1UL << pin);
+        } else {
+            highMask |= (1UL << (pin - 32));
+        }
+    }
+
+    static void checkPeer(DeadlineTask peer, unsigned long now) {
+        DeadlineMonitorLogic::TaskDeadlineState &p = tasks[peer];
+        if (!subscribed[peer] || !DeadlineMonitorLogic::isStalled(p, now)) return;
+
+        // Hard miss: hardware safe state FIRST, then diagnostics, then reset.
+        safeShutdownGpio();
+        unsigned long elapsed = now - p.lastHeartbeat;
+        recordHardMiss(peer, p.currentStage, elapsed);
+        Serial.println(String("🚨 HARD DEADLINE MISS: ") + taskName(peer) +
+                       " stalled " + String(elapsed) + "ms in stage " +
+                       loopStageToString(p.currentStage) + " - safe shutdown + restart");
+        Serial.flush();
+        esp_restart();
+    }
+
+    static void reportPreviousReset() {
+        if (g_deadlineResetMagic != DEADLINE_RESET_MAGIC) {
+            g_deadlineHardResets = 0;
+            return;
+        }
+        esp_reset_reason_t reason = esp_reset_reason();
+        if (reason != ESP_RST_SW && reason != ESP_RST_TASK_WDT && reason != ESP_RST_PANIC) {
+            return;
+        }
+        if (g_deadlineResetStage < 0 || g_deadlineResetStage >= LOOP_STAGE_COUNT) {
+            return;
+        }
+        DebugHelper::debugImportant(String("🚨 Previous reset: ") +
+                                    taskName(g_deadlineResetTask) + " task stalled " +
+                                    String(g_deadlineResetElapsedMs) + "ms in stage " +
+                                    loopStageToString(g_deadlineResetStage) +
+                                    " (deadline resets since power-on: " +
+                                    String(g_deadlineHardResets) + ")");
+        // Report once; keep the counter
+        g_deadlineResetStage = -1;
+    }
+};
+
+// ============================================
+// Static Member Initialization
+// ============================================
+DeadlineMonitorLogic::TaskDeadlineState LoopDeadlineMonitor::tasks[DEADLINE_TASK_COUNT];
+bool LoopDeadlineMonitor::subscribed[DEADLINE_TASK_COUNT] = {false, false};
+bool LoopDeadlineMonitor::wdtReady = false;
+unsigned long LoopDeadlineMonitor::lastMissLogTime = 0;
+
+// IDF task watchdog ISR hook (weak in esp_task_wdt). Runs before the panic
+// reset when a subscribed task stops feeding the TWDT entirely.
+extern "C" void IRAM_ATTR esp_task_wdt_isr_user_handler(void) {
+    LoopDeadlineMonitor::onTaskWatchdog();
+}
+
+#endif // LOOP_DEADLINE_MONITOR_H
@@ -8,11 +8,23 @@
 #include <time.h>
 #include "config.h"
 #include "ValveController.h"
+#include "MoistureSensors.h"
+#include "FlowMeter.h"
+#include "PowerManager.h"
+#include "LoopDeadlineMonitor.h"
+#include "OtaPipeline.h"
+#include "BinaryLog.h"
+#include "DnsCache.h"
+#include "MetricsWireFormat.h"
+#include "GzipLogic.h"
 
 // Forward declaration - WateringSystem is included after class definition
 class WateringSystem;
 extern WateringSystem* g_wateringSystem_ptr;
 
+static_assert(DEADLINE_TASK_COUNT * LOOP_STAGE_COUNT <= MetricsWireFormat::MAX_MISSES,
+              "deadline miss counters would be dropped from metrics pushes");
+
 // ============================================
 // Metrics Log Entry
 // ============================================
@@ -40,6 +52,31 @@ private:
     static int logPushAttempts;
     static int logPushSuccesses;
 
+    // Binary log: format IDs the proxy has acknowledged, and whether it
+    // speaks /v1/logs/push-binary at all (older proxies answer 404)
+    static uint32_t knownFormats[BINARY_LOG_MAX_FORMATS];
+    static int knownFormatCount;
+    static bool binaryLogsUnsupported;
+
+    // Binary metrics (MetricsWireFormat): `base` is the last snapshot the
+    // proxy acknowledged, so the next frame only needs what changed since
+    static MetricsWireFormat::Snapshot snapshot;
+    static MetricsWireFormat::Snapshot base;
+    static bool haveBase;
+    static uint16_t baseSeq;
+    static uint16_t frameSeq;
+    static bool schemaAcknowledged;
+    static bool binaryMetricsUnsupported;
+    static uint8_t wireBuffer[METRICS_WIRE_BUFFER_SIZE];
+    static uint32_t lastPayloadBytes;
+    static uint32_t lastEncodeUs;
+
+    // Upload compression: bytes the proxy received before / after gzip, and
+    // whether it turned down Content-Encoding: gzip
+    static bool gzipUnsupported;
+    static uint32_t uploadRawBytes;
+    static uint32_t uploadWireBytes;
+
     // HTTP helpers (same pattern as TelegramNotifier)
     static bool useProxy() {
         return String(METRICS_PROXY_BASE_URL).length() > 0;
@@ -61,7 +98,7 @@ private:
         }
     }
 
-    static bool beginHttp(HTTPClient& http, const String& url, WiFiClientSecure& secureClient, WiFiClient& plainClient) {
+    static bool beginHttp(HTTPClient& http, const String& url, DnsCachedSecureClient& secureClient, DnsCachedClient& plainClient) {
         if (url.startsWith("https://")) {
             secureClient.setInsecure();
             return http.begin(secureClient, url);
@@ -90,10 +127,17 @@ private:
     }
 
     static bool isAnyValveActive();
+    static void collectSnapshot(MetricsWireFormat::Snapshot& s);
     static String buildMetricsJson();
     static String buildLogsJson();
     static bool pushMetrics(const String& json);
+    static int postBinaryMetrics(bool full, unsigned long startUs);
+    static int sendToProxy(const char* path, const char* contentType, const uint8_t* body, size_t len, bool gzip);
+    static int postToProxy(const char* path, const char* contentType, const uint8_t* body, size_t len);
+    static bool pushBinaryMetrics();
     static bool pushLogs(const String& json);
+    static void pushBinaryLogs();
+    static void convertBinaryLogsToText();
 
 public:
     // Callback for g_metricsLog function pointer (set in init)
@@ -138,11 +182,28 @@ unsigned long MetricsPusher::lastPushTime = 0;
 int MetricsPusher::lastLogPushHttpCode = 0;
 int MetricsPusher::logPushAttempts = 0;
 int MetricsPusher::logPushSuccesses = 0;
+uint32_t MetricsPusher::knownFormats[BINARY_LOG_MAX_FORMATS];
+int MetricsPusher::knownFormatCount = 0;
+bool MetricsPusher::binaryLogsUnsupported = false;
+MetricsWireFormat::Snapshot MetricsPusher::snapshot;
+MetricsWireFormat::Snapshot MetricsPusher::base;
+bool MetricsPusher::haveBase = false;
+uint16_t MetricsPusher::baseSeq = 0;
+uint16_t MetricsPusher::frameSeq = 0;
+bool MetricsPusher::schemaAcknowledged = false;
+bool MetricsPusher::binaryMetricsUnsupported = false;
+uint8_t MetricsPusher::wireBuffer[METRICS_WIRE_BUFFER_SIZE];
+uint32_t MetricsPusher::lastPayloadBytes = 0;
+uint32_t MetricsPusher::lastEncodeUs = 0;
+bool MetricsPusher::gzipUnsupported = false;
+uint32_t MetricsPusher::uploadRawBytes = 0;
+uint32_t MetricsPusher::uploadWireBytes = 0;
 
 // ============================================
 // Include WateringSystem AFTER static member init to avoid circular deps
 // ============================================
 #include "WateringSystem.h"
+#include "NetworkManager.h"
 
 // ============================================
 // Implementation (needs WateringSystem)
@@ -161,14 +222,22 @@ inline void MetricsPusher::loop() {
     if (!useProxy() || !WiFi.isConnected()) return;
 
     unsigned long now = millis();
-    unsigned long interval = isAnyValveActive() ? METRICS_PUSH_INTERVAL_ACTIVE_MS : METRICS_PUSH_INTERVAL_IDLE_MS;
+    unsigned long interval = isAnyValveActive() ? RuntimeConfig::get().metricsPushActiveMs
+                                                : RuntimeConfig::get().metricsPushIdleMs;
 
     if (lastPushTime != 0 && (now - lastPushTime) < interval) return;
     lastPushTime = now;
 
-    // Push metrics
-    String metricsJson = buildMetricsJson();
-    pushMetrics(metricsJson);
+    // Push metrics: compact binary frame, JSON for proxies without it
+    if (METRICS_BINARY_PUSH && !binaryMetricsUnsupported) {
+        pushBinaryMetrics();
+    }
+    if (!METRICS_BINARY_PUSH || binaryMetricsUnsupported) {
+        pushMetrics(buildMetricsJson());
+    }
+
+    // Binary records first: on an old proxy they fall back to text entries
+    pushBinaryLogs();
 
     // Push logs if buffer non-empty
     if (logCount > 0) {
@@ -183,72 +252,83 @@ inline void MetricsPusher::loop() {
     }
 }
 
-inline String MetricsPusher::buildMetricsJson() {
-    String json = "{";
-
-    // Uptime
-    json += "\"uptime_s\":" + String(millis() / 1000);
-
-    // Free heap
-    json += ",\"free_heap\":" + String(ESP.getFreeHeap());
-
-    // WiFi RSSI
-    json += ",\"wifi_rssi\":" + String(WiFi.RSSI());
+inline void MetricsPusher::collectSnapshot(MetricsWireFormat::Snapshot& s) {
+    using namespace MetricsWireFormat;
+    clear(s);
+
+    set(s, SYS_UPTIME_S, millis() / 1000);
+    set(s, SYS_FREE_HEAP, ESP.getFreeHeap());
+    set(s, SYS_WIFI_RSSI, WiFi.RSSI());
+
+    // WiFi link state machine: attempts, reconnects and how long they took
+    const WifiLinkLogic::Link &link = NetworkManager::getLink();
+    set(s, SYS_WIFI_CONNECT_ATTEMPTS, link.attempts);
+    set(s, SYS_WIFI_RECONNECTS, link.reconnects);
+    set(s, SYS_WIFI_LAST_CONNECT_MS, link.lastConnectMs);
+    set(s, SYS_WIFI_LAST_OUTAGE_MS, link.lastOutageMs);
+    set(s, SYS_WIFI_LAST_OUTAGE_ATTEMPTS, link.lastOutageAttempts);
+    set(s, SYS_WIFI_DISCONNECT_REASON, link.lastDisconnectReason);
+    set(s, SYS_WIFI_ASSOC_TO_IP_MS, link.lastAssocToIpMs);
+    set(s, SYS_WIFI_LAST_CONNECT_DIRECTED, link.lastConnectDirected ? 1 : 0);
+    set(s, SYS_WIFI_DIRECTED_ATTEMPTS, link.directedAttempts);
+    set(s, SYS_WIFI_DIRECTED_FAILURES, link.directedFailures);
+    set(s, SYS_DNS_HITS, DnsCache::getHits());
+    set(s, SYS_DNS_MISSES, DnsCache::getMisses());
+    set(s, SYS_DNS_PREFETCHES, DnsCache::getPrefetches());
+    set(s, SYS_DNS_STALE_SERVED, DnsCache::getStaleServed());
+    set(s, SYS_DNS_FAILURES, DnsCache::getFailures());
 
     if (g_wateringSystem_ptr) {
-        // Pump
-        json += ",\"pump\":" + String(g_wateringSystem_ptr->getPumpState() == PUMP_ON ? 1 : 0);
-
-        // Overflow
-        json += ",\"overflow\":" + String(g_wateringSystem_ptr->isOverflowDetected() ? 1 : 0);
-        json += ",\"overflow_streak\":" + String(g_wateringSystem_ptr->getOverflowDetectionStreak());
-
-        // Water tank
-        json += ",\"water_tank_ok\":" + String(g_wateringSystem_ptr->isWaterLevelLow() ? 0 : 1);
-
-        // Plant light
-        json += ",\"plant_light\":" + String(g_wateringSystem_ptr->isPlantLightOn() ? 1 : 0);
-
-        // Telegram failures
-        json += ",\"telegram_failures\":" + String(g_telegramFailures);
+        set(s, SYS_PUMP, g_wateringSystem_ptr->getPumpState() == PUMP_ON ? 1 : 0);
+        set(s, SYS_OVERFLOW, g_wateringSystem_ptr->isOverflowDetected() ? 1 : 0);
+        set(s, SYS_OVERFLOW_STREAK, g_wateringSystem_ptr->getOverflowDetectionStreak());
+        set(s, SYS_WATER_TANK_OK, g_wateringSystem_ptr->isWaterLevelLow() ? 0 : 1);
+        set(s, SYS_PLANT_LIGHT, g_wateringSystem_ptr->isPlantLightOn() ? 1 : 0);
+        set(s, SYS_TELEGRAM_FAILURES, g_telegramFailures);
 
         // Valves
         unsigned long currentTime = millis();
-        json += ",\"valves\":[";
         for (int i = 0; i < NUM_VALVES; i++) {
             ValveController* v = g_wateringSystem_ptr->getValve(i);
             if (!v) continue;
+            Valve* out = addValve(s, (uint8_t)i);
+            if (!out) break;
 
-            if (i > 0) json += ",";
-            json += "{";
-            json += "\"id\":" + String(i);
-            json += ",\"state\":" + String(v->state == VALVE_OPEN ? 1 : 0);
-            json += ",\"phase\":" + String((int)v->phase);
-            json += ",\"rain\":" + String(v->rainDetected ? 1 : 0);
+            set(*out, VALVE_STATE, v->state == VALVE_OPEN ? 1 : 0);
+            set(*out, VALVE_PHASE, (int)v->phase);
+            set(*out, VALVE_RAIN, v->rainDetected ? 1 : 0);
 
             // Watering duration in seconds
             unsigned long wateringSec = 0;
             if (v->phase == PHASE_WATERING && v->wateringStartTime > 0) {
                 wateringSec = (currentTime - v->wateringStartTime) / 1000;
             }
-            json += ",\"watering_s\":" + String(wateringSec);
+            set(*out, VALVE_WATERING_S, wateringSec);
 
             // Water level percentage
             float waterLevel = calculateCurrentWaterLevel(v, currentTime);
-            json += ",\"water_level_pct\":" + String((int)waterLevel);
+            set(*out, VALVE_WATER_LEVEL_PCT, (int)waterLevel);
+            if (MoistureSensors::hasChannel(i) && v->moisturePercent >= 0) {
+                setFloat(*out, VALVE_MOISTURE_PCT, v->moisturePercent);
+            }
+            if (FlowMeter::present()) {
+                setFloat(*out, VALVE_LAST_CYCLE_L, v->lastCycleLitres);
+                setFloat(*out, VALVE_FLOW_LPM, v->lastFlowRateLpm);
+                set(*out, VALVE_NO_FLOW, v->noFlowDetected ? 1 : 0);
+            }
 
             // Learning data
-            json += ",\"calibrated\":" + String(v->isCalibrated ? 1 : 0);
-            json += ",\"auto_watering\":" + String(v->autoWateringEnabled ? 1 : 0);
-            json += ",\"interval_mult\":" + String(v->intervalMultiplier, 2);
-            json += ",\"total_cycles\":" + String(v->totalWateringCycles);
+            set(*out, VALVE_CALIBRATED, v->isCalibrated ? 1 : 0);
+            set(*out, VALVE_AUTO_WATERING, v->autoWateringEnabled ? 1 : 0);
+            setFloat(*out, VALVE_INTERVAL_MULT, v->intervalMultiplier);
+            set(*out, VALVE_TOTAL_CYCLES, v->totalWateringCycles);
 
             // Time since last watering
             unsigned long timeSince = 0;
             if (hasLastWateringReference(v)) {
                 timeSince = getTimeSinceLastWatering(v, currentTime);
             }
-            json += ",\"time_since_ms\":" + String(timeSince);
+            set(*out, VALVE_TIME_SINCE_MS, timeSince);
 
             // Time until empty
             unsigned long timeUntilEmpty = 0;
@@ -258,14 +338,14 @@ inline String MetricsPusher::buildMetricsJson() {
                     timeUntilEmpty = v->emptyToFullDuration - ts;
                 }
             }
-            json += ",\"time_until_empty_ms\":" + String(timeUntilEmpty);
+            set(*out, VALVE_TIME_UNTIL_EMPTY_MS, timeUntilEmpty);
 
             // Time since last watering attempt (for 24h safety interval tracking)
             unsigned long timeSinceAttempt = 0;
             if (hasLastWateringAttemptReference(v)) {
                 timeSinceAttempt = getTimeSinceLastWateringAttempt(v, currentTime);
             }
-            json += ",\"time_since_attempt_ms\":" + String(timeSinceAttempt);
+            set(*out, VALVE_TIME_SINCE_ATTEMPT_MS, timeSinceAttempt);
 
             // Time until next watering (mirrors shouldWaterNow logic)
             // max(emptyToFullDuration - timeSince, 24h_min - timeSinceAttempt, 0)
@@ -281,24 +361,83 @@ inline String MetricsPusher::buildMetricsJson() {
                 }
                 timeUntilNext = consumptionRemaining > safetyRemaining ? consumptionRemaining : safetyRemaining;
             }
-            json += ",\"time_until_next_ms\":" + String(timeUntilNext);
+            set(*out, VALVE_TIME_UNTIL_NEXT_MS, timeUntilNext);
 
-            json += ",\"baseline_fill_ms\":" + String(v->baselineFillDuration);
-            json += ",\"last_fill_ms\":" + String(v->lastFillDuration);
-            json += ",\"empty_duration_ms\":" + String(v->emptyToFullDuration);
+            set(*out, VALVE_BASELINE_FILL_MS, v->baselineFillDuration);
+            set(*out, VALVE_LAST_FILL_MS, v->lastFillDuration);
+            set(*out, VALVE_EMPTY_DURATION_MS, v->emptyToFullDuration);
+        }
+    }
 
-            json += "}";
+    // Task deadline monitor: loop latency and soft misses by culprit stage
+    set(s, SYS_LOOP_LAST_MS, LoopDeadlineMonitor::getLastCycleMs(DEADLINE_TASK_CONTROL));
+    set(s, SYS_LOOP_MAX_MS, LoopDeadlineMonitor::getMaxCycleMs(DEADLINE_TASK_CONTROL));
+    set(s, SYS_NET_LOOP_MAX_MS, LoopDeadlineMonitor::getMaxCycleMs(DEADLINE_TASK_NETWORK));
+    set(s, SYS_DEADLINE_HARD_RESETS, LoopDeadlineMonitor::getHardResetCount());
+    for (int t = 0; t < DEADLINE_TASK_COUNT; t++) {
+        for (int stage = 0; stage < LOOP_STAGE_COUNT; stage++) {
+            uint32_t count = LoopDeadlineMonitor::getMissCount((DeadlineTask)t, stage);
+            if (count == 0) continue;
+            addMiss(s, LoopDeadlineMonitor::taskName(t), loopStageToString(stage), count);
         }
-        json += "]";
     }
 
+    // OTA pipeline: the update that installed this firmware, failures since boot
+    set(s, SYS_OTA_LAST_BYTES, OtaPipeline::getLastBootUpdateBytes());
+    set(s, SYS_OTA_LAST_DURATION_MS, OtaPipeline::getLastBootUpdateDurationMs());
+    set(s, SYS_OTA_LAST_THROUGHPUT_BPS, OtaPipeline::getLastBootUpdateThroughputBps());
+    set(s, SYS_OTA_FAILURES, OtaPipeline::getFailureCount());
+
+    // I/O expanders (0 when the zone topology uses ESP32 GPIOs only)
+    set(s, SYS_IO_EXPANDER_BUS_ERRORS, ZoneIO::getBusErrors());
+    if (FlowMeter::present()) {
+        set(s, SYS_FLOW_METER_PULSES, FlowMeter::totalPulses());
+    }
+
+    // Power management: time per mode / WiFi level, modelled current, wake latency
+    PowerLogic::Stats power = PowerManager::getStats();
+    set(s, SYS_POWER_MODE, (int)PowerManager::getMode());
+    set(s, SYS_POWER_IDLE_S, (uint32_t)(power.modeMs[PowerLogic::MODE_IDLE] / 1000));
+    set(s, SYS_POWER_ACTIVE_S, (uint32_t)(power.modeMs[PowerLogic::MODE_ACTIVE] / 1000));
+    set(s, SYS_WIFI_PS, (int)PowerManager::getWifiSave());
+    setFloat(s, SYS_POWER_EST_MA, PowerManager::currentMa());
+    setFloat(s, SYS_POWER_AVG_MA, PowerManager::averageCurrentMa());
+    set(s, SYS_WAKE_COUNT, power.wakes);
+    set(s, SYS_WAKE_LATENCY_LAST_US, power.lastWakeLatencyUs);
+    set(s, SYS_WAKE_LATENCY_MAX_US, power.maxWakeLatencyUs);
+
     // Log push diagnostics (visible in Prometheus for debugging)
-    json += ",\"log_buffer_count\":" + String(logCount);
-    json += ",\"log_push_last_code\":" + String(lastLogPushHttpCode);
-    json += ",\"log_push_attempts\":" + String(logPushAttempts);
-    json += ",\"log_push_successes\":" + String(logPushSuccesses);
+    set(s, SYS_LOG_BUFFER_COUNT, logCount);
+    set(s, SYS_LOG_PUSH_LAST_CODE, lastLogPushHttpCode);
+    set(s, SYS_LOG_PUSH_ATTEMPTS, logPushAttempts);
+    set(s, SYS_LOG_PUSH_SUCCESSES, logPushSuccesses);
+    set(s, SYS_BLOG_PENDING, BinaryLog::getRecordCount());
+    set(s, SYS_BLOG_DROPPED, BinaryLog::getDroppedCount());
+
+    // Cost of the previous push (whichever format it used)
+    set(s, SYS_METRICS_PAYLOAD_BYTES, lastPayloadBytes);
+    set(s, SYS_METRICS_ENCODE_US, lastEncodeUs);
+    set(s, SYS_UPLOAD_RAW_BYTES, uploadRawBytes);
+    set(s, SYS_UPLOAD_WIRE_BYTES, uploadWireBytes);
+}
 
-    json += "}";
+// JSON push body for proxies without /v1/metrics/push-binary
+inline String MetricsPusher::buildMetricsJson() {
+    unsigned long start = micros();
+    collectSnapshot(snapshot);
+    String json;
+    size_t len = MetricsWireFormat::toJson(snapshot, nullptr, 0);  // Measure only
+    char* buf = (char*)malloc(len + 1);
+    if (buf && MetricsWireFormat::toJson(snapshot, buf, len + 1) == len) {
+        json = buf;
+    }
+    free(buf);
+    if (json.length() != len) {
+        Serial.println("[MetricsPusher] Out of memory for " + String(len) + " byte metrics JSON");
+        json = "";
+    }
+    lastEncodeUs = micros() - start;
+    lastPayloadBytes = json.length();
     return json;
 }
 
@@ -367,47 +506,121 @@ inline String MetricsPusher::buildLogsJson() {
     return json;
 }
 
-inline bool MetricsPusher::pushMetrics(const String& json) {
+inline int MetricsPusher::sendToProxy(const char* path, const char* contentType, const uint8_t* body, size_t len,
+                                      bool gzip) {
     HTTPClient http;
-    WiFiClientSecure secureClient;
-    WiFiClient plainClient;
-
-    String url = proxyBaseUrl() + "/v1/metrics/push";
-    if (!beginHttp(http, url, secureClient, plainClient)) {
-        return false;
+    DnsCachedSecureClient secureClient;
+    DnsCachedClient plainClient;
+    if (!beginHttp(http, proxyBaseUrl() + path, secureClient, plainClient)) {
+        return -1;
     }
-
-    http.addHeader("Content-Type", "application/json");
+    http.addHeader("Content-Type", contentType);
+    if (gzip) http.addHeader("Content-Encoding", "gzip");
     applyAuthHeader(http);
     http.setTimeout(METRICS_HTTP_TIMEOUT_MS);
-
-    int httpCode = http.POST(json);
+    int httpCode = http.POST(const_cast<uint8_t*>(body), len);
     http.end();
+    return httpCode;
+}
+
+// Every upload to the proxy goes through here. Bodies of UPLOAD_GZIP_MIN_BYTES
+// and up are gzip-compressed when that makes them smaller. A 400 / 415 to the
+// gzip body is retried plain; if that succeeds, the proxy only gets plain bodies.
+inline int MetricsPusher::postToProxy(const char* path, const char* contentType, const uint8_t* body, size_t len) {
+    uint8_t* packed = nullptr;
+    size_t packedLen = 0;
+    if (UPLOAD_GZIP && !gzipUnsupported && len >= UPLOAD_GZIP_MIN_BYTES) {
+        GzipLogic::Compressor* z = (GzipLogic::Compressor*)malloc(sizeof(GzipLogic::Compressor));
+        packed = (uint8_t*)malloc(len);  // No room to grow: larger output = not worth it
+        if (z && packed) {
+            GzipLogic::begin(*z, packed, len);
+            GzipLogic::write(*z, body, len);
+            packedLen = GzipLogic::finish(*z);
+        }
+        free(z);
+        if (packedLen == 0) {
+            free(packed);
+            packed = nullptr;
+        }
+    }
 
+    bool rejected = false;
+    if (packed) {
+        int httpCode = sendToProxy(path, contentType, packed, packedLen, true);
+        free(packed);
+        if (httpCode > 0) {
+            uploadRawBytes += len;
+            uploadWireBytes += packedLen;
+        }
+        if (httpCode != 400 && httpCode != 415) return httpCode;
+        rejected = true;
+    }
+
+    int httpCode = sendToProxy(path, contentType, body, len, false);
+    if (httpCode > 0) {
+        uploadRawBytes += len;
+        uploadWireBytes += len;
+    }
+    // Only blame the encoding if the same body goes through uncompressed
+    if (rejected && httpCode >= 200 && httpCode < 300) {
+        gzipUnsupported = true;
+        Serial.println("[MetricsPusher] Proxy rejects gzip uploads, sending plain bodies from now on");
+    }
+    return httpCode;
+}
+
+inline bool MetricsPusher::pushMetrics(const String& json) {
+    if (json.length() == 0) return false;  // buildMetricsJson() failed and said why
+    int httpCode = postToProxy("/v1/metrics/push", "application/json", (const uint8_t*)json.c_str(), json.length());
     return (httpCode >= 200 && httpCode < 300);
 }
 
-inline bool MetricsPusher::pushLogs(const String& json) {
-    logPushAttempts++;
+// Encodes the current snapshot (a delta against the acknowledged base unless
+// `full`) and posts it. Returns the HTTP code, -1 if nothing was sent.
+// lastEncodeUs covers startUs up to the end of encoding.
+inline int MetricsPusher::postBinaryMetrics(bool full, unsigned long startUs) {
+    bool delta = !full && haveBase && MetricsWireFormat::canDelta(snapshot, base);
+    uint16_t seq = frameSeq + 1;
+    size_t len = MetricsWireFormat::encode(snapshot, delta ? &base : nullptr, seq, baseSeq,
+                                           full || !schemaAcknowledged, wireBuffer, sizeof(wireBuffer));
+    lastEncodeUs = micros() - startUs;
+    if (len == 0) {
+        Serial.println("[MetricsPusher] Binary metrics frame exceeds METRICS_WIRE_BUFFER_SIZE");
+        return -1;
+    }
+    frameSeq = seq;
+    lastPayloadBytes = len;
+    return postToProxy("/v1/metrics/push-binary", "application/octet-stream", wireBuffer, len);
+}
 
-    HTTPClient http;
-    WiFiClientSecure secureClient;
-    WiFiClient plainClient;
+inline bool MetricsPusher::pushBinaryMetrics() {
+    unsigned long start = micros();
+    collectSnapshot(snapshot);
+    int httpCode = postBinaryMetrics(false, start);
+    if (httpCode == 409) {
+        // Proxy restarted (no schema) or missed our base frame: resend in full
+        httpCode = postBinaryMetrics(true, micros());
+    }
 
-    String url = proxyBaseUrl() + "/v1/logs/push";
-    if (!beginHttp(http, url, secureClient, plainClient)) {
-        lastLogPushHttpCode = -1;
-        Serial.println("[MetricsPusher] Log push: beginHttp failed");
-        return false;
+    if (httpCode >= 200 && httpCode < 300) {
+        schemaAcknowledged = true;
+        base = snapshot;
+        baseSeq = frameSeq;
+        haveBase = true;
+        return true;
     }
+    if (httpCode == 404) {
+        binaryMetricsUnsupported = true;
+        Serial.println("[MetricsPusher] Proxy has no /v1/metrics/push-binary, falling back to JSON");
+    }
+    return false;
+}
 
-    http.addHeader("Content-Type", "application/json");
-    applyAuthHeader(http);
-    http.setTimeout(METRICS_HTTP_TIMEOUT_MS);
+inline bool MetricsPusher::pushLogs(const String& json) {
+    logPushAttempts++;
 
-    int httpCode = http.POST(json);
+    int httpCode = postToProxy("/v1/logs/push", "application/json", (const uint8_t*)json.c_str(), json.length());
     lastLogPushHttpCode = httpCode;
-    http.end();
 
     bool success = (httpCode >= 200 && httpCode < 300);
     if (success) {
@@ -419,4 +632,98 @@ inline bool MetricsPusher::pushLogs(const String& json) {
     return success;
 }
 
+inline void MetricsPusher::pushBinaryLogs() {
+    if (BinaryLog::pendingBytes() == 0) return;
+    if (binaryLogsUnsupported) {
+        convertBinaryLogsToText();
+        return;
+    }
+
+    uint8_t* records = (uint8_t*)malloc(BINARY_LOG_RING_BYTES);
+    if (!records) return;
+    uint16_t recordCount = 0;
+    uint32_t endPos = 0;
+    size_t recordBytes = BinaryLog::snapshot(records, BINARY_LOG_RING_BYTES, recordCount, endPos);
+
+    // Only formats the proxy has not acknowledged travel with the records
+    uint32_t newFormats[BINARY_LOG_MAX_FORMATS];
+    int newCount = BinaryLogFormat::collectNewFormats(records, recordBytes, knownFormats,
+                                                      knownFormatCount, newFormats,
+                                                      BINARY_LOG_MAX_FORMATS);
+    size_t tableBytes = 0;
+    for (int i = 0; i < newCount; i++) {
+        tableBytes += BinaryLogFormat::formatEntrySize((const char*)newFormats[i]);
+    }
+
+    size_t total = BinaryLogFormat::BATCH_HEADER_SIZE + tableBytes + recordBytes;
+    uint8_t* batch = (uint8_t*)malloc(total);
+    if (!batch) {
+        free(records);
+        return;
+    }
+    time_t now;
+    time(&now);
+    BinaryLogFormat::BatchHeader header;
+    BinaryLog::getBuildId(header.buildId);
+    header.epochSeconds = (uint32_t)((unsigned long)now - RTC_TIMEZONE_OFFSET_SEC);
+    header.millisNow = (uint32_t)millis();
+    header.dropped = BinaryLog::getDroppedCount();
+    header.formatCount = (uint16_t)newCount;
+    header.recordCount = recordCount;
+    BinaryLogFormat::writeBatchHeader(header, batch);
+    size_t pos = BinaryLogFormat::BATCH_HEADER_SIZE;
+    for (int i = 0; i < newCount; i++) {
+        pos += BinaryLogFormat::writeFormatEntry(newFormats[i], (const char*)newFormats[i], batch + pos);
+    }
+    memcpy(batch + pos, records, recordBytes);
+    free(records);
+
+    logPushAttempts++;
+    int httpCode = postToProxy("/v1/logs/push-binary", "application/octet-stream", batch, total);
+    free(batch);
+    lastLogPushHttpCode = httpCode;
+
+    if (httpCode >= 200 && httpCode < 300) {
+        logPushSuccesses++;
+        BinaryLog::acknowledge(endPos);
+        for (int i = 0; i < newCount; i++) {
+            if (knownFormatCount >= BINARY_LOG_MAX_FORMATS) knownFormatCount = 0;  // Resend all later
+            knownFormats[knownFormatCount++] = newFormats[i];
+        }
+        Serial.println("[MetricsPusher] Binary log push OK (" + String(recordCount) + " records, " +
+                       String(total) + " bytes)");
+    } else if (httpCode == 409) {
+        // Proxy lost its format cache (restart): send every format next time
+        knownFormatCount = 0;
+        Serial.println("[MetricsPusher] Binary log push: proxy needs formats, resending");
+    } else if (httpCode == 404) {
+        binaryLogsUnsupported = true;
+        Serial.println("[MetricsPusher] Proxy has no /v1/logs/push-binary, falling back to text");
+        convertBinaryLogsToText();
+    } else {
+        Serial.println("[MetricsPusher] Binary log push FAILED, HTTP " + String(httpCode));
+    }
+}
+
+// Fallback for proxies without the binary endpoint: expand on Core 0 into the
+// JSON log buffer (timestamps become the push time).
+inline void MetricsPusher::convertBinaryLogsToText() {
+    uint8_t* records = (uint8_t*)malloc(BINARY_LOG_RING_BYTES);
+    if (!records) return;
+    uint16_t recordCount = 0;
+    uint32_t endPos = 0;
+    size_t recordBytes = BinaryLog::snapshot(records, BINARY_LOG_RING_BYTES, recordCount, endPos);
+    char text[192];
+    for (size_t pos = 0; pos < recordBytes; pos += records[pos]) {
+        const uint8_t* record = records + pos;
+        const char* format = (const char*)BinaryLogFormat::getU32(record + 2);
+        BinaryLogFormat::formatRecord(format, record + BinaryLogFormat::RECORD_HEADER_SIZE,
+                                      record[0] - BinaryLogFormat::RECORD_HEADER_SIZE,
+                                      text, sizeof(text));
+        addLogEntry(BinaryLogFormat::levelName(record[1]), String(text));
+    }
+    free(records);
+    BinaryLog::acknowledge(endPos);
+}
+
 #endif // METRICS_PUSHER_H
@@ -0,0 +1,660 @@
+#ifndef METRICS_WIRE_FORMAT_H
+#define METRICS_WIRE_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef NATIVE_TEST
+#include "TestConfig.h"
+#else
+#include "config.h"
+#endif
+#include "DeadlineMonitorLogic.h"
+
+// Compact metrics push format, shared by the firmware (MetricsPusher.h), the
+// native tests and the host decoder (tools/metrics_decode.py). Hardware-free.
+//
+// One Snapshot holds every value of the JSON push as an integer: floats are
+// fixed-point (KIND_FIXED1 = tenths, KIND_FIXED2 = hundredths), and each
+// system field / valve field has a presence bit, so optional hardware simply
+// leaves its bits clear. toJson() renders a snapshot as the JSON push body,
+// so both formats carry the same names and values.
+//
+// Frame (body of POST /v1/metrics/push-binary), little-endian header:
+//   "WMB1" | schema id u32 | seq u16 | base seq u16 | flags u8
+//   [schema]  if FLAG_SCHEMA: 2 x (varint count, count x (kind u8, len u8, name))
+//             system fields, then valve fields
+//   system    varint presence mask, then one varint per set bit
+//   valves    varint count, count x (varint id, varint mask, varints)
+//   misses    varint count, count x (len u8 task, len u8 stage, varint count)
+// Values are LEB128 varints; KIND_INT and the fixed-point kinds are zigzag.
+//
+// A FLAG_DELTA frame only carries the fields (and valves) that changed since
+// frame `base seq`, the last one the proxy acknowledged; values are absolute,
+// so a lost frame never corrupts a counter. The decoder answers "need full"
+// when it lacks that base or the schema, and the device then sends a full
+// frame with its schema. Fields are only ever appended to the tables; a
+// decoder maps them by name and skips names it doesn't know.
+namespace MetricsWireFormat {
+
+const uint8_t MAGIC[4] = {'W', 'M', 'B', '1'};
+const size_t HEADER_SIZE = 13;
+const uint8_t FLAG_SCHEMA = 0x01;
+const uint8_t FLAG_DELTA = 0x02;
+
+enum Kind { KIND_UINT = 0, KIND_INT = 1, KIND_FIXED1 = 2, KIND_FIXED2 = 3 };
+
+struct Field {
+  const char *name;
+  uint8_t kind;
+};
+
+// ============================================
+// Schema - append only
+// ============================================
+enum SystemField {
+  SYS_UPTIME_S,
+  SYS_FREE_HEAP,
+  SYS_WIFI_RSSI,
+  SYS_WIFI_CONNECT_ATTEMPTS,
+  SYS_WIFI_RECONNECTS,
+  SYS_WIFI_LAST_CONNECT_MS,
+  SYS_WIFI_LAST_OUTAGE_MS,
+  SYS_WIFI_LAST_OUTAGE_ATTEMPTS,
+  SYS_WIFI_DISCONNECT_REASON,
+  SYS_WIFI_ASSOC_TO_IP_MS,
+  SYS_WIFI_LAST_CONNECT_DIRECTED,
+  SYS_WIFI_DIRECTED_ATTEMPTS,
+  SYS_WIFI_DIRECTED_FAILURES,
+  SYS_DNS_HITS,
+  SYS_DNS_MISSES,
+  SYS_DNS_PREFETCHES,
+  SYS_DNS_STALE_SERVED,
+  SYS_DNS_FAILURES,
+  SYS_PUMP,
+  SYS_OVERFLOW,
+  SYS_OVERFLOW_STREAK,
+  SYS_WATER_TANK_OK,
+  SYS_PLANT_LIGHT,
+  SYS_TELEGRAM_FAILURES,
+  SYS_LOOP_LAST_MS,
+  SYS_LOOP_MAX_MS,
+  SYS_NET_LOOP_MAX_MS,
+  SYS_DEADLINE_HARD_RESETS,
+  SYS_OTA_LAST_BYTES,
+  SYS_OTA_LAST_DURATION_MS,
+  SYS_OTA_LAST_THROUGHPUT_BPS,
+  SYS_OTA_FAILURES,
+  SYS_IO_EXPANDER_BUS_ERRORS,
+  SYS_FLOW_METER_PULSES,
+  SYS_POWER_MODE,
+  SYS_POWER_IDLE_S,
+  SYS_POWER_ACTIVE_S,
+  SYS_WIFI_PS,
+  SYS_POWER_EST_MA,
+  SYS_POWER_AVG_MA,
+  SYS_WAKE_COUNT,
+  SYS_WAKE_LATENCY_LAST_US,
+  SYS_WAKE_LATENCY_MAX_US,
+  SYS_LOG_BUFFER_COUNT,
+  SYS_LOG_PUSH_LAST_CODE,
+  SYS_LOG_PUSH_ATTEMPTS,
+  SYS_LOG_PUSH_SUCCESSES,
+  SYS_BLOG_PENDING,
+  SYS_BLOG_DROPPED,
+  SYS_METRICS_PAYLOAD_BYTES,
+  SYS_METRICS_ENCODE_US,
+  SYS_UPLOAD_RAW_BYTES,
+  SYS_UPLOAD_WIRE_BYTES,
+  SYS_FIELD_COUNT
+};
+
+const Field SYSTEM_FIELDS[] = {
+    {"uptime_s", KIND_UINT},
+    {"free_heap", KIND_UINT},
+    {"wifi_rssi", KIND_INT},
+    {"wifi_connect_attempts", KIND_UINT},
+    {"wifi_reconnects", KIND_UINT},
+    {"wifi_last_connect_ms", KIND_UINT},
+    {"wifi_last_outage_ms", KIND_UINT},
+    {"wifi_last_outage_attempts", KIND_UINT},
+    {"wifi_disconnect_reason", KIND_UINT},
+    {"wifi_assoc_to_ip_ms", KIND_UINT},
+    {"wifi_last_connect_directed", KIND_UINT},
+    {"wifi_directed_attempts", KIND_UINT},
+    {"wifi_directed_failures", KIND_UINT},
+    {"dns_hits", KIND_UINT},
+    {"dns_misses", KIND_UINT},
+    {"dns_prefetches", KIND_UINT},
+    {"dns_stale_served", KIND_UINT},
+    {"dns_failures", KIND_UINT},
+    {"pump", KIND_UINT},
+    {"overflow", KIND_UINT},
+    {"overflow_streak", KIND_UINT},
+    {"water_tank_ok", KIND_UINT},
+    {"plant_light", KIND_UINT},
+    {"telegram_failures", KIND_UINT},
+    {"loop_last_ms", KIND_UINT},
+    {"loop_max_ms", KIND_UINT},
+    {"net_loop_max_ms", KIND_UINT},
+    {"deadline_hard_resets", KIND_UINT},
+    {"ota_last_bytes", KIND_UINT},
+    {"ota_last_duration_ms", KIND_UINT},
+    {"ota_last_throughput_bps", KIND_UINT},
+    {"ota_failures", KIND_UINT},
+    {"io_expander_bus_errors", KIND_UINT},
+    {"flow_meter_pulses", KIND_UINT},
+    {"power_mode", KIND_UINT},
+    {"power_idle_s", KIND_UINT},
+    {"power_active_s", KIND_UINT},
+    {"wifi_ps", KIND_UINT},
+    {"power_est_ma", KIND_FIXED1},
+    {"power_avg_ma", KIND_FIXED1},
+    {"wake_count", KIND_UINT},
+    {"wake_latency_last_us", KIND_UINT},
+    {"wake_latency_max_us", KIND_UINT},
+    {"log_buffer_count", KIND_UINT},
+    {"log_push_last_code", KIND_INT},
+    {"log_push_attempts", KIND_UINT},
+    {"log_push_successes", KIND_UINT},
+    {"blog_pending", KIND_UINT},
+    {"blog_dropped", KIND_UINT},
+    {"metrics_payload_bytes", KIND_UINT},
+    {"metrics_encode_us", KIND_UINT},
+    {"upload_raw_bytes", KIND_UINT},
+    {"upload_wire_bytes", KIND_UINT},
+};
+
+enum ValveField {
+  VALVE_STATE,
+  VALVE_PHASE,
+  VALVE_RAIN,
+  VALVE_WATERING_S,
+  VALVE_WATER_LEVEL_PCT,
+  VALVE_MOISTURE_PCT,
+  VALVE_LAST_CYCLE_L,
+  VALVE_FLOW_LPM,
+  VALVE_NO_FLOW,
+  VALVE_CALIBRATED,
+  VALVE_AUTO_WATERING,
+  VALVE_INTERVAL_MULT,
+  VALVE_TOTAL_CYCLES,
+  VALVE_TIME_SINCE_MS,
+  VALVE_TIME_UNTIL_EMPTY_MS,
+  VALVE_TIME_SINCE_ATTEMPT_MS,
+  VALVE_TIME_UNTIL_NEXT_MS,
+  VALVE_BASELINE_FILL_MS,
+  VALVE_LAST_FILL_MS,
+  VALVE_EMPTY_DURATION_MS,
+  VALVE_FIELD_COUNT
+};
+
+const Field VALVE_FIELDS[] = {
+    {"state", KIND_UINT},
+    {"phase", KIND_UINT},
+    {"rain", KIND_UINT},
+    {"watering_s", KIND_UINT},
+    {"water_level_pct", KIND_INT},
+    {"moisture_pct", KIND_FIXED1},
+    {"last_cycle_l", KIND_FIXED2},
+    {"flow_lpm", KIND_FIXED2},
+    {"no_flow", KIND_UINT},
+    {"calibrated", KIND_UINT},
+    {"auto_watering", KIND_UINT},
+    {"interval_mult", KIND_FIXED2},
+    {"total_cycles", KIND_UINT},
+    {"time_since_ms", KIND_UINT},
+    {"time_until_empty_ms", KIND_UINT},
+    {"time_since_attempt_ms", KIND_UINT},
+    {"time_until_next_ms", KIND_UINT},
+    {"baseline_fill_ms", KIND_UINT},
+    {"last_fill_ms", KIND_UINT},
+    {"empty_duration_ms", KIND_UINT},
+};
+
+const int MAX_FIELDS = 64;  // One presence bit each
+static_assert(sizeof(SYSTEM_FIELDS) / sizeof(Field) == SYS_FIELD_COUNT, "SYSTEM_FIELDS out of sync");
+static_assert(sizeof(VALVE_FIELDS) / sizeof(Field) == VALVE_FIELD_COUNT, "VALVE_FIELDS out of sync");
+static_assert(SYS_FIELD_COUNT <= MAX_FIELDS && VALVE_FIELD_COUNT <= MAX_FIELDS, "presence mask is 64 bits");
+
+// FNV-1a over kinds and names: changes whenever a table does
+inline uint32_t schemaId() {
+  uint32_t h = 2166136261UL;
+  const Field *tables[2] = {SYSTEM_FIELDS, VALVE_FIELDS};
+  const int counts[2] = {SYS_FIELD_COUNT, VALVE_FIELD_COUNT};
+  for (int t = 0; t < 2; t++) {
+    for (int i = 0; i < counts[t]; i++) {
+      h = (h ^ tables[t][i].kind) * 16777619UL;
+      for (const char *p = tables[t][i].name; *p; p++) h = (h ^ (uint8_t)*p) * 16777619UL;
+      h = (h ^ 0) * 16777619UL;
+    }
+    h = (h ^ 0xFF) * 16777619UL;
+  }
+  return h;
+}
+
+// ============================================
+// Snapshot
+// ============================================
+const int MAX_VALVES = NUM_VALVES;  // Every zone of the build's topology
+const int MAX_MISSES = 2 * LOOP_STAGE_COUNT;  // Control and network task, every stage
+const int MAX_NAME = 24;
+
+struct Valve {
+  uint8_t id;
+  uint64_t present;
+  int64_t values[VALVE_FIELD_COUNT];
+};
+
+struct Miss {
+  char task[MAX_NAME];
+  char stage[MAX_NAME];
+  uint32_t count;
+};
+
+struct Snapshot {
+  uint64_t present;
+  int64_t values[SYS_FIELD_COUNT];
+  uint8_t valveCount;
+  Valve valves[MAX_VALVES];
+  uint8_t missCount;
+  Miss misses[MAX_MISSES];
+};
+
+inline void clear(Snapshot &s) { memset(&s, 0, sizeof(s)); }
+
+inline int64_t toFixed(float value, uint8_t kind) {
+  float scaled = kind == KIND_FIXED1 ? value * 10.0f : kind == KIND_FIXED2 ? value * 100.0f : value;
+  return (int64_t)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+}
+
+inline void set(Snapshot &s, SystemField f, int64_t value) {
+  s.values[f] = value;
+  s.present |= (uint64_t)1 << f;
+}
+
+inline void setFloat(Snapshot &s, SystemField f, float value) { set(s, f, toFixed(value, SYSTEM_FIELDS[f].kind)); }
+
+// Next valve slot, or nullptr when full
+inline Valve *addValve(Snapshot &s, uint8_t id) {
+  if (s.valveCount >= MAX_VALVES) return nullptr;
+  Valve &v = s.valves[s.valveCount++];
+  memset(&v, 0, sizeof(v));
+  v.id = id;
+  return &v;
+}
+
+inline void set(Valve &v, ValveField f, int64_t value) {
+  v.values[f] = value;
+  v.present |= (uint64_t)1 << f;
+}
+
+inline void setFloat(Valve &v, ValveField f, float value) { set(v, f, toFixed(value, VALVE_FIELDS[f].kind)); }
+
+inline bool addMiss(Snapshot &s, const char *task, const char *stage, uint32_t count) {
+  if (s.missCount >= MAX_MISSES) return false;
+  Miss &m = s.misses[s.missCount++];
+  strncpy(m.task, task, MAX_NAME - 1);
+  m.task[MAX_NAME - 1] = '\0';
+  strncpy(m.stage, stage, MAX_NAME - 1);
+  m.stage[MAX_NAME - 1] = '\0';
+  m.count = count;
+  return true;
+}
+
+// A delta can't express a field or valve going away: send a full frame then
+inline bool canDelta(const Snapshot &cur, const Snapshot &base) {
+  if (cur.present != base.present || cur.valveCount != base.valveCount) return false;
+  for (int i = 0; i < cur.valveCount; i++) {
+    if (cur.valves[i].id != base.valves[i].id || cur.valves[i].present != base.valves[i].present) return false;
+  }
+  return true;
+}
+
+// ============================================
+// Encoding
+// ============================================
+struct Writer {
+  uint8_t *buf;
+  size_t capacity;
+  size_t pos;
+  bool overflow;
+};
+
+inline void putByte(Writer &w, uint8_t b) {
+  if (w.pos >= w.capacity) {
+    w.overflow = true;
+    return;
+  }
+  w.buf[w.pos++] = b;
+}
+
+inline void putVarint(Writer &w, uint64_t v) {
+  while (v >= 0x80) {
+    putByte(w, (uint8_t)(v | 0x80));
+    v >>= 7;
+  }
+  putByte(w, (uint8_t)v);
+}
+
+inline void putValue(Writer &w, int64_t v, uint8_t kind) {
+  if (kind == KIND_UINT) {
+    putVarint(w, (uint64_t)v);
+  } else {
+    putVarint(w, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));  // zigzag
+  }
+}
+
+inline void putName(Writer &w, const char *name) {
+  size_t len = strlen(name);
+  if (len > 255) len = 255;
+  putByte(w, (uint8_t)len);
+  for (size_t i = 0; i < len; i++) putByte(w, (uint8_t)name[i]);
+}
+
+inline void putFields(Writer &w, const int64_t *values, uint64_t mask, const Field *fields, int count) {
+  putVarint(w, mask);
+  for (int i = 0; i < count; i++) {
+    if (mask & ((uint64_t)1 << i)) putValue(w, values[i], fields[i].kind);
+  }
+}
+
+inline uint64_t changedMask(const int64_t *cur, const int64_t *base, uint64_t present, int count) {
+  uint64_t mask = 0;
+  for (int i = 0; i < count; i++) {
+    uint64_t bit = (uint64_t)1 << i;
+    if ((present & bit) && cur[i] != base[i]) mask |= bit;
+  }
+  return mask;
+}
+
+// Full frame when base is null, else a delta against it (the caller checks
+// canDelta). Returns the frame length, 0 if it doesn't fit.
+inline size_t encode(const Snapshot &cur, const Snapshot *base, uint16_t seq, uint16_t baseSeq, bool withSchema,
+                     uint8_t *buf, size_t capacity) {
+  Writer w = {buf, capacity, 0, false};
+  uint32_t id = schemaId();
+  for (int i = 0; i < 4; i++) putByte(w, MAGIC[i]);
+  for (int i = 0; i < 4; i++) putByte(w, (uint8_t)(id >> (8 * i)));
+  putByte(w, (uint8_t)seq);
+  putByte(w, (uint8_t)(seq >> 8));
+  putByte(w, (uint8_t)(base ? baseSeq : 0));
+  putByte(w, (uint8_t)(base ? baseSeq >> 8 : 0));
+  putByte(w, (uint8_t)((withSchema ? FLAG_SCHEMA : 0) | (base ? FLAG_DELTA : 0)));
+
+  if (withSchema) {
+    const Field *tables[2] = {SYSTEM_FIELDS, VALVE_FIELDS};
+    const int counts[2] = {SYS_FIELD_COUNT, VALVE_FIELD_COUNT};
+    for (int t = 0; t < 2; t++) {
+      putVarint(w, (uint64_t)counts[t]);
+      for (int i = 0; i < counts[t]; i++) {
+        putByte(w, tables[t][i].kind);
+        putName(w, tables[t][i].name);
+      }
+    }
+  }
+
+  putFields(w, cur.values, base ? changedMask(cur.values, base->values, cur.present, SYS_FIELD_COUNT) : cur.present,
+            SYSTEM_FIELDS, SYS_FIELD_COUNT);
+
+  uint64_t valveMasks[MAX_VALVES];
+  uint8_t sent = 0;
+  for (int i = 0; i < cur.valveCount; i++) {
+    const Valve &v = cur.valves[i];
+    valveMasks[i] = base ? changedMask(v.values, base->valves[i].values, v.present, VALVE_FIELD_COUNT) : v.present;
+    if (!base || valveMasks[i] != 0) sent++;
+  }
+  putVarint(w, sent);
+  for (int i = 0; i < cur.valveCount; i++) {
+    if (base && valveMasks[i] == 0) continue;
+    putVarint(w, cur.valves[i].id);
+    putFields(w, cur.valves[i].values, valveMasks[i], VALVE_FIELDS, VALVE_FIELD_COUNT);
+  }
+
+  putVarint(w, cur.missCount);
+  for (int i = 0; i < cur.missCount; i++) {
+    putName(w, cur.misses[i].task);
+    putName(w, cur.misses[i].stage);
+    putVarint(w, cur.misses[i].count);
+  }
+  return w.overflow ? 0 : w.pos;
+}
+
+// ============================================
+// Decoding (host side, and the native tests)
+// ============================================
+// The decoder keeps the last schema and snapshot it accepted; delta frames
+// are applied on top of that snapshot.
+struct Decoder {
+  bool haveSchema;
+  uint32_t schemaId;
+  uint8_t wireCount[2];              // Fields per table in the sender's schema
+  uint8_t wireKind[2][MAX_FIELDS];
+  int8_t localIndex[2][MAX_FIELDS];  // -1 = unknown name, skipped
+  bool haveState;
+  uint16_t seq;
+  Snapshot state;
+};
+
+enum DecodeResult { DECODE_OK, DECODE_NEED_FULL, DECODE_BAD };
+
+inline void resetDecoder(Decoder &d) { memset(&d, 0, sizeof(d)); }
+
+struct Reader {
+  const uint8_t *buf;
+  size_t len;
+  size_t pos;
+  bool ok;
+};
+
+inline uint8_t getByte(Reader &r) {
+  if (r.pos >= r.len) {
+    r.ok = false;
+    return 0;
+  }
+  return r.buf[r.pos++];
+}
+
+inline uint64_t getVarint(Reader &r) {
+  uint64_t v = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    uint8_t b = getByte(r);
+    v |= (uint64_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) return v;
+  }
+  r.ok = false;
+  return 0;
+}
+
+inline int64_t getValue(Reader &r, uint8_t kind) {
+  uint64_t v = getVarint(r);
+  if (kind == KIND_UINT) return (int64_t)v;
+  return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+inline void getName(Reader &r, char *out, size_t size) {
+  uint8_t len = getByte(r);
+  for (uint8_t i = 0; i < len; i++) {
+    char c = (char)getByte(r);
+    if (i + 1u < size) out[i] = c;
+  }
+  out[len < size ? len : size - 1] = '\0';
+}
+
+inline bool readSchema(Reader &r, Decoder &d, uint32_t id) {
+  const Field *tables[2] = {SYSTEM_FIELDS, VALVE_FIELDS};
+  const int counts[2] = {SYS_FIELD_COUNT, VALVE_FIELD_COUNT};
+  for (int t = 0; t < 2; t++) {
+    uint64_t n = getVarint(r);
+    if (n > (uint64_t)MAX_FIELDS) return false;
+    d.wireCount[t] = (uint8_t)n;
+    for (uint64_t i = 0; i < n; i++) {
+      char name[64];
+      uint8_t kind = getByte(r);
+      getName(r, name, sizeof(name));
+      d.wireKind[t][i] = kind;
+      d.localIndex[t][i] = -1;
+      for (int k = 0; k < counts[t]; k++) {
+        if (tables[t][k].kind == kind && strcmp(tables[t][k].name, name) == 0) d.localIndex[t][i] = (int8_t)k;
+      }
+    }
+  }
+  if (!r.ok) return false;
+  d.schemaId = id;
+  d.haveSchema = true;
+  return true;
+}
+
+inline void readFields(Reader &r, const Decoder &d, int table, int64_t *values, uint64_t &present) {
+  uint64_t mask = getVarint(r);
+  for (int i = 0; i < d.wireCount[table]; i++) {
+    if (!(mask & ((uint64_t)1 << i))) continue;
+    int64_t v = getValue(r, d.wireKind[table][i]);
+    int local = d.localIndex[table][i];
+    if (local < 0) continue;
+    values[local] = v;
+    present |= (uint64_t)1 << local;
+  }
+  if (d.wireCount[table] < 64 && (mask >> d.wireCount[table])) r.ok = false;  // Bits beyond the schema
+}
+
+inline DecodeResult decode(Decoder &d, const uint8_t *msg, size_t len) {
+  if (len < HEADER_SIZE || memcmp(msg, MAGIC, 4) != 0) return DECODE_BAD;
+  uint32_t id = (uint32_t)msg[4] | ((uint32_t)msg[5] << 8) | ((uint32_t)msg[6] << 16) | ((uint32_t)msg[7] << 24);
+  uint16_t seq = (uint16_t)(msg[8] | (msg[9] << 8));
+  uint16_t baseSeq = (uint16_t)(msg[10] | (msg[11] << 8));
+  uint8_t flags = msg[12];
+  Reader r = {msg, len, HEADER_SIZE, true};
+
+  if (flags & FLAG_SCHEMA) {
+    if (!readSchema(r, d, id)) return DECODE_BAD;
+  } else if (!d.haveSchema || d.schemaId != id) {
+    return DECODE_NEED_FULL;
+  }
+  bool delta = (flags & FLAG_DELTA) != 0;
+  if (delta && (!d.haveState || d.seq != baseSeq)) return DECODE_NEED_FULL;
+
+  Snapshot next;
+  if (delta) {
+    next = d.state;
+  } else {
+    clear(next);
+  }
+  readFields(r, d, 0, next.values, next.present);
+
+  uint64_t valves = getVarint(r);
+  for (uint64_t n = 0; n < valves && r.ok; n++) {
+    uint8_t id8 = (uint8_t)getVarint(r);
+    Valve *v = nullptr;
+    for (int i = 0; i < next.valveCount; i++) {
+      if (next.valves[i].id == id8) v = &next.valves[i];
+    }
+    if (v == nullptr) {
+      if (delta) return DECODE_BAD;  // Deltas never add valves
+      v = addValve(next, id8);
+      if (v == nullptr) return DECODE_BAD;
+    }
+    readFields(r, d, 1, v->values, v->present);
+  }
+
+  next.missCount = 0;
+  uint64_t misses = getVarint(r);
+  for (uint64_t n = 0; n < misses && r.ok; n++) {
+    char task[MAX_NAME];
+    char stage[MAX_NAME];
+    getName(r, task, sizeof(task));
+    getName(r, stage, sizeof(stage));
+    addMiss(next, task, stage, (uint32_t)getVarint(r));
+  }
+  if (!r.ok || r.pos != len) return DECODE_BAD;
+
+  d.state = next;
+  d.seq = seq;
+  d.haveState = true;
+  return DECODE_OK;
+}
+
+// ============================================
+// JSON rendering (the /v1/metrics/push body)
+// ============================================
+struct JsonOut {
+  char *buf;
+  size_t capacity;
+  size_t pos;
+};
+
+inline void jsonPut(JsonOut &o, const char *s) {
+  for (; *s; s++) {
+    if (o.pos + 1 < o.capacity) o.buf[o.pos] = *s;
+    o.pos++;
+  }
+}
+
+inline void jsonNumber(JsonOut &o, int64_t v, uint8_t kind) {
+  uint64_t u = v < 0 ? (uint64_t)0 - (uint64_t)v : (uint64_t)v;
+  int decimals = kind == KIND_FIXED1 ? 1 : kind == KIND_FIXED2 ? 2 : 0;
+  uint64_t scale = decimals == 1 ? 10 : decimals == 2 ? 100 : 1;
+  uint64_t whole = u / scale;
+  uint64_t frac = u % scale;
+  char out[26];
+  int n = sizeof(out) - 1;
+  out[n] = '\0';
+  for (int i = 0; i < decimals; i++) {
+    out[--n] = (char)('0' + frac % 10);
+    frac /= 10;
+  }
+  if (decimals) out[--n] = '.';
+  do {
+    out[--n] = (char)('0' + whole % 10);
+    whole /= 10;
+  } while (whole != 0);
+  if (v < 0) out[--n] = '-';
+  jsonPut(o, out + n);
+}
+
+inline void jsonFields(JsonOut &o, const int64_t *values, uint64_t present, const Field *fields, int count,
+                       bool &first) {
+  for (int i = 0; i < count; i++) {
+    if (!(present & ((uint64_t)1 << i))) continue;
+    jsonPut(o, first ? "\"" : ",\"");
+    first = false;
+    jsonPut(o, fields[i].name);
+    jsonPut(o, "\":");
+    jsonNumber(o, values[i], fields[i].kind);
+  }
+}
+
+// Returns the JSON length; the output is complete only if that is < capacity.
+// toJson(s, nullptr, 0) just measures.
+inline size_t toJson(const Snapshot &s, char *buf, size_t capacity) {
+  JsonOut o = {buf, capacity, 0};
+  bool first = true;
+  jsonPut(o, "{");
+  jsonFields(o, s.values, s.present, SYSTEM_FIELDS, SYS_FIELD_COUNT, first);
+  jsonPut(o, first ? "\"valves\":[" : ",\"valves\":[");
+  for (int i = 0; i < s.valveCount; i++) {
+    jsonPut(o, i == 0 ? "{\"id\":" : ",{\"id\":");
+    jsonNumber(o, s.valves[i].id, KIND_UINT);
+    bool noFirst = false;
+    jsonFields(o, s.valves[i].values, s.valves[i].present, VALVE_FIELDS, VALVE_FIELD_COUNT, noFirst);
+    jsonPut(o, "}");
+  }
+  jsonPut(o, "],\"deadline_misses\":[");
+  for (int i = 0; i < s.missCount; i++) {
+    jsonPut(o, i == 0 ? "{\"task\":\"" : ",{\"task\":\"");
+    jsonPut(o, s.misses[i].task);
+    jsonPut(o, "\",\"stage\":\"");
+    jsonPut(o, s.misses[i].stage);
+    jsonPut(o, "\",\"count\":");
+    jsonNumber(o, s.misses[i].count, KIND_UINT);
+    jsonPut(o, "}");
+  }
+  jsonPut(o, "]}");
+  if (capacity > 0) buf[o.pos < capacity ? o.pos : capacity - 1] = '\0';
+  return o.pos;
+}
+
+}  // namespace MetricsWireFormat
+
+#endif  // METRICS_WIRE_FORMAT_H
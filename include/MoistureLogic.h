@@ -0,0 +1,89 @@
+#ifndef MOISTURE_LOGIC_H
+#define MOISTURE_LOGIC_H
+
+#include <stdint.h>
+
+// Analog capacitive-moisture signal chain, hardware-free. MoistureSensors.h
+// feeds it raw ADC1 readings; the control loop and calculateCurrentWaterLevel
+// only ever see the filtered percentage.
+//
+//   burst of N raw reads -> trimmed mean (min and max dropped: ADC spikes from
+//   pump/relay switching) -> first-order IIR in Q8 fixed point
+//   (y += (x - y) >> shift, time constant ~2^shift samples) -> percent
+//   between the tray's dry and wet calibration points.
+namespace MoistureLogic {
+
+struct Filter {
+  int32_t q8;          // Filtered raw value << 8
+  bool primed;         // First sample seeds the filter instead of ramping from 0
+  uint32_t updatedAt;  // millis() of the last update
+};
+
+inline Filter makeFilter() {
+  Filter f;
+  f.q8 = 0;
+  f.primed = false;
+  f.updatedAt = 0;
+  return f;
+}
+
+// Mean of the burst without its smallest and largest sample (plain mean for
+// fewer than 3 samples).
+inline uint16_t trimmedMean(const uint16_t *samples, int count) {
+  if (count <= 0) return 0;
+  uint32_t sum = 0;
+  uint16_t lo = samples[0];
+  uint16_t hi = samples[0];
+  for (int i = 0; i < count; i++) {
+    sum += samples[i];
+    if (samples[i] < lo) lo = samples[i];
+    if (samples[i] > hi) hi = samples[i];
+  }
+  if (count < 3) return (uint16_t)((sum + count / 2) / count);
+  sum -= (uint32_t)lo + hi;
+  return (uint16_t)((sum + (count - 2) / 2) / (count - 2));
+}
+
+inline void update(Filter &f, uint16_t raw, int shift, uint32_t now) {
+  int32_t x = (int32_t)raw << 8;
+  if (!f.primed) {
+    f.q8 = x;
+    f.primed = true;
+  } else {
+    f.q8 += (x - f.q8) >> shift;
+  }
+  f.updatedAt = now;
+}
+
+inline uint16_t value(const Filter &f) { return (uint16_t)((f.q8 + 128) >> 8); }
+
+inline bool fresh(const Filter &f, uint32_t now, uint32_t staleMs) {
+  return f.primed && now - f.updatedAt < staleMs;
+}
+
+// 0 at the dry point, 100 at the wet point, clamped. Works for sensors that
+// read lower when wet (capacitive) and higher when wet (resistive).
+inline float percent(uint16_t raw, uint16_t dryRaw, uint16_t wetRaw) {
+  if (dryRaw == wetRaw) return 0.0f;
+  float pct = ((float)raw - (float)dryRaw) * 100.0f / ((float)wetRaw - (float)dryRaw);
+  if (pct < 0.0f) return 0.0f;
+  if (pct > 100.0f) return 100.0f;
+  return pct;
+}
+
+// Setpoint 0 = disabled (rain sensor only); a negative percent = no reading.
+inline bool setpointReached(float moisturePct, uint32_t setpointPct) {
+  return setpointPct > 0 && moisturePct >= 0.0f && moisturePct >= (float)setpointPct;
+}
+
+// Blends the time-extrapolated level with the measured one; with no usable
+// estimate (uncalibrated tray) the measurement stands alone.
+inline float correctWaterLevel(float estimatePct, bool estimateKnown, float moisturePct,
+                               float weight) {
+  if (!estimateKnown) return moisturePct;
+  return weight * moisturePct + (1.0f - weight) * estimatePct;
+}
+
+}  // namespace MoistureLogic
+
+#endif  // MOISTURE_LOGIC_H
@@ -0,0 +1,86 @@
+#ifndef MOISTURE_SENSORS_H
+#define MOISTURE_SENSORS_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "DebugHelper.h"
+#include "MoistureLogic.h"
+#include "RuntimeConfig.h"
+
+// ============================================
+// MoistureSensors - optional analog moisture probe per tray (ADC1)
+// Header-only static class (same pattern as DebugHelper)
+//
+// loop() runs in the network task (Core 0) every MOISTURE_SAMPLE_INTERVAL_MS:
+// one burst of MOISTURE_OVERSAMPLE reads per probe, trimmed mean, IIR filter.
+// The control loop (Core 1) only reads the result through percent(). Each
+// filter has a single writer and 32-bit fields, so a read racing an update
+// sees the old or the new sample, never garbage. A reading older than
+// MOISTURE_STALE_MS (network task stalled) reads as "no probe".
+// ============================================
+class MoistureSensors {
+private:
+    static MoistureLogic::Filter filters[NUM_VALVES];
+    static unsigned long lastSampleTime;
+    static int channelCount;
+
+public:
+    // ADC resolution and attenuation are set globally in setup()
+    static void init() {
+        channelCount = 0;
+        for (int i = 0; i < NUM_VALVES; i++) {
+            filters[i] = MoistureLogic::makeFilter();
+            if (!hasChannel(i)) continue;
+            pinMode(MOISTURE_ADC_PINS[i], INPUT);
+            channelCount++;
+            DebugHelper::debug("✓ Moisture probe tray " + String(i + 1) + " on GPIO " +
+                               String(MOISTURE_ADC_PINS[i]));
+        }
+    }
+
+    static void loop() {
+        if (channelCount == 0) return;
+        unsigned long now = millis();
+        if (now - lastSampleTime < MOISTURE_SAMPLE_INTERVAL_MS) return;
+        lastSampleTime = now;
+
+        uint16_t samples[MOISTURE_OVERSAMPLE];
+        for (int i = 0; i < NUM_VALVES; i++) {
+            if (!hasChannel(i)) continue;
+            for (int s = 0; s < MOISTURE_OVERSAMPLE; s++) {
+                samples[s] = (uint16_t)analogRead(MOISTURE_ADC_PINS[i]);
+            }
+            MoistureLogic::update(filters[i], MoistureLogic::trimmedMean(samples, MOISTURE_OVERSAMPLE),
+                                  MOISTURE_IIR_SHIFT, now);
+        }
+    }
+
+    static bool hasChannel(int valveIndex) {
+        return valveIndex >= 0 && valveIndex < NUM_VALVES && MOISTURE_ADC_PINS[valveIndex] >= 0;
+    }
+
+    // Filtered ADC counts (0 before the first sample)
+    static uint16_t raw(int valveIndex) {
+        if (!hasChannel(valveIndex)) return 0;
+        return MoistureLogic::value(filters[valveIndex]);
+    }
+
+    // 0-100% between the tray's calibration points, or -1 (no probe / stale)
+    static float percent(int valveIndex, unsigned long now) {
+        if (!hasChannel(valveIndex)) return -1.0f;
+        MoistureLogic::Filter f = filters[valveIndex];
+        if (!MoistureLogic::fresh(f, now, MOISTURE_STALE_MS)) return -1.0f;
+        const RuntimeConfigLogic::Values& cfg = RuntimeConfig::get();
+        return MoistureLogic::percent(MoistureLogic::value(f), cfg.moistureDryRaw[valveIndex],
+                                      cfg.moistureWetRaw[valveIndex]);
+    }
+};
+
+// ============================================
+// Static Member Initialization
+// ============================================
+MoistureLogic::Filter MoistureSensors::filters[NUM_VALVES];
+unsigned long MoistureSensors::lastSampleTime = 0;
+int MoistureSensors::channelCount = 0;
+
+#endif // MOISTURE_SENSORS_H
@@ -2,23 +2,156 @@
 #define NETWORK_MANAGER_H
 
 #include <WiFi.h>
+#include <Preferences.h>
+#include <time.h>
 #include "config.h"
 #include "DebugHelper.h"
+#include "BinaryLog.h"
 #include "WateringSystem.h"
+#include "WifiLinkLogic.h"
+#include "WifiFastConnectLogic.h"
 
 // ============================================
 // Network Manager Class
-// WiFi management with exponential backoff reconnection
+// Event-driven WiFi reconnection with exponential backoff
+//
+// The WiFi event task only queues STA_GOT_IP / STA_DISCONNECTED / STA_LOST_IP;
+// loopWiFi() on the Core 0 network task drains the queue into the
+// WifiLinkLogic state machine, runs its timers and carries out its actions
+// (begin / reset). No call here waits for association, so local HTTP, OTA
+// and notification draining keep running through an outage.
+//
+// Fast reconnect: the AP and lease of the last good connection are cached in
+// NVS; the first attempt of a boot or outage goes straight to that BSSID and
+// channel (no scan), falling back to a scanning attempt if it fails.
 // ============================================
 class NetworkManager {
 private:
     static WateringSystem* wateringSystem;
 
-    // WiFi outage tracking (v1.17.3)
-    static unsigned long wifiDisconnectedSince;    // 0 = connected, >0 = millis() when disconnect detected
+    static const WifiLinkLogic::Config linkConfig;
+    static WifiLinkLogic::Link link;
+    static WifiLinkLogic::EventQueue events;
+    static portMUX_TYPE eventLock;
+    static uint32_t eventGeneration;               // Link generation of the attempt the driver is on
     static bool wifiLongOutageNotified;            // true if 1min outage notification was sent
-    static unsigned long lastWifiReconnectAttempt;  // millis() of last reconnect attempt
-    static unsigned long wifiReconnectBackoffMs;   // current backoff interval (grows exponentially)
+    static WifiFastConnectLogic::Cache cache;      // Last good AP + lease (mirrors NVS)
+    static uint32_t ssidHash;
+
+    // WiFi event task: record and return, the network task does the rest.
+    // Every attempt starts with the radio off, so its events follow its own
+    // STA_START in the event stream; that is where the tag moves on, and
+    // events still queued from before (our reset's disconnect) keep the old one.
+    static void onWiFiEvent(arduino_event_id_t event, arduino_event_info_t info) {
+        WifiLinkLogic::EventType type;
+        uint8_t reason = 0;
+        switch (event) {
+            case ARDUINO_EVENT_WIFI_STA_START:
+                eventGeneration = __atomic_load_n(&link.generation, __ATOMIC_ACQUIRE);
+                return;
+            case ARDUINO_EVENT_WIFI_STA_CONNECTED:
+                type = WifiLinkLogic::EVENT_CONNECTED;
+                break;
+            case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+                type = WifiLinkLogic::EVENT_GOT_IP;
+                break;
+            case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+                type = WifiLinkLogic::EVENT_DISCONNECTED;
+                reason = info.wifi_sta_disconnected.reason;
+                break;
+            case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+                type = WifiLinkLogic::EVENT_LOST_IP;
+                break;
+            default:
+                return;
+        }
+        unsigned long now = millis();
+        portENTER_CRITICAL(&eventLock);
+        WifiLinkLogic::push(events, type, reason, eventGeneration, now);
+        portEXIT_CRITICAL(&eventLock);
+    }
+
+    static void apply(WifiLinkLogic::Action action) {
+        switch (action) {
+            case WifiLinkLogic::ACTION_BEGIN:
+                beginAttempt();
+                break;
+            case WifiLinkLogic::ACTION_RESET:
+                // Radio off until the next attempt: a clean driver state
+                // without the old blocking delay, and no scanning in between
+                WiFi.disconnect(true);
+                if (link.directed) {
+                    cache.valid = 0;  // Stale AP or channel: scan from now on
+                    Serial.println("↩️ Directed WiFi attempt failed, scanning instead");
+                } else if (link.outageAttempts > 0) {
+                    Serial.println("❌ WiFi attempt failed, next in " +
+                                   String(WifiLinkLogic::retryInMs(link, millis()) / 1000) + "s");
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    static uint32_t unixNow() {
+        time_t now = time(nullptr);
+        return now > 1640000000 ? (uint32_t)now : 0;  // 0 until the clock is set
+    }
+
+    // Static config, a reusable cached lease, or back to DHCP
+    static void configureAddress(bool directed) {
+        IPAddress ip, gateway, subnet, dns;
+        if (WIFI_STATIC_IP[0] != '\0' && ip.fromString(WIFI_STATIC_IP) && gateway.fromString(WIFI_STATIC_GATEWAY) &&
+            subnet.fromString(WIFI_STATIC_SUBNET)) {
+            if (!dns.fromString(WIFI_STATIC_DNS)) dns = gateway;
+            WiFi.config(ip, gateway, subnet, dns);
+        } else if (directed && WifiFastConnectLogic::reuseLease(cache, ssidHash, WIFI_REUSE_DHCP_LEASE, unixNow(),
+                                                                 WIFI_LEASE_REUSE_MAX_AGE_S)) {
+            WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.subnet),
+                        IPAddress(cache.dns));
+        } else {
+            WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+        }
+    }
+
+    static void beginAttempt() {
+        bool directed = WifiFastConnectLogic::useDirected(cache, ssidHash, link.outageAttempts);
+        Serial.println("🔄 WiFi connect attempt " + String(link.outageAttempts) + " (total " +
+                       String(link.attempts) + (directed ? ", directed ch " + String(cache.channel) : String()) +
+                       ")");
+        WiFi.mode(WIFI_STA);
+        configureAddress(directed);
+        if (directed) {
+            WifiLinkLogic::markDirected(link);
+            WiFi.begin(SSID, SSID_PASSWORD, cache.channel, cache.bssid);
+        } else {
+            WiFi.begin(SSID, SSID_PASSWORD);
+        }
+    }
+
+    static void loadCache() {
+        Preferences prefs;
+        if (prefs.begin(WIFI_CACHE_NVS_NAMESPACE, true)) {
+            if (prefs.getBytesLength("ap") == sizeof(cache)) {
+                prefs.getBytes("ap", &cache, sizeof(cache));
+            }
+            prefs.end();
+        }
+    }
+
+    // Link just came up: remember this AP and lease if anything changed
+    static void saveCache() {
+        WifiFastConnectLogic::Cache fresh = WifiFastConnectLogic::remember(
+            ssidHash, WiFi.BSSID(), (uint8_t)WiFi.channel(), (uint32_t)WiFi.localIP(),
+            (uint32_t)WiFi.gatewayIP(), (uint32_t)WiFi.subnetMask(), (uint32_t)WiFi.dnsIP(), unixNow());
+        if (!WifiFastConnectLogic::needsSave(cache, fresh, WIFI_CACHE_REFRESH_S)) return;
+        Preferences prefs;
+        if (prefs.begin(WIFI_CACHE_NVS_NAMESPACE, false)) {
+            prefs.putBytes("ap", &fresh, sizeof(fresh));
+            prefs.end();
+        }
+        cache = fresh;
+    }
 
 public:
     // ========== Initialization ==========
@@ -27,115 +160,106 @@ public:
     }
 
     static void init() {
+        WifiLinkLogic::clear(events);
+        ssidHash = WifiFastConnectLogic::ssidHash(SSID);
+        loadCache();
+        WiFi.onEvent(onWiFiEvent);
         DebugHelper::debug("Network Manager initialized");
     }
 
     // ========== WiFi Management ==========
+    // Starts the first attempt and returns; loopWiFi() takes it from there.
     static void connectWiFi() {
         DebugHelper::debug("Connecting to WiFi: " + DebugHelper::maskCredential(String(SSID)));
-        WiFi.mode(WIFI_STA);
-        WiFi.begin(SSID, SSID_PASSWORD);
-
-        int attempts = 0;
-        while (WiFi.status() != WL_CONNECTED && attempts < WIFI_MAX_RETRY_ATTEMPTS) {
-            delay(WIFI_RETRY_DELAY_MS);
-            yield();  // Feed watchdog
-            attempts++;
-        }
+        WiFi.setAutoReconnect(false);  // Reconnection is ours, not the driver's
+        apply(WifiLinkLogic::start(link, millis()));
+    }
 
-        if (WiFi.status() == WL_CONNECTED) {
-            WiFi.setAutoReconnect(true);
-            DebugHelper::debug("✓ WiFi Connected! IP: " + WiFi.localIP().toString() + ", RSSI: " + String(WiFi.RSSI()) + " dBm");
-        } else {
-            DebugHelper::debugImportant("❌ WiFi Connection Failed!");
+    // setup() only: the boot countdown needs Telegram. Runs the state machine
+    // until the link is up or timeoutMs passes.
+    static bool waitForConnection(unsigned long timeoutMs) {
+        unsigned long start = millis();
+        while (!isWiFiConnected() && millis() - start < timeoutMs) {
+            loopWiFi();
+            delay(50);
         }
+        loopWiFi();  // Log the connection
+        return isWiFiConnected();
     }
 
     static bool isWiFiConnected() {
         return WiFi.status() == WL_CONNECTED;
     }
 
-    // ========== WiFi Reconnection with Backoff (v1.17.3) ==========
-    // Call from Core 0 networkTask. Handles reconnection with exponential backoff
-    // and WiFi.disconnect(true) cleanup to prevent driver corruption.
+    // ========== WiFi Reconnection (event-driven, non-blocking) ==========
+    // Call from Core 0 networkTask every pass.
     static void loopWiFi() {
-        if (WiFi.status() == WL_CONNECTED) {
-            // WiFi is connected — check if we just recovered from an outage
-            if (wifiDisconnectedSince > 0) {
-                unsigned long outageDuration = millis() - wifiDisconnectedSince;
-                unsigned long minutes = outageDuration / 60000;
-                unsigned long seconds = (outageDuration / 1000) % 60;
-                DebugHelper::debugImportant("✓ WiFi reconnected after " + String(minutes) + "m " + String(seconds) + "s outage, IP: " + WiFi.localIP().toString() + ", RSSI: " + String(WiFi.RSSI()) + " dBm");
-                if (g_metricsLog) g_metricsLog("info", "WiFi connected RSSI=" + String(WiFi.RSSI()));
-                // Reset all tracking
-                wifiDisconnectedSince = 0;
-                wifiLongOutageNotified = false;
-                wifiReconnectBackoffMs = WIFI_RECONNECT_BACKOFF_INITIAL_MS;
+        WifiLinkLogic::Event event;
+        while (true) {
+            portENTER_CRITICAL(&eventLock);
+            bool have = WifiLinkLogic::pop(events, event);
+            portEXIT_CRITICAL(&eventLock);
+            if (!have) break;
+
+            WifiLinkLogic::State before = link.state;
+            uint32_t reconnectsBefore = link.reconnects;
+            apply(WifiLinkLogic::onEvent(link, event.type, event.reason, event.generation, event.at, linkConfig));
+            if (before != WifiLinkLogic::LINK_UP && link.state == WifiLinkLogic::LINK_UP) {
+                logLinkUp(link.reconnects > reconnectsBefore);
+            } else if (before == WifiLinkLogic::LINK_UP && link.state != WifiLinkLogic::LINK_UP) {
+                Serial.println("⚠️ WiFi disconnected (reason " + String(link.lastDisconnectReason) +
+                               "), will reconnect with backoff");
+                BLOG_WARN("WiFi disconnected reason=%d", (int)link.lastDisconnectReason);
             }
-            return;
         }
 
-        // WiFi is disconnected
         unsigned long now = millis();
+        apply(WifiLinkLogic::tick(link, now, linkConfig));
 
-        if (wifiDisconnectedSince == 0) {
-            // First detection of disconnect
-            wifiDisconnectedSince = now;
-            if (wifiDisconnectedSince == 0) wifiDisconnectedSince = 1;  // avoid 0 (means "connected")
-            Serial.println("⚠️ WiFi disconnected, will attempt reconnect with backoff");
-            if (g_metricsLog) g_metricsLog("warn", "WiFi disconnected");
+        // Long outage: can only log to Serial since WiFi is down
+        if (link.downSince != 0 && !wifiLongOutageNotified &&
+            now - link.downSince >= WIFI_OUTAGE_NOTIFY_THRESHOLD_MS) {
+            Serial.println("⚠️ WiFi disconnected for " + String((now - link.downSince) / 60000) +
+                           " minutes, still trying to reconnect...");
+            wifiLongOutageNotified = true;
         }
+    }
 
-        // Check if we should notify about long outage
-        if (!wifiLongOutageNotified) {
-            unsigned long outageDuration = now - wifiDisconnectedSince;
-            if (outageDuration >= WIFI_OUTAGE_NOTIFY_THRESHOLD_MS) {
-                unsigned long minutes = outageDuration / 60000;
-                // Can only log to Serial since WiFi is down
-                Serial.println("⚠��� WiFi disconnected for " + String(minutes) + " minutes, still trying to reconnect...");
-                wifiLongOutageNotified = true;
-            }
-        }
-
-        // Check if backoff period has elapsed
-        if (now - lastWifiReconnectAttempt < wifiReconnectBackoffMs) {
-            return;  // Not time yet
-        }
-
-        lastWifiReconnectAttempt = now;
-
-        // CRITICAL: Disconnect fully before reconnecting to reset WiFi driver state
-        Serial.println("🔄 WiFi reconnect attempt (backoff: " + String(wifiReconnectBackoffMs / 1000) + "s)");
-        WiFi.disconnect(true);  // true = turn off WiFi radio completely
-        delay(100);             // Brief pause for driver cleanup
+    // ========== Metrics ==========
+    static const WifiLinkLogic::Link& getLink() { return link; }
+    static uint32_t getDroppedEvents() { return events.dropped; }
 
-        WiFi.mode(WIFI_STA);
-        WiFi.begin(SSID, SSID_PASSWORD);
-
-        // Short blocking wait: WIFI_RECONNECT_MAX_ATTEMPTS retries x 500ms = 2.5s
-        int attempts = 0;
-        while (WiFi.status() != WL_CONNECTED && attempts < WIFI_RECONNECT_MAX_ATTEMPTS) {
-            delay(WIFI_RETRY_DELAY_MS);
-            yield();
-            attempts++;
-        }
-
-        if (WiFi.status() == WL_CONNECTED) {
-            WiFi.setAutoReconnect(true);
-            // Recovery will be logged on next loopWiFi() call (wifiDisconnectedSince > 0)
+private:
+    static void logLinkUp(bool afterOutage) {
+        wifiLongOutageNotified = false;
+        saveCache();
+        if (afterOutage) {
+            unsigned long minutes = link.lastOutageMs / 60000;
+            unsigned long seconds = (link.lastOutageMs / 1000) % 60;
+            DebugHelper::debugImportant("✓ WiFi reconnected after " + String(minutes) + "m " + String(seconds) +
+                                        "s outage (" + String(link.lastOutageAttempts) + " attempts, assoc->IP " +
+                                        String(link.lastAssocToIpMs) + "ms), IP: " +
+                                        WiFi.localIP().toString() + ", RSSI: " + String(WiFi.RSSI()) + " dBm");
         } else {
-            // Increase backoff for next attempt (exponential, capped)
-            wifiReconnectBackoffMs = min(wifiReconnectBackoffMs * 2, WIFI_RECONNECT_BACKOFF_MAX_MS);
-            Serial.println("❌ WiFi reconnect failed, next attempt in " + String(wifiReconnectBackoffMs / 1000) + "s");
+            DebugHelper::debug("✓ WiFi Connected in " + String(link.lastConnectMs) + "ms" +
+                               String(link.lastConnectDirected ? " (directed)" : "") + "! IP: " +
+                               WiFi.localIP().toString() + ", RSSI: " + String(WiFi.RSSI()) + " dBm");
         }
+        BLOG_INFO("WiFi connected RSSI=%d", (int)WiFi.RSSI());
     }
 };
 
 // Static member initialization
 WateringSystem* NetworkManager::wateringSystem = nullptr;
-unsigned long NetworkManager::wifiDisconnectedSince = 0;
+const WifiLinkLogic::Config NetworkManager::linkConfig = {
+    WIFI_CONNECT_ATTEMPT_TIMEOUT_MS, WIFI_DIRECTED_ATTEMPT_TIMEOUT_MS, WIFI_RECONNECT_SETTLE_MS,
+    WIFI_RECONNECT_BACKOFF_INITIAL_MS, WIFI_RECONNECT_BACKOFF_MAX_MS};
+WifiLinkLogic::Link NetworkManager::link = WifiLinkLogic::makeLink(NetworkManager::linkConfig);
+WifiLinkLogic::EventQueue NetworkManager::events;
+portMUX_TYPE NetworkManager::eventLock = portMUX_INITIALIZER_UNLOCKED;
+uint32_t NetworkManager::eventGeneration = 0;
 bool NetworkManager::wifiLongOutageNotified = false;
-unsigned long NetworkManager::lastWifiReconnectAttempt = 0;
-unsigned long NetworkManager::wifiReconnectBackoffMs = WIFI_RECONNECT_BACKOFF_INITIAL_MS;
+WifiFastConnectLogic::Cache NetworkManager::cache = WifiFastConnectLogic::emptyCache();
+uint32_t NetworkManager::ssidHash = 0;
 
 #endif // NETWORK_MANAGER_H
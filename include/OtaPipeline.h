@@ -0,0 +1,455 @@
+#ifndef OTA_PIPELINE_H
+#define OTA_PIPELINE_H
+
+#include <Arduino.h>
+#include <Update.h>
+#include <mbedtls/sha256.h>
+#include "config.h"
+#include "OtaProgressLogic.h"
+#include "DeltaOtaUpdater.h"
+#include "WebAssetLogic.h"
+#include "LoopDeadlineMonitor.h"
+
+enum OtaTarget {
+    OTA_TARGET_FIRMWARE,     // Full app image into the inactive OTA slot
+    OTA_TARGET_DELTA,        // WDP1 patch, decoded by DeltaOtaUpdater
+    OTA_TARGET_FILESYSTEM    // LittleFS image
+};
+
+enum OtaState {
+    OTA_STATE_IDLE,
+    OTA_STATE_RECEIVING,
+    OTA_STATE_FINISHING,
+    OTA_STATE_SUCCESS,
+    OTA_STATE_FAILED
+};
+
+// Stats of the update that produced the running firmware. Written just before
+// the post-update restart, survive it (not power loss).
+#define OTA_STATS_MAGIC 0x07A5B007UL
+RTC_NOINIT_ATTR uint32_t g_otaStatsMagic;
+RTC_NOINIT_ATTR uint32_t g_otaLastBytes;
+RTC_NOINIT_ATTR uint32_t g_otaLastDurationMs;
+RTC_NOINIT_ATTR uint32_t g_otaLastThroughputBps;
+
+// ============================================
+// OtaPipeline - double-buffered OTA writer
+// Header-only static class (same pattern as DebugHelper)
+//
+// network task (HTTP upload callback)      OtaWriter task (core 0, prio 2)
+//   push(): copy chunk into ring slot  -->   SHA-256 + Update.write / delta
+//   <-- slot back on freeQueue when written
+//
+// The receiver only blocks when every slot is waiting for flash, so TCP keeps
+// streaming while a sector is erased and the whole update (the window in which
+// only the control loop and its watchdog supervise watering) gets shorter.
+// The upload's own SHA-256 is computed in the writer and checked against the
+// optional ?sha256= argument before the new image is marked bootable.
+//
+// Buffers and the writer task are created on the first update and reused.
+// ============================================
+class OtaPipeline {
+private:
+    static const uint8_t NO_BUFFER = 0xFF;        // Also the end-of-stream marker on fullQueue
+
+    static uint8_t* buffers[OTA_PIPELINE_BUFFER_COUNT];
+    static uint32_t lengths[OTA_PIPELINE_BUFFER_COUNT];
+    static QueueHandle_t freeQueue;
+    static QueueHandle_t fullQueue;
+    static SemaphoreHandle_t drainedSemaphore;
+    static TaskHandle_t writerTaskHandle;
+
+    static uint8_t fillIndex;
+    static uint32_t fillCount;
+
+    static OtaTarget target;
+    static volatile OtaState state;
+    static volatile bool writerFailed;
+    static bool writerBusy;            // Failed while stuck; not yet past its drain marker
+    static mbedtls_sha256_context streamSha;
+    static String lastError;
+    static uint32_t failures;
+
+    static unsigned long startMs;
+    static unsigned long endMs;
+    static unsigned long lastProgressLogMs;
+    static uint32_t expectedBytes;
+    static volatile uint32_t bytesReceived;
+    static volatile uint32_t bytesWritten;
+
+    static bool writeToTarget(const uint8_t* data, size_t len) {
+        if (target == OTA_TARGET_DELTA) {
+            return DeltaOtaUpdater::write(data, len);
+        }
+        return Update.write(const_cast<uint8_t*>(data), len) == len;
+    }
+
+    static void writerTask(void* parameter) {
+        (void)parameter;
+        uint8_t index;
+        for (;;) {
+            if (xQueueReceive(fullQueue, &index, portMAX_DELAY) != pdTRUE) continue;
+            if (index == NO_BUFFER) {
+                xSemaphoreGive(drainedSemaphore);
+                continue;
+            }
+            // After a failure keep cycling slots back so the receiver never
+            // deadlocks; finish()/abort() report the error.
+            if (!writerFailed) {
+                mbedtls_sha256_update_ret(&streamSha, buffers[index], lengths[index]);
+                if (writeToTarget(buffers[index], lengths[index])) {
+                    bytesWritten += lengths[index];
+                } else {
+                    writerFailed = true;
+                }
+            }
+            xQueueSend(freeQueue, &index, portMAX_DELAY);
+        }
+    }
+
+    static bool createResources() {
+        if (writerTaskHandle != NULL) return true;
+
+        for (int i = 0; i < OTA_PIPELINE_BUFFER_COUNT; i++) {
+            if (buffers[i] == nullptr) {
+                buffers[i] = (uint8_t*)ps_malloc(OTA_PIPELINE_BUFFER_SIZE);
+                if (buffers[i] == nullptr) buffers[i] = (uint8_t*)malloc(OTA_PIPELINE_BUFFER_SIZE);
+                if (buffers[i] == nullptr) return false;
+            }
+        }
+        if (freeQueue == NULL) freeQueue = xQueueCreate(OTA_PIPELINE_BUFFER_COUNT, sizeof(uint8_t));
+        // +1 so the end-of-stream marker never blocks
+        if (fullQueue == NULL) fullQueue = xQueueCreate(OTA_PIPELINE_BUFFER_COUNT + 1, sizeof(uint8_t));
+        if (drainedSemaphore == NULL) drainedSemaphore = xSemaphoreCreateBinary();
+        if (freeQueue == NULL || fullQueue == NULL || drainedSemaphore == NULL) return false;
+
+        xTaskCreatePinnedToCore(writerTask, "OtaWriter", OTA_WRITER_TASK_STACK, NULL,
+                                OTA_WRITER_TASK_PRIORITY, &writerTaskHandle, 0);
+        return writerTaskHandle != NULL;
+    }
+
+    // Wait (heartbeating) until `done` holds or the stall timeout expires.
+    static bool waitForWriter(bool (*done)()) {
+        unsigned long waitStart = millis();
+        while (!done()) {
+            LoopDeadlineMonitor::heartbeat(DEADLINE_TASK_NETWORK);
+            if (millis() - waitStart > OTA_PIPELINE_STALL_TIMEOUT_MS) return false;
+        }
+        return true;
+    }
+
+    static bool takeFreeBuffer() {
+        return xQueueReceive(freeQueue, &fillIndex, pdMS_TO_TICKS(100)) == pdTRUE;
+    }
+
+    static bool takeDrained() {
+        return xSemaphoreTake(drainedSemaphore, pdMS_TO_TICKS(100)) == pdTRUE;
+    }
+
+    static void submitFillBuffer() {
+        lengths[fillIndex] = fillCount;
+        xQueueSend(fullQueue, &fillIndex, portMAX_DELAY);
+        fillIndex = NO_BUFFER;
+        fillCount = 0;
+    }
+
+    // Hand back the partially filled slot (if any) and wait until the writer
+    // has processed everything queued before the end-of-stream marker.
+    static bool drain() {
+        if (fillIndex != NO_BUFFER) {
+            if (fillCount > 0 && !writerFailed) {
+                submitFillBuffer();
+            } else {
+                xQueueSend(freeQueue, &fillIndex, 0);
+                fillIndex = NO_BUFFER;
+                fillCount = 0;
+            }
+        }
+        uint8_t marker = NO_BUFFER;
+        xQueueSend(fullQueue, &marker, portMAX_DELAY);
+        return waitForWriter(takeDrained);
+    }
+
+    static String targetError() {
+        if (target == OTA_TARGET_DELTA) return DeltaOtaUpdater::getLastError();
+        return String(Update.errorString());
+    }
+
+    static void abortTarget() {
+        if (target == OTA_TARGET_DELTA) {
+            DeltaOtaUpdater::abort();
+        } else {
+            Update.abort();
+        }
+    }
+
+    static bool failWith(const String& error, bool writerIdle) {
+        // A writer stuck in flash I/O still owns Update, streamSha and its
+        // slot - leave them alone, but make it drop whatever it picks up
+        // next. reclaimWriter() cleans up once it reaches the drain marker.
+        writerFailed = true;
+        if (writerIdle) {
+            abortTarget();
+            mbedtls_sha256_free(&streamSha);
+        } else {
+            writerBusy = true;
+        }
+        lastError = error;
+        endMs = millis();
+        state = OTA_STATE_FAILED;
+        failures++;
+        Serial.printf("\nOTA failed after %u bytes: %s\n", (unsigned)bytesReceived, error.c_str());
+        return false;
+    }
+
+    // Deferred half of failWith() for a stuck writer. False while it is still
+    // busy: resetting the queues then would re-seed a slot it still holds.
+    static bool reclaimWriter() {
+        if (!writerBusy) return true;
+        if (xSemaphoreTake(drainedSemaphore, 0) != pdTRUE) return false;
+        abortTarget();
+        mbedtls_sha256_free(&streamSha);
+        writerBusy = false;
+        return true;
+    }
+
+    static void logProgress(bool force) {
+        unsigned long now = millis();
+        if (!force && now - lastProgressLogMs < OTA_PROGRESS_LOG_INTERVAL_MS) return;
+        lastProgressLogMs = now;
+        Serial.printf("OTA: %d%% (%u/%u bytes received), %u written, %u B/s, ETA %lds\n",
+                      OtaProgressLogic::percent(bytesReceived, expectedBytes),
+                      (unsigned)bytesReceived, (unsigned)expectedBytes,
+                      (unsigned)bytesWritten, (unsigned)getThroughputBps(), getEtaSeconds());
+    }
+
+public:
+    static const char* stateName(OtaState s) {
+        switch (s) {
+            case OTA_STATE_IDLE:      return "idle";
+            case OTA_STATE_RECEIVING: return "receiving";
+            case OTA_STATE_FINISHING: return "finishing";
+            case OTA_STATE_SUCCESS:   return "success";
+            case OTA_STATE_FAILED:    return "failed";
+            default:                  return "unknown";
+        }
+    }
+
+    static const char* targetName(OtaTarget t) {
+        switch (t) {
+            case OTA_TARGET_FIRMWARE:   return "firmware";
+            case OTA_TARGET_DELTA:      return "delta";
+            case OTA_TARGET_FILESYSTEM: return "filesystem";
+            default:                    return "unknown";
+        }
+    }
+
+    // Start a pipelined update. expectedTotal is the request's Content-Length
+    // (multipart overhead included, so progress ends a little below 100%);
+    // 0 if unknown.
+    static bool begin(OtaTarget newTarget, uint32_t expectedTotal) {
+        if (!reclaimWriter()) {
+            lastError = "flash writer of the previous update still busy";
+            state = OTA_STATE_FAILED;
+            failures++;
+            Serial.println("OTA failed: " + lastError);
+            return false;
+        }
+        target = newTarget;
+        lastError = "";
+        writerFailed = false;
+        bytesReceived = 0;
+        bytesWritten = 0;
+        expectedBytes = expectedTotal;
+        startMs = millis();
+        endMs = 0;
+        lastProgressLogMs = startMs;
+        fillIndex = NO_BUFFER;
+        fillCount = 0;
+
+        if (!createResources()) {
+            lastError = "cannot allocate OTA pipeline";
+            state = OTA_STATE_FAILED;
+            failures++;
+            Serial.println("OTA failed: " + lastError);
+            return false;
+        }
+        xQueueReset(freeQueue);
+        xQueueReset(fullQueue);
+        xSemaphoreTake(drainedSemaphore, 0);
+        for (uint8_t i = 0; i < OTA_PIPELINE_BUFFER_COUNT; i++) {
+            xQueueSend(freeQueue, &i, 0);
+        }
+
+        bool started;
+        if (target == OTA_TARGET_DELTA) {
+            started = DeltaOtaUpdater::begin();
+        } else {
+            started = Update.begin(UPDATE_SIZE_UNKNOWN,
+                                   target == OTA_TARGET_FILESYSTEM ? U_SPIFFS : U_FLASH);
+        }
+        if (!started) {
+            lastError = targetError();
+            state = OTA_STATE_FAILED;
+            failures++;
+            Serial.println("OTA failed: " + lastError);
+            return false;
+        }
+        mbedtls_sha256_init(&streamSha);
+        mbedtls_sha256_starts_ret(&streamSha, 0);
+        state = OTA_STATE_RECEIVING;
+        Serial.printf("OTA: %s update started (%u bytes expected)\n",
+                      targetName(target), (unsigned)expectedTotal);
+        return true;
+    }
+
+    // Queue one upload chunk. Blocks only while every ring slot is in flight.
+    static bool push(const uint8_t* data, size_t len) {
+        if (state != OTA_STATE_RECEIVING) return false;
+        if (writerFailed) {
+            bool idle = drain();
+            return failWith(targetError(), idle);
+        }
+        bytesReceived += len;
+        while (len > 0) {
+            if (fillIndex == NO_BUFFER && !waitForWriter(takeFreeBuffer)) {
+                uint8_t marker = NO_BUFFER;
+                xQueueSend(fullQueue, &marker, 0);  // What reclaimWriter() waits for
+                return failWith("flash writer stalled", false);
+            }
+            uint32_t n = OtaProgressLogic::fillBuffer(buffers[fillIndex], fillCount,
+                                                      OTA_PIPELINE_BUFFER_SIZE, data, len);
+            data += n;
+            len -= n;
+            if (fillCount == OTA_PIPELINE_BUFFER_SIZE) submitFillBuffer();
+        }
+        logProgress(false);
+        return true;
+    }
+
+    // Flush, verify the streamed SHA-256 (if the client sent one) and finalize
+    // the target. Only a true return leaves a bootable image behind.
+    static bool finish(const String& expectedSha256Hex) {
+        if (state != OTA_STATE_RECEIVING) return false;
+        state = OTA_STATE_FINISHING;
+        if (!drain()) return failWith("flash writer did not drain", false);
+        if (writerFailed) return failWith(targetError(), true);
+
+        uint8_t digest[32];
+        mbedtls_sha256_finish_ret(&streamSha, digest);
+        if (expectedSha256Hex.length() > 0 &&
+            !WebAssetLogic::hexMatches(expectedSha256Hex.c_str(), digest, sizeof(digest))) {
+            return failWith("upload SHA-256 mismatch", true);
+        }
+        mbedtls_sha256_free(&streamSha);
+
+        bool ok = target == OTA_TARGET_DELTA ? DeltaOtaUpdater::end() : Update.end(true);
+        if (!ok) {
+            lastError = targetError();
+            endMs = millis();
+            state = OTA_STATE_FAILED;
+            failures++;
+            Serial.println("OTA failed: " + lastError);
+            return false;
+        }
+
+        endMs = millis();
+        state = OTA_STATE_SUCCESS;
+        logProgress(true);
+        Serial.printf("OTA: %s update complete, %u bytes in %lums\n",
+                      targetName(target), (unsigned)bytesReceived, endMs - startMs);
+        g_otaLastBytes = bytesReceived;
+        g_otaLastDurationMs = endMs - startMs;
+        g_otaLastThroughputBps = getThroughputBps();
+        g_otaStatsMagic = OTA_STATS_MAGIC;
+        return true;
+    }
+
+    // Connection dropped mid-upload.
+    static void abort() {
+        if (state != OTA_STATE_RECEIVING && state != OTA_STATE_FINISHING) return;
+        bool idle = drain();
+        failWith("upload aborted", idle);
+    }
+
+    static OtaState getState() { return state; }
+    static bool isActive() { return state == OTA_STATE_RECEIVING || state == OTA_STATE_FINISHING; }
+    static const String& getLastError() { return lastError; }
+    static uint32_t getFailureCount() { return failures; }
+    static uint32_t getBytesReceived() { return bytesReceived; }
+    static uint32_t getBytesWritten() { return bytesWritten; }
+
+    static unsigned long getElapsedMs() {
+        if (state == OTA_STATE_IDLE) return 0;
+        return (isActive() ? millis() : endMs) - startMs;
+    }
+
+    static uint32_t getThroughputBps() {
+        return OtaProgressLogic::throughputBps(bytesReceived, getElapsedMs());
+    }
+
+    static long getEtaSeconds() {
+        if (!isActive()) return 0;
+        return OtaProgressLogic::etaSeconds(bytesReceived, expectedBytes, getThroughputBps());
+    }
+
+    static uint32_t getLastBootUpdateBytes() {
+        return g_otaStatsMagic == OTA_STATS_MAGIC ? g_otaLastBytes : 0;
+    }
+    static uint32_t getLastBootUpdateDurationMs() {
+        return g_otaStatsMagic == OTA_STATS_MAGIC ? g_otaLastDurationMs : 0;
+    }
+    static uint32_t getLastBootUpdateThroughputBps() {
+        return g_otaStatsMagic == OTA_STATS_MAGIC ? g_otaLastThroughputBps : 0;
+    }
+
+    // The last update attempted since boot and the one that installed the
+    // running firmware. No live progress here: uploads run inside the
+    // single-threaded WebServer, so /status is only served once one has
+    // ended (and a successful one reboots). Live progress, throughput and
+    // ETA go to Serial from logProgress().
+    static String statusJson() {
+        String json = "{\"state\":\"" + String(stateName(state)) + "\"";
+        json += ",\"target\":\"" + String(targetName(target)) + "\"";
+        json += ",\"received\":" + String(getBytesReceived());
+        json += ",\"written\":" + String(getBytesWritten());
+        json += ",\"duration_ms\":" + String(getElapsedMs());
+        json += ",\"throughput_bps\":" + String(getThroughputBps());
+        json += ",\"failures\":" + String(failures);
+        String escaped = lastError;
+        escaped.replace("\"", "'");
+        json += ",\"error\":\"" + escaped + "\"";
+        json += ",\"last_boot_update\":{\"bytes\":" + String(getLastBootUpdateBytes());
+        json += ",\"duration_ms\":" + String(getLastBootUpdateDurationMs());
+        json += ",\"throughput_bps\":" + String(getLastBootUpdateThroughputBps()) + "}";
+        json += "}";
+        return json;
+    }
+};
+
+// ============================================
+// Static Member Initialization
+// ============================================
+uint8_t* OtaPipeline::buffers[OTA_PIPELINE_BUFFER_COUNT] = {nullptr};
+uint32_t OtaPipeline::lengths[OTA_PIPELINE_BUFFER_COUNT] = {0};
+QueueHandle_t OtaPipeline::freeQueue = NULL;
+QueueHandle_t OtaPipeline::fullQueue = NULL;
+SemaphoreHandle_t OtaPipeline::drainedSemaphore = NULL;
+TaskHandle_t OtaPipeline::writerTaskHandle = NULL;
+uint8_t OtaPipeline::fillIndex = OtaPipeline::NO_BUFFER;
+uint32_t OtaPipeline::fillCount = 0;
+OtaTarget OtaPipeline::target = OTA_TARGET_FIRMWARE;
+volatile OtaState OtaPipeline::state = OTA_STATE_IDLE;
+volatile bool OtaPipeline::writerFailed = false;
+bool OtaPipeline::writerBusy = false;
+mbedtls_sha256_context OtaPipeline::streamSha;
+String OtaPipeline::lastError = "";
+uint32_t OtaPipeline::failures = 0;
+unsigned long OtaPipeline::startMs = 0;
+unsigned long OtaPipeline::endMs = 0;
+unsigned long OtaPipeline::lastProgressLogMs = 0;
+uint32_t OtaPipeline::expectedBytes = 0;
+volatile uint32_t OtaPipeline::bytesReceived = 0;
+volatile uint32_t OtaPipeline::bytesWritten = 0;
+
+#endif // OTA_PIPELINE_H
@@ -0,0 +1,46 @@
+#ifndef OTA_PROGRESS_LOGIC_H
+#define OTA_PROGRESS_LOGIC_H
+
+#include <stdint.h>
+
+// Pure, hardware-free progress arithmetic for the OTA pipeline (OtaPipeline.h),
+// shared with the native test suite. All values are derived from byte counters
+// and millis() timestamps so they can be reported from any task.
+namespace OtaProgressLogic {
+
+// Percent of `total` done, or -1 while the total is unknown.
+inline int percent(uint32_t done, uint32_t total) {
+  if (total == 0) return -1;
+  if (done >= total) return 100;
+  return (int)((uint64_t)done * 100 / total);
+}
+
+// Average throughput in bytes per second since the transfer started.
+inline uint32_t throughputBps(uint32_t bytes, unsigned long elapsedMs) {
+  if (elapsedMs == 0) return 0;
+  return (uint32_t)((uint64_t)bytes * 1000 / elapsedMs);
+}
+
+// Seconds left at the current throughput, or -1 when it cannot be estimated.
+inline long etaSeconds(uint32_t done, uint32_t total, uint32_t bps) {
+  if (total == 0 || bps == 0) return -1;
+  if (done >= total) return 0;
+  return (long)((total - done + bps - 1) / bps);
+}
+
+// Copy as much of `len` bytes into a partially filled buffer as fits. Returns
+// the number of bytes consumed; the caller hands the buffer off when full.
+inline uint32_t fillBuffer(uint8_t *buffer, uint32_t &fill, uint32_t capacity,
+                           const uint8_t *data, uint32_t len) {
+  uint32_t room = capacity - fill;
+  uint32_t n = len < room ? len : room;
+  for (uint32_t i = 0; i < n; i++) {
+    buffer[fill + i] = data[i];
+  }
+  fill += n;
+  return n;
+}
+
+} // namespace OtaProgressLogic
+
+#endif // OTA_PROGRESS_LOGIC_H
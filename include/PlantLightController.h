@@ -9,6 +9,7 @@
 #else
 #include "config.h"
 #endif
+#include "LightScheduleLogic.h"
 
 enum PlantLightMode {
   PLANT_LIGHT_MODE_AUTO = 0,
@@ -16,10 +17,37 @@ enum PlantLightMode {
   PLANT_LIGHT_MODE_MANUAL_OFF = 2
 };
 
+// The control loop (Core 1) owns `schedule` and its cached evaluation. A new
+// schedule from the API task (Core 0) is written to `requested` under a
+// sequence count (odd while a write is in progress) and picked up by the
+// control loop at the start of its next shouldBeOnNow(), between ticks, so
+// it never evaluates a half-written schedule or has its cache reset under
+// it. Readers outside the control loop take consistent copies of
+// `requested` and evaluate them without touching the cache.
 class PlantLightController {
+public:
+  // One evaluation of a schedule at a point in time.
+  struct Evaluation {
+    bool on;
+    bool changes;          // Whether `on` flips before local midnight
+    time_t nextEvaluation; // That flip, else local midnight
+    LightScheduleLogic::SunTimes sunToday;
+  };
+
 private:
   bool lampOn;
   PlantLightMode mode;
+  LightScheduleLogic::Schedule schedule;
+
+  // Latest schedule set through setSchedule(); single writer
+  LightScheduleLogic::Schedule requested;
+  uint32_t requestSeq;
+  uint32_t appliedSeq;   // requestSeq that `schedule` was copied at
+
+  // Cached evaluation of `schedule`, valid for [decidedAt, nextEvaluation)
+  bool scheduledOn;
+  time_t decidedAt;
+  time_t nextEvaluation;
 
   bool writeRelayState(bool enabled) {
     lampOn = enabled;
@@ -28,6 +56,34 @@ private:
     return true;
   }
 
+  // Copy of `requested` taken while no write was in progress, with the
+  // sequence count it belongs to. False if a write got in the way.
+  bool tryReadRequested(LightScheduleLogic::Schedule &out, uint32_t &seq) const {
+    seq = __atomic_load_n(&requestSeq, __ATOMIC_ACQUIRE);
+    if (seq & 1) return false;
+    out = requested;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&requestSeq, __ATOMIC_RELAXED) == seq;
+  }
+
+  // Control loop only: adopt a schedule set since the last call.
+  void applyRequestedSchedule() {
+    if (__atomic_load_n(&requestSeq, __ATOMIC_RELAXED) == appliedSeq) return;
+    LightScheduleLogic::Schedule copy;
+    uint32_t seq;
+    if (!tryReadRequested(copy, seq)) return;  // Mid-write; next tick
+    schedule = copy;
+    appliedSeq = seq;
+    nextEvaluation = 0;
+  }
+
+  void evaluate(time_t now) {
+    Evaluation e = evaluateSchedule(schedule, now);
+    scheduledOn = e.on;
+    decidedAt = now;
+    nextEvaluation = e.nextEvaluation;
+  }
+
   bool applyRelayState(bool enabled) {
     if (lampOn == enabled) {
       return false;
@@ -37,35 +93,126 @@ private:
   }
 
 public:
-  PlantLightController() : lampOn(false), mode(PLANT_LIGHT_MODE_AUTO) {}
+  PlantLightController()
+      : lampOn(false), mode(PLANT_LIGHT_MODE_AUTO),
+        schedule(defaultSchedule()), requested(schedule), requestSeq(0),
+        appliedSeq(0), scheduledOn(false), decidedAt(0), nextEvaluation(0) {}
 
   void init() {
     pinMode(PLANT_LIGHT_RELAY_PIN, OUTPUT);
     writeRelayState(false);
   }
 
-  static bool isScheduleActive(const tm &timeInfo) {
-    const int currentMinute = timeInfo.tm_hour * 60 + timeInfo.tm_min;
-    const int onMinute =
+  // The compiled-in default (PLANT_LIGHT_SCHEDULE_* in config.h) until a
+  // schedule is set through /api/lamp/schedule.
+  static LightScheduleLogic::Schedule defaultSchedule() {
+    LightScheduleLogic::Schedule s;
+    s.windowCount = 1;
+    s.windows[0].on.anchor = LightScheduleLogic::ANCHOR_CLOCK;
+    s.windows[0].on.minutes =
         PLANT_LIGHT_SCHEDULE_ON_HOUR * 60 + PLANT_LIGHT_SCHEDULE_ON_MINUTE;
-    const int offMinute =
+    s.windows[0].off.anchor = LightScheduleLogic::ANCHOR_CLOCK;
+    s.windows[0].off.minutes =
         PLANT_LIGHT_SCHEDULE_OFF_HOUR * 60 + PLANT_LIGHT_SCHEDULE_OFF_MINUTE;
+    s.latitude = PLANT_LIGHT_LATITUDE;
+    s.longitude = PLANT_LIGHT_LONGITUDE;
+    return s;
+  }
+
+  // Whether `schedule` wants the lamp on at a broken-down local time (sun
+  // times taken as if local time were UTC+utcOffsetMin).
+  static bool isScheduleActive(const tm &timeInfo,
+                               const LightScheduleLogic::Schedule &schedule,
+                               int utcOffsetMin) {
+    LightScheduleLogic::SunTimes sun[4];
+    LightScheduleLogic::sunWindow(timeInfo.tm_yday, schedule.latitude,
+                                  schedule.longitude, utcOffsetMin, sun);
+    return LightScheduleLogic::isOnAt(schedule, sun,
+                                      timeInfo.tm_hour * 60 + timeInfo.tm_min);
+  }
+
+  static bool isScheduleActive(const tm &timeInfo) {
+    return isScheduleActive(timeInfo, defaultSchedule(), 0);
+  }
+
+  static Evaluation evaluateSchedule(const LightScheduleLogic::Schedule &schedule,
+                                     time_t now) {
+    tm local;
+    tm utc;
+    localtime_r(&now, &local);
+    gmtime_r(&now, &utc);
+    int minute = local.tm_hour * 60 + local.tm_min;
+    int utcOffsetMin = LightScheduleLogic::utcOffsetMinutes(
+        local.tm_year, local.tm_yday, minute, utc.tm_year, utc.tm_yday,
+        utc.tm_hour * 60 + utc.tm_min);
+
+    LightScheduleLogic::SunTimes sun[4];
+    LightScheduleLogic::sunWindow(local.tm_yday, schedule.latitude,
+                                  schedule.longitude, utcOffsetMin, sun);
+    LightScheduleLogic::Decision decision =
+        LightScheduleLogic::decide(schedule, sun, minute);
 
-    if (onMinute == offMinute) {
-      return true;
+    // mktime() resolves the minute in local time, so a DST shift between
+    // now and the transition is handled too.
+    tm next = local;
+    next.tm_hour = 0;
+    next.tm_min = decision.nextMinute;
+    next.tm_sec = 0;
+    next.tm_isdst = -1;
+    time_t nextTime = mktime(&next);
+
+    Evaluation e;
+    e.on = decision.on;
+    e.changes = decision.changes;
+    e.nextEvaluation = nextTime > now ? nextTime : now + 60;
+    e.sunToday = sun[1];
+    return e;
+  }
+
+  // Control loop only. Per-tick cost is the range check; the schedule itself
+  // is only evaluated when the cached decision expires (next transition or
+  // local midnight), the clock steps backwards, or a new schedule was set.
+  bool shouldBeOnNow(time_t now) {
+    applyRequestedSchedule();
+    if (now >= decidedAt && now < nextEvaluation) {
+      return scheduledOn;
     }
+    evaluate(now);
+    return scheduledOn;
+  }
 
-    if (onMinute < offMinute) {
-      return currentMinute >= onMinute && currentMinute < offMinute;
+  // Safe from any task: hands the schedule to the control loop, which
+  // switches to it at its next shouldBeOnNow().
+  bool setSchedule(const LightScheduleLogic::Schedule &newSchedule) {
+    if (!LightScheduleLogic::validLocation(newSchedule.latitude,
+                                           newSchedule.longitude)) {
+      return false;
     }
+    uint32_t seq = __atomic_load_n(&requestSeq, __ATOMIC_RELAXED);
+    __atomic_store_n(&requestSeq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);  // Odd count visible before the data
+    requested = newSchedule;
+    __atomic_store_n(&requestSeq, seq + 2, __ATOMIC_RELEASE);
+    return true;
+  }
 
-    return currentMinute >= onMinute || currentMinute < offMinute;
+  // The schedule last set (possibly not yet adopted by the control loop).
+  LightScheduleLogic::Schedule getSchedule() const {
+    LightScheduleLogic::Schedule copy;
+    uint32_t seq;
+    while (!tryReadRequested(copy, seq)) {
+    }
+    return copy;
   }
 
-  bool shouldBeOnNow(time_t now) const {
-    tm timeInfo;
-    localtime_r(&now, &timeInfo);
-    return isScheduleActive(timeInfo);
+  size_t getScheduleText(char *out, size_t outSize) const {
+    return LightScheduleLogic::format(getSchedule(), out, outSize);
+  }
+
+  // What auto mode wants under getSchedule(), evaluated fresh for callers
+  // outside the control loop (its cache is left alone).
+  bool autoWantsOn(time_t now) const {
+    return evaluateSchedule(getSchedule(), now).on;
   }
 
   bool applyAutomaticSchedule(time_t now) {
@@ -88,7 +235,7 @@ public:
 
   bool setAuto(time_t now) {
     mode = PLANT_LIGHT_MODE_AUTO;
-    return applyRelayState(shouldBeOnNow(now));
+    return applyRelayState(autoWantsOn(now));
   }
 
   void syncAutoStateSilently(time_t now) {
@@ -0,0 +1,145 @@
+#ifndef POWER_LOGIC_H
+#define POWER_LOGIC_H
+
+#include <stdint.h>
+
+// Idle power policy and accounting, hardware-free. PowerManager.h applies it
+// with esp_pm locks, esp_wifi_set_ps and the control loop period.
+//
+//   ACTIVE: a valve cycle, queue, pump or overflow confirmation is in
+//           progress, or one ended less than enterIdleMs ago. 100Hz loop,
+//           CPU locked at max frequency, no light sleep.
+//   IDLE:   slow loop; CPU may scale down and, with tickless idle, light
+//           sleep between loop wakes. Sensor pin changes wake it at once.
+//
+// WiFi power save follows the traffic seen by the web server instead of the
+// watering state: none while a client is talking, DTIM modem sleep after
+// holdMs, listen-interval (max modem) sleep after deepAfterMs.
+namespace PowerLogic {
+
+enum Mode { MODE_ACTIVE = 0, MODE_IDLE = 1, MODE_COUNT = 2 };
+enum WifiSave { WIFI_SAVE_NONE = 0, WIFI_SAVE_MIN = 1, WIFI_SAVE_MAX = 2, WIFI_SAVE_COUNT = 3 };
+
+inline const char *modeName(Mode m) { return m == MODE_IDLE ? "idle" : "active"; }
+
+inline const char *wifiSaveName(WifiSave w) {
+  switch (w) {
+    case WIFI_SAVE_MIN: return "min_modem";
+    case WIFI_SAVE_MAX: return "max_modem";
+    default: return "none";
+  }
+}
+
+// Busy always means ACTIVE; otherwise stay ACTIVE until enterIdleMs of quiet.
+inline Mode nextMode(bool busy, unsigned long now, unsigned long lastBusyAt,
+                     unsigned long enterIdleMs) {
+  if (busy) return MODE_ACTIVE;
+  return now - lastBusyAt >= enterIdleMs ? MODE_IDLE : MODE_ACTIVE;
+}
+
+inline WifiSave wifiSaveFor(unsigned long now, unsigned long lastTrafficAt,
+                            unsigned long holdMs, unsigned long deepAfterMs) {
+  unsigned long quiet = now - lastTrafficAt;
+  if (quiet < holdMs) return WIFI_SAVE_NONE;
+  if (quiet < deepAfterMs) return WIFI_SAVE_MIN;
+  return WIFI_SAVE_MAX;
+}
+
+// A sensor edge goes unnoticed for at most one loop period without a wake.
+inline unsigned long loopPeriodMs(Mode m, unsigned long activeMs, unsigned long idleMs) {
+  return m == MODE_IDLE ? idleMs : activeMs;
+}
+
+// Level-triggered pin interrupts (the only kind that also wakes light sleep)
+// fire on the opposite of the current level, so each change fires once.
+inline bool wakeOnHighLevel(bool pinIsHigh) { return !pinIsHigh; }
+
+struct Stats {
+  Mode mode;
+  WifiSave wifi;
+  unsigned long since;                  // millis() of the last account()
+  uint64_t modeMs[MODE_COUNT];
+  uint64_t wifiMs[WIFI_SAVE_COUNT];
+  uint32_t modeChanges;
+  uint32_t wakes;                       // Sensor-pin wakes handled
+  uint32_t lastWakeLatencyUs;           // Pin edge -> control loop pass
+  uint32_t maxWakeLatencyUs;
+  uint64_t sumWakeLatencyUs;
+};
+
+inline Stats makeStats(unsigned long now) {
+  Stats s;
+  s.mode = MODE_ACTIVE;
+  s.wifi = WIFI_SAVE_NONE;
+  s.since = now;
+  for (int i = 0; i < MODE_COUNT; i++) s.modeMs[i] = 0;
+  for (int i = 0; i < WIFI_SAVE_COUNT; i++) s.wifiMs[i] = 0;
+  s.modeChanges = 0;
+  s.wakes = 0;
+  s.lastWakeLatencyUs = 0;
+  s.maxWakeLatencyUs = 0;
+  s.sumWakeLatencyUs = 0;
+  return s;
+}
+
+// Charge the time since the last call to the current mode and WiFi level.
+inline void account(Stats &s, unsigned long now) {
+  unsigned long elapsed = now - s.since;
+  s.modeMs[s.mode] += elapsed;
+  s.wifiMs[s.wifi] += elapsed;
+  s.since = now;
+}
+
+inline void setMode(Stats &s, Mode m, unsigned long now) {
+  account(s, now);
+  if (m != s.mode) s.modeChanges++;
+  s.mode = m;
+}
+
+inline void setWifi(Stats &s, WifiSave w, unsigned long now) {
+  account(s, now);
+  s.wifi = w;
+}
+
+inline void recordWake(Stats &s, uint32_t latencyUs) {
+  s.wakes++;
+  s.lastWakeLatencyUs = latencyUs;
+  if (latencyUs > s.maxWakeLatencyUs) s.maxWakeLatencyUs = latencyUs;
+  s.sumWakeLatencyUs += latencyUs;
+}
+
+inline uint32_t meanWakeLatencyUs(const Stats &s) {
+  return s.wakes > 0 ? (uint32_t)(s.sumWakeLatencyUs / s.wakes) : 0;
+}
+
+inline float idleFraction(const Stats &s) {
+  uint64_t total = s.modeMs[MODE_ACTIVE] + s.modeMs[MODE_IDLE];
+  return total > 0 ? (float)s.modeMs[MODE_IDLE] / (float)total : 0.0f;
+}
+
+// Current model: CPU draw per mode plus WiFi draw per power-save level
+struct CurrentModel {
+  float cpuMa[MODE_COUNT];
+  float wifiMa[WIFI_SAVE_COUNT];
+};
+
+inline float currentMa(const CurrentModel &model, Mode m, WifiSave w) {
+  return model.cpuMa[m] + model.wifiMa[w];
+}
+
+// Time-weighted average since boot (call account() first)
+inline float averageCurrentMa(const Stats &s, const CurrentModel &model) {
+  uint64_t modeTotal = s.modeMs[MODE_ACTIVE] + s.modeMs[MODE_IDLE];
+  uint64_t wifiTotal = 0;
+  for (int i = 0; i < WIFI_SAVE_COUNT; i++) wifiTotal += s.wifiMs[i];
+  if (modeTotal == 0 || wifiTotal == 0) return currentMa(model, s.mode, s.wifi);
+  float cpu = 0.0f;
+  for (int i = 0; i < MODE_COUNT; i++) cpu += model.cpuMa[i] * (float)s.modeMs[i];
+  float wifi = 0.0f;
+  for (int i = 0; i < WIFI_SAVE_COUNT; i++) wifi += model.wifiMa[i] * (float)s.wifiMs[i];
+  return cpu / (float)modeTotal + wifi / (float)wifiTotal;
+}
+
+}  // namespace PowerLogic
+
+#endif  // POWER_LOGIC_H
@@ -0,0 +1,217 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include <esp_attr.h>
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include <esp_wifi.h>
+#include <driver/gpio.h>
+#include <soc/gpio_struct.h>
+#if CONFIG_IDF_TARGET_ESP32S3
+#include <esp32s3/pm.h>
+#endif
+#include "config.h"
+#include "DebugHelper.h"
+#include "BinaryLog.h"
+#include "PowerLogic.h"
+
+// ============================================
+// PowerManager - idle CPU/WiFi power saving for both tasks
+// Header-only static class (same pattern as DebugHelper)
+//
+// The control loop (Core 1) calls update() with WateringSystem::needsFastLoop()
+// and then waitForNextCycle() instead of a fixed delay(10). While ACTIVE it
+// holds a CPU_FREQ_MAX and a NO_LIGHT_SLEEP lock; in IDLE it releases them, so
+// esp_pm can drop to POWER_CPU_MIN_MHZ and, with tickless idle, light-sleep
+// until the next loop wake. The overflow and tank level pins use level
+// interrupts flipped to the opposite level on every fire: that catches each
+// change, also wakes the chip from light sleep, and notifies the loop task
+// directly. Core 0 calls loopNetwork() to pick the WiFi power-save level from
+// web server traffic and networkPollMs() for its own delay.
+// ============================================
+class PowerManager {
+private:
+    static PowerLogic::Stats stats;
+    static PowerLogic::Mode mode;
+    static unsigned long lastBusyAt;
+    static unsigned long lastTrafficAt;
+    static bool pmConfigured;
+    static esp_pm_lock_handle_t cpuLock;
+    static esp_pm_lock_handle_t sleepLock;
+    static TaskHandle_t loopTask;
+    static volatile uint32_t pendingWakeAtUs;  // micros() of the first unhandled pin change, 0 = none
+
+    static const PowerLogic::CurrentModel &model() {
+        static const PowerLogic::CurrentModel m = {
+            {POWER_MODEL_CPU_ACTIVE_MA, POWER_MODEL_CPU_IDLE_MA},
+            {POWER_MODEL_WIFI_NONE_MA, POWER_MODEL_WIFI_MIN_MODEM_MA, POWER_MODEL_WIFI_MAX_MODEM_MA}};
+        return m;
+    }
+
+    static bool IRAM_ATTR readPinLevel(int pin) {
+        if (pin < 32) return (GPIO.in >> pin) & 1;
+        return (GPIO.in1.val >> (pin - 32)) & 1;
+    }
+
+    static void IRAM_ATTR armLevel(int pin) {
+        GPIO.pin[pin].int_type = PowerLogic::wakeOnHighLevel(readPinLevel(pin)) ? GPIO_INTR_HIGH_LEVEL
+                                                                                  : GPIO_INTR_LOW_LEVEL;
+    }
+
+    static void IRAM_ATTR onSensorPinChange(void *arg) {
+        armLevel((int)(intptr_t)arg);
+        if (pendingWakeAtUs == 0) pendingWakeAtUs = micros() | 1;
+        BaseType_t woken = pdFALSE;
+        if (loopTask != NULL) vTaskNotifyGiveFromISR(loopTask, &woken);
+        if (woken == pdTRUE) portYIELD_FROM_ISR();
+    }
+
+    static void watchSensorPin(int pin) {
+        bool high = digitalRead(pin) == HIGH;
+        attachInterruptArg(digitalPinToInterrupt(pin), onSensorPinChange, (void *)(intptr_t)pin,
+                           PowerLogic::wakeOnHighLevel(high) ? ONHIGH : ONLOW);
+        gpio_wakeup_enable((gpio_num_t)pin,
+                           PowerLogic::wakeOnHighLevel(high) ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL);
+    }
+
+    static void setLocks(bool held) {
+        if (!pmConfigured) return;
+        if (held) {
+            esp_pm_lock_acquire(cpuLock);
+            esp_pm_lock_acquire(sleepLock);
+        } else {
+            esp_pm_lock_release(sleepLock);
+            esp_pm_lock_release(cpuLock);
+        }
+    }
+
+    static wifi_ps_type_t psTypeFor(PowerLogic::WifiSave save) {
+        switch (save) {
+            case PowerLogic::WIFI_SAVE_MAX: return WIFI_PS_MAX_MODEM;
+            case PowerLogic::WIFI_SAVE_MIN: return WIFI_PS_MIN_MODEM;
+            default: return WIFI_PS_NONE;
+        }
+    }
+
+public:
+    // Call from setup() on the loop task, after the sensor pins are configured.
+    static void init() {
+        unsigned long now = millis();
+        stats = PowerLogic::makeStats(now);
+        lastBusyAt = now;
+        lastTrafficAt = now;
+        loopTask = xTaskGetCurrentTaskHandle();
+        if (!POWER_MANAGEMENT_ENABLED) return;
+
+#if CONFIG_PM_ENABLE && CONFIG_IDF_TARGET_ESP32S3
+        esp_pm_config_esp32s3_t pm = {};
+        pm.max_freq_mhz = POWER_CPU_MAX_MHZ;
+        pm.min_freq_mhz = POWER_CPU_MIN_MHZ;
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+        pm.light_sleep_enable = POWER_LIGHT_SLEEP;
+#endif
+        if (esp_pm_configure(&pm) == ESP_OK &&
+            esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "ctl_active", &cpuLock) == ESP_OK &&
+            esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "ctl_nosleep", &sleepLock) == ESP_OK) {
+            pmConfigured = true;
+            setLocks(true);  // Boot starts ACTIVE
+        }
+#endif
+        watchSensorPin(MASTER_OVERFLOW_SENSOR_PIN);
+        watchSensorPin(WATER_LEVEL_SENSOR_PIN);
+        esp_sleep_enable_gpio_wakeup();
+
+        String how = pmConfigured ? "DFS " + String(POWER_CPU_MIN_MHZ) + "-" + String(POWER_CPU_MAX_MHZ) + "MHz"
+                                  : String("esp_pm unavailable, loop pacing only");
+        if (lightSleepEnabled()) how += ", light sleep";
+        DebugHelper::debug("✓ Power management: " + how + ", idle after " +
+                           String(POWER_IDLE_ENTER_MS / 1000) + "s");
+    }
+
+    // Control loop, once per pass before the watering logic. Records the
+    // pin-change -> reaction latency and switches ACTIVE/IDLE.
+    static void update(bool busy) {
+        if (pendingWakeAtUs != 0) {
+            uint32_t latencyUs = (micros() | 1) - pendingWakeAtUs;
+            pendingWakeAtUs = 0;
+            PowerLogic::recordWake(stats, latencyUs);
+        }
+
+        unsigned long now = millis();
+        if (busy) lastBusyAt = now;
+        PowerLogic::Mode next = POWER_MANAGEMENT_ENABLED
+                                    ? PowerLogic::nextMode(busy, now, lastBusyAt, POWER_IDLE_ENTER_MS)
+                                    : PowerLogic::MODE_ACTIVE;
+        if (next == mode) return;
+
+        mode = next;
+        PowerLogic::setMode(stats, mode, now);
+        setLocks(mode == PowerLogic::MODE_ACTIVE);
+        BLOG_INFO("Power mode -> %s", PowerLogic::modeName(mode));
+    }
+
+    // Replaces the loop's fixed delay: sleeps one period for the current mode,
+    // or less if a sensor pin changes.
+    static void waitForNextCycle() {
+        unsigned long periodMs = PowerLogic::loopPeriodMs(mode, POWER_ACTIVE_LOOP_PERIOD_MS,
+                                                          POWER_IDLE_LOOP_PERIOD_MS);
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(periodMs));
+    }
+
+    // Network task, once per pass: `traffic` = a web client was served.
+    static void loopNetwork(bool traffic) {
+        unsigned long now = millis();
+        if (traffic) lastTrafficAt = now;
+        if (!POWER_MANAGEMENT_ENABLED) return;
+        PowerLogic::WifiSave want = PowerLogic::wifiSaveFor(now, lastTrafficAt, WIFI_PS_TRAFFIC_HOLD_MS,
+                                                            WIFI_PS_DEEP_AFTER_MS);
+        // Compare with the driver rather than our last call: the Arduino WiFi
+        // layer re-applies its own setting whenever the station restarts.
+        wifi_ps_type_t current;
+        if (esp_wifi_get_ps(&current) != ESP_OK) return;  // WiFi not started
+        if (current != psTypeFor(want) && esp_wifi_set_ps(psTypeFor(want)) != ESP_OK) return;
+        if (want != stats.wifi) PowerLogic::setWifi(stats, want, now);
+    }
+
+    static unsigned long networkPollMs() {
+        return mode == PowerLogic::MODE_IDLE ? POWER_IDLE_NET_POLL_MS : POWER_ACTIVE_NET_POLL_MS;
+    }
+
+    // ========== Reporting ==========
+    static PowerLogic::Mode getMode() { return mode; }
+    static PowerLogic::WifiSave getWifiSave() { return stats.wifi; }
+    static bool lightSleepEnabled() {
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+        return pmConfigured && POWER_LIGHT_SLEEP;
+#else
+        return false;
+#endif
+    }
+
+    // Snapshot with the current stretch accounted up to now
+    static PowerLogic::Stats getStats() {
+        PowerLogic::Stats s = stats;
+        PowerLogic::account(s, millis());
+        return s;
+    }
+
+    static float currentMa() { return PowerLogic::currentMa(model(), mode, stats.wifi); }
+
+    static float averageCurrentMa() { return PowerLogic::averageCurrentMa(getStats(), model()); }
+};
+
+// ============================================
+// Static Member Initialization
+// ============================================
+PowerLogic::Stats PowerManager::stats = PowerLogic::makeStats(0);
+PowerLogic::Mode PowerManager::mode = PowerLogic::MODE_ACTIVE;
+unsigned long PowerManager::lastBusyAt = 0;
+unsigned long PowerManager::lastTrafficAt = 0;
+bool PowerManager::pmConfigured = false;
+esp_pm_lock_handle_t PowerManager::cpuLock = NULL;
+esp_pm_lock_handle_t PowerManager::sleepLock = NULL;
+TaskHandle_t PowerManager::loopTask = NULL;
+volatile uint32_t PowerManager::pendingWakeAtUs = 0;
+
+#endif // POWER_MANAGER_H
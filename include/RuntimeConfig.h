@@ -0,0 +1,241 @@
+#ifndef RUNTIME_CONFIG_H
+#define RUNTIME_CONFIG_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <WebServer.h>
+#include "config.h"
+#include "RuntimeConfigLogic.h"
+#include "DebugHelper.h"
+#include "LoopDeadlineMonitor.h"
+#include <secret.h>
+
+extern WebServer httpServer;
+
+// ============================================
+// RuntimeConfig - NVS-backed tunables with hot reload
+// Header-only static class (same pattern as DebugHelper)
+//
+//   GET  /api/config                          all fields: value, default, min, max
+//   POST /api/config?name=...&value=...       set one field (persisted)
+//   POST /api/config?reset=<name>|all         back to the compiled default
+//
+// A change is validated as a whole (same invariants as the config.h
+// static_asserts), written into a free one of three immutable snapshots and
+// published by storing the `current` pointer, so get() and the per-valve
+// timeout accessors are a single acquire load on the hot path. The replaced
+// snapshot is only rewritten after the control loop has closed a pass
+// (LoopDeadlineMonitor cycle count) since it was replaced: a control pass
+// never holds a snapshot beyond the pass it loaded it in. Readers on the
+// network task are the writer's own task and never overlap a publish. If
+// three changes land within one control pass, the third waits for the pass.
+// ============================================
+class RuntimeConfig {
+private:
+    static RuntimeConfigLogic::Values snapshots[RuntimeConfigLogic::SNAPSHOT_SLOTS];
+    static RuntimeConfigLogic::SnapshotSlots slots;
+    static const RuntimeConfigLogic::Values* current;
+
+    // Single writer (the /api/config handler on the network task). Returns a
+    // slot no control pass can still be reading, or -1 if the control loop
+    // did not close a pass within its hard deadline.
+    static int waitForFreeSlot() {
+        unsigned long start = millis();
+        for (;;) {
+            int slot = RuntimeConfigLogic::freeSlot(
+                slots, LoopDeadlineMonitor::getCompletedCycles(DEADLINE_TASK_CONTROL));
+            if (slot >= 0) return slot;
+            if (millis() - start >= CONTROL_LOOP_HARD_DEADLINE_MS) return -1;
+            LoopDeadlineMonitor::heartbeat(DEADLINE_TASK_NETWORK);
+            delay(1);
+        }
+    }
+
+    static void publish(int slot, const RuntimeConfigLogic::Values& values) {
+        snapshots[slot] = values;
+        __atomic_store_n(&current, &snapshots[slot], __ATOMIC_RELEASE);
+        RuntimeConfigLogic::retire(
+            slots, slot, LoopDeadlineMonitor::getCompletedCycles(DEADLINE_TASK_CONTROL));
+    }
+
+    static bool isAuthorized() {
+        if (!httpServer.authenticate(OTA_USER, OTA_PASSWORD)) {
+            httpServer.requestAuthentication();
+            return false;
+        }
+        return true;
+    }
+
+    static void sendError(int code, const char* message) {
+        httpServer.send(code, "application/json",
+                        String("{\"success\":false,\"message\":\"") + message + "\"}");
+    }
+
+public:
+    // Loads stored overrides on top of the defaults. A stored set that no
+    // longer validates (e.g. after a firmware change tightened a range) is
+    // ignored as a whole rather than partially applied.
+    static void init() {
+        RuntimeConfigLogic::Values values = RuntimeConfigLogic::defaults();
+        int overrides = 0;
+        Preferences prefs;
+        if (prefs.begin(RUNTIME_CONFIG_NVS_NAMESPACE, true)) {
+            char key[16];
+            for (int i = 0; i < RuntimeConfigLogic::FIELD_COUNT; i++) {
+                const RuntimeConfigLogic::Field& f = RuntimeConfigLogic::FIELDS[i];
+                for (int k = 0; k < f.count; k++) {
+                    RuntimeConfigLogic::nvsKey(f, k, key, sizeof(key));
+                    if (!prefs.isKey(key)) continue;
+                    *RuntimeConfigLogic::slot(values, f, k) = prefs.getUInt(key);
+                    overrides++;
+                }
+            }
+            prefs.end();
+        }
+
+        char why[128];
+        if (!RuntimeConfigLogic::validate(values, why, sizeof(why))) {
+            DebugHelper::debugImportant("⚠️ Runtime config rejected (" + String(why) +
+                                        ") - using compiled defaults");
+            values = RuntimeConfigLogic::defaults();
+            overrides = 0;
+        }
+        // Before the control loop and network task run: nothing reads yet
+        RuntimeConfigLogic::resetSlots(slots);
+        snapshots[0] = values;
+        __atomic_store_n(&current, &snapshots[0], __ATOMIC_RELEASE);
+        DebugHelper::debug("✓ Runtime config: " + String(overrides) + " override(s)");
+    }
+
+    // Valid until the end of the caller's control pass (or network task pass)
+    static inline const RuntimeConfigLogic::Values& get() {
+        return *__atomic_load_n(&current, __ATOMIC_ACQUIRE);
+    }
+
+    static inline unsigned long normalTimeout(int valveIndex) {
+        if (valveIndex < 0 || valveIndex >= NUM_VALVES) return MAX_WATERING_TIME;
+        return get().normalTimeoutMs[valveIndex];
+    }
+
+    static inline unsigned long emergencyTimeout(int valveIndex) {
+        if (valveIndex < 0 || valveIndex >= NUM_VALVES) return ABSOLUTE_SAFETY_TIMEOUT;
+        return get().emergencyTimeoutMs[valveIndex];
+    }
+
+    // Validates the whole candidate, persists the one key, then publishes.
+    static bool set(const char* name, const char* value, char* why, size_t whySize) {
+        RuntimeConfigLogic::Values candidate = get();
+        if (!RuntimeConfigLogic::setField(candidate, name, value, why, whySize) ||
+            !RuntimeConfigLogic::validate(candidate, why, whySize)) {
+            return false;
+        }
+        int index = 0;
+        const RuntimeConfigLogic::Field& f =
+            RuntimeConfigLogic::FIELDS[RuntimeConfigLogic::findField(name, index)];
+        char key[16];
+        RuntimeConfigLogic::nvsKey(f, index, key, sizeof(key));
+        int slot = waitForFreeSlot();
+        if (slot < 0) {
+            snprintf(why, whySize, "control loop busy - try again");
+            return false;
+        }
+        Preferences prefs;
+        if (!prefs.begin(RUNTIME_CONFIG_NVS_NAMESPACE, false) ||
+            prefs.putUInt(key, RuntimeConfigLogic::get(candidate, f, index)) == 0) {
+            prefs.end();
+            snprintf(why, whySize, "NVS write failed");
+            return false;
+        }
+        prefs.end();
+        publish(slot, candidate);
+        DebugHelper::debugImportant("⚙️ Config: " + String(name) + " = " + String(value));
+        return true;
+    }
+
+    // "all" or one field name; restores the compiled default.
+    static bool reset(const char* name, char* why, size_t whySize) {
+        RuntimeConfigLogic::Values candidate = get();
+        RuntimeConfigLogic::Values defaults = RuntimeConfigLogic::defaults();
+        int slot = waitForFreeSlot();
+        if (slot < 0) {
+            snprintf(why, whySize, "control loop busy - try again");
+            return false;
+        }
+        Preferences prefs;
+        if (!prefs.begin(RUNTIME_CONFIG_NVS_NAMESPACE, false)) {
+            snprintf(why, whySize, "NVS unavailable");
+            return false;
+        }
+        if (strcmp(name, "all") == 0) {
+            prefs.clear();
+            prefs.end();
+            publish(slot, defaults);
+            DebugHelper::debugImportant("⚙️ Config: all fields reset to defaults");
+            return true;
+        }
+
+        int index = 0;
+        int fieldIndex = RuntimeConfigLogic::findField(name, index);
+        if (fieldIndex < 0) {
+            prefs.end();
+            snprintf(why, whySize, "unknown field '%s'", name);
+            return false;
+        }
+        const RuntimeConfigLogic::Field& f = RuntimeConfigLogic::FIELDS[fieldIndex];
+        *RuntimeConfigLogic::slot(candidate, f, index) = RuntimeConfigLogic::get(defaults, f, index);
+        if (!RuntimeConfigLogic::validate(candidate, why, whySize)) {
+            prefs.end();
+            return false;
+        }
+        char key[16];
+        RuntimeConfigLogic::nvsKey(f, index, key, sizeof(key));
+        prefs.remove(key);
+        prefs.end();
+        publish(slot, candidate);
+        DebugHelper::debugImportant("⚙️ Config: " + String(name) + " reset to default");
+        return true;
+    }
+
+    static void handleConfig() {
+        if (!isAuthorized()) return;
+        bool change = httpServer.hasArg("reset") || httpServer.hasArg("name");
+        if (change && httpServer.method() != HTTP_POST) {
+            sendError(405, "use POST to change config");
+            return;
+        }
+        char why[160];
+        if (httpServer.hasArg("reset")) {
+            if (!reset(httpServer.arg("reset").c_str(), why, sizeof(why))) {
+                sendError(400, why);
+                return;
+            }
+        } else if (httpServer.hasArg("name")) {
+            if (!set(httpServer.arg("name").c_str(), httpServer.arg("value").c_str(), why, sizeof(why))) {
+                sendError(400, why);
+                return;
+            }
+        }
+
+        static char json[3072];
+        if (RuntimeConfigLogic::formatJson(get(), json, sizeof(json)) == 0) {
+            sendError(500, "config JSON too large");
+            return;
+        }
+        httpServer.send(200, "application/json",
+                        String("{\"success\":true,\"config\":") + json + "}");
+    }
+
+    static void registerHandlers() {
+        httpServer.on("/api/config", HTTP_ANY, handleConfig);
+    }
+};
+
+// ============================================
+// Static Member Initialization
+// ============================================
+RuntimeConfigLogic::Values RuntimeConfig::snapshots[RuntimeConfigLogic::SNAPSHOT_SLOTS] = {
+    RuntimeConfigLogic::defaults(), RuntimeConfigLogic::defaults(), RuntimeConfigLogic::defaults()};
+RuntimeConfigLogic::SnapshotSlots RuntimeConfig::slots = {};
+const RuntimeConfigLogic::Values* RuntimeConfig::current = &RuntimeConfig::snapshots[0];
+
+#endif // RUNTIME_CONFIG_H
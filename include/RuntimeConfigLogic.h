@@ -0,0 +1,281 @@
+#ifndef RUNTIME_CONFIG_LOGIC_H
+#define RUNTIME_CONFIG_LOGIC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef NATIVE_TEST
+#include "TestConfig.h"
+#else
+#include "config.h"
+#endif
+
+// Typed schema for the tunables that can change without a rebuild, shared by
+// RuntimeConfig.h (NVS + /api/config) and the native tests. Hardware-free.
+//
+// Every field is a uint32 with a compile-time default (the config.h
+// constant), a range, and an NVS key. Per-valve fields are arrays addressed
+// as "name.N" with the 1-based valve number, e.g. "normal_timeout_ms.3".
+// validate() re-checks the cross-field invariants that config.h enforces
+// with static_assert, so a runtime value can never be less safe than a
+// compiled one.
+namespace RuntimeConfigLogic {
+
+const uint32_t MIN_EMERGENCY_MARGIN_MS = 5000;  // Same margin as VALIDATE_TIMEOUT
+const uint32_t MIN_MOISTURE_SPAN_RAW = 100;     // Dry/wet points closer than this are noise
+
+struct Values {
+  uint32_t normalTimeoutMs[NUM_VALVES];
+  uint32_t emergencyTimeoutMs[NUM_VALVES];
+  uint32_t interValveGapMs;
+  uint32_t rainCheckIntervalMs;
+  uint32_t valveStabilizationMs;
+  uint32_t rainDebounceThreshold;
+  uint32_t rainConfirmations;
+  uint32_t overflowDebounceThreshold;
+  uint32_t overflowConfirmations;
+  uint32_t metricsPushActiveMs;
+  uint32_t metricsPushIdleMs;
+  uint32_t moistureSetpointPct[NUM_VALVES];
+  uint32_t moistureDryRaw[NUM_VALVES];
+  uint32_t moistureWetRaw[NUM_VALVES];
+};
+
+struct Field {
+  const char *name;     // API name
+  const char *nvsKey;   // <= 14 chars incl. valve digit (NVS limit is 15)
+  size_t offset;        // Into Values
+  uint8_t count;        // 1, or NUM_VALVES for per-valve arrays
+  uint32_t minValue;
+  uint32_t maxValue;
+};
+
+const Field FIELDS[] = {
+  {"normal_timeout_ms", "nto", offsetof(Values, normalTimeoutMs), NUM_VALVES, 10000, 120000},
+  {"emergency_timeout_ms", "eto", offsetof(Values, emergencyTimeoutMs), NUM_VALVES, 15000, 180000},
+  {"inter_valve_gap_ms", "gap", offsetof(Values, interValveGapMs), 1, 0, 600000},
+  {"rain_check_interval_ms", "rain_iv", offsetof(Values, rainCheckIntervalMs), 1, 50, 2000},
+  {"valve_stabilization_ms", "stab", offsetof(Values, valveStabilizationMs), 1, 100, 10000},
+  {"rain_debounce_threshold", "rain_thr", offsetof(Values, rainDebounceThreshold), 1, 1,
+   RAIN_SENSOR_DEBOUNCE_SAMPLES},
+  {"rain_confirmations", "rain_conf", offsetof(Values, rainConfirmations), 1, 1, 10},
+  {"overflow_debounce_threshold", "ovf_thr", offsetof(Values, overflowDebounceThreshold), 1, 1,
+   OVERFLOW_DEBOUNCE_SAMPLES},
+  {"overflow_confirmations", "ovf_conf", offsetof(Values, overflowConfirmations), 1, 1, 10},
+  {"metrics_push_active_ms", "m_active", offsetof(Values, metricsPushActiveMs), 1, 1000, 600000},
+  {"metrics_push_idle_ms", "m_idle", offsetof(Values, metricsPushIdleMs), 1, 1000, 3600000},
+  {"moisture_setpoint_pct", "mst_set", offsetof(Values, moistureSetpointPct), NUM_VALVES, 0, 100},
+  {"moisture_dry_raw", "mst_dry", offsetof(Values, moistureDryRaw), NUM_VALVES, 0, 4095},
+  {"moisture_wet_raw", "mst_wet", offsetof(Values, moistureWetRaw), NUM_VALVES, 0, 4095},
+};
+const int FIELD_COUNT = sizeof(FIELDS) / sizeof(FIELDS[0]);
+
+inline Values defaults() {
+  Values v;
+  for (int i = 0; i < NUM_VALVES; i++) {
+    v.normalTimeoutMs[i] = getValveNormalTimeout(i);
+    v.emergencyTimeoutMs[i] = getValveEmergencyTimeout(i);
+    v.moistureSetpointPct[i] = MOISTURE_DEFAULT_SETPOINT_PCT;
+    v.moistureDryRaw[i] = MOISTURE_DEFAULT_DRY_RAW;
+    v.moistureWetRaw[i] = MOISTURE_DEFAULT_WET_RAW;
+  }
+  v.interValveGapMs = INTER_VALVE_GAP_MS;
+  v.rainCheckIntervalMs = RAIN_CHECK_INTERVAL;
+  v.valveStabilizationMs = VALVE_STABILIZATION_DELAY;
+  v.rainDebounceThreshold = RAIN_SENSOR_DEBOUNCE_THRESHOLD;
+  v.rainConfirmations = RAIN_SENSOR_CONFIRMATION_CHECKS;
+  v.overflowDebounceThreshold = OVERFLOW_DEBOUNCE_THRESHOLD;
+  v.overflowConfirmations = OVERFLOW_CONFIRMATION_CHECKS;
+  v.metricsPushActiveMs = METRICS_PUSH_INTERVAL_ACTIVE_MS;
+  v.metricsPushIdleMs = METRICS_PUSH_INTERVAL_IDLE_MS;
+  return v;
+}
+
+// Snapshot slots behind RuntimeConfig's published pointer. The slot a publish
+// replaces is retired at the control loop's completed-pass count; a control
+// pass holds at most the snapshot it started with, so the slot may be
+// rewritten once that count has moved on.
+const int SNAPSHOT_SLOTS = 3;
+
+struct SnapshotSlots {
+  int current;
+  bool retired[SNAPSHOT_SLOTS];
+  uint32_t retiredAt[SNAPSHOT_SLOTS];
+};
+
+inline void resetSlots(SnapshotSlots &s) {
+  s.current = 0;
+  for (int i = 0; i < SNAPSHOT_SLOTS; i++) {
+    s.retired[i] = false;
+    s.retiredAt[i] = 0;
+  }
+}
+
+// A slot the next publish may overwrite, or -1 while every other slot can
+// still be in use by the control pass that was running when it was retired.
+inline int freeSlot(const SnapshotSlots &s, uint32_t completedCycles) {
+  for (int i = 0; i < SNAPSHOT_SLOTS; i++) {
+    if (i == s.current) continue;
+    if (!s.retired[i] || s.retiredAt[i] != completedCycles) return i;
+  }
+  return -1;
+}
+
+// `next` has been published; `completedCycles` must be read after the store.
+inline void retire(SnapshotSlots &s, int next, uint32_t completedCycles) {
+  s.retired[s.current] = true;
+  s.retiredAt[s.current] = completedCycles;
+  s.retired[next] = false;
+  s.current = next;
+}
+
+inline uint32_t *slot(Values &v, const Field &f, int index) {
+  return reinterpret_cast<uint32_t *>(reinterpret_cast<uint8_t *>(&v) + f.offset) + index;
+}
+
+inline uint32_t get(const Values &v, const Field &f, int index) {
+  return *slot(const_cast<Values &>(v), f, index);
+}
+
+// "normal_timeout_ms.3" -> field + 0-based index. Returns the field index or -1.
+inline int findField(const char *name, int &index) {
+  const char *dot = strchr(name, '.');
+  size_t len = dot ? (size_t)(dot - name) : strlen(name);
+  for (int i = 0; i < FIELD_COUNT; i++) {
+    const Field &f = FIELDS[i];
+    if (strlen(f.name) != len || strncmp(f.name, name, len) != 0) continue;
+    if (f.count == 1) {
+      if (dot) return -1;
+      index = 0;
+      return i;
+    }
+    if (!dot || dot[1] < '1' || dot[1] > '9') return -1;
+    char *end;
+    long valve = strtol(dot + 1, &end, 10);
+    if (*end != '\0' || valve > f.count) return -1;
+    index = (int)valve - 1;
+    return i;
+  }
+  return -1;
+}
+
+inline void nvsKey(const Field &f, int index, char *out, size_t outSize) {
+  if (f.count == 1) {
+    snprintf(out, outSize, "%s", f.nvsKey);
+  } else {
+    snprintf(out, outSize, "%s%d", f.nvsKey, index);
+  }
+}
+
+// Ranges plus the cross-field invariants. Returns true or fills `why`.
+inline bool validate(const Values &v, char *why, size_t whySize) {
+  for (int i = 0; i < FIELD_COUNT; i++) {
+    const Field &f = FIELDS[i];
+    for (int k = 0; k < f.count; k++) {
+      uint32_t value = get(v, f, k);
+      if (value < f.minValue || value > f.maxValue) {
+        if (f.count == 1) {
+          snprintf(why, whySize, "%s=%lu outside [%lu, %lu]", f.name, (unsigned long)value,
+                   (unsigned long)f.minValue, (unsigned long)f.maxValue);
+        } else {
+          snprintf(why, whySize, "%s.%d=%lu outside [%lu, %lu]", f.name, k + 1,
+                   (unsigned long)value, (unsigned long)f.minValue, (unsigned long)f.maxValue);
+        }
+        return false;
+      }
+    }
+  }
+  for (int i = 0; i < NUM_VALVES; i++) {
+    if (v.emergencyTimeoutMs[i] < v.normalTimeoutMs[i] + MIN_EMERGENCY_MARGIN_MS) {
+      snprintf(why, whySize,
+               "emergency_timeout_ms.%d must be at least %lums above normal_timeout_ms.%d", i + 1,
+               (unsigned long)MIN_EMERGENCY_MARGIN_MS, i + 1);
+      return false;
+    }
+    uint32_t span = v.moistureDryRaw[i] > v.moistureWetRaw[i]
+                        ? v.moistureDryRaw[i] - v.moistureWetRaw[i]
+                        : v.moistureWetRaw[i] - v.moistureDryRaw[i];
+    if (span < MIN_MOISTURE_SPAN_RAW) {
+      snprintf(why, whySize, "moisture_dry_raw.%d and moisture_wet_raw.%d must differ by at least %lu",
+               i + 1, i + 1, (unsigned long)MIN_MOISTURE_SPAN_RAW);
+      return false;
+    }
+  }
+  if (v.rainCheckIntervalMs < RAIN_SENSOR_DEBOUNCE_SAMPLES * RAIN_SENSOR_DEBOUNCE_DELAY_MS) {
+    snprintf(why, whySize, "rain_check_interval_ms shorter than one debounced read");
+    return false;
+  }
+  if (v.metricsPushIdleMs < v.metricsPushActiveMs) {
+    snprintf(why, whySize, "metrics_push_idle_ms must not be shorter than metrics_push_active_ms");
+    return false;
+  }
+  return true;
+}
+
+// Parses and range-checks one assignment into `v` (no cross-field check:
+// the caller validates the whole candidate).
+inline bool setField(Values &v, const char *name, const char *valueText, char *why,
+                     size_t whySize) {
+  int index = 0;
+  int fieldIndex = findField(name, index);
+  if (fieldIndex < 0) {
+    snprintf(why, whySize, "unknown field '%s'", name);
+    return false;
+  }
+  char *end;
+  unsigned long value = strtoul(valueText, &end, 10);
+  if (end == valueText || *end != '\0' || valueText[0] == '-') {
+    snprintf(why, whySize, "'%s' is not a non-negative integer", valueText);
+    return false;
+  }
+  const Field &f = FIELDS[fieldIndex];
+  if (value < f.minValue || value > f.maxValue) {
+    snprintf(why, whySize, "%s must be in [%lu, %lu]", name, (unsigned long)f.minValue,
+             (unsigned long)f.maxValue);
+    return false;
+  }
+  *slot(v, f, index) = (uint32_t)value;
+  return true;
+}
+
+// {"name":{"value":..,"default":..,"min":..,"max":..},...}; arrays as lists.
+inline size_t formatJson(const Values &v, char *out, size_t outSize) {
+  Values d = defaults();
+  size_t len = 0;
+  int n = snprintf(out, outSize, "{");
+  if (n < 0) return 0;
+  len = (size_t)n;
+  for (int i = 0; i < FIELD_COUNT && len < outSize; i++) {
+    const Field &f = FIELDS[i];
+    n = snprintf(out + len, outSize - len, "%s\"%s\":{\"min\":%lu,\"max\":%lu,", i ? "," : "",
+                 f.name, (unsigned long)f.minValue, (unsigned long)f.maxValue);
+    if (n < 0) return 0;
+    len += (size_t)n;
+    const Values *sources[2] = {&v, &d};
+    const char *labels[2] = {"value", "default"};
+    for (int s = 0; s < 2 && len < outSize; s++) {
+      n = snprintf(out + len, outSize - len, "%s\"%s\":%s", s ? "," : "", labels[s],
+                   f.count > 1 ? "[" : "");
+      if (n < 0) return 0;
+      len += (size_t)n;
+      for (int k = 0; k < f.count && len < outSize; k++) {
+        n = snprintf(out + len, outSize - len, "%s%lu", k ? "," : "",
+                     (unsigned long)get(*sources[s], f, k));
+        if (n < 0) return 0;
+        len += (size_t)n;
+      }
+      if (f.count > 1 && len < outSize) len += snprintf(out + len, outSize - len, "]");
+    }
+    if (len < outSize) len += snprintf(out + len, outSize - len, "}");
+  }
+  if (len < outSize) len += snprintf(out + len, outSize - len, "}");
+  if (len >= outSize) return 0;
+  return len;
+}
+
+} // namespace RuntimeConfigLogic
+
+#endif // RUNTIME_CONFIG_LOGIC_H
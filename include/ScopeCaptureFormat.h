@@ -0,0 +1,163 @@
+#ifndef SCOPE_CAPTURE_FORMAT_H
+#define SCOPE_CAPTURE_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Binary WebSocket frames of the hardware-test firmware's logic-analyzer
+// capture (test-main.cpp 'G' command), shared with the native tests and the
+// decoder in data/web/test/dashboard.html. Hardware-free; little-endian.
+//
+// The sampler reads every sensor pin at 1-6 kHz but only keeps an edge when
+// the pin bitmask changes, so a quiet bus costs nothing and a 200 us EMI
+// spike from the pump relay still shows up as two edges. Each frame covers
+// [startUs, endUs) and is self-contained:
+//
+//   header  SCOPE_HEADER_SIZE bytes (see ScopeFrameHeader)
+//   edges   edgeCount x (deltaUs varint, mask u16)
+//
+// deltaUs is relative to the previous edge (the first one to startUs), so a
+// typical edge is 3-4 bytes. startMask is the pin state at startUs.
+namespace ScopeCaptureFormat {
+
+const uint8_t SCOPE_MAGIC[4] = {'W', 'S', 'C', '1'};
+const size_t SCOPE_HEADER_SIZE = 28;
+const size_t SCOPE_MAX_EDGE_SIZE = 5 + 2;  // 32-bit varint + mask
+
+// Channel bits in the mask (order shown top to bottom in the dashboard)
+enum ScopeChannel {
+  SCOPE_CH_RAIN1 = 0,   // ..SCOPE_CH_RAIN1 + 5 for sensors 1-6
+  SCOPE_CH_WATER_LEVEL = 6,
+  SCOPE_CH_OVERFLOW = 7,
+  SCOPE_CH_PUMP = 8,          // Output latch, not the pad
+  SCOPE_CH_SENSOR_POWER = 9,  // GPIO 18 output latch
+  SCOPE_CHANNEL_COUNT = 10
+};
+
+struct ScopeEdge {
+  uint32_t tsUs;
+  uint16_t mask;
+};
+
+struct ScopeFrameHeader {
+  uint16_t intervalUs;    // Sample period
+  uint8_t channelCount;
+  uint32_t startUs;
+  uint32_t endUs;
+  uint32_t samples;       // Samples taken in [startUs, endUs)
+  uint16_t droppedEdges;  // Edges lost because the ring was full
+  uint16_t startMask;
+  uint16_t edgeCount;
+};
+
+inline void putU16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+inline void putU32(uint8_t *p, uint32_t v) {
+  for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+inline uint16_t getU16(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+inline uint32_t getU32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+// LEB128; returns bytes written.
+inline size_t putVarint(uint8_t *p, uint32_t v) {
+  size_t n = 0;
+  while (v >= 0x80) {
+    p[n++] = (uint8_t)(v | 0x80);
+    v >>= 7;
+  }
+  p[n++] = (uint8_t)v;
+  return n;
+}
+
+// Returns bytes read, or 0 if truncated/overlong.
+inline size_t getVarint(const uint8_t *p, size_t len, uint32_t &v) {
+  v = 0;
+  for (size_t i = 0; i < len && i < 5; i++) {
+    v |= (uint32_t)(p[i] & 0x7F) << (7 * i);
+    if ((p[i] & 0x80) == 0) return i + 1;
+  }
+  return 0;
+}
+
+inline void writeHeader(const ScopeFrameHeader &h, uint8_t *out) {
+  memcpy(out, SCOPE_MAGIC, 4);
+  putU16(out + 4, h.intervalUs);
+  out[6] = h.channelCount;
+  out[7] = 0;
+  putU32(out + 8, h.startUs);
+  putU32(out + 12, h.endUs);
+  putU32(out + 16, h.samples);
+  putU16(out + 20, h.droppedEdges);
+  putU16(out + 22, h.startMask);
+  putU16(out + 24, h.edgeCount);
+  putU16(out + 26, 0);
+}
+
+// Encodes as many edges as fit in outSize. header.edgeCount is set to the
+// number written; the caller keeps the rest for the next frame (and should
+// then end this frame at the first unsent edge's timestamp). Returns the
+// frame length.
+inline size_t encodeFrame(ScopeFrameHeader &header, const ScopeEdge *edges,
+                          size_t edgeCount, uint8_t *out, size_t outSize) {
+  if (outSize < SCOPE_HEADER_SIZE) return 0;
+  size_t len = SCOPE_HEADER_SIZE;
+  uint32_t prev = header.startUs;
+  uint16_t written = 0;
+  while (written < edgeCount && written < 0xFFFF &&
+         len + SCOPE_MAX_EDGE_SIZE <= outSize) {
+    const ScopeEdge &e = edges[written];
+    len += putVarint(out + len, e.tsUs - prev);
+    putU16(out + len, e.mask);
+    len += 2;
+    prev = e.tsUs;
+    written++;
+  }
+  header.edgeCount = written;
+  writeHeader(header, out);
+  return len;
+}
+
+// Returns the number of edges decoded into `edges`, or -1 on a malformed
+// frame.
+inline int decodeFrame(const uint8_t *frame, size_t len, ScopeFrameHeader &header,
+                       ScopeEdge *edges, int maxEdges) {
+  if (len < SCOPE_HEADER_SIZE || memcmp(frame, SCOPE_MAGIC, 4) != 0) return -1;
+  header.intervalUs = getU16(frame + 4);
+  header.channelCount = frame[6];
+  header.startUs = getU32(frame + 8);
+  header.endUs = getU32(frame + 12);
+  header.samples = getU32(frame + 16);
+  header.droppedEdges = getU16(frame + 20);
+  header.startMask = getU16(frame + 22);
+  header.edgeCount = getU16(frame + 24);
+  if (header.edgeCount > maxEdges) return -1;
+
+  size_t pos = SCOPE_HEADER_SIZE;
+  uint32_t ts = header.startUs;
+  for (int i = 0; i < header.edgeCount; i++) {
+    uint32_t delta;
+    size_t n = getVarint(frame + pos, len - pos, delta);
+    if (n == 0 || pos + n + 2 > len) return -1;
+    pos += n;
+    ts += delta;
+    edges[i].tsUs = ts;
+    edges[i].mask = getU16(frame + pos);
+    pos += 2;
+  }
+  return pos == len ? header.edgeCount : -1;
+}
+
+} // namespace ScopeCaptureFormat
+
+#endif // SCOPE_CAPTURE_FORMAT_H
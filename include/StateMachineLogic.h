@@ -161,6 +161,37 @@ inline ProcessResult processValveLogic(
   return result;
 }
 
+// Global safety watchdog for one valve, independent of processValveLogic so
+// it still catches a state machine that stopped advancing. A valve that has
+// been in PHASE_WATERING for at least `emergencyTimeout` is marked closed and
+// timed out and handed to PHASE_CLOSING_VALVE for the normal cleanup.
+// Returns true when it tripped; the caller drives the valve and pump outputs.
+inline bool watchdogTrip(ValveController &valve, unsigned long currentTime,
+                         unsigned long emergencyTimeout) {
+  if (valve.phase != PHASE_WATERING || valve.wateringStartTime == 0) {
+    return false;
+  }
+  if (currentTime - valve.wateringStartTime < emergencyTimeout) {
+    return false;
+  }
+  valve.state = VALVE_CLOSED;
+  valve.timeoutOccurred = true;
+  valve.phase = PHASE_CLOSING_VALVE;
+  return true;
+}
+
+// Whether a valve other than `except` is still watering, i.e. the pump has
+// to stay on after `except` was stopped.
+inline bool otherValveWatering(ValveController *const *valves, int count,
+                               int except) {
+  for (int i = 0; i < count; i++) {
+    if (i != except && valves[i]->phase == PHASE_WATERING) {
+      return true;
+    }
+  }
+  return false;
+}
+
 } // namespace StateMachineLogic
 
 #endif // STATE_MACHINE_LOGIC_H
@@ -8,7 +8,10 @@
 #include "config.h"
 #include "secret.h"
 #include "DebugHelper.h"
+#include "BinaryLog.h"
+#include "TraceRecorder.h"
 #include "DS3231RTC.h"
+#include "DnsCache.h"
 
 // ============================================ 
 // Telegram Notifier Class
@@ -98,7 +101,7 @@ private:
         }
     }
 
-    static bool beginHttpClient(HTTPClient& http, const String& url, WiFiClientSecure& secureClient, WiFiClient& plainClient) {
+    static bool beginHttpClient(HTTPClient& http, const String& url, DnsCachedSecureClient& secureClient, DnsCachedClient& plainClient) {
         if (url.startsWith("https://")) {
             secureClient.setInsecure();  // For simplicity - use proper cert verification in production
             return http.begin(secureClient, url);
@@ -173,9 +176,10 @@ private:
             return false;
         }
 
+        TRACE_SCOPE(TraceEventFormat::TRACE_CAT_TELEGRAM, "telegram_send");
         HTTPClient http;
-        WiFiClientSecure client;
-        WiFiClient plainClient;
+        DnsCachedSecureClient client;
+        DnsCachedClient plainClient;
         bool usingProxy = useMonitoringProxy();
 
         int httpCode = -1;
@@ -220,11 +224,11 @@ private:
         if (success) {
             onTelegramSuccess();
             logTransportLocalOnly("✓ Telegram message sent");
-            if (g_metricsLog) g_metricsLog("debug", "Telegram sent OK");
+            BLOG_DEBUG("Telegram sent OK");
         } else {
             onTelegramFailure();
             logTransportLocalOnly("❌ Telegram send failed (" + String(usingProxy ? "proxy" : "direct") + "), HTTP code: " + String(httpCode));
-            if (g_metricsLog) g_metricsLog("warn", "Telegram failed HTTP " + String(httpCode));
+            BLOG_WARN("Telegram failed HTTP %d", httpCode);
             g_telegramFailures++;
             if (httpCode > 0) {
                 logTransportLocalOnly("Response: " + http.getString());
@@ -282,9 +286,10 @@ public:
             return false;
         }
 
+        TRACE_SCOPE(TraceEventFormat::TRACE_CAT_TELEGRAM, "telegram_notify");
         HTTPClient http;
-        WiFiClientSecure client;
-        WiFiClient plainClient;
+        DnsCachedSecureClient client;
+        DnsCachedClient plainClient;
         bool usingProxy = useMonitoringProxy();
 
         int httpCode = -1;
@@ -338,7 +343,7 @@ public:
     static String getHelpMessage() {
         String message = "📘 <b>AVAILABLE COMMANDS</b>\n\n";
         message += "<b>Watering</b>\n";
-        message += "/water N - Water tray N (1-6)\n";
+        message += "/water N - Water tray N (1-" + String(NUM_VALVES) + ")\n";
         message += "/start_all - Water all trays sequentially\n";
         message += "/halt - Block watering (OTA/web stay active)\n";
         message += "/resume - Exit halt mode\n\n";
@@ -347,7 +352,8 @@ public:
         message += "/settime - Sync from NTP\n";
         message += "/test_sensors - Test all rain sensors\n";
         message += "/overflow_status - Overflow sensor readings\n";
-        message += "/water_level_status - Water tank sensor readings\n\n";
+        message += "/water_level_status - Water tank sensor readings\n";
+        message += "/log_level - Show/set log levels per subsystem\n\n";
         message += "<b>Safety</b>\n";
         message += "/reset_overflow - Clear overflow lock\n";
         message += "/reinit_gpio - Reinitialize relay GPIOs\n\n";
@@ -361,8 +367,13 @@ public:
 
     static String getMainMenuKeyboard() {
         String kb = "{\"inline_keyboard\":[";
-        kb += "[{\"text\":\"💧 1\",\"callback_data\":\"water_1\"},{\"text\":\"💧 2\",\"callback_data\":\"water_2\"},{\"text\":\"💧 3\",\"callback_data\":\"water_3\"}],";
-        kb += "[{\"text\":\"💧 4\",\"callback_data\":\"water_4\"},{\"text\":\"💧 5\",\"callback_data\":\"water_5\"},{\"text\":\"💧 6\",\"callback_data\":\"water_6\"}],";
+        // One button per tray, three to a row
+        for (int i = 0; i < NUM_VALVES; i++) {
+            String n = String(i + 1);
+            kb += (i % 3 == 0) ? "[" : ",";
+            kb += "{\"text\":\"💧 " + n + "\",\"callback_data\":\"water_" + n + "\"}";
+            if (i % 3 == 2 || i == NUM_VALVES - 1) kb += "],";
+        }
         kb += "[{\"text\":\"🚿 Water All\",\"callback_data\":\"start_all\"}],";
         kb += "[{\"text\":\"⏸ Halt\",\"callback_data\":\"halt\"},{\"text\":\"▶️ Resume\",\"callback_data\":\"resume\"}],";
         kb += "[{\"text\":\"🕐 Time\",\"callback_data\":\"time\"},{\"text\":\"🔍 Sensors\",\"callback_data\":\"test_sensors\"}],";
@@ -377,8 +388,8 @@ public:
         if (cbId.isEmpty() || !WiFi.isConnected()) return;
 
         HTTPClient http;
-        WiFiClientSecure client;
-        WiFiClient plainClient;
+        DnsCachedSecureClient client;
+        DnsCachedClient plainClient;
         bool usingProxy = useMonitoringProxy();
 
         if (usingProxy) {
@@ -419,8 +430,8 @@ public:
         lastBotCommandsAttemptMs() = now;
 
         HTTPClient http;
-        WiFiClientSecure client;
-        WiFiClient plainClient;
+        DnsCachedSecureClient client;
+        DnsCachedClient plainClient;
         bool usingProxy = useMonitoringProxy();
 
         int httpCode = -1;
@@ -528,6 +539,15 @@ public:
         return message;
     }
 
+    static String formatNoFlowAlert(int trayNumber, float litres) {
+        String message = "🚱 <b>No Flow Alert</b>\n";
+        message += "⏰ " + getCurrentDateTime() + "\n";
+        message += "🌱 Tray " + String(trayNumber) + ": pump stopped, flow meter saw " +
+                   String(litres, 2) + " L.\n";
+        message += "Possible causes: dry pump, blocked pipe, closed supply.";
+        return message;
+    }
+
     // Format watering schedule notification (no network call)
     // scheduleData[i][0] = tray number, [1] = planned time, [2] = duration, [3] = cycle (hours)
     static String formatWateringSchedule(const String scheduleData[][4], int numTrays, const String& title) {
@@ -583,8 +603,8 @@ public:
         }
 
         HTTPClient http;
-        WiFiClientSecure client;
-        WiFiClient plainClient;
+        DnsCachedSecureClient client;
+        DnsCachedClient plainClient;
         bool usingProxy = useMonitoringProxy();
 
         String allowedUpdates = "[\"message\",\"callback_query\"]";
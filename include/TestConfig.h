@@ -45,6 +45,14 @@ inline unsigned long getValveEmergencyTimeout(int valveIndex) {
 }
 
 static const unsigned long SENSOR_POWER_STABILIZATION = 100;
+static const unsigned long INTER_VALVE_GAP_MS = 30000;
+static const unsigned long METRICS_PUSH_INTERVAL_ACTIVE_MS = 10000;
+static const unsigned long METRICS_PUSH_INTERVAL_IDLE_MS = 60000;
+
+// Master overflow sensor debouncing (mirror production config.h)
+static const int OVERFLOW_DEBOUNCE_SAMPLES = 7;
+static const int OVERFLOW_DEBOUNCE_THRESHOLD = 5;
+static const int OVERFLOW_CONFIRMATION_CHECKS = 3;
 
 // Rain/soil sensor debouncing (mirror production config.h)
 static const int RAIN_SENSOR_DEBOUNCE_SAMPLES = 7;
@@ -72,7 +80,42 @@ static const int PLANT_LIGHT_SCHEDULE_ON_HOUR = 22;
 static const int PLANT_LIGHT_SCHEDULE_ON_MINUTE = 0;
 static const int PLANT_LIGHT_SCHEDULE_OFF_HOUR = 7;
 static const int PLANT_LIGHT_SCHEDULE_OFF_MINUTE = 0;
+static const float PLANT_LIGHT_LATITUDE = 55.75f;
+static const float PLANT_LIGHT_LONGITUDE = 37.62f;
 static const unsigned long PLANT_LIGHT_SCHEDULE_CHECK_INTERVAL_MS = 1000;
+
+// ============================================
+// Analog Moisture Constants for Testing
+// ============================================
+static const int MOISTURE_OVERSAMPLE = 16;
+static const int MOISTURE_IIR_SHIFT = 3;
+static const unsigned long MOISTURE_STALE_MS = 2000;
+static const float MOISTURE_LEVEL_CORRECTION_WEIGHT = 0.8f;
+static const unsigned long MOISTURE_DEFAULT_SETPOINT_PCT = 0;
+static const unsigned long MOISTURE_DEFAULT_DRY_RAW = 3000;
+static const unsigned long MOISTURE_DEFAULT_WET_RAW = 1300;
+
+// ============================================
+// Flow Meter Constants for Testing
+// ============================================
+static const float FLOW_METER_PULSES_PER_LITRE = 450.0f;
+static const unsigned long FLOW_RATE_WINDOW_MS = 1000;
+static const unsigned long FLOW_PRIME_GRACE_MS = 1500;
+static const unsigned long FLOW_NO_FLOW_TIMEOUT_MS = 1000;
+
+// ============================================
+// Power Management Constants for Testing
+// ============================================
+static const unsigned long POWER_IDLE_ENTER_MS = 30000;
+static const unsigned long POWER_ACTIVE_LOOP_PERIOD_MS = 10;
+static const unsigned long POWER_IDLE_LOOP_PERIOD_MS = 250;
+static const unsigned long WIFI_PS_TRAFFIC_HOLD_MS = 5000;
+static const unsigned long WIFI_PS_DEEP_AFTER_MS = 60000;
+static const float POWER_MODEL_CPU_ACTIVE_MA = 45.0f;
+static const float POWER_MODEL_CPU_IDLE_MA = 12.0f;
+static const float POWER_MODEL_WIFI_NONE_MA = 80.0f;
+static const float POWER_MODEL_WIFI_MIN_MODEM_MA = 22.0f;
+static const float POWER_MODEL_WIFI_MAX_MODEM_MA = 9.0f;
 #endif
 
 #endif // TEST_CONFIG_H
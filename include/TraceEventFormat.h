@@ -0,0 +1,129 @@
+#ifndef TRACE_EVENT_FORMAT_H
+#define TRACE_EVENT_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Chrome trace-event JSON for GET /trace/download, shared by the firmware
+// (TraceRecorder.h) and the native tests. Hardware-free.
+//
+// The download is a JSON array that Perfetto (ui.perfetto.dev) and
+// chrome://tracing open directly. pid is always 1 and tid is the core, so
+// each core gets its own track:
+//   X  complete span   sensor polls, HTTP requests, Telegram sends, flash writes
+//   b/e async span     valve phases; id = valve index, one track per valve
+//   C  counter         pump on/off
+//   i  instant         one-off markers
+// Event names must be string literals (the ring stores the pointer) and
+// must not need JSON escaping.
+namespace TraceEventFormat {
+
+enum TraceCategory {
+  TRACE_CAT_VALVE = 0,
+  TRACE_CAT_PUMP,
+  TRACE_CAT_SENSOR,
+  TRACE_CAT_HTTP,
+  TRACE_CAT_TELEGRAM,
+  TRACE_CAT_FLASH,
+  TRACE_CAT_COUNT
+};
+
+const char PH_COMPLETE = 'X';
+const char PH_ASYNC_BEGIN = 'b';
+const char PH_ASYNC_END = 'e';
+const char PH_COUNTER = 'C';
+const char PH_INSTANT = 'i';
+
+const int32_t NO_ARG = INT32_MIN;
+
+struct TraceEvent {
+  uint64_t tsUs;      // esp_timer_get_time() at the start of the event
+  const char *name;
+  uint32_t durUs;     // X only
+  int32_t value;      // X/i: "arg" (NO_ARG to omit); b/e: id; C: counter value
+  char phase;
+  uint8_t category;
+  uint8_t core;
+};
+
+inline const char *categoryName(int category) {
+  switch (category) {
+  case TRACE_CAT_VALVE: return "valve";
+  case TRACE_CAT_PUMP: return "pump";
+  case TRACE_CAT_SENSOR: return "sensor";
+  case TRACE_CAT_HTTP: return "http";
+  case TRACE_CAT_TELEGRAM: return "telegram";
+  case TRACE_CAT_FLASH: return "flash";
+  default: return "other";
+  }
+}
+
+// Microseconds as a JSON integer. Split into seconds + micros so we never
+// depend on printf's 64-bit support (newlib-nano drops %llu).
+inline int formatMicros(uint64_t us, char *out, size_t outSize) {
+  unsigned long seconds = (unsigned long)(us / 1000000ULL);
+  unsigned long micros = (unsigned long)(us % 1000000ULL);
+  if (seconds == 0) return snprintf(out, outSize, "%lu", micros);
+  return snprintf(out, outSize, "%lu%06lu", seconds, micros);
+}
+
+// One event as a JSON object (no separator). Returns the length, or 0 if
+// it did not fit.
+inline size_t formatEvent(const TraceEvent &e, char *out, size_t outSize) {
+  char ts[24];
+  formatMicros(e.tsUs, ts, sizeof(ts));
+  int n = snprintf(out, outSize,
+                   "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%s,\"pid\":1,\"tid\":%u",
+                   e.name, categoryName(e.category), e.phase, ts, (unsigned)e.core);
+  if (n < 0 || (size_t)n >= outSize) return 0;
+  size_t len = (size_t)n;
+
+  switch (e.phase) {
+  case PH_COMPLETE:
+    n = snprintf(out + len, outSize - len, ",\"dur\":%lu", (unsigned long)e.durUs);
+    break;
+  case PH_ASYNC_BEGIN:
+  case PH_ASYNC_END:
+    n = snprintf(out + len, outSize - len, ",\"id\":%ld", (long)e.value);
+    break;
+  case PH_INSTANT:
+    n = snprintf(out + len, outSize - len, ",\"s\":\"t\"");
+    break;
+  default:
+    n = 0;
+    break;
+  }
+  if (n < 0 || (size_t)(len + n) >= outSize) return 0;
+  len += n;
+
+  if (e.phase == PH_COUNTER) {
+    n = snprintf(out + len, outSize - len, ",\"args\":{\"value\":%ld}}", (long)e.value);
+  } else if ((e.phase == PH_COMPLETE || e.phase == PH_INSTANT) && e.value != NO_ARG) {
+    n = snprintf(out + len, outSize - len, ",\"args\":{\"arg\":%ld}}", (long)e.value);
+  } else {
+    n = snprintf(out + len, outSize - len, "}");
+  }
+  if (n < 0 || (size_t)(len + n) >= outSize) return 0;
+  return len + n;
+}
+
+// Metadata event naming a core's track.
+inline size_t formatThreadName(int core, const char *name, char *out, size_t outSize) {
+  int n = snprintf(out, outSize,
+                   "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                   "\"args\":{\"name\":\"%s\"}}",
+                   core, name);
+  if (n < 0 || (size_t)n >= outSize) return 0;
+  return (size_t)n;
+}
+
+// Ring bookkeeping: writeIndex counts every event ever recorded, so the
+// live window is [first, writeIndex) and older slots have been overwritten.
+inline uint32_t oldestIndex(uint32_t writeIndex, uint32_t capacity) {
+  return writeIndex > capacity ? writeIndex - capacity : 0;
+}
+
+} // namespace TraceEventFormat
+
+#endif // TRACE_EVENT_FORMAT_H
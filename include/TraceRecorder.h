@@ -0,0 +1,222 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <Arduino.h>
+#include <WebServer.h>
+#include <esp_timer.h>
+#include "config.h"
+#include "TraceEventFormat.h"
+#include "DebugHelper.h"
+#include "LoopDeadlineMonitor.h"
+#include <secret.h>
+
+extern WebServer httpServer;
+
+// ============================================
+// TraceRecorder - always-on event ring, exported as Chrome trace JSON
+// Header-only static class (same pattern as DebugHelper)
+//
+//   GET  /trace/status
+//   GET  /trace/download      trace.json for ui.perfetto.dev / chrome://tracing
+//   POST /trace/clear
+//
+// Both cores record into one PSRAM ring of TRACE_RING_EVENTS fixed-size
+// events (timestamp from esp_timer, name pointer, core). Recording is a
+// spinlocked slot copy with no allocation, so it stays on in production;
+// the oldest events are overwritten. Recording pauses while a download is
+// streamed so the snapshot is consistent.
+// ============================================
+class TraceRecorder {
+private:
+    static TraceEventFormat::TraceEvent* events;
+    static uint32_t writeIndex;
+    static volatile bool paused;
+    static uint32_t droppedWhilePaused;
+    static portMUX_TYPE ringLock;
+
+    static void record(char phase, uint8_t category, const char* name,
+                       uint64_t tsUs, uint32_t durUs, int32_t value) {
+        if (events == nullptr) return;
+        portENTER_CRITICAL(&ringLock);
+        if (paused) {
+            droppedWhilePaused++;
+        } else {
+            TraceEventFormat::TraceEvent& e = events[writeIndex % TRACE_RING_EVENTS];
+            e.tsUs = tsUs;
+            e.name = name;
+            e.durUs = durUs;
+            e.value = value;
+            e.phase = phase;
+            e.category = category;
+            e.core = (uint8_t)xPortGetCoreID();
+            writeIndex++;
+        }
+        portEXIT_CRITICAL(&ringLock);
+    }
+
+    static bool isAuthorized() {
+        if (!httpServer.authenticate(OTA_USER, OTA_PASSWORD)) {
+            httpServer.requestAuthentication();
+            return false;
+        }
+        return true;
+    }
+
+public:
+    static void init() {
+        if (events != nullptr) return;
+        events = (TraceEventFormat::TraceEvent*)ps_malloc(
+            TRACE_RING_EVENTS * sizeof(TraceEventFormat::TraceEvent));
+        if (events == nullptr) {
+            DebugHelper::debugImportant("⚠️ Trace: cannot allocate event ring - tracing disabled");
+            return;
+        }
+        DebugHelper::debug("✓ Trace ring: " + String(TRACE_RING_EVENTS) + " events");
+    }
+
+    static inline uint64_t nowUs() { return (uint64_t)esp_timer_get_time(); }
+
+    // Span that started at startUs and ends now.
+    static void complete(uint8_t category, const char* name, uint64_t startUs,
+                         int32_t arg = TraceEventFormat::NO_ARG) {
+        uint64_t now = nowUs();
+        record(TraceEventFormat::PH_COMPLETE, category, name, startUs,
+               (uint32_t)(now - startUs), arg);
+    }
+
+    // Long-running state that crosses loop iterations (valve phases).
+    static void asyncBegin(uint8_t category, const char* name, int32_t id) {
+        record(TraceEventFormat::PH_ASYNC_BEGIN, category, name, nowUs(), 0, id);
+    }
+
+    static void asyncEnd(uint8_t category, const char* name, int32_t id) {
+        record(TraceEventFormat::PH_ASYNC_END, category, name, nowUs(), 0, id);
+    }
+
+    static void counter(uint8_t category, const char* name, int32_t value) {
+        record(TraceEventFormat::PH_COUNTER, category, name, nowUs(), 0, value);
+    }
+
+    static void instant(uint8_t category, const char* name,
+                        int32_t arg = TraceEventFormat::NO_ARG) {
+        record(TraceEventFormat::PH_INSTANT, category, name, nowUs(), 0, arg);
+    }
+
+    static uint32_t recordedEvents() {
+        return writeIndex < TRACE_RING_EVENTS ? writeIndex : TRACE_RING_EVENTS;
+    }
+
+    static String statusJson() {
+        String json = "{\"enabled\":" + String(events != nullptr ? "true" : "false");
+        json += ",\"events\":" + String(recordedEvents());
+        json += ",\"capacity\":" + String(TRACE_RING_EVENTS);
+        json += ",\"total\":" + String(writeIndex);
+        json += ",\"overwritten\":" + String(writeIndex - recordedEvents());
+        json += ",\"dropped_while_downloading\":" + String(droppedWhilePaused);
+        json += "}";
+        return json;
+    }
+
+    static void handleStatus() {
+        if (!isAuthorized()) return;
+        httpServer.send(200, "application/json", statusJson());
+    }
+
+    static void handleClear() {
+        if (!isAuthorized()) return;
+        portENTER_CRITICAL(&ringLock);
+        writeIndex = 0;
+        droppedWhilePaused = 0;
+        portEXIT_CRITICAL(&ringLock);
+        httpServer.send(200, "application/json", statusJson());
+    }
+
+    static void handleDownload() {
+        if (!isAuthorized()) return;
+        if (events == nullptr) {
+            httpServer.send(503, "text/plain", "tracing disabled (no PSRAM)");
+            return;
+        }
+
+        portENTER_CRITICAL(&ringLock);
+        paused = true;
+        uint32_t end = writeIndex;
+        portEXIT_CRITICAL(&ringLock);
+        uint32_t first = TraceEventFormat::oldestIndex(end, TRACE_RING_EVENTS);
+
+        httpServer.setContentLength(CONTENT_LENGTH_UNKNOWN);
+        httpServer.sendHeader("Content-Disposition", "attachment; filename=\"trace.json\"");
+        httpServer.send(200, "application/json", "");
+
+        char line[256];
+        String chunk;
+        chunk.reserve(2048);
+        chunk = "[";
+        TraceEventFormat::formatThreadName(0, "core0 (network)", line, sizeof(line));
+        chunk += line;
+        chunk += ",";
+        TraceEventFormat::formatThreadName(1, "core1 (control)", line, sizeof(line));
+        chunk += line;
+
+        for (uint32_t i = first; i < end; i++) {
+            size_t len = TraceEventFormat::formatEvent(events[i % TRACE_RING_EVENTS], line, sizeof(line));
+            if (len == 0) continue;
+            chunk += ",\n";
+            chunk += line;
+            if (chunk.length() >= 1800) {
+                httpServer.sendContent(chunk);
+                chunk = "";
+                LoopDeadlineMonitor::heartbeat(DEADLINE_TASK_NETWORK);
+            }
+        }
+        chunk += "]\n";
+        httpServer.sendContent(chunk);
+        httpServer.sendContent("");
+
+        paused = false;
+    }
+
+    static void registerHandlers() {
+        httpServer.on("/trace/status", HTTP_GET, handleStatus);
+        httpServer.on("/trace/download", HTTP_GET, handleDownload);
+        httpServer.on("/trace/clear", HTTP_POST, handleClear);
+    }
+};
+
+// Records an X span for the enclosing scope. Spans shorter than minUs are
+// discarded, which keeps idle polls (an empty handleClient()) out of the ring.
+class TraceScope {
+public:
+    TraceScope(uint8_t category, const char* name,
+               int32_t arg = TraceEventFormat::NO_ARG, uint32_t minUs = 0)
+        : category(category), name(name), arg(arg), minUs(minUs),
+          startUs(TraceRecorder::nowUs()) {}
+
+    ~TraceScope() {
+        if (minUs > 0 && TraceRecorder::nowUs() - startUs < minUs) return;
+        TraceRecorder::complete(category, name, startUs, arg);
+    }
+
+private:
+    uint8_t category;
+    const char* name;
+    int32_t arg;
+    uint32_t minUs;
+    uint64_t startUs;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+// TRACE_SCOPE(TraceEventFormat::TRACE_CAT_SENSOR, "rain_sensor", valveIndex)
+#define TRACE_SCOPE(...) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(__VA_ARGS__)
+
+// ============================================
+// Static Member Initialization
+// ============================================
+TraceEventFormat::TraceEvent* TraceRecorder::events = nullptr;
+uint32_t TraceRecorder::writeIndex = 0;
+volatile bool TraceRecorder::paused = false;
+uint32_t TraceRecorder::droppedWhilePaused = 0;
+portMUX_TYPE TraceRecorder::ringLock = portMUX_INITIALIZER_UNLOCKED;
+
+#endif // TRACE_RECORDER_H
@@ -7,6 +7,7 @@
 #include "config.h"
 #endif
 #include <Arduino.h>
+#include "MoistureLogic.h"
 
 // ============================================
 // Enums
@@ -87,6 +88,20 @@ struct ValveController {
                                            // Used when lastWateringCompleteTime == 0 after long outage
   unsigned long realTimeSinceLastWateringAttempt; // Same recovery path for attempt timestamps
 
+  // Filtered analog moisture reading (0-100%), refreshed by processValve from
+  // MoistureSensors. -1 when the tray has no probe or the reading is stale.
+  float moisturePercent;
+
+  // Flow meter results of the last pump run (0 without a meter). A run that
+  // saw no pulses after the priming grace ends with noFlowDetected set.
+  float lastCycleLitres;
+  float lastFlowRateLpm;
+  bool noFlowDetected;
+
+  // The last wet confirmation came from the moisture setpoint while the rain
+  // sensor was still dry: the cycle ended early, not with a full tray.
+  bool moistureStopped;
+
   // Constructor
   ValveController(int idx)
       : valveIndex(idx), state(VALVE_CLOSED), phase(PHASE_IDLE),
@@ -98,7 +113,9 @@ struct ValveController {
         isCalibrated(false), totalWateringCycles(0), consecutiveTimeouts(0),
         autoWateringEnabled(true), intervalMultiplier(1.0),
         lastCycleWasTimeoutRecovery(false), rainWetStreak(0),
-        realTimeSinceLastWatering(0), realTimeSinceLastWateringAttempt(0) {}
+        realTimeSinceLastWatering(0), realTimeSinceLastWateringAttempt(0),
+        moisturePercent(-1.0f), lastCycleLitres(0.0f), lastFlowRateLpm(0.0f),
+        noFlowDetected(false), moistureStopped(false) {}
 };
 
 // ============================================
@@ -163,13 +180,16 @@ inline unsigned long getTimeSinceLastWateringAttempt(
   return 0;
 }
 
-// Calculate current water level percentage based on time elapsed
-inline float calculateCurrentWaterLevel(const ValveController *valve,
-                                        unsigned long currentTime) {
+// Water level extrapolated from the learned consumption time. `known` is false
+// for trays without calibration data (the 0% is then "unknown", not "empty").
+inline float estimateWaterLevelFromTime(const ValveController *valve,
+                                        unsigned long currentTime, bool &known) {
+  known = false;
   if (!valve->isCalibrated || valve->emptyToFullDuration == 0 ||
       !hasLastWateringReference(valve)) {
     return 0.0; // Unknown
   }
+  known = true;
 
   unsigned long timeSinceLastWatering =
       getTimeSinceLastWatering(valve, currentTime);
@@ -185,6 +205,19 @@ inline float calculateCurrentWaterLevel(const ValveController *valve,
   return (waterLevel < 0.0f) ? 0.0f : waterLevel;
 }
 
+// Calculate current water level percentage: time-based estimate, corrected
+// by the tray's analog moisture reading when one is fresh.
+inline float calculateCurrentWaterLevel(const ValveController *valve,
+                                        unsigned long currentTime) {
+  bool known;
+  float estimate = estimateWaterLevelFromTime(valve, currentTime, known);
+  if (valve->moisturePercent < 0.0f) {
+    return estimate;
+  }
+  return MoistureLogic::correctWaterLevel(estimate, known, valve->moisturePercent,
+                                          MOISTURE_LEVEL_CORRECTION_WEIGHT);
+}
+
 // Get tray state: "empty", "full", "between"
 inline const char *getTrayState(float waterLevelPercent) {
   if (waterLevelPercent < 10.0)
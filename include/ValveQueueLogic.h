@@ -2,6 +2,7 @@
 #define VALVE_QUEUE_LOGIC_H
 
 #include <Arduino.h>
+#include <utility>
 
 namespace ValveQueueLogic {
 
@@ -29,11 +30,13 @@ inline bool enqueue(QueueEntry* queue, int& length, int capacity,
 }
 
 // Returns true if head was popped into out; false if queue empty.
+// Entries are moved, not copied, so popping never allocates String buffers
+// on the control loop.
 inline bool dequeue(QueueEntry* queue, int& length, QueueEntry& out) {
   if (length == 0) return false;
-  out = queue[0];
+  out = std::move(queue[0]);
   for (int i = 1; i < length; i++) {
-    queue[i - 1] = queue[i];
+    queue[i - 1] = std::move(queue[i]);
   }
   length--;
   return true;
@@ -44,7 +47,7 @@ inline bool remove(QueueEntry* queue, int& length, int valveIndex) {
   for (int i = 0; i < length; i++) {
     if (queue[i].valveIndex == valveIndex) {
       for (int j = i + 1; j < length; j++) {
-        queue[j - 1] = queue[j];
+        queue[j - 1] = std::move(queue[j]);
       }
       length--;
       return true;
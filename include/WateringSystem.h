@@ -10,6 +10,14 @@
 #include "DS3231RTC.h"
 #include "LearningAlgorithm.h"
 #include "SensorDebounce.h"
+#include "StateMachineLogic.h"
+#include "LoopDeadlineMonitor.h"
+#include "BinaryLog.h"
+#include "TraceRecorder.h"
+#include "RuntimeConfig.h"
+#include "ZoneIO.h"
+#include "MoistureSensors.h"
+#include "FlowMeter.h"
 #include <Adafruit_NeoPixel.h>
 #include <Arduino.h>
 #include <ArduinoJson.h>
@@ -31,7 +39,7 @@ const char *LEARNING_DATA_FILE_OLD =
 // Session Tracking Struct (for Telegram notifications)
 // ============================================
 struct WateringSessionData {
-  int trayNumber;          // 1-6 (display format)
+  int trayNumber;          // 1-NUM_VALVES (display format)
   unsigned long startTime; // millis() when valve opened
   unsigned long endTime;   // millis() when completed
   float duration;          // duration in seconds
@@ -55,6 +63,10 @@ private:
   unsigned long lastStatePublish;
   String lastStateJson;
 
+  // Last phase/pump state written to the trace ring (see traceStateChanges)
+  WateringPhase tracedPhase[NUM_VALVES];
+  PumpState tracedPumpState;
+
   // Universal single-valve queue (replaces sequentialMode-only machinery).
   // At most one valve may be non-IDLE at a time; others wait here.
   ValveQueueLogic::QueueEntry valveQueue[NUM_VALVES];
@@ -98,7 +110,7 @@ public:
   // ========== Constructor ==========
   WateringSystem()
       : pumpState(PUMP_OFF), activeValveCount(0), lastStatePublish(0),
-        lastStateJson(""), valveQueueLength(0), currentlyActiveValve(-1),
+        lastStateJson(""), tracedPumpState(PUMP_OFF), valveQueueLength(0), currentlyActiveValve(-1),
         nextValveReadyTime(0), batchSessionActive(false), telegramSessionActive(false), sessionTriggerType(""),
         autoWateringValveIndex(-1), haltMode(false), overflowDetected(false),
         lastOverflowCheck(0), lastOverflowResetTime(0), overflowDetectionStreak(0),
@@ -109,6 +121,7 @@ public:
         notificationQueue(nullptr) {
     for (int i = 0; i < NUM_VALVES; i++) {
       valves[i] = new ValveController(i);
+      tracedPhase[i] = PHASE_IDLE;
     }
   }
 
@@ -147,6 +160,8 @@ public:
   // Persistence
   bool saveLearningData();
   bool loadLearningData();
+  bool loadPlantLightSchedule();
+  bool savePlantLightSchedule();
 
   // State management
   void publishCurrentState();
@@ -182,6 +197,9 @@ public:
   void setHaltMode(bool enabled);
   bool isHaltMode() { return haltMode; }
 
+  // Power management: anything that needs the 100Hz control loop
+  bool needsFastLoop();
+
   // Master overflow sensor control
   bool isOverflowDetected() { return overflowDetected; }
   void resetOverflowFlag(); // Reset overflow flag after fixing issue
@@ -197,6 +215,13 @@ public:
   bool setPlantLightManualOff();
   bool setPlantLightAuto();
   String getPlantLightStatusMessage();
+  bool setPlantLightSchedule(const String &windows, float latitude,
+                             float longitude);
+  String getPlantLightScheduleText();
+  String getPlantLightScheduleJson();
+  LightScheduleLogic::Schedule getPlantLightSchedule() {
+    return plantLight.getSchedule();
+  }
 
   // Metrics accessors (for MetricsPusher)
   PumpState getPumpState() { return pumpState; }
@@ -230,9 +255,11 @@ private:
 
   // ========== Hardware Control ==========
   bool readRainSensor(int valveIndex);
+  bool moistureSetpointReached(int valveIndex) const;
   void openValve(int valveIndex);
   void closeValve(int valveIndex);
   void updatePumpState();
+  void traceStateChanges();
 
   // ========== Time-Based Learning Algorithm ==========
   void processLearningData(ValveController *valve, unsigned long currentTime);
@@ -267,20 +294,25 @@ inline void WateringSystem::init() {
   statusLED.clear();
   statusLED.show();  // Initialize to OFF
 
+  // I/O expanders first: valve and rain sensor lines may live on them
+  ZoneIO::init();
+  MoistureSensors::init();
+  FlowMeter::init();
+
   // Initialize valve pins
   String valvePinsInfo = "Valve GPIOs: ";
   for (int i = 0; i < NUM_VALVES; i++) {
-    valvePinsInfo += String(i) + "→" + String(VALVE_PINS[i]);
+    valvePinsInfo += String(i) + "→" + ZoneIO::describe(VALVE_PINS[i]);
     if (i < NUM_VALVES - 1)
       valvePinsInfo += ", ";
-    pinMode(VALVE_PINS[i], OUTPUT);
-    digitalWrite(VALVE_PINS[i], LOW);
+    ZoneIO::setMode(VALVE_PINS[i], OUTPUT);
+    ZoneIO::write(VALVE_PINS[i], LOW);
   }
   DebugHelper::debug(valvePinsInfo);
 
   // Initialize rain sensor pins with internal pull-up
   for (int i = 0; i < NUM_VALVES; i++) {
-    pinMode(RAIN_SENSOR_PINS[i], INPUT_PULLUP);
+    ZoneIO::setMode(RAIN_SENSOR_PINS[i], INPUT_PULLUP);
   }
 
   // Initialize master overflow sensor pin
@@ -292,11 +324,12 @@ inline void WateringSystem::init() {
   DebugHelper::debug("Water level sensor: GPIO " + String(WATER_LEVEL_SENSOR_PIN));
 
   plantLight.init();
+  loadPlantLightSchedule();
   time_t now;
   time(&now);
   plantLight.syncAutoStateSilently(now);
   DebugHelper::debug("Plant light relay: GPIO " + String(PLANT_LIGHT_RELAY_PIN) +
-                     " (auto 22:00-07:00)");
+                     " (auto " + getPlantLightScheduleText() + ")");
 
   DebugHelper::debug("✓ WateringSystem initialized");
   publishStateChange("system", "initialized");
@@ -323,10 +356,11 @@ inline void WateringSystem::reinitializeGPIOHardware() {
   pinMode(RAIN_SENSOR_POWER_PIN, OUTPUT);
   digitalWrite(RAIN_SENSOR_POWER_PIN, LOW);
 
-  // Reinitialize all valve pins
+  // Reinitialize all valve pins (expander registers are rewritten as a whole)
+  ZoneIO::reinit();
   for (int i = 0; i < NUM_VALVES; i++) {
-    pinMode(VALVE_PINS[i], OUTPUT);
-    digitalWrite(VALVE_PINS[i], LOW);
+    ZoneIO::setMode(VALVE_PINS[i], OUTPUT);
+    ZoneIO::write(VALVE_PINS[i], LOW);
   }
 
   // Reinitialize plant light relay without changing logical mode/state.
@@ -343,6 +377,7 @@ inline void WateringSystem::reinitializeGPIOHardware() {
 
 // ========== Persistence Functions ==========
 inline bool WateringSystem::saveLearningData() {
+  TRACE_SCOPE(TraceEventFormat::TRACE_CAT_FLASH, "save_learning_data");
   DebugHelper::debug("💾 Saving learning data to flash...");
 
   // Create JSON document
@@ -582,33 +617,65 @@ inline void WateringSystem::processWateringLoop() {
   unsigned long currentTime = millis();
 
   // 🚨 MASTER OVERFLOW SENSOR - HIGHEST PRIORITY CHECK
+  LoopDeadlineMonitor::enterStage(DEADLINE_TASK_CONTROL, STAGE_OVERFLOW_SENSOR);
   checkMasterOverflowSensor(currentTime);
 
   // 🚨 WATER LEVEL SENSOR - CHECK TANK WATER LEVEL
+  LoopDeadlineMonitor::enterStage(DEADLINE_TASK_CONTROL, STAGE_WATER_LEVEL);
   checkWaterLevelSensor(currentTime);
 
   // 🚨 GLOBAL SAFETY WATCHDOG - ALWAYS RUN FIRST
+  LoopDeadlineMonitor::enterStage(DEADLINE_TASK_CONTROL, STAGE_SAFETY_WATCHDOG);
+  ZoneIO::loop(currentTime);  // Re-arm an expander that reset before any valve decision
   globalSafetyWatchdog(currentTime);
 
   // Plant light schedule runs independently of watering safety logic.
+  LoopDeadlineMonitor::enterStage(DEADLINE_TASK_CONTROL, STAGE_PLANT_LIGHT);
   updatePlantLightSchedule(currentTime);
 
   // Check for automatic watering (time-based)
+  LoopDeadlineMonitor::enterStage(DEADLINE_TASK_CONTROL, STAGE_AUTO_WATERING);
   checkAutoWatering(currentTime);
 
   // Drain queue: start next valve if gap elapsed and no valve is active.
+  LoopDeadlineMonitor::enterStage(DEADLINE_TASK_CONTROL, STAGE_QUEUE);
   processQueue(currentTime);
 
   // Process each valve independently
+  LoopDeadlineMonitor::enterStage(DEADLINE_TASK_CONTROL, STAGE_VALVES);
   for (int i = 0; i < NUM_VALVES; i++) {
     processValve(i, currentTime);
   }
 
   // Publish state periodically
   if (currentTime - lastStatePublish >= STATE_PUBLISH_INTERVAL) {
+    LoopDeadlineMonitor::enterStage(DEADLINE_TASK_CONTROL, STAGE_PUBLISH);
     publishCurrentState();
     lastStatePublish = currentTime;
   }
+
+  traceStateChanges();
+}
+
+// Diff phases and pump against the last traced values once per tick, so
+// every path that changes them (state machine, queue, safety stops, API on
+// Core 0) shows up in the trace without instrumenting each assignment.
+inline void WateringSystem::traceStateChanges() {
+  for (int i = 0; i < NUM_VALVES; i++) {
+    WateringPhase phase = valves[i]->phase;
+    if (phase == tracedPhase[i]) continue;
+    if (tracedPhase[i] != PHASE_IDLE) {
+      TraceRecorder::asyncEnd(TraceEventFormat::TRACE_CAT_VALVE, phaseToString(tracedPhase[i]), i);
+    }
+    if (phase != PHASE_IDLE) {
+      TraceRecorder::asyncBegin(TraceEventFormat::TRACE_CAT_VALVE, phaseToString(phase), i);
+    }
+    tracedPhase[i] = phase;
+  }
+  if (pumpState != tracedPumpState) {
+    TraceRecorder::counter(TraceEventFormat::TRACE_CAT_PUMP, "pump", pumpState == PUMP_ON ? 1 : 0);
+    tracedPumpState = pumpState;
+  }
 }
 
 // ========== GLOBAL SAFETY WATCHDOG ==========
@@ -616,44 +683,32 @@ inline void WateringSystem::processWateringLoop() {
 inline void WateringSystem::globalSafetyWatchdog(unsigned long currentTime) {
   for (int i = 0; i < NUM_VALVES; i++) {
     ValveController* valve = valves[i];
+    unsigned long emergencyTimeout = RuntimeConfig::emergencyTimeout(i);
+    unsigned long wateringDuration = currentTime - valve->wateringStartTime;
 
-    // Check if any valve has been watering too long
-    if (valve->phase == PHASE_WATERING && valve->wateringStartTime > 0) {
-      unsigned long wateringDuration = currentTime - valve->wateringStartTime;
-
-      // CRITICAL: If exceeded absolute timeout, FORCE STOP EVERYTHING
-      if (wateringDuration >= getValveEmergencyTimeout(i)) {
-        DebugHelper::debugImportant("🚨🚨🚨 GLOBAL SAFETY WATCHDOG TRIGGERED! 🚨🚨🚨");
-        DebugHelper::debugImportant("Valve " + String(i) + " exceeded " + String(getValveEmergencyTimeout(i) / 1000) + "s!");
-        DebugHelper::debugImportant("Duration: " + String(wateringDuration / 1000) + "s");
-        DebugHelper::debugImportant("FORCING EMERGENCY SHUTDOWN!");
-        if (g_metricsLog) g_metricsLog("error", "Safety watchdog: valve " + String(i) + " exceeded " + String(getValveEmergencyTimeout(i) / 1000) + "s, forcing shutdown");
-
-        // FORCE DIRECT GPIO CONTROL - BYPASS ALL STATE MACHINES
-        digitalWrite(VALVE_PINS[i], LOW);
-        valve->state = VALVE_CLOSED;
-
-        // Force pump off if no other valves active
-        bool anyWatering = false;
-        for (int j = 0; j < NUM_VALVES; j++) {
-          if (j != i && valves[j]->phase == PHASE_WATERING) {
-            anyWatering = true;
-          }
-        }
-        if (!anyWatering) {
-          digitalWrite(PUMP_PIN, LOW);
-          pumpState = PUMP_OFF;
-          statusLED.clear();
-          statusLED.show();
-        }
-
-        // Mark as timeout and move to cleanup
-        valve->timeoutOccurred = true;
-        valve->phase = PHASE_CLOSING_VALVE;
-
-        DebugHelper::debugImportant("Emergency shutdown complete for valve " + String(i));
-      }
+    // CRITICAL: If exceeded absolute timeout, FORCE STOP EVERYTHING
+    // (valve marked closed + timed out, phase -> PHASE_CLOSING_VALVE)
+    if (!StateMachineLogic::watchdogTrip(*valve, currentTime, emergencyTimeout)) {
+      continue;
+    }
+    DebugHelper::debugImportant("🚨🚨🚨 GLOBAL SAFETY WATCHDOG TRIGGERED! 🚨🚨🚨");
+    DebugHelper::debugImportant("Valve " + String(i) + " exceeded " + String(emergencyTimeout / 1000) + "s!");
+    DebugHelper::debugImportant("Duration: " + String(wateringDuration / 1000) + "s");
+    DebugHelper::debugImportant("FORCING EMERGENCY SHUTDOWN!");
+    BLOG_ERROR("Safety watchdog: valve %d exceeded %lus, forcing shutdown", i, emergencyTimeout / 1000);
+
+    // FORCE DIRECT GPIO CONTROL - BYPASS ALL STATE MACHINES
+    ZoneIO::write(VALVE_PINS[i], LOW);
+
+    // Force pump off if no other valves active
+    if (!StateMachineLogic::otherValveWatering(valves, NUM_VALVES, i)) {
+      digitalWrite(PUMP_PIN, LOW);
+      pumpState = PUMP_OFF;
+      statusLED.clear();
+      statusLED.show();
     }
+
+    DebugHelper::debugImportant("Emergency shutdown complete for valve " + String(i));
   }
 }
 
@@ -682,25 +737,25 @@ inline void WateringSystem::checkMasterOverflowSensor(unsigned long currentTime)
     }
   }
 
-  bool debouncedDetected = (lowReadings >= OVERFLOW_DEBOUNCE_THRESHOLD);
+  bool debouncedDetected = (lowReadings >= (int)RuntimeConfig::get().overflowDebounceThreshold);
 
   // Require multiple consecutive debounced detections to avoid latching on a
   // single noisy burst. This makes the line effectively need to stay bad for
   // several 100ms checks rather than one 35ms sampling window.
   if (debouncedDetected) {
-    if (overflowDetectionStreak < OVERFLOW_CONFIRMATION_CHECKS) {
+    int confirmations = (int)RuntimeConfig::get().overflowConfirmations;
+    if (overflowDetectionStreak < confirmations) {
       overflowDetectionStreak++;
     }
 
-    if (!overflowDetected &&
-        overflowDetectionStreak >= OVERFLOW_CONFIRMATION_CHECKS) {
+    if (!overflowDetected && overflowDetectionStreak >= confirmations) {
       // Confirmed sustained detection - trigger emergency stop
       DebugHelper::debugImportant("🚨🚨🚨 MASTER OVERFLOW SENSOR TRIGGERED! 🚨🚨🚨");
       DebugHelper::debugImportant("Water overflow detected on GPIO " + String(MASTER_OVERFLOW_SENSOR_PIN) +
                                   " (" + String(lowReadings) + "/" + String(OVERFLOW_DEBOUNCE_SAMPLES) +
                                   " LOW readings, streak " + String(overflowDetectionStreak) +
-                                  "/" + String(OVERFLOW_CONFIRMATION_CHECKS) + ")");
-      if (g_metricsLog) g_metricsLog("error", "Overflow detected! GPIO " + String(MASTER_OVERFLOW_SENSOR_PIN) + " streak=" + String(overflowDetectionStreak));
+                                  "/" + String(confirmations) + ")");
+      BLOG_ERROR("Overflow detected! GPIO %d streak=%d", MASTER_OVERFLOW_SENSOR_PIN, overflowDetectionStreak);
       overflowDetected = true;
 
       // Emergency stop everything
@@ -749,7 +804,7 @@ inline int WateringSystem::getMasterOverflowLowReadings() {
 inline String WateringSystem::getOverflowStatusMessage() {
   int rawReading = getMasterOverflowRawReading();
   int lowReadings = getMasterOverflowLowReadings();
-  bool debouncedDetected = (lowReadings >= OVERFLOW_DEBOUNCE_THRESHOLD);
+  bool debouncedDetected = (lowReadings >= (int)RuntimeConfig::get().overflowDebounceThreshold);
 
   String message = "🚨 <b>OVERFLOW SENSOR STATUS</b>\n\n";
   message += "⏰ " + TelegramNotifier::getCurrentDateTime() + "\n";
@@ -760,12 +815,12 @@ inline String WateringSystem::getOverflowStatusMessage() {
   message += "🧪 Debounced reading: " + String(lowReadings) + "/" +
              String(OVERFLOW_DEBOUNCE_SAMPLES) + " LOW samples\n";
   message += "📈 Trigger streak: " + String(overflowDetectionStreak) + "/" +
-             String(OVERFLOW_CONFIRMATION_CHECKS) + "\n";
+             String(RuntimeConfig::get().overflowConfirmations) + "\n";
   message += "🚦 Debounced result: " +
              String(debouncedDetected ? "OVERFLOW DETECTED" : "NORMAL") + "\n\n";
-  message += "Threshold: " + String(OVERFLOW_DEBOUNCE_THRESHOLD) + "/" +
+  message += "Threshold: " + String(RuntimeConfig::get().overflowDebounceThreshold) + "/" +
              String(OVERFLOW_DEBOUNCE_SAMPLES) + " LOW samples required\n";
-  message += "Latch rule: " + String(OVERFLOW_CONFIRMATION_CHECKS) +
+  message += "Latch rule: " + String(RuntimeConfig::get().overflowConfirmations) +
              " consecutive debounced detections required";
 
   return message;
@@ -812,10 +867,7 @@ inline void WateringSystem::emergencyStopAll(const String &reason) {
 
   // Queued valves must NOT pop off once overflow clears — user must re-request.
   if (valveQueueLength > 0) {
-    if (g_metricsLog) {
-      g_metricsLog("warn", "queue: cleared on emergency (" +
-                               String(valveQueueLength) + " entries dropped)");
-    }
+    BLOG_WARN("queue: cleared on emergency (%d entries dropped)", valveQueueLength);
     ValveQueueLogic::clear(valveQueueLength);
   }
   batchSessionActive = false;
@@ -824,7 +876,7 @@ inline void WateringSystem::emergencyStopAll(const String &reason) {
 
   // Force close all valves via direct GPIO control
   for (int i = 0; i < NUM_VALVES; i++) {
-    digitalWrite(VALVE_PINS[i], LOW);
+    ZoneIO::write(VALVE_PINS[i], LOW);
     valves[i]->state = VALVE_CLOSED;
     valves[i]->phase = PHASE_IDLE;
   }
@@ -859,6 +911,22 @@ inline void WateringSystem::resetOverflowFlag() {
 
 // ========== WATER LEVEL SENSOR WATCHDOG ==========
 // Monitors water level sensor and blocks watering if tank is empty
+inline bool WateringSystem::needsFastLoop() {
+  if (pumpState == PUMP_ON || currentlyActiveValve != -1 || valveQueueLength > 0) {
+    return true;
+  }
+  // An overflow confirmation in progress must not slow down between reads
+  if (overflowDetectionStreak > 0) {
+    return true;
+  }
+  for (int i = 0; i < NUM_VALVES; i++) {
+    if (valves[i]->phase != PHASE_IDLE) {
+      return true;
+    }
+  }
+  return false;
+}
+
 inline void WateringSystem::checkWaterLevelSensor(unsigned long currentTime) {
   // Check sensor every 100ms to ensure fast response
   if (currentTime - lastWaterLevelCheck < WATER_LEVEL_CHECK_INTERVAL) {
@@ -888,7 +956,7 @@ inline void WateringSystem::checkWaterLevelSensor(unsigned long currentTime) {
         // First time blocking - trigger emergency stop and send notification
         DebugHelper::debugImportant("⚠️⚠️⚠️ WATER LEVEL LOW CONFIRMED (" + String(WATER_LEVEL_LOW_DELAY / 1000) + "s delay expired) ⚠️⚠️⚠️");
         DebugHelper::debugImportant("Water tank is empty - GPIO " + String(WATER_LEVEL_SENSOR_PIN));
-        if (g_metricsLog) g_metricsLog("warn", "Water level low confirmed, GPIO " + String(WATER_LEVEL_SENSOR_PIN));
+        BLOG_WARN("Water level low confirmed, GPIO %d", WATER_LEVEL_SENSOR_PIN);
         waterLevelLow = true;
         waterLevelLowNotificationSent = false;
         waterLevelLowWaitingLogged = false; // Reset for next event
@@ -1000,7 +1068,7 @@ inline void WateringSystem::updatePlantLightSchedule(unsigned long currentTime)
                                             : "🌙 <b>PLANT LIGHT OFF</b>\n\n");
   message += "⏰ " + TelegramNotifier::getCurrentDateTime() + "\n";
   message += "🤖 Mode: automatic schedule\n";
-  message += "📅 Schedule: 22:00 -> 07:00";
+  message += "📅 Schedule: " + getPlantLightScheduleText();
 
   queueTelegramNotification(message);
   publishStateChange("plant_light", plantLight.isOn() ? "on" : "off");
@@ -1037,13 +1105,128 @@ inline String WateringSystem::getPlantLightStatusMessage() {
   message += "State: " + String(plantLight.isOn() ? "ON" : "OFF") + "\n";
   message += "Mode: " + String(plantLight.getModeName()) + "\n";
   message += "Relay GPIO: " + String(PLANT_LIGHT_RELAY_PIN) + "\n";
-  message += "Schedule: 22:00 -> 07:00\n";
-  message += "Auto wants: " +
-             String(plantLight.shouldBeOnNow(now) ? "ON now" : "OFF now");
+  const LightScheduleLogic::Schedule schedule = plantLight.getSchedule();
+  PlantLightController::Evaluation e =
+      PlantLightController::evaluateSchedule(schedule, now);
+  char windows[128];
+  LightScheduleLogic::format(schedule, windows, sizeof(windows));
+  message += "Schedule: " + String(windows) + "\n";
+  if (LightScheduleLogic::usesSun(schedule)) {
+    LightScheduleLogic::SunTimes sun = e.sunToday;
+    char sunText[40];
+    snprintf(sunText, sizeof(sunText), "Sunrise %02d:%02d, sunset %02d:%02d\n",
+             sun.sunrise / 60, sun.sunrise % 60, sun.sunset / 60, sun.sunset % 60);
+    message += sunText;
+  }
+  message += "Auto wants: " + String(e.on ? "ON now" : "OFF now");
+  time_t nextChange = e.changes ? e.nextEvaluation : 0;
+  if (nextChange > 0) {
+    tm nextInfo;
+    localtime_r(&nextChange, &nextInfo);
+    char nextText[24];
+    strftime(nextText, sizeof(nextText), " until %H:%M", &nextInfo);
+    message += nextText;
+  }
 
   return message;
 }
 
+inline String WateringSystem::getPlantLightScheduleText() {
+  char text[128];
+  plantLight.getScheduleText(text, sizeof(text));
+  return String(text);
+}
+
+inline String WateringSystem::getPlantLightScheduleJson() {
+  time_t now;
+  time(&now);
+  const LightScheduleLogic::Schedule schedule = plantLight.getSchedule();
+  PlantLightController::Evaluation e =
+      PlantLightController::evaluateSchedule(schedule, now);
+  char windows[128];
+  LightScheduleLogic::format(schedule, windows, sizeof(windows));
+
+  String json = "{\"windows\":\"" + String(windows) + "\"";
+  json += ",\"latitude\":" + String(schedule.latitude, 4);
+  json += ",\"longitude\":" + String(schedule.longitude, 4);
+  json += ",\"sunrise_min\":" + String(e.sunToday.sunrise);
+  json += ",\"sunset_min\":" + String(e.sunToday.sunset);
+  json += ",\"auto_on\":" + String(e.on ? "true" : "false");
+  json += ",\"next_change\":" + String((unsigned long)(e.changes ? e.nextEvaluation : 0));
+  json += "}";
+  return json;
+}
+
+// Replaces the automatic schedule and persists it. The control loop switches
+// to it on its next plant-light check (within a second in auto mode).
+// Returns false if the window list or location is invalid.
+inline bool WateringSystem::setPlantLightSchedule(const String &windows,
+                                                  float latitude,
+                                                  float longitude) {
+  LightScheduleLogic::Schedule schedule = plantLight.getSchedule();
+  if (!LightScheduleLogic::parse(windows.c_str(), schedule)) {
+    return false;
+  }
+  schedule.latitude = latitude;
+  schedule.longitude = longitude;
+  if (!plantLight.setSchedule(schedule)) {
+    return false;
+  }
+  savePlantLightSchedule();
+
+  DebugHelper::debugImportant("💡 Plant light schedule: " + getPlantLightScheduleText());
+  publishStateChange("plant_light", "schedule_changed");
+  publishCurrentState();
+  return true;
+}
+
+inline bool WateringSystem::savePlantLightSchedule() {
+  const LightScheduleLogic::Schedule schedule = plantLight.getSchedule();
+  StaticJsonDocument<256> doc;
+  doc["windows"] = getPlantLightScheduleText();
+  doc["latitude"] = schedule.latitude;
+  doc["longitude"] = schedule.longitude;
+
+  File file = LittleFS.open(PLANT_LIGHT_SCHEDULE_FILE, "w");
+  if (!file) {
+    DebugHelper::debugImportant("❌ Failed to open plant light schedule for writing");
+    return false;
+  }
+  bool ok = serializeJson(doc, file) > 0;
+  file.close();
+  return ok;
+}
+
+// Keeps the compiled-in default when the file is missing or invalid.
+inline bool WateringSystem::loadPlantLightSchedule() {
+  if (!LittleFS.exists(PLANT_LIGHT_SCHEDULE_FILE)) {
+    return false;
+  }
+  File file = LittleFS.open(PLANT_LIGHT_SCHEDULE_FILE, "r");
+  if (!file) {
+    return false;
+  }
+  StaticJsonDocument<256> doc;
+  DeserializationError error = deserializeJson(doc, file);
+  file.close();
+  if (error) {
+    DebugHelper::debugImportant("⚠️ Plant light schedule unreadable: " +
+                                String(error.c_str()));
+    return false;
+  }
+
+  LightScheduleLogic::Schedule schedule = plantLight.getSchedule();
+  const char *windows = doc["windows"] | "";
+  schedule.latitude = doc["latitude"] | PLANT_LIGHT_LATITUDE;
+  schedule.longitude = doc["longitude"] | PLANT_LIGHT_LONGITUDE;
+  if (!LightScheduleLogic::parse(windows, schedule) ||
+      !plantLight.setSchedule(schedule)) {
+    DebugHelper::debugImportant("⚠️ Plant light schedule invalid - using default");
+    return false;
+  }
+  return true;
+}
+
 // ========== Automatic Watering Check ==========
 inline void WateringSystem::checkAutoWatering(unsigned long currentTime) {
   // OVERFLOW CHECK: Block all watering if overflow detected
@@ -1075,7 +1258,7 @@ inline void WateringSystem::checkAutoWatering(unsigned long currentTime) {
       DebugHelper::debug("⏰ AUTO-WATERING TRIGGERED: Valve " +
                                   String(i));
       DebugHelper::debug("  Tray is empty - starting automatic watering");
-      if (g_metricsLog) g_metricsLog("info", "Auto-watering triggered: valve " + String(i));
+      BLOG_INFO("Auto-watering triggered: valve %d", i);
 
       requestWatering(i, "Auto", /*force=*/false);
     }
@@ -1215,21 +1398,18 @@ inline void WateringSystem::beginValveCycle(
     recordSessionStart(valveIndex);
   }
 
-  if (g_metricsLog) {
-    g_metricsLog("info", "queue: dequeued valve " + String(valveIndex) +
-                             " (trigger=" + entry.triggerType + ")");
-  }
+  BLOG_INFO("queue: dequeued valve %d (trigger=%s)", valveIndex, entry.triggerType.c_str());
 
-  DebugHelper::debug("▶ beginValveCycle: valve " + String(valveIndex) +
-                     " (trigger=" + entry.triggerType + ")");
+  DLOG_INFO(LOG_SYS_QUEUE, "▶ beginValveCycle: valve " + String(valveIndex) +
+                           " (trigger=" + entry.triggerType + ")");
 }
 
 inline void WateringSystem::enqueueValve(int valveIndex,
                                           const String& triggerType,
                                           bool force) {
   if (valveIndex == currentlyActiveValve) {
-    DebugHelper::debug("queue: valve " + String(valveIndex) +
-                       " already active — skip enqueue");
+    DLOG_DEBUG(LOG_SYS_QUEUE, "queue: valve " + String(valveIndex) +
+                                  " already active — skip enqueue");
     return;
   }
 
@@ -1237,18 +1417,15 @@ inline void WateringSystem::enqueueValve(int valveIndex,
   bool added = ValveQueueLogic::enqueue(valveQueue, valveQueueLength,
                                          NUM_VALVES, entry);
   if (!added) {
-    DebugHelper::debug("queue: valve " + String(valveIndex) +
-                       " already queued — skip enqueue");
+    DLOG_DEBUG(LOG_SYS_QUEUE, "queue: valve " + String(valveIndex) +
+                                  " already queued — skip enqueue");
     return;
   }
 
-  if (g_metricsLog) {
-    g_metricsLog("info", "queue: enqueued valve " + String(valveIndex) +
-                             " (trigger=" + triggerType + ")");
-  }
-  DebugHelper::debug("⊕ enqueued valve " + String(valveIndex) +
-                     " (trigger=" + triggerType + ", queue=" +
-                     String(valveQueueLength) + ")");
+  BLOG_INFO("queue: enqueued valve %d (trigger=%s)", valveIndex, triggerType.c_str());
+  DLOG_INFO(LOG_SYS_QUEUE, "⊕ enqueued valve " + String(valveIndex) +
+                           " (trigger=" + triggerType + ", queue=" +
+                           String(valveQueueLength) + ")");
 }
 
 inline void WateringSystem::processQueue(unsigned long currentTime) {
@@ -1257,11 +1434,11 @@ inline void WateringSystem::processQueue(unsigned long currentTime) {
   // shutdowns — anything that lands the valve in PHASE_IDLE.
   if (currentlyActiveValve != -1 &&
       valves[currentlyActiveValve]->phase == PHASE_IDLE) {
-    DebugHelper::debug("↻ valve " + String(currentlyActiveValve) +
-                       " idle — gap timer started (" +
-                       String(INTER_VALVE_GAP_MS / 1000) + "s)");
+    DLOG_INFO(LOG_SYS_QUEUE, "↻ valve " + String(currentlyActiveValve) +
+                             " idle — gap timer started (" +
+                             String(RuntimeConfig::get().interValveGapMs / 1000) + "s)");
     currentlyActiveValve = -1;
-    nextValveReadyTime = currentTime + INTER_VALVE_GAP_MS;
+    nextValveReadyTime = currentTime + RuntimeConfig::get().interValveGapMs;
 
     // Batch completion: active valve just finished AND queue is empty AND
     // we're inside a batch session. Emit the completion notification once.
@@ -1299,31 +1476,25 @@ inline void WateringSystem::processQueue(unsigned long currentTime) {
 
   // Safety gates (defer but don't drop).
   if (overflowDetected || waterLevelLow || haltMode) {
-    if (g_metricsLog) {
-      String reason = overflowDetected ? "overflow"
-                                       : (waterLevelLow ? "water_low" : "halt");
-      g_metricsLog("warn",
-                   "queue: dequeue deferred — safety gate (" + reason + ")");
-    }
+    BLOG_WARN("queue: dequeue deferred — safety gate (%s)",
+              overflowDetected ? "overflow" : (waterLevelLow ? "water_low" : "halt"));
     return;
   }
 
   // Peek head, then re-check learning-interval for non-force entries
-  // (may be stale after long waits behind safety gates).
-  ValveQueueLogic::QueueEntry head = valveQueue[0];
-  ValveController *valve = valves[head.valveIndex];
+  // (may be stale after long waits behind safety gates). Peek in place
+  // rather than copying the entry and its trigger String.
+  int headValve = valveQueue[0].valveIndex;
+  ValveController *valve = valves[headValve];
 
-  if (!head.force && valve->isCalibrated && valve->emptyToFullDuration > 0 &&
+  if (!valveQueue[0].force && valve->isCalibrated && valve->emptyToFullDuration > 0 &&
       valve->lastWateringCompleteTime > 0 &&
       valve->lastWateringCompleteTime <= currentTime) {
     unsigned long timeSince = currentTime - valve->lastWateringCompleteTime;
     if (timeSince < valve->emptyToFullDuration) {
       ValveQueueLogic::QueueEntry drop;
       ValveQueueLogic::dequeue(valveQueue, valveQueueLength, drop);
-      if (g_metricsLog) {
-        g_metricsLog("info", "queue: dropped valve " + String(head.valveIndex) +
-                                 " at dequeue — no longer due (learning)");
-      }
+      BLOG_INFO("queue: dropped valve %d at dequeue — no longer due (learning)", headValve);
       return;
     }
   }
@@ -1340,11 +1511,7 @@ inline void WateringSystem::stopWatering(int valveIndex) {
 
   // Remove from queue if pending (never actually opened)
   if (ValveQueueLogic::remove(valveQueue, valveQueueLength, valveIndex)) {
-    if (g_metricsLog) {
-      g_metricsLog("info",
-                   "queue: removed valve " + String(valveIndex) +
-                       " (stop requested)");
-    }
+    BLOG_INFO("queue: removed valve %d (stop requested)", valveIndex);
     DebugHelper::debug("⊖ removed queued valve " + String(valveIndex));
     return;
   }
@@ -1395,7 +1562,7 @@ inline void WateringSystem::startSequentialWatering(const String &triggerType) {
     return;
   }
 
-  // Build the per-valve list (5→0 so tray 6 waters first — existing behavior)
+  // Build the per-valve list (last→0 so the highest tray waters first — existing behavior)
   int targetValves[NUM_VALVES];
   int targetCount = NUM_VALVES;
   for (int i = 0; i < NUM_VALVES; i++) {
@@ -1416,10 +1583,7 @@ inline void WateringSystem::startSequentialWatering(const String &triggerType) {
     enqueueValve(targetValves[i], "Sequential", /*force=*/true);
   }
 
-  if (g_metricsLog) {
-    g_metricsLog("info", "queue: bulk-enqueued " + String(targetCount) +
-                             " valves (trigger=" + triggerType + ")");
-  }
+  BLOG_INFO("queue: bulk-enqueued %d valves (trigger=%s)", targetCount, triggerType.c_str());
 }
 
 inline void WateringSystem::startSequentialWateringCustom(int *valveIndices,
@@ -1447,10 +1611,7 @@ inline void WateringSystem::startSequentialWateringCustom(int *valveIndices,
     enqueueValve(valveIndices[i], "Sequential", /*force=*/true);
   }
 
-  if (g_metricsLog) {
-    g_metricsLog("info", "queue: bulk-enqueued " + String(count) +
-                             " valves (custom, trigger=" + triggerType + ")");
-  }
+  BLOG_INFO("queue: bulk-enqueued %d valves (custom, trigger=%s)", count, triggerType.c_str());
 }
 
 inline bool WateringSystem::isValveComplete(int valveIndex) {
@@ -1460,6 +1621,7 @@ inline bool WateringSystem::isValveComplete(int valveIndex) {
 
 // ========== Hardware Control ==========
 inline bool WateringSystem::readRainSensor(int valveIndex) {
+  TRACE_SCOPE(TraceEventFormat::TRACE_CAT_SENSOR, "rain_sensor", valveIndex);
   // CRITICAL: Rain sensors need TWO power signals (per CLAUDE.md):
   // 1. Valve pin HIGH (specific sensor power)
   // 2. GPIO 18 HIGH (common rail enable)
@@ -1473,7 +1635,7 @@ inline bool WateringSystem::readRainSensor(int valveIndex) {
   // - Other phases: Turn on briefly for reading, then off
 
   // Ensure pins are configured correctly
-  pinMode(VALVE_PINS[valveIndex], OUTPUT);
+  ZoneIO::setMode(VALVE_PINS[valveIndex], OUTPUT);
   pinMode(RAIN_SENSOR_POWER_PIN, OUTPUT);
 
   // Check if any valve is currently in PHASE_WATERING
@@ -1486,7 +1648,7 @@ inline bool WateringSystem::readRainSensor(int valveIndex) {
   }
 
   // Power on sensor: valve pin + common rail
-  digitalWrite(VALVE_PINS[valveIndex], HIGH);
+  ZoneIO::write(VALVE_PINS[valveIndex], HIGH);
   digitalWrite(RAIN_SENSOR_POWER_PIN, HIGH);
 
   // Only delay if we're turning on GPIO 18 for the first time
@@ -1504,14 +1666,14 @@ inline bool WateringSystem::readRainSensor(int valveIndex) {
   // the whole sampling window.
   int lowReadings = 0;
   for (int i = 0; i < RAIN_SENSOR_DEBOUNCE_SAMPLES; i++) {
-    if (digitalRead(RAIN_SENSOR_PINS[valveIndex]) == LOW) {
+    if (ZoneIO::read(RAIN_SENSOR_PINS[valveIndex]) == LOW) {
       lowReadings++;
     }
     if (i < RAIN_SENSOR_DEBOUNCE_SAMPLES - 1) {
       delay(RAIN_SENSOR_DEBOUNCE_DELAY_MS);
     }
   }
-  bool wet = SensorDebounce::isWet(lowReadings, RAIN_SENSOR_DEBOUNCE_THRESHOLD);
+  bool wet = SensorDebounce::isWet(lowReadings, (int)RuntimeConfig::get().rainDebounceThreshold);
 
   // Power management: Only turn off GPIO 18 if NOT in watering phase
   // During watering, GPIO 18 stays HIGH for continuous sensor monitoring
@@ -1520,14 +1682,11 @@ inline bool WateringSystem::readRainSensor(int valveIndex) {
   }
 
   // ENHANCED LOGGING: Log actual GPIO values for debugging
-  static unsigned long lastDetailedLog = 0;
-  if (millis() - lastDetailedLog > 5000) {  // Detailed log every 5s
-    DebugHelper::debug("Sensor " + String(valveIndex) + " GPIO " + String(RAIN_SENSOR_PINS[valveIndex]) +
-                      ": " + String(lowReadings) + "/" + String(RAIN_SENSOR_DEBOUNCE_SAMPLES) +
-                      " LOW (" + String(wet ? "WET" : "DRY") +
-                      "), GPIO18=" + String(anyWatering ? "CONTINUOUS" : "PULSED"));
-    lastDetailedLog = millis();
-  }
+  DLOG_EVERY(LOG_SYS_SENSOR, LOG_LEVEL_DEBUG, 5000,  // Detailed log every 5s
+             "Sensor " + String(valveIndex) + " " + ZoneIO::describe(RAIN_SENSOR_PINS[valveIndex]) +
+             ": " + String(lowReadings) + "/" + String(RAIN_SENSOR_DEBOUNCE_SAMPLES) +
+             " LOW (" + String(wet ? "WET" : "DRY") +
+             "), GPIO18=" + String(anyWatering ? "CONTINUOUS" : "PULSED"));
 
   return wet; // majority LOW = wet/rain detected
 }
@@ -1540,9 +1699,9 @@ inline void WateringSystem::openValve(int valveIndex) {
   // LOW even when GPIO is set HIGH (expected behavior, not a failure).
 
   DebugHelper::debug("🔧 OPENING VALVE " + String(valveIndex));
-  DebugHelper::debug("  GPIO Pin: " + String(VALVE_PINS[valveIndex]));
+  DebugHelper::debug("  Pin: " + ZoneIO::describe(VALVE_PINS[valveIndex]));
 
-  digitalWrite(VALVE_PINS[valveIndex], HIGH);
+  ZoneIO::write(VALVE_PINS[valveIndex], HIGH);
 
   valves[valveIndex]->state = VALVE_OPEN;
   activeValveCount++;
@@ -1557,13 +1716,13 @@ inline void WateringSystem::closeValve(int valveIndex) {
   }
 
   // Close valve hardware
-  digitalWrite(VALVE_PINS[valveIndex], LOW);
+  ZoneIO::write(VALVE_PINS[valveIndex], LOW);
   valves[valveIndex]->state = VALVE_CLOSED;
   if (activeValveCount > 0)
     activeValveCount--;
 
   DebugHelper::debug("🔧 CLOSING VALVE " + String(valveIndex) +
-                              " (GPIO " + String(VALVE_PINS[valveIndex]) + ")");
+                              " (" + ZoneIO::describe(VALVE_PINS[valveIndex]) + ")");
 }
 
 inline void WateringSystem::updatePumpState() {
@@ -1621,8 +1780,20 @@ inline void WateringSystem::processLearningData(ValveController *valve,
       0.5; // Binary search refinement (decrease)
   const float INTERVAL_INCREMENT_FINE = 0.25; // Fine-tuning adjustment
 
+  LearningAlgorithm::CycleOutcome outcome = LearningAlgorithm::classifyCycle(
+      valve->noFlowDetected, valve->timeoutOccurred, valve->moistureStopped,
+      valve->wateringStartTime > 0, valve->rainDetected);
+
+  // No flow (dry pump / blocked line) says nothing about the tray: keep the
+  // learned interval. The attempt time already gates the next retry.
+  if (outcome == LearningAlgorithm::CYCLE_NO_FLOW) {
+    DebugHelper::debug("🚱 No-flow stop on valve " + String(valve->valveIndex) +
+                       " - learning data unchanged");
+    return;
+  }
+
   // Handle timeout scenarios
-  if (valve->timeoutOccurred) {
+  if (outcome == LearningAlgorithm::CYCLE_TIMEOUT) {
     valve->consecutiveTimeouts++;
     DebugHelper::debug("⏰ Consecutive timeouts for valve " +
                        String(valve->valveIndex) + ": " +
@@ -1672,11 +1843,8 @@ inline void WateringSystem::processLearningData(ValveController *valve,
         String(INTERVAL_INCREMENT_FINE, 2) +
         "); next cycle will skip fine-tune bump");
 
-    if (g_metricsLog)
-      g_metricsLog("info", "Valve " + String(valve->valveIndex) +
-                              ": learning: timeout, interval " +
-                              String(oldMultiplier, 2) + "x->" +
-                              String(valve->intervalMultiplier, 2) + "x");
+    BLOG_INFO("Valve %d: learning: timeout, interval %.2fx->%.2fx", valve->valveIndex,
+              oldMultiplier, valve->intervalMultiplier);
     saveLearningData();
     if (valve->consecutiveTimeouts == CONSECUTIVE_TIMEOUT_ALERT_THRESHOLD) {
       queueTelegramNotification(TelegramNotifier::formatRepeatedTimeoutAlert(
@@ -1686,10 +1854,31 @@ inline void WateringSystem::processLearningData(ValveController *valve,
     return;
   }
 
+  // Moisture setpoint reached with the rain sensor still dry: the plant has
+  // what it needs, but the tray is not full. Restart the wait from now and
+  // leave the baseline, fill durations and interval multiplier alone.
+  if (outcome == LearningAlgorithm::CYCLE_SETPOINT) {
+    valve->lastWateringCompleteTime = currentTime;
+    valve->realTimeSinceLastWatering = 0;
+    valve->lastWateringAttemptTime = currentTime;
+    valve->realTimeSinceLastWateringAttempt = 0;
+    valve->consecutiveTimeouts = 0;
+    if (!valve->isCalibrated) {
+      valve->emptyToFullDuration = UNCALIBRATED_RETRY_INTERVAL_MS;
+    }
+    DebugHelper::debug("💧 Moisture setpoint stop on valve " + String(valve->valveIndex) +
+                       " - fill not learned, interval " +
+                       String(valve->intervalMultiplier, 2) + "x kept");
+    BLOG_INFO("Valve %d: learning: setpoint stop, not learned", valve->valveIndex);
+    saveLearningData();
+    sendScheduleUpdateIfNeeded();
+    return;
+  }
+
   // CASE 1: Tray already full (sensor wet before pump started)
   // wateringStartTime == 0 means pump never started, rainDetected == true means
   // sensor is wet
-  if (valve->wateringStartTime == 0 && valve->rainDetected) {
+  if (outcome == LearningAlgorithm::CYCLE_ALREADY_FULL) {
     // CRITICAL: Detect restart/power-outage scenarios
     // If tray was recently watered (< 2 hours ago), this is likely a restart
     // Don't punish with interval doubling - just skip this cycle
@@ -1775,14 +1964,15 @@ inline void WateringSystem::processLearningData(ValveController *valve,
         "  Next attempt in: " +
         LearningAlgorithm::formatDuration(valve->emptyToFullDuration));
 
-    if (g_metricsLog) g_metricsLog("info", "Valve " + String(valve->valveIndex) + ": learning: tray full, interval " + String(oldMultiplier, 2) + "x->" + String(valve->intervalMultiplier, 2) + "x");
+    BLOG_INFO("Valve %d: learning: tray full, interval %.2fx->%.2fx", valve->valveIndex,
+              oldMultiplier, valve->intervalMultiplier);
     saveLearningData();
     sendScheduleUpdateIfNeeded();
     return;
   }
 
   // CASE 2: Successful watering (pump ran and sensor became wet)
-  if (!valve->rainDetected || valve->wateringStartTime == 0) {
+  if (outcome != LearningAlgorithm::CYCLE_FILLED) {
     return; // Not a successful watering
   }
 
@@ -1931,7 +2121,8 @@ inline void WateringSystem::processLearningData(ValveController *valve,
                      "% (" + String(getTrayState(waterLevelBefore)) + ")");
   DebugHelper::debug("  Total cycles: " + String(valve->totalWateringCycles));
 
-  if (g_metricsLog) g_metricsLog("info", "Valve " + String(valve->valveIndex) + ": learning: fill=" + String(fillDuration / 1000.0, 1) + "s interval " + String(oldMultiplier, 2) + "x->" + String(valve->intervalMultiplier, 2) + "x");
+  BLOG_INFO("Valve %d: learning: fill=%.1fs interval %.2fx->%.2fx", valve->valveIndex,
+            fillDuration / 1000.0, oldMultiplier, valve->intervalMultiplier);
   saveLearningData();
   sendScheduleUpdateIfNeeded();
 }
@@ -2027,11 +2218,7 @@ inline bool WateringSystem::setIntervalMultiplier(int valveIndex,
   DebugHelper::debug("🔧 Valve " + String(valveIndex) +
                      ": interval set manually " + String(oldMultiplier, 2) +
                      "x → " + String(multiplier, 2) + "x");
-  if (g_metricsLog)
-    g_metricsLog("info", "Valve " + String(valveIndex) +
-                            ": manual interval set " +
-                            String(oldMultiplier, 2) + "x->" +
-                            String(multiplier, 2) + "x");
+  BLOG_INFO("Valve %d: manual interval set %.2fx->%.2fx", valveIndex, oldMultiplier, multiplier);
   publishStateChange("valve" + String(valveIndex), "interval_set");
   saveLearningData();
   sendScheduleUpdateIfNeeded();
@@ -2253,7 +2440,7 @@ inline void WateringSystem::sendWateringSchedule(const String &title) {
     } else if (valve->emptyToFullDuration > 0 || valve->isCalibrated) {
       // Retry/calibration-in-progress path: baseline is unknown yet, but valve can
       // still water using per-valve timeout safeguards.
-      float fallbackDurationSec = getValveNormalTimeout(i) / 1000.0;
+      float fallbackDurationSec = RuntimeConfig::normalTimeout(i) / 1000.0;
       scheduleData[i][2] = String(fallbackDurationSec, 1);
     } else {
       scheduleData[i][2] = "-";
@@ -2492,26 +2679,26 @@ inline void WateringSystem::testSensor(int valveIndex) {
   DebugHelper::debug("     ✓ Power pin configured as OUTPUT");
 
   // Test 2: Check sensor pin configuration
-  DebugHelper::debug("  2️⃣ Checking sensor pin (GPIO " + String(RAIN_SENSOR_PINS[valveIndex]) + ")");
-  pinMode(RAIN_SENSOR_PINS[valveIndex], INPUT_PULLUP);
+  DebugHelper::debug("  2️⃣ Checking sensor pin (" + ZoneIO::describe(RAIN_SENSOR_PINS[valveIndex]) + ")");
+  ZoneIO::setMode(RAIN_SENSOR_PINS[valveIndex], INPUT_PULLUP);
   DebugHelper::debug("     ✓ Sensor pin configured as INPUT_PULLUP");
 
   // Test 3: Read sensor with power OFF (should be HIGH due to pullup)
-  digitalWrite(VALVE_PINS[valveIndex], LOW);
+  ZoneIO::write(VALVE_PINS[valveIndex], LOW);
   digitalWrite(RAIN_SENSOR_POWER_PIN, LOW);
   delay(100);
-  int valueOff = digitalRead(RAIN_SENSOR_PINS[valveIndex]);
+  int valueOff = ZoneIO::read(RAIN_SENSOR_PINS[valveIndex]);
   DebugHelper::debug("  3️⃣ Sensor reading (power OFF): " + String(valueOff) +
                      " (" + String(valueOff == HIGH ? "HIGH - DRY ✓" : "LOW - UNEXPECTED ⚠️") + ")");
 
   // Test 4: Read sensor with power ON (actual reading)
   // CRITICAL: Sensor needs valve pin HIGH + GPIO 18 HIGH
-  digitalWrite(VALVE_PINS[valveIndex], HIGH);
+  ZoneIO::write(VALVE_PINS[valveIndex], HIGH);
   digitalWrite(RAIN_SENSOR_POWER_PIN, HIGH);
   delay(SENSOR_POWER_STABILIZATION);
-  int valueOn = digitalRead(RAIN_SENSOR_PINS[valveIndex]);
+  int valueOn = ZoneIO::read(RAIN_SENSOR_PINS[valveIndex]);
   digitalWrite(RAIN_SENSOR_POWER_PIN, LOW);
-  digitalWrite(VALVE_PINS[valveIndex], LOW);
+  ZoneIO::write(VALVE_PINS[valveIndex], LOW);
 
   DebugHelper::debug("  4️⃣ Sensor reading (power ON): " + String(valueOn) +
                      " (" + String(valueOn == LOW ? "LOW - WET 💧" : "HIGH - DRY ☀️") + ")");
@@ -2544,22 +2731,22 @@ inline void WateringSystem::testAllSensors() {
 
   for (int i = 0; i < NUM_VALVES; i++) {
     // Configure sensor pin
-    pinMode(RAIN_SENSOR_PINS[i], INPUT_PULLUP);
+    ZoneIO::setMode(RAIN_SENSOR_PINS[i], INPUT_PULLUP);
 
     // Read with power OFF
-    digitalWrite(VALVE_PINS[i], LOW);
+    ZoneIO::write(VALVE_PINS[i], LOW);
     digitalWrite(RAIN_SENSOR_POWER_PIN, LOW);
     delay(50);
-    int valueOff = digitalRead(RAIN_SENSOR_PINS[i]);
+    int valueOff = ZoneIO::read(RAIN_SENSOR_PINS[i]);
 
     // Read with power ON
     // CRITICAL: Sensor needs valve pin HIGH + GPIO 18 HIGH
-    digitalWrite(VALVE_PINS[i], HIGH);
+    ZoneIO::write(VALVE_PINS[i], HIGH);
     digitalWrite(RAIN_SENSOR_POWER_PIN, HIGH);
     delay(SENSOR_POWER_STABILIZATION);
-    int valueOn = digitalRead(RAIN_SENSOR_PINS[i]);
+    int valueOn = ZoneIO::read(RAIN_SENSOR_PINS[i]);
     digitalWrite(RAIN_SENSOR_POWER_PIN, LOW);
-    digitalWrite(VALVE_PINS[i], LOW);
+    ZoneIO::write(VALVE_PINS[i], LOW);
 
     // Add to summary
     String tray = String(i + 1);
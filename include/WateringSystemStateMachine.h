@@ -2,6 +2,7 @@
 #define WATERING_SYSTEM_STATE_MACHINE_H
 
 #include "DebugHelper.h"
+#include "BinaryLog.h"
 
 // This file contains the state machine implementation for WateringSystem
 // Included at the end of WateringSystem.h
@@ -9,6 +10,8 @@
 // ========== State Machine Implementation ==========
 inline void WateringSystem::processValve(int valveIndex, unsigned long currentTime) {
     ValveController* valve = valves[valveIndex];
+    const RuntimeConfigLogic::Values& cfg = RuntimeConfig::get();  // One consistent snapshot per pass
+    valve->moisturePercent = MoistureSensors::percent(valveIndex, currentTime);
 
     switch (valve->phase) {
         case PHASE_IDLE:
@@ -19,25 +22,28 @@ inline void WateringSystem::processValve(int valveIndex, unsigned long currentTi
             openValve(valveIndex);
             valve->valveOpenTime = currentTime;
             valve->phase = PHASE_WAITING_STABILIZATION;
-            DebugHelper::debug("✓ Valve " + String(valveIndex) + " opened - waiting stabilization");
-            if (g_metricsLog) g_metricsLog("info", "Valve " + String(valveIndex) + ": opened");
+            DLOG_DEBUG(LOG_SYS_VALVE, "✓ Valve " + String(valveIndex) + " opened - waiting stabilization");
+            BLOG_INFO("Valve %d: opened", valveIndex);
             publishStateChange("valve" + String(valveIndex), "valve_opened");
             break;
 
         case PHASE_WAITING_STABILIZATION:
-            if (currentTime - valve->valveOpenTime >= VALVE_STABILIZATION_DELAY) {
+            if (currentTime - valve->valveOpenTime >= cfg.valveStabilizationMs) {
                 valve->phase = PHASE_CHECKING_INITIAL_RAIN;
                 valve->lastRainCheck = currentTime;
                 valve->rainWetStreak = 0;  // fresh streak for the initial already-full check
-                DebugHelper::debug("Step 2: Checking rain sensor (water is flowing now)...");
+                valve->moistureStopped = false;
+                DLOG_DEBUG(LOG_SYS_VALVE, "Step 2: Checking rain sensor (water is flowing now)...");
             }
             break;
 
         case PHASE_CHECKING_INITIAL_RAIN:
-            if (currentTime - valve->lastRainCheck >= RAIN_CHECK_INTERVAL) {
+            if (currentTime - valve->lastRainCheck >= cfg.rainCheckIntervalMs) {
                 valve->lastRainCheck = currentTime;
-                bool isRaining = readRainSensor(valveIndex);
+                bool sensorWet = readRainSensor(valveIndex);
+                bool isRaining = sensorWet || moistureSetpointReached(valveIndex);
                 valve->rainDetected = isRaining;
+                valve->moistureStopped = isRaining && !sensorWet;
 
                 if (isRaining) {
                     // Require SUSTAINED wet here too: a single (debounced) wet read at
@@ -45,13 +51,15 @@ inline void WateringSystem::processValve(int valveIndex, unsigned long currentTi
                     // Need RAIN_SENSOR_CONFIRMATION_CHECKS consecutive wet reads; a dry
                     // read (else-branch) resets the streak and proceeds to water.
                     valve->rainWetStreak = SensorDebounce::nextWetStreak(valve->rainWetStreak, true);
-                    if (!SensorDebounce::fillConfirmed(valve->rainWetStreak, RAIN_SENSOR_CONFIRMATION_CHECKS)) {
+                    if (!SensorDebounce::fillConfirmed(valve->rainWetStreak, cfg.rainConfirmations)) {
                         break;  // not yet confirmed full — re-check next poll before skipping
                     }
 
                     // Sensor sustained wet = TRAY IS FULL - treat as successful fill
-                    DebugHelper::debug("✓ Sensor " + String(valveIndex) + " already WET - tray is FULL");
-                    if (g_metricsLog) g_metricsLog("info", "Valve " + String(valveIndex) + ": rain=WET");
+                    DLOG_INFO(LOG_SYS_VALVE, "✓ Sensor " + String(valveIndex) +
+                              (valve->moistureStopped ? " DRY but moisture " + String((int)valve->moisturePercent) + "% at setpoint - skipping"
+                                                      : " already WET - tray is FULL"));
+                    BLOG_INFO("Valve %d: rain=WET", valveIndex);
 
                     // SAFETY: Close valve immediately
                     closeValve(valveIndex);
@@ -65,9 +73,9 @@ inline void WateringSystem::processValve(int valveIndex, unsigned long currentTi
                     // If not calibrated, set temporary retry duration to attempt calibration later
                     if (!valve->isCalibrated) {
                         valve->emptyToFullDuration = UNCALIBRATED_RETRY_INTERVAL_MS;
-                        DebugHelper::debug("  Tray not calibrated - will retry watering in " + String(UNCALIBRATED_RETRY_INTERVAL_MS / 3600000) + " hours for calibration");
+                        DLOG_INFO(LOG_SYS_VALVE, "  Tray not calibrated - will retry watering in " + String(UNCALIBRATED_RETRY_INTERVAL_MS / 3600000) + " hours for calibration");
                     } else {
-                        DebugHelper::debug("  Updated lastWateringCompleteTime - auto-watering will wait for consumption");
+                        DLOG_INFO(LOG_SYS_VALVE, "  Updated lastWateringCompleteTime - auto-watering will wait for consumption");
                     }
 
                     publishStateChange("valve" + String(valveIndex), "already_full_skipped");
@@ -76,13 +84,13 @@ inline void WateringSystem::processValve(int valveIndex, unsigned long currentTi
                     valve->phase = PHASE_CLOSING_VALVE;
                 } else {
                     // Sensor dry - start watering
-                    DebugHelper::debug("✓ Sensor " + String(valveIndex) + " is DRY - starting pump (timeout: " + String(getValveNormalTimeout(valveIndex) / 1000) + "s)");
-                    if (g_metricsLog) {
-                        g_metricsLog("info", "Valve " + String(valveIndex) + ": rain=DRY");
-                        g_metricsLog("info", "Valve " + String(valveIndex) + ": watering started");
-                    }
+                    DLOG_INFO(LOG_SYS_VALVE, "✓ Sensor " + String(valveIndex) + " is DRY - starting pump (timeout: " + String(RuntimeConfig::normalTimeout(valveIndex) / 1000) + "s)");
+                    BLOG_INFO("Valve %d: rain=DRY", valveIndex);
+                    BLOG_INFO("Valve %d: watering started", valveIndex);
                     valve->wateringStartTime = currentTime;
                     valve->timeoutOccurred = false;
+                    valve->noFlowDetected = false;
+                    FlowMeter::startCycle(currentTime);
                     valve->rainWetStreak = 0;  // start sustained-wet confirmation fresh
                     valve->phase = PHASE_WATERING;
                     updatePumpState();
@@ -93,14 +101,14 @@ inline void WateringSystem::processValve(int valveIndex, unsigned long currentTi
 
         case PHASE_WATERING:
             // SAFETY CHECK 1: ABSOLUTE EMERGENCY TIMEOUT - HARD CUTOFF
-            if (currentTime - valve->wateringStartTime >= getValveEmergencyTimeout(valveIndex)) {
-                DebugHelper::debugImportant("🚨 EMERGENCY CUTOFF: Valve " + String(valveIndex) + " exceeded ABSOLUTE limit " + String(getValveEmergencyTimeout(valveIndex) / 1000) + "s!");
+            if (currentTime - valve->wateringStartTime >= RuntimeConfig::emergencyTimeout(valveIndex)) {
+                DebugHelper::debugImportant("🚨 EMERGENCY CUTOFF: Valve " + String(valveIndex) + " exceeded ABSOLUTE limit " + String(RuntimeConfig::emergencyTimeout(valveIndex) / 1000) + "s!");
                 DebugHelper::debugImportant("🚨 This indicates a CRITICAL SAFETY FAILURE!");
                 DebugHelper::debugImportant("🚨 Check sensor hardware immediately!");
 
                 // EMERGENCY: Force everything OFF
                 valve->timeoutOccurred = true;
-                digitalWrite(VALVE_PINS[valveIndex], LOW);  // Force close
+                ZoneIO::write(VALVE_PINS[valveIndex], LOW);  // Force close
                 digitalWrite(PUMP_PIN, LOW);  // Force pump off
                 updatePumpState();
 
@@ -110,8 +118,8 @@ inline void WateringSystem::processValve(int valveIndex, unsigned long currentTi
             }
 
             // SAFETY CHECK 2: Normal timeout - MAX WATERING TIME
-            if (currentTime - valve->wateringStartTime >= getValveNormalTimeout(valveIndex)) {
-                DebugHelper::debugImportant("⚠️ TIMEOUT: Valve " + String(valveIndex) + " exceeded " + String(getValveNormalTimeout(valveIndex) / 1000) + "s - IMMEDIATE SAFETY STOP");
+            if (currentTime - valve->wateringStartTime >= RuntimeConfig::normalTimeout(valveIndex)) {
+                DebugHelper::debugImportant("⚠️ TIMEOUT: Valve " + String(valveIndex) + " exceeded " + String(RuntimeConfig::normalTimeout(valveIndex) / 1000) + "s - IMMEDIATE SAFETY STOP");
 
                 // SAFETY: Immediately close valve and stop pump
                 valve->timeoutOccurred = true;
@@ -123,17 +131,38 @@ inline void WateringSystem::processValve(int valveIndex, unsigned long currentTi
                 break;
             }
 
-            // SAFETY CHECK 2: Monitor rain sensor - ALWAYS RESPECT RAIN SENSOR
-            if (currentTime - valve->lastRainCheck >= RAIN_CHECK_INTERVAL) {
+            // SAFETY CHECK 3: Flow meter - a dry pump or blocked line shows up as
+            // no pulses within a second, long before the valve timeout
+            FlowMeter::update(currentTime);
+            if (FlowMeter::noFlow(currentTime)) {
+                DebugHelper::debugImportant("🚱 NO FLOW: Valve " + String(valveIndex) + " - no meter pulses for " +
+                                            String(FLOW_NO_FLOW_TIMEOUT_MS) + "ms after " +
+                                            String((currentTime - valve->wateringStartTime) / 1000.0f, 1) +
+                                            "s of pumping - dry pump or blocked line, STOPPING");
+                valve->noFlowDetected = true;
+                closeValve(valveIndex);
+                updatePumpState();
+                queueTelegramNotification(TelegramNotifier::formatNoFlowAlert(
+                    valveIndex + 1, FlowMeter::cycleLitres()));
+
+                publishStateChange("valve" + String(valveIndex), "no_flow_stop");
+                valve->phase = PHASE_CLOSING_VALVE;
+                break;
+            }
+
+            // SAFETY CHECK 4: Monitor rain sensor - ALWAYS RESPECT RAIN SENSOR
+            if (currentTime - valve->lastRainCheck >= cfg.rainCheckIntervalMs) {
                 valve->lastRainCheck = currentTime;
-                bool isRaining = readRainSensor(valveIndex);
+                bool sensorWet = readRainSensor(valveIndex);
+                bool isRaining = sensorWet || moistureSetpointReached(valveIndex);
                 valve->rainDetected = isRaining;
+                valve->moistureStopped = isRaining && !sensorWet;
 
                 // Show progress every 1 second
-                if ((currentTime - valve->wateringStartTime) % 1000 < RAIN_CHECK_INTERVAL) {
+                if ((currentTime - valve->wateringStartTime) % 1000 < cfg.rainCheckIntervalMs) {
                     int elapsed = (currentTime - valve->wateringStartTime) / 1000;
-                    int remaining = (getValveNormalTimeout(valveIndex) - (currentTime - valve->wateringStartTime)) / 1000;
-                    DebugHelper::debug("Valve " + String(valveIndex) + ": " + String(elapsed) + "s/" + String(remaining) + "s, Sensor: " + String(isRaining ? "WET" : "DRY"));
+                    int remaining = (RuntimeConfig::normalTimeout(valveIndex) - (currentTime - valve->wateringStartTime)) / 1000;
+                    DLOG_DEBUG(LOG_SYS_VALVE, "Valve " + String(valveIndex) + ": " + String(elapsed) + "s/" + String(remaining) + "s, Sensor: " + String(isRaining ? "WET" : "DRY"));
                 }
 
                 if (isRaining) {
@@ -144,7 +173,7 @@ inline void WateringSystem::processValve(int valveIndex, unsigned long currentTi
                     // a real fill (the field cause of the tray-interval runaway). A dry
                     // read in the else-branch resets the streak.
                     valve->rainWetStreak = SensorDebounce::nextWetStreak(valve->rainWetStreak, true);
-                    if (!SensorDebounce::fillConfirmed(valve->rainWetStreak, RAIN_SENSOR_CONFIRMATION_CHECKS)) {
+                    if (!SensorDebounce::fillConfirmed(valve->rainWetStreak, cfg.rainConfirmations)) {
                         break;  // not yet confirmed — keep watering, re-check next poll
                     }
 
@@ -152,7 +181,8 @@ inline void WateringSystem::processValve(int valveIndex, unsigned long currentTi
                     // Calculate FULL cycle time: from valve open to valve close
                     int totalTime = (currentTime - valve->valveOpenTime) / 1000;
                     int pumpTime = (currentTime - valve->wateringStartTime) / 1000;
-                    DebugHelper::debug("✓ Valve " + String(valveIndex) + " COMPLETE - Total: " + String(totalTime) + "s (pump: " + String(pumpTime) + "s)");
+                    DLOG_INFO(LOG_SYS_VALVE, "✓ Valve " + String(valveIndex) + " COMPLETE - Total: " + String(totalTime) + "s (pump: " + String(pumpTime) + "s)" +
+                              (sensorWet ? String() : ", moisture " + String((int)valve->moisturePercent) + "% reached setpoint"));
 
                     // Count how many valves are watering
                     int wateringCount = 0;
@@ -164,7 +194,7 @@ inline void WateringSystem::processValve(int valveIndex, unsigned long currentTi
 
                     // New logic for single valve watering
                     if (wateringCount == 1) {
-                        DebugHelper::debug("✓ Single valve watering complete. Stopping pump and closing valve.");
+                        DLOG_INFO(LOG_SYS_VALVE, "✓ Single valve watering complete. Stopping pump and closing valve.");
                         // SAFETY: Stop pump immediately and close valve
                         digitalWrite(PUMP_PIN, LOW);
                         pumpState = PUMP_OFF;
@@ -187,7 +217,7 @@ inline void WateringSystem::processValve(int valveIndex, unsigned long currentTi
 
                     if (!valve->wateringRequested) {
                         // Manual stop requested - immediately close valve and stop pump
-                        DebugHelper::debug("⚠️ Manual stop for valve " + String(valveIndex) + " - IMMEDIATE STOP");
+                        DLOG_INFO(LOG_SYS_VALVE, "⚠️ Manual stop for valve " + String(valveIndex) + " - IMMEDIATE STOP");
 
                         // SAFETY: Immediately close valve and stop pump
                         closeValve(valveIndex);
@@ -208,7 +238,7 @@ inline void WateringSystem::processValve(int valveIndex, unsigned long currentTi
                             }
                             if (!anyWateringStop) {
                                 digitalWrite(RAIN_SENSOR_POWER_PIN, LOW);
-                                DebugHelper::debug("Sensor power (GPIO 18) turned OFF - no valves watering");
+                                DLOG_DEBUG(LOG_SYS_SENSOR, "Sensor power (GPIO 18) turned OFF - no valves watering");
                             }
                         }
                     }
@@ -220,8 +250,13 @@ inline void WateringSystem::processValve(int valveIndex, unsigned long currentTi
             // Record session end for Telegram before processing learning data
             if (telegramSessionActive && sessionData[valveIndex].active) {
                 String status;
-                if (valve->timeoutOccurred) {
+                if (valve->noFlowDetected) {
+                    status = "🚱 NO FLOW";
+                } else if (valve->timeoutOccurred) {
                     status = "⚠️ TIMEOUT";
+                } else if (valve->rainDetected && valve->moistureStopped) {
+                    // Moisture probe reached the setpoint before the rain sensor
+                    status = "✓ SETPOINT";
                 } else if (valve->rainDetected && valve->wateringStartTime > 0) {
                     // Sensor became wet AFTER pump started = successful watering
                     status = "✓ OK";
@@ -249,6 +284,18 @@ inline void WateringSystem::processValve(int valveIndex, unsigned long currentTi
                 }
             }
 
+            // Volume actually delivered (pump ran only if wateringStartTime is set)
+            if (FlowMeter::present() && valve->wateringStartTime > 0) {
+                FlowMeter::update(currentTime);
+                valve->lastCycleLitres = FlowMeter::cycleLitres();
+                valve->lastFlowRateLpm = FlowMeter::rateLpm();
+                DLOG_INFO(LOG_SYS_VALVE, "💧 Valve " + String(valveIndex) + " delivered " +
+                          String(valve->lastCycleLitres, 2) + " L (" +
+                          String(valve->lastFlowRateLpm, 2) + " L/min)");
+                BLOG_INFO("Valve %d: flow %.2f L, %.2f L/min", valveIndex, valve->lastCycleLitres,
+                          valve->lastFlowRateLpm);
+            }
+
             // Process learning data for successful waterings
             processLearningData(valve, currentTime);
 
@@ -256,8 +303,8 @@ inline void WateringSystem::processValve(int valveIndex, unsigned long currentTi
             closeValve(valveIndex);
             {
                 unsigned long closeDuration = (valve->valveOpenTime > 0) ? (currentTime - valve->valveOpenTime) / 1000 : 0;
-                if (g_metricsLog) g_metricsLog("info", "Valve " + String(valveIndex) + ": closing, duration=" + String(closeDuration) + "s" + (valve->timeoutOccurred ? " TIMEOUT" : ""));
-                (void)closeDuration;
+                BLOG_INFO("Valve %d: closing, duration=%lus%s", valveIndex, closeDuration,
+                          valve->timeoutOccurred ? " TIMEOUT" : "");
             }
             valve->phase = PHASE_IDLE;
             valve->wateringRequested = false;
@@ -276,7 +323,7 @@ inline void WateringSystem::processValve(int valveIndex, unsigned long currentTi
             }
             if (!anyWatering) {
                 digitalWrite(RAIN_SENSOR_POWER_PIN, LOW);
-                DebugHelper::debug("Sensor power (GPIO 18) turned OFF - no valves watering");
+                DLOG_DEBUG(LOG_SYS_SENSOR, "Sensor power (GPIO 18) turned OFF - no valves watering");
             }
             break;
         }
@@ -298,13 +345,21 @@ inline void WateringSystem::processValve(int valveIndex, unsigned long currentTi
             }
             if (!anyWateringError) {
                 digitalWrite(RAIN_SENSOR_POWER_PIN, LOW);
-                DebugHelper::debug("Sensor power (GPIO 18) turned OFF - no valves watering");
+                DLOG_DEBUG(LOG_SYS_SENSOR, "Sensor power (GPIO 18) turned OFF - no valves watering");
             }
             break;
         }
     }
 }
 
+// A fresh moisture reading at or above the tray's setpoint counts as a wet
+// read, so it goes through the same sustained-wet confirmation. Stale or
+// missing probes (moisturePercent < 0) never end a fill.
+inline bool WateringSystem::moistureSetpointReached(int valveIndex) const {
+    return MoistureLogic::setpointReached(valves[valveIndex]->moisturePercent,
+                                          RuntimeConfig::get().moistureSetpointPct[valveIndex]);
+}
+
 // ========== State Publishing ==========
 inline void WateringSystem::publishCurrentState() {
     // Build state JSON
@@ -353,15 +408,14 @@ inline void WateringSystem::publishCurrentState() {
     stateJson += ",\"raw_state\":\"" +
                  String(overflowRawReading == LOW ? "triggered" : "dry") + "\"";
     stateJson += ",\"trigger_streak\":" + String(overflowDetectionStreak);
-    stateJson += ",\"trigger_streak_required\":" + String(OVERFLOW_CONFIRMATION_CHECKS);
+    stateJson += ",\"trigger_streak_required\":" + String(RuntimeConfig::get().overflowConfirmations);
     stateJson += "}";
 
     stateJson += ",\"plant_light\":{";
     stateJson += "\"state\":\"" + String(plantLight.isOn() ? "on" : "off") + "\"";
     stateJson += ",\"mode\":\"" + String(plantLight.getModeName()) + "\"";
     stateJson += ",\"relay_gpio\":" + String(PLANT_LIGHT_RELAY_PIN);
-    stateJson += ",\"schedule_on\":\"22:00\"";
-    stateJson += ",\"schedule_off\":\"07:00\"";
+    stateJson += ",\"schedule\":\"" + getPlantLightScheduleText() + "\"";
     stateJson += "}";
 
     stateJson += ",\"valves\":[";
@@ -374,11 +428,27 @@ inline void WateringSystem::publishCurrentState() {
         stateJson += ",\"phase\":\"" + String(phaseToString(valve->phase)) + "\"";
         stateJson += ",\"rain\":" + String(valve->rainDetected ? "true" : "false");
         stateJson += ",\"timeout\":" + String(valve->timeoutOccurred ? "true" : "false");
+        if (FlowMeter::present()) {
+            bool pumping = valve->phase == PHASE_WATERING;
+            stateJson += ",\"flow\":{";
+            stateJson += "\"rate_lpm\":" + String(pumping ? FlowMeter::rateLpm() : 0.0f, 2);
+            stateJson += ",\"cycle_l\":" + String(pumping ? FlowMeter::cycleLitres() : 0.0f, 2);
+            stateJson += ",\"last_cycle_l\":" + String(valve->lastCycleLitres, 2);
+            stateJson += ",\"no_flow\":" + String(valve->noFlowDetected ? "true" : "false");
+            stateJson += "}";
+        }
+        if (MoistureSensors::hasChannel(i)) {
+            stateJson += ",\"moisture\":{";
+            stateJson += "\"pct\":" + String((int)valve->moisturePercent);
+            stateJson += ",\"raw\":" + String(MoistureSensors::raw(i));
+            stateJson += ",\"setpoint_pct\":" + String(RuntimeConfig::get().moistureSetpointPct[i]);
+            stateJson += "}";
+        }
 
         // Add watering progress if active
         if (valve->phase == PHASE_WATERING && valve->wateringStartTime > 0) {
             unsigned long elapsed = millis() - valve->wateringStartTime;
-            int remainingSeconds = (getValveNormalTimeout(i) - elapsed) / 1000;
+            int remainingSeconds = (RuntimeConfig::normalTimeout(i) - elapsed) / 1000;
             if (remainingSeconds < 0) remainingSeconds = 0;
             stateJson += ",\"watering_seconds\":" + String(elapsed / 1000);
             stateJson += ",\"remaining_seconds\":" + String(remainingSeconds);
@@ -0,0 +1,86 @@
+#ifndef WEB_ASSET_LOGIC_H
+#define WEB_ASSET_LOGIC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Pure, hardware-free helpers for the per-file web asset update endpoints
+// (WebAssetUpdater.h), shared with the native test suite.
+//
+// Only files below WEB_ASSET_ROOT may be written or deleted. Learning data and
+// history checkpoints live in the LittleFS root, so a path check here is what
+// guarantees an asset sync can never clobber them.
+namespace WebAssetLogic {
+
+const char WEB_ASSET_ROOT[] = "/web/";
+const char WEB_ASSET_TEMP_SUFFIX[] = ".part";
+const size_t WEB_ASSET_MAX_PATH = 63;  // LittleFS name limit (LFS_NAME_MAX 64 incl. NUL)
+
+inline bool isAllowedPathChar(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '/' || c == '.' || c == '-' || c == '_';
+}
+
+inline bool endsWith(const char *s, const char *suffix) {
+  size_t n = strlen(s);
+  size_t m = strlen(suffix);
+  return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+// Accept "/web/<dir>/<file>" style paths only: fixed root, safe characters, no
+// empty or dot-only segments, no trailing slash, and never a temp file name.
+inline bool isAllowedAssetPath(const char *path) {
+  if (!path) return false;
+  size_t len = strlen(path);
+  size_t rootLen = sizeof(WEB_ASSET_ROOT) - 1;
+  if (len <= rootLen || len > WEB_ASSET_MAX_PATH - (sizeof(WEB_ASSET_TEMP_SUFFIX) - 1)) {
+    return false;
+  }
+  if (strncmp(path, WEB_ASSET_ROOT, rootLen) != 0) return false;
+  if (path[len - 1] == '/') return false;
+  if (endsWith(path, WEB_ASSET_TEMP_SUFFIX)) return false;
+
+  size_t segmentStart = 1;
+  for (size_t i = 1; i <= len; i++) {
+    char c = path[i];
+    if (c == '/' || c == '\0') {
+      size_t segLen = i - segmentStart;
+      if (segLen == 0) return false;                               // "//"
+      if (path[segmentStart] == '.') return false;                 // ".", "..", hidden
+      segmentStart = i + 1;
+      continue;
+    }
+    if (!isAllowedPathChar(c)) return false;
+  }
+  return true;
+}
+
+inline char hexDigit(uint8_t v) { return v < 10 ? '0' + v : 'a' + (v - 10); }
+
+// Lowercase hex, `out` must hold 2 * len + 1 chars.
+inline void toHex(const uint8_t *bytes, size_t len, char *out) {
+  for (size_t i = 0; i < len; i++) {
+    out[2 * i] = hexDigit(bytes[i] >> 4);
+    out[2 * i + 1] = hexDigit(bytes[i] & 0x0F);
+  }
+  out[2 * len] = '\0';
+}
+
+// Case-insensitive comparison of a hex digest string against raw bytes.
+inline bool hexMatches(const char *hex, const uint8_t *bytes, size_t len) {
+  if (!hex || strlen(hex) != 2 * len) return false;
+  char expected[65];
+  if (len > 32) return false;
+  toHex(bytes, len, expected);
+  for (size_t i = 0; i < 2 * len; i++) {
+    char c = hex[i];
+    if (c >= 'A' && c <= 'F') c = c - 'A' + 'a';
+    if (c != expected[i]) return false;
+  }
+  return true;
+}
+
+} // namespace WebAssetLogic
+
+#endif // WEB_ASSET_LOGIC_H
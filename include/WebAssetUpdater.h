@@ -0,0 +1,251 @@
+#ifndef WEB_ASSET_UPDATER_H
+#define WEB_ASSET_UPDATER_H
+
+#include <Arduino.h>
+#include <WebServer.h>
+#include <LittleFS.h>
+#include <mbedtls/sha256.h>
+#include "WebAssetLogic.h"
+#include "LoopDeadlineMonitor.h"
+#include <secret.h>
+
+extern WebServer httpServer;
+
+// ============================================
+// WebAssetUpdater - per-file web UI updates (replaces full LittleFS images)
+// Header-only static class (same pattern as DebugHelper)
+//
+//   GET  /assets/manifest                     {"files":[{"path","size","sha256"}]}
+//   POST /assets/upload?path=..&sha256=..     multipart file body
+//   POST /assets/delete?path=..
+//
+// An upload is written to "<path>.part" while hashing; only when the SHA-256
+// matches is it renamed over the live file (LittleFS replaces the target
+// atomically), so a dropped connection never leaves a half-written page.
+// Paths are restricted to /web/ (see WebAssetLogic), which keeps
+// LEARNING_DATA_FILE and other root files out of reach.
+// ============================================
+class WebAssetUpdater {
+private:
+    static File uploadFile;
+    static mbedtls_sha256_context uploadSha;
+    static String uploadPath;
+    static String uploadError;
+    static size_t uploadSize;
+    static bool uploadAccepted;
+
+    static bool isAuthorized() {
+        return httpServer.authenticate(OTA_USER, OTA_PASSWORD);
+    }
+
+    static void sendResult(int code, bool success, const String& message) {
+        String escaped = message;
+        escaped.replace("\"", "'");
+        httpServer.send(code, "application/json",
+                        "{\"success\":" + String(success ? "true" : "false") +
+                        ",\"message\":\"" + escaped + "\"}");
+    }
+
+    // Create every missing parent directory of `path`.
+    static void ensureParentDirs(const String& path) {
+        int slash = path.indexOf('/', 1);
+        while (slash > 0) {
+            String dir = path.substring(0, slash);
+            if (!LittleFS.exists(dir)) LittleFS.mkdir(dir);
+            slash = path.indexOf('/', slash + 1);
+        }
+    }
+
+    static bool hashFile(const String& path, char* hexOut, size_t& sizeOut) {
+        File f = LittleFS.open(path, "r");
+        if (!f) return false;
+        uint8_t buf[256];
+        uint8_t digest[32];
+        mbedtls_sha256_context sha;
+        mbedtls_sha256_init(&sha);
+        mbedtls_sha256_starts_ret(&sha, 0);
+        sizeOut = 0;
+        while (f.available()) {
+            size_t n = f.read(buf, sizeof(buf));
+            if (n == 0) break;
+            mbedtls_sha256_update_ret(&sha, buf, n);
+            sizeOut += n;
+        }
+        f.close();
+        mbedtls_sha256_finish_ret(&sha, digest);
+        mbedtls_sha256_free(&sha);
+        WebAssetLogic::toHex(digest, sizeof(digest), hexOut);
+        return true;
+    }
+
+    static void appendManifest(File dir, String& json, bool& first) {
+        File entry = dir.openNextFile();
+        while (entry) {
+            String path = String(entry.path());
+            if (entry.isDirectory()) {
+                appendManifest(entry, json, first);
+            } else if (!path.endsWith(WebAssetLogic::WEB_ASSET_TEMP_SUFFIX)) {
+                char hex[65];
+                size_t size = 0;
+                entry.close();
+                if (hashFile(path, hex, size)) {
+                    if (!first) json += ",";
+                    first = false;
+                    json += "{\"path\":\"" + path + "\",\"size\":" + String(size) +
+                            ",\"sha256\":\"" + String(hex) + "\"}";
+                }
+                LoopDeadlineMonitor::heartbeat(DEADLINE_TASK_NETWORK);
+            }
+            entry = dir.openNextFile();
+        }
+    }
+
+    static void resetUpload() {
+        if (uploadFile) uploadFile.close();
+        uploadPath = "";
+        uploadError = "";
+        uploadSize = 0;
+        uploadAccepted = false;
+    }
+
+    static void discardUpload() {
+        if (uploadFile) uploadFile.close();
+        if (uploadPath.length() > 0) {
+            LittleFS.remove(uploadPath + WebAssetLogic::WEB_ASSET_TEMP_SUFFIX);
+        }
+        mbedtls_sha256_free(&uploadSha);
+        uploadAccepted = false;
+    }
+
+public:
+    static void handleManifest() {
+        if (!isAuthorized()) {
+            httpServer.requestAuthentication();
+            return;
+        }
+        String json = "{\"files\":[";
+        bool first = true;
+        File root = LittleFS.open("/web");
+        if (root && root.isDirectory()) {
+            appendManifest(root, json, first);
+        }
+        json += "]}";
+        httpServer.send(200, "application/json", json);
+    }
+
+    // Streaming part of POST /assets/upload
+    static void handleUploadChunk() {
+        HTTPUpload& upload = httpServer.upload();
+        LoopDeadlineMonitor::heartbeat(DEADLINE_TASK_NETWORK);
+
+        if (upload.status == UPLOAD_FILE_START) {
+            resetUpload();
+            if (!isAuthorized()) {
+                uploadError = "unauthorized";
+                return;
+            }
+            String path = httpServer.arg("path");
+            if (!WebAssetLogic::isAllowedAssetPath(path.c_str())) {
+                uploadError = "path not allowed: " + path;
+                return;
+            }
+            uploadPath = path;
+            ensureParentDirs(path);
+            uploadFile = LittleFS.open(path + WebAssetLogic::WEB_ASSET_TEMP_SUFFIX, "w");
+            if (!uploadFile) {
+                uploadError = "cannot create temp file";
+                return;
+            }
+            mbedtls_sha256_init(&uploadSha);
+            mbedtls_sha256_starts_ret(&uploadSha, 0);
+            uploadAccepted = true;
+        } else if (upload.status == UPLOAD_FILE_WRITE) {
+            if (!uploadAccepted) return;
+            if (uploadFile.write(upload.buf, upload.currentSize) != upload.currentSize) {
+                uploadError = "write failed (filesystem full?)";
+                discardUpload();
+                return;
+            }
+            mbedtls_sha256_update_ret(&uploadSha, upload.buf, upload.currentSize);
+            uploadSize += upload.currentSize;
+        } else if (upload.status == UPLOAD_FILE_END) {
+            if (!uploadAccepted) return;
+            uploadFile.close();
+            uint8_t digest[32];
+            mbedtls_sha256_finish_ret(&uploadSha, digest);
+            mbedtls_sha256_free(&uploadSha);
+            uploadAccepted = false;
+
+            String tempPath = uploadPath + WebAssetLogic::WEB_ASSET_TEMP_SUFFIX;
+            if (!WebAssetLogic::hexMatches(httpServer.arg("sha256").c_str(), digest, sizeof(digest))) {
+                uploadError = "sha256 mismatch";
+                LittleFS.remove(tempPath);
+                return;
+            }
+            if (!LittleFS.rename(tempPath, uploadPath)) {
+                uploadError = "rename failed";
+                LittleFS.remove(tempPath);
+                return;
+            }
+            Serial.printf("✓ Web asset updated: %s (%u bytes)\n", uploadPath.c_str(), (unsigned)uploadSize);
+        } else if (upload.status == UPLOAD_FILE_ABORTED) {
+            uploadError = "upload aborted";
+            discardUpload();
+        }
+    }
+
+    // Completion part of POST /assets/upload
+    static void handleUploadDone() {
+        if (!isAuthorized()) {
+            httpServer.requestAuthentication();
+            return;
+        }
+        if (uploadError.length() > 0) {
+            sendResult(400, false, uploadError);
+        } else if (uploadPath.length() == 0) {
+            sendResult(400, false, "no file received");
+        } else {
+            sendResult(200, true, uploadPath + " (" + String(uploadSize) + " bytes)");
+        }
+        resetUpload();
+    }
+
+    static void handleDelete() {
+        if (!isAuthorized()) {
+            httpServer.requestAuthentication();
+            return;
+        }
+        String path = httpServer.arg("path");
+        if (!WebAssetLogic::isAllowedAssetPath(path.c_str())) {
+            sendResult(400, false, "path not allowed: " + path);
+            return;
+        }
+        if (!LittleFS.exists(path)) {
+            sendResult(404, false, "not found: " + path);
+            return;
+        }
+        if (!LittleFS.remove(path)) {
+            sendResult(500, false, "remove failed: " + path);
+            return;
+        }
+        sendResult(200, true, "deleted " + path);
+    }
+
+    static void registerHandlers() {
+        httpServer.on("/assets/manifest", HTTP_GET, handleManifest);
+        httpServer.on("/assets/upload", HTTP_POST, handleUploadDone, handleUploadChunk);
+        httpServer.on("/assets/delete", HTTP_POST, handleDelete);
+    }
+};
+
+// ============================================
+// Static Member Initialization
+// ============================================
+File WebAssetUpdater::uploadFile;
+mbedtls_sha256_context WebAssetUpdater::uploadSha;
+String WebAssetUpdater::uploadPath = "";
+String WebAssetUpdater::uploadError = "";
+size_t WebAssetUpdater::uploadSize = 0;
+bool WebAssetUpdater::uploadAccepted = false;
+
+#endif // WEB_ASSET_UPDATER_H
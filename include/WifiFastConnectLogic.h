@@ -0,0 +1,90 @@
+#ifndef WIFI_FAST_CONNECT_LOGIC_H
+#define WIFI_FAST_CONNECT_LOGIC_H
+
+#include <stdint.h>
+#include <string.h>
+
+// What the last good connection looked like, hardware-free. NetworkManager.h
+// keeps it in NVS and uses it for a directed first attempt: begin() with the
+// cached BSSID and channel skips the all-channel scan, and a reusable address
+// (static config, or an opted-in cached lease) skips DHCP. A failed directed
+// attempt falls back to an ordinary scanning one straight away.
+namespace WifiFastConnectLogic {
+
+static const uint32_t CACHE_VERSION = 1;
+
+struct Cache {
+  uint32_t version;
+  uint32_t ssidHash;  // Cache from another network is ignored
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint8_t valid;
+  uint32_t ip;        // Addresses as lwIP u32 (network byte order)
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+  uint32_t savedAt;   // Unix time the lease was obtained, 0 = unknown
+};
+
+inline Cache emptyCache() {
+  Cache c;
+  memset(&c, 0, sizeof(c));
+  c.version = CACHE_VERSION;
+  return c;
+}
+
+// FNV-1a, enough to notice an SSID change
+inline uint32_t ssidHash(const char *ssid) {
+  uint32_t h = 2166136261UL;
+  for (const char *p = ssid; *p; p++) {
+    h ^= (uint8_t)*p;
+    h *= 16777619UL;
+  }
+  return h;
+}
+
+inline bool usable(const Cache &c, uint32_t hash) {
+  return c.version == CACHE_VERSION && c.valid && c.ssidHash == hash && c.channel >= 1 && c.channel <= 14;
+}
+
+// Directed only for the first attempt of a boot or outage; retries scan.
+inline bool useDirected(const Cache &c, uint32_t hash, uint32_t attemptInOutage) {
+  return attemptInOutage == 1 && usable(c, hash);
+}
+
+// A cached DHCP lease is only safe to reuse as a static address when the
+// router keeps it for us (reservation) and it is recent.
+inline bool reuseLease(const Cache &c, uint32_t hash, bool enabled, uint32_t nowUnix, uint32_t maxAgeS) {
+  if (!enabled || !usable(c, hash) || c.ip == 0 || c.savedAt == 0 || nowUnix < c.savedAt) return false;
+  return nowUnix - c.savedAt <= maxAgeS;
+}
+
+inline Cache remember(uint32_t hash, const uint8_t *bssid, uint8_t channel, uint32_t ip, uint32_t gateway,
+                      uint32_t subnet, uint32_t dns, uint32_t nowUnix) {
+  Cache c = emptyCache();
+  c.ssidHash = hash;
+  memcpy(c.bssid, bssid, sizeof(c.bssid));
+  c.channel = channel;
+  c.valid = 1;
+  c.ip = ip;
+  c.gateway = gateway;
+  c.subnet = subnet;
+  c.dns = dns;
+  c.savedAt = nowUnix;
+  return c;
+}
+
+// Worth an NVS write? Same AP and lease: only refresh a lease timestamp that
+// is getting old, to keep flash writes to roughly one per refreshS.
+inline bool needsSave(const Cache &stored, const Cache &fresh, uint32_t refreshS) {
+  if (!stored.valid || stored.ssidHash != fresh.ssidHash || stored.channel != fresh.channel ||
+      memcmp(stored.bssid, fresh.bssid, sizeof(stored.bssid)) != 0 || stored.ip != fresh.ip ||
+      stored.gateway != fresh.gateway || stored.subnet != fresh.subnet || stored.dns != fresh.dns) {
+    return true;
+  }
+  return fresh.savedAt >= stored.savedAt + refreshS;
+}
+
+}  // namespace WifiFastConnectLogic
+
+#endif  // WIFI_FAST_CONNECT_LOGIC_H
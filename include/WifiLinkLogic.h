@@ -0,0 +1,251 @@
+#ifndef WIFI_LINK_LOGIC_H
+#define WIFI_LINK_LOGIC_H
+
+#include <stdint.h>
+
+// WiFi station reconnection state machine, hardware-free. NetworkManager.h
+// feeds it the ESP32 WiFi events and a tick from the network task, and
+// carries out the returned action; nothing here waits.
+//
+//   DOWN ──start──> CONNECTING ──got IP──> UP
+//                     │    ^                 │
+//     disconnect /    │    │ wait elapsed    │ disconnect / lost IP
+//     attempt timeout v    │                 v
+//                    BACKOFF <───────────────┘
+//
+// Entering BACKOFF resets the driver (radio off) so the next attempt starts
+// clean. The first wait after losing a working link is short (settleMs);
+// every failed attempt doubles the wait up to backoffMaxMs, except a failed
+// directed attempt (WifiFastConnectLogic), which is retried with a scan at once.
+//
+// Every attempt and every reset starts a new generation. The caller tags each
+// driver event with the generation it belongs to, and events of any other
+// generation (the disconnect caused by our own reset, an address for an
+// attempt that already timed out) are dropped, however late they are drained.
+namespace WifiLinkLogic {
+
+enum State { LINK_DOWN = 0, LINK_CONNECTING = 1, LINK_UP = 2, LINK_BACKOFF = 3 };
+enum Action { ACTION_NONE, ACTION_BEGIN, ACTION_RESET };
+enum EventType { EVENT_CONNECTED, EVENT_GOT_IP, EVENT_DISCONNECTED, EVENT_LOST_IP };
+
+inline const char *stateName(State s) {
+  switch (s) {
+    case LINK_CONNECTING: return "connecting";
+    case LINK_UP: return "up";
+    case LINK_BACKOFF: return "backoff";
+    default: return "down";
+  }
+}
+
+struct Config {
+  unsigned long attemptTimeoutMs;  // begin() -> got IP, else the attempt failed
+  unsigned long directedTimeoutMs; // Same for a directed (cached BSSID) attempt
+  unsigned long settleMs;          // First wait after a working link drops
+  unsigned long backoffInitialMs;
+  unsigned long backoffMaxMs;
+};
+
+struct Link {
+  State state;
+  unsigned long stateSince;
+  unsigned long waitMs;           // Current BACKOFF duration
+  unsigned long backoffMs;        // Wait after the next failed attempt
+  unsigned long downSince;        // Link lost (or first start); 0 = up
+  uint32_t attempts;              // begin() calls since boot
+  uint32_t outageAttempts;        // begin() calls in the current outage
+  uint32_t reconnects;            // Outages that ended with a working link
+  unsigned long lastConnectMs;    // begin() -> got IP of the last good attempt
+  unsigned long lastOutageMs;     // Link lost -> got IP of the last outage
+  uint32_t lastOutageAttempts;
+  uint8_t lastDisconnectReason;   // wifi_err_reason_t of the last drop
+  bool directed;                  // Current attempt uses the cached BSSID/channel (set by the caller)
+  bool lastConnectDirected;
+  unsigned long associatedAt;     // 0 until the current attempt associates
+  unsigned long lastAssocToIpMs;  // Association -> got IP of the last good attempt
+  uint32_t directedAttempts;
+  uint32_t directedFailures;
+  uint32_t generation;            // Bumped by every attempt and every reset
+};
+
+inline Link makeLink(const Config &cfg) {
+  Link l;
+  l.state = LINK_DOWN;
+  l.stateSince = 0;
+  l.waitMs = 0;
+  l.backoffMs = cfg.backoffInitialMs;
+  l.downSince = 0;
+  l.attempts = 0;
+  l.outageAttempts = 0;
+  l.reconnects = 0;
+  l.lastConnectMs = 0;
+  l.lastOutageMs = 0;
+  l.lastOutageAttempts = 0;
+  l.lastDisconnectReason = 0;
+  l.directed = false;
+  l.lastConnectDirected = false;
+  l.associatedAt = 0;
+  l.lastAssocToIpMs = 0;
+  l.directedAttempts = 0;
+  l.directedFailures = 0;
+  l.generation = 0;
+  return l;
+}
+
+inline void enter(Link &l, State s, unsigned long now) {
+  l.state = s;
+  l.stateSince = now;
+}
+
+inline Action beginAttempt(Link &l, unsigned long now) {
+  enter(l, LINK_CONNECTING, now);
+  l.generation++;
+  l.attempts++;
+  l.outageAttempts++;
+  l.directed = false;
+  l.associatedAt = 0;
+  return ACTION_BEGIN;
+}
+
+// Caller, right after ACTION_BEGIN, when it used the cached BSSID/channel
+inline void markDirected(Link &l) {
+  l.directed = true;
+  l.directedAttempts++;
+}
+
+// Radio off, then wait waitMs; whatever the old generation still reports is stale
+inline Action resetLink(Link &l, unsigned long now) {
+  enter(l, LINK_BACKOFF, now);
+  l.generation++;
+  return ACTION_RESET;
+}
+
+// A failed directed attempt only means the cache is stale: scan right away
+// without growing the backoff.
+inline Action failAttempt(Link &l, unsigned long now, const Config &cfg) {
+  if (l.directed) {
+    l.directedFailures++;
+    l.waitMs = 0;
+    return resetLink(l, now);
+  }
+  l.waitMs = l.backoffMs;
+  l.backoffMs = l.backoffMs * 2 < cfg.backoffMaxMs ? l.backoffMs * 2 : cfg.backoffMaxMs;
+  return resetLink(l, now);
+}
+
+// Boot: first attempt right away; the outage clock starts here.
+inline Action start(Link &l, unsigned long now) {
+  if (l.state != LINK_DOWN) return ACTION_NONE;
+  l.downSince = now != 0 ? now : 1;
+  return beginAttempt(l, now);
+}
+
+// `now` is when the event happened, `generation` the one it was tagged with.
+// Events of an earlier generation are stale and ignored.
+inline Action onEvent(Link &l, EventType event, uint8_t reason, uint32_t generation, unsigned long now,
+                      const Config &cfg) {
+  if (generation != l.generation) return ACTION_NONE;
+  switch (event) {
+    case EVENT_CONNECTED:
+      if (l.state == LINK_CONNECTING) l.associatedAt = now != 0 ? now : 1;
+      return ACTION_NONE;
+
+    case EVENT_GOT_IP:
+      // Only an attempt can succeed: an address arriving after its timeout
+      // reset the driver is gone again
+      if (l.state != LINK_CONNECTING) return ACTION_NONE;
+      l.lastConnectMs = now - l.stateSince;
+      l.lastAssocToIpMs = l.associatedAt != 0 ? now - l.associatedAt : 0;
+      l.lastConnectDirected = l.directed;
+      l.directed = false;
+      if (l.downSince != 0 && l.attempts > l.outageAttempts) {
+        // Attempts before this outage exist, so it is not the boot connection
+        l.reconnects++;
+        l.lastOutageMs = now - l.downSince;
+        l.lastOutageAttempts = l.outageAttempts;
+      }
+      l.downSince = 0;
+      l.outageAttempts = 0;
+      l.backoffMs = cfg.backoffInitialMs;
+      enter(l, LINK_UP, now);
+      return ACTION_NONE;
+
+    case EVENT_DISCONNECTED:
+    case EVENT_LOST_IP:
+      if (event == EVENT_DISCONNECTED) l.lastDisconnectReason = reason;
+      if (l.state == LINK_UP) {
+        l.downSince = now != 0 ? now : 1;
+        l.waitMs = cfg.settleMs;
+        return resetLink(l, now);
+      }
+      // Our own reset also reports a disconnect: only an attempt can fail
+      if (l.state == LINK_CONNECTING) return failAttempt(l, now, cfg);
+      return ACTION_NONE;
+  }
+  return ACTION_NONE;
+}
+
+inline Action tick(Link &l, unsigned long now, const Config &cfg) {
+  unsigned long inState = now - l.stateSince;
+  unsigned long timeoutMs = l.directed ? cfg.directedTimeoutMs : cfg.attemptTimeoutMs;
+  if (l.state == LINK_CONNECTING && inState >= timeoutMs) return failAttempt(l, now, cfg);
+  if (l.state == LINK_BACKOFF && inState >= l.waitMs) return beginAttempt(l, now);
+  return ACTION_NONE;
+}
+
+// Next retry in ms (0 unless waiting in BACKOFF)
+inline unsigned long retryInMs(const Link &l, unsigned long now) {
+  if (l.state != LINK_BACKOFF) return 0;
+  unsigned long inState = now - l.stateSince;
+  return inState >= l.waitMs ? 0 : l.waitMs - inState;
+}
+
+// Events arrive on the WiFi event task and are handed to the network task
+// through this ring (the caller guards push/pop with a spinlock). A full ring
+// drops the oldest entry: only the latest link transitions matter.
+struct Event {
+  EventType type;
+  uint8_t reason;
+  uint32_t generation;
+  unsigned long at;
+};
+
+static const int EVENT_QUEUE_SIZE = 8;
+
+struct EventQueue {
+  Event items[EVENT_QUEUE_SIZE];
+  int head;
+  int count;
+  uint32_t dropped;
+};
+
+inline void clear(EventQueue &q) {
+  q.head = 0;
+  q.count = 0;
+  q.dropped = 0;
+}
+
+inline void push(EventQueue &q, EventType type, uint8_t reason, uint32_t generation, unsigned long at) {
+  if (q.count == EVENT_QUEUE_SIZE) {
+    q.head = (q.head + 1) % EVENT_QUEUE_SIZE;
+    q.count--;
+    q.dropped++;
+  }
+  Event &e = q.items[(q.head + q.count) % EVENT_QUEUE_SIZE];
+  e.type = type;
+  e.reason = reason;
+  e.generation = generation;
+  e.at = at;
+  q.count++;
+}
+
+inline bool pop(EventQueue &q, Event &out) {
+  if (q.count == 0) return false;
+  out = q.items[q.head];
+  q.head = (q.head + 1) % EVENT_QUEUE_SIZE;
+  q.count--;
+  return true;
+}
+
+}  // namespace WifiLinkLogic
+
+#endif  // WIFI_LINK_LOGIC_H
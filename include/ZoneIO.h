@@ -0,0 +1,208 @@
+#ifndef ZONE_IO_H
+#define ZONE_IO_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <freertos/semphr.h>
+#include "config.h"
+#include "DebugHelper.h"
+#include "IoExpanderLogic.h"
+
+static_assert(IO_EXPANDER_PIN_BASE == IoExpanderLogic::EXPANDER_PIN_BASE,
+              "config.h EXPANDER_PIN() must match IoExpanderLogic");
+
+// ============================================
+// ZoneIO - valve / rain sensor pin access for any zone topology
+// Header-only static class (same pattern as DebugHelper)
+//
+// Drop-in for pinMode/digitalWrite/digitalRead on VALVE_PINS and
+// RAIN_SENSOR_PINS entries: ESP32 GPIOs go straight to the Arduino calls,
+// EXPANDER_PIN() entries go to an MCP23017 on the DS3231's I2C bus (Wire is
+// started by DS3231RTC::init(), before WateringSystem::init()). With no
+// expander in the profile the dispatch folds away at compile time.
+//
+// Input reads use the cached 16-bit sample of the chip while the shared INT
+// line is quiet, so the 7-sample rain debounce costs no bus traffic unless a
+// sensor actually changed. loop() reads each chip's configuration back once a
+// second and reconfigures a chip that was reset (brown-out), and LOW writes -
+// valve closes and safety stops - always go to the chip, whatever the cache
+// says. A mutex serialises expander access between the
+// control loop (Core 1) and diagnostics / GPIO re-init from Core 0.
+// ============================================
+class ZoneIO {
+private:
+    struct WireBus {
+        bool write(uint8_t address, uint8_t reg, const uint8_t* data, size_t n) {
+            Wire.beginTransmission(address);
+            Wire.write(reg);
+            Wire.write(data, n);
+            return Wire.endTransmission() == 0;
+        }
+        bool read(uint8_t address, uint8_t reg, uint8_t* data, size_t n) {
+            Wire.beginTransmission(address);
+            Wire.write(reg);
+            if (Wire.endTransmission(false) != 0) return false;
+            if (Wire.requestFrom(address, (uint8_t)n) != n) return false;
+            for (size_t i = 0; i < n; i++) data[i] = Wire.read();
+            return true;
+        }
+    };
+
+    static const int CHIP_SLOTS = IO_EXPANDER_COUNT > 0 ? IO_EXPANDER_COUNT : 1;
+    static WireBus bus;
+    static IoExpanderLogic::Chip chips[CHIP_SLOTS];
+    static SemaphoreHandle_t lock;
+    static volatile bool interruptPending;
+    static unsigned long sampledAt;
+    static unsigned long verifiedAt;
+
+    static void IRAM_ATTR onInterrupt() { interruptPending = true; }
+
+    static bool interruptsWired() { return IO_EXPANDER_INT_PIN >= 0; }
+
+    static void take() { xSemaphoreTake(lock, portMAX_DELAY); }
+    static void give() { xSemaphoreGive(lock); }
+
+    // Re-sample every input chip when INT fired or the cache is stale; a
+    // single pin read without INT wiring samples just its own chip.
+    static void refreshInputs(int chip) {
+        unsigned long now = millis();
+        if (!IoExpanderLogic::needsSample(interruptsWired(), interruptPending, sampledAt, now,
+                                          IO_EXPANDER_SAMPLE_MAX_AGE_MS)) {
+            return;
+        }
+        if (!interruptsWired()) {
+            IoExpanderLogic::sample(bus, chips[chip]);
+            return;
+        }
+        interruptPending = false;
+        for (int c = 0; c < IO_EXPANDER_COUNT; c++) {
+            if (IoExpanderLogic::hasInputs(chips[c])) IoExpanderLogic::sample(bus, chips[c]);
+        }
+        sampledAt = now;
+    }
+
+    static void reportFailure(const char* what, int pin) {
+        DLOG_EVERY(LOG_SYS_SENSOR, LOG_LEVEL_ERROR, 10000,
+                   "❌ I/O expander " + String(what) + " failed (chip " +
+                   String(IoExpanderLogic::chipOf(pin)) + ", bit " +
+                   String(IoExpanderLogic::bitOf(pin)) + ")");
+    }
+
+public:
+    // Valve lines become LOW outputs, rain sensor lines pulled-up inputs, in
+    // one configuration pass per chip (no per-pin register traffic).
+    static void init() {
+        if (IO_EXPANDER_COUNT == 0) return;
+        if (lock == NULL) lock = xSemaphoreCreateMutex();
+        Wire.setClock(IO_EXPANDER_I2C_CLOCK_HZ);
+
+        IoExpanderLogic::planChips(VALVE_PINS, RAIN_SENSOR_PINS, NUM_VALVES, chips,
+                                   IO_EXPANDER_COUNT, interruptsWired());
+
+        if (interruptsWired()) {
+            pinMode(IO_EXPANDER_INT_PIN, INPUT_PULLUP);
+            attachInterrupt(digitalPinToInterrupt(IO_EXPANDER_INT_PIN), onInterrupt, FALLING);
+        }
+        reinit();
+    }
+
+    // Rewrites every chip register from the cached state - the expander
+    // counterpart of re-running pinMode() on stuck relays.
+    static void reinit() {
+        if (IO_EXPANDER_COUNT == 0) return;
+        take();
+        for (int c = 0; c < IO_EXPANDER_COUNT; c++) {
+            if (IoExpanderLogic::configure(bus, chips[c])) {
+                DebugHelper::debug("✓ MCP23017 0x" + String(chips[c].address, HEX) +
+                                   " ready (IODIR 0x" + String(chips[c].direction, HEX) + ")");
+            } else {
+                DebugHelper::debugImportant("❌ MCP23017 0x" + String(chips[c].address, HEX) +
+                                            " not responding on I2C");
+            }
+        }
+        sampledAt = millis();
+        give();
+    }
+
+    // Control loop hook: restores chips that lost their registers.
+    static void loop(unsigned long now) {
+        if (IO_EXPANDER_COUNT == 0 || now - verifiedAt < IO_EXPANDER_VERIFY_INTERVAL_MS) return;
+        verifiedAt = now;
+        take();
+        for (int c = 0; c < IO_EXPANDER_COUNT; c++) {
+            if (IoExpanderLogic::check(bus, chips[c]) != IoExpanderLogic::CHECK_MISMATCH) continue;
+            bool ok = IoExpanderLogic::configure(bus, chips[c]);
+            DebugHelper::debugImportant("⚠️ MCP23017 0x" + String(chips[c].address, HEX) +
+                                        " lost its configuration (reset?), " +
+                                        (ok ? "restored" : "restore failed"));
+        }
+        give();
+    }
+
+    static void setMode(int pin, uint8_t mode) {
+        if (!IoExpanderLogic::isExpanderPin(pin)) {
+            pinMode(pin, mode);
+            return;
+        }
+        take();
+        bool ok = IoExpanderLogic::setMode(bus, chips[IoExpanderLogic::chipOf(pin)],
+                                           IoExpanderLogic::bitOf(pin), mode != OUTPUT,
+                                           mode == INPUT_PULLUP);
+        give();
+        if (!ok) reportFailure("pin mode", pin);
+    }
+
+    static void write(int pin, uint8_t level) {
+        if (!IoExpanderLogic::isExpanderPin(pin)) {
+            digitalWrite(pin, level);
+            return;
+        }
+        take();
+        bool ok = IoExpanderLogic::writeBit(bus, chips[IoExpanderLogic::chipOf(pin)],
+                                            IoExpanderLogic::bitOf(pin), level == HIGH,
+                                            level == LOW);  // Closing always reaches the chip
+        give();
+        if (!ok) reportFailure("write", pin);
+    }
+
+    // On a bus error the last good sample is returned.
+    static int read(int pin) {
+        if (!IoExpanderLogic::isExpanderPin(pin)) return digitalRead(pin);
+        int chip = IoExpanderLogic::chipOf(pin);
+        take();
+        uint32_t errors = chips[chip].busErrors;
+        refreshInputs(chip);
+        bool level = IoExpanderLogic::inputBit(chips[chip], IoExpanderLogic::bitOf(pin));
+        bool failed = chips[chip].busErrors != errors;
+        give();
+        if (failed) reportFailure("read", pin);
+        return level ? HIGH : LOW;
+    }
+
+    // "GPIO 8" or "MCP23017 0x21 GPB3", for logs and diagnostics.
+    static String describe(int pin) {
+        if (!IoExpanderLogic::isExpanderPin(pin)) return "GPIO " + String(pin);
+        int bit = IoExpanderLogic::bitOf(pin);
+        return "MCP23017 0x" + String(IoExpanderLogic::addressOf(IoExpanderLogic::chipOf(pin)), HEX) +
+               (bit < 8 ? " GPA" : " GPB") + String(bit % 8);
+    }
+
+    static uint32_t getBusErrors() {
+        uint32_t total = 0;
+        for (int c = 0; c < IO_EXPANDER_COUNT; c++) total += chips[c].busErrors;
+        return total;
+    }
+};
+
+// ============================================
+// Static Member Initialization
+// ============================================
+ZoneIO::WireBus ZoneIO::bus;
+IoExpanderLogic::Chip ZoneIO::chips[ZoneIO::CHIP_SLOTS];
+SemaphoreHandle_t ZoneIO::lock = NULL;
+volatile bool ZoneIO::interruptPending = false;
+unsigned long ZoneIO::sampledAt = 0;
+unsigned long ZoneIO::verifiedAt = 0;
+
+#endif // ZONE_IO_H
@@ -3,6 +3,8 @@
 
 #include <Arduino.h>
 #include <WebServer.h>
+#include "HistoryStore.h"
+#include "DebugHelper.h"
 
 // External references
 extern WebServer httpServer;
@@ -22,7 +24,7 @@ inline void handleWaterApi() {
     String valveStr = httpServer.arg("valve");
     int valve = valveStr.toInt();
 
-    if (valve < 1 || valve > 6) {
+    if (valve < 1 || valve > NUM_VALVES) {
         httpServer.send(400, "application/json", "{\"success\":false,\"message\":\"Invalid valve number\"}");
         return;
     }
@@ -42,13 +44,13 @@ inline void handleStopApi() {
 
     if (valveStr == "all") {
         Serial.println("✓ API: Stopping all valves");
-        for (int i = 0; i < 6; i++) {
+        for (int i = 0; i < NUM_VALVES; i++) {
             g_wateringSystem_ptr->stopWatering(i);
         }
         httpServer.send(200, "application/json", "{\"success\":true,\"message\":\"All watering stopped\"}");
     } else {
         int valve = valveStr.toInt();
-        if (valve < 1 || valve > 6) {
+        if (valve < 1 || valve > NUM_VALVES) {
             httpServer.send(400, "application/json", "{\"success\":false,\"message\":\"Invalid valve number\"}");
             return;
         }
@@ -68,9 +70,9 @@ inline void handleStatusApi() {
 
     if (stateJson.length() == 0) {
         stateJson = "{\"pump\":\"off\",\"valves\":[";
-        for (int i = 0; i < 6; i++) {
+        for (int i = 0; i < NUM_VALVES; i++) {
             stateJson += "{\"id\":" + String(i) + ",\"state\":\"closed\",\"phase\":\"idle\",\"rain\":false}";
-            if (i < 5) stateJson += ",";
+            if (i < NUM_VALVES - 1) stateJson += ",";
         }
         stateJson += "]}";
     }
@@ -107,6 +109,33 @@ inline void handlePlantLightApi() {
     httpServer.send(400, "application/json", "{\"success\":false,\"message\":\"Invalid action (use on, off, or auto)\"}");
 }
 
+// GET /api/lamp/schedule                                   -> current schedule
+// GET /api/lamp/schedule?windows=sunset-30..23:00,05:30..sunrise[&lat=55.75&lon=37.62]
+// Windows: HH:MM | sunrise[+-min] | sunset[+-min], up to 4, "off" for none.
+inline void handlePlantLightScheduleApi() {
+    if (!g_wateringSystem_ptr) {
+        httpServer.send(500, "application/json", "{\"success\":false,\"message\":\"System not initialized\"}");
+        return;
+    }
+
+    if (httpServer.hasArg("windows") || httpServer.hasArg("lat") || httpServer.hasArg("lon")) {
+        const LightScheduleLogic::Schedule current = g_wateringSystem_ptr->getPlantLightSchedule();
+        String windows = httpServer.hasArg("windows") ? httpServer.arg("windows")
+                                                      : g_wateringSystem_ptr->getPlantLightScheduleText();
+        float latitude = httpServer.hasArg("lat") ? httpServer.arg("lat").toFloat() : current.latitude;
+        float longitude = httpServer.hasArg("lon") ? httpServer.arg("lon").toFloat() : current.longitude;
+        if (!g_wateringSystem_ptr->setPlantLightSchedule(windows, latitude, longitude)) {
+            httpServer.send(400, "application/json",
+                            "{\"success\":false,\"message\":\"Invalid schedule: use windows=EDGE..EDGE[,...] "
+                            "with EDGE = HH:MM, sunrise[+-min] or sunset[+-min] (max 4), lat -90..90, lon -180..180\"}");
+            return;
+        }
+        Serial.println("✓ API: Plant light schedule set to " + g_wateringSystem_ptr->getPlantLightScheduleText());
+    }
+    httpServer.send(200, "application/json",
+                    "{\"success\":true,\"schedule\":" + g_wateringSystem_ptr->getPlantLightScheduleJson() + "}");
+}
+
 inline void handleStartAllApi() {
     if (!g_wateringSystem_ptr) {
         httpServer.send(500, "application/json", "{\"success\":false,\"message\":\"System not initialized\"}");
@@ -136,8 +165,8 @@ inline void handleResetCalibrationApi() {
 
     // Handle specific valve
     int valve = valveStr.toInt();
-    if (valve < 1 || valve > 6) {
-        httpServer.send(400, "application/json", "{\"success\":false,\"message\":\"Invalid valve number (use 1-6 or 'all')\"}");
+    if (valve < 1 || valve > NUM_VALVES) {
+        httpServer.send(400, "application/json", "{\"success\":false,\"message\":\"Invalid valve number (use 1-" + String(NUM_VALVES) + " or 'all')\"}");
         return;
     }
 
@@ -156,8 +185,8 @@ inline void handleSetMultiplierApi() {
     String multStr = httpServer.arg("multiplier");
 
     int valve = valveStr.toInt();
-    if (valve < 1 || valve > 6) {
-        httpServer.send(400, "application/json", "{\"success\":false,\"message\":\"Invalid valve number (use 1-6)\"}");
+    if (valve < 1 || valve > NUM_VALVES) {
+        httpServer.send(400, "application/json", "{\"success\":false,\"message\":\"Invalid valve number (use 1-" + String(NUM_VALVES) + ")\"}");
         return;
     }
 
@@ -176,4 +205,98 @@ inline void handleSetMultiplierApi() {
                         ",\"multiplier\":" + String(multiplier, 2) + "}");
 }
 
+// GET /api/history?range=<seconds>&points=<n>&series=<name,name,...>
+// Picks the finest archive covering `range` and averages rows server-side so
+// the response never exceeds `points` values per series. Gaps are null.
+inline void handleHistoryApi() {
+    if (!HistoryStore::isReady()) {
+        httpServer.send(503, "application/json", "{\"success\":false,\"message\":\"History not available\"}");
+        return;
+    }
+
+    long rangeSec = httpServer.hasArg("range") ? httpServer.arg("range").toInt() : 3600;
+    int points = httpServer.hasArg("points") ? httpServer.arg("points").toInt() : 120;
+    if (rangeSec <= 0 || points <= 0) {
+        httpServer.send(400, "application/json", "{\"success\":false,\"message\":\"range and points must be positive\"}");
+        return;
+    }
+    if (points > HISTORY_API_MAX_POINTS) points = HISTORY_API_MAX_POINTS;
+
+    // Requested series (default: all)
+    bool selected[HISTORY_SERIES_COUNT];
+    String seriesArg = httpServer.arg("series");
+    for (int s = 0; s < HISTORY_SERIES_COUNT; s++) {
+        selected[s] = seriesArg.length() == 0;
+    }
+    int start = 0;
+    while (seriesArg.length() > 0 && start <= (int)seriesArg.length()) {
+        int comma = seriesArg.indexOf(',', start);
+        if (comma < 0) comma = seriesArg.length();
+        String name = seriesArg.substring(start, comma);
+        name.trim();
+        int s = HistoryStore::seriesByName(name);
+        if (s < 0) {
+            httpServer.send(400, "application/json", "{\"success\":false,\"message\":\"Unknown series: " + name + "\"}");
+            return;
+        }
+        selected[s] = true;
+        start = comma + 1;
+    }
+
+    const HistoryStoreLogic::Archive* archives = HistoryStore::getArchives();
+    int archiveIndex = HistoryStoreLogic::chooseArchive(archives, HISTORY_ARCHIVE_COUNT, (uint32_t)rangeSec);
+    const HistoryStoreLogic::Archive& archive = archives[archiveIndex];
+    HistoryStoreLogic::DownsampleWindow window = HistoryStoreLogic::planWindow(archive, (uint32_t)rangeSec, points);
+
+    // Stream one series at a time: a full 16-series reply is tens of KB.
+    httpServer.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    httpServer.send(200, "application/json", "");
+    String chunk = "{\"success\":true";
+    chunk += ",\"resolution_s\":" + String(archive.stepSec);
+    chunk += ",\"start\":" + String(window.startEpoch);
+    chunk += ",\"step\":" + String(window.stepSec);
+    chunk += ",\"points\":" + String(window.points);
+    chunk += ",\"series\":{";
+    httpServer.sendContent(chunk);
+
+    bool first = true;
+    for (int s = 0; s < HISTORY_SERIES_COUNT; s++) {
+        if (!selected[s]) continue;
+        chunk = first ? "\"" : ",\"";
+        first = false;
+        chunk += HistoryStore::seriesName(s) + "\":[";
+        for (int p = 0; p < window.points; p++) {
+            if (p > 0) chunk += ",";
+            int16_t v = HistoryStoreLogic::downsamplePoint(archive, HISTORY_SERIES_COUNT, s, window, p);
+            chunk += HistoryStore::formatValue(s, v);
+        }
+        chunk += "]";
+        httpServer.sendContent(chunk);
+    }
+    httpServer.sendContent("}}");
+    httpServer.sendContent("");
+}
+
+// GET /api/log_level                               -> current levels
+// GET /api/log_level?subsystem=valve&level=debug   -> set (subsystem=all for every one)
+// Levels live in RAM only and reset to LOG_DEFAULT_LEVEL on reboot.
+inline void handleLogLevelApi() {
+    if (httpServer.hasArg("subsystem") || httpServer.hasArg("level")) {
+        int subsystem = LogLevelLogic::parseSubsystem(httpServer.arg("subsystem").c_str());
+        int level = LogLevelLogic::parseLevel(httpServer.arg("level").c_str());
+        if (subsystem < 0 || level < 0) {
+            httpServer.send(400, "application/json",
+                            "{\"success\":false,\"message\":\"Use subsystem=system|valve|sensor|queue|learning|network|all "
+                            "and level=debug|info|warn|error|off\"}");
+            return;
+        }
+        DebugHelper::setLogLevel(subsystem, (LogLevel)level);
+        Serial.printf("✓ API: Log level %s = %s\n",
+                      subsystem == LOG_SYS_COUNT ? "all" : LogLevelLogic::subsystemName(subsystem),
+                      LogLevelLogic::levelName(level));
+    }
+    httpServer.send(200, "application/json",
+                    "{\"success\":true,\"levels\":" + DebugHelper::getLogLevelsJson() + "}");
+}
+
 #endif // API_HANDLERS_H
@@ -63,27 +63,48 @@ const bool PLANT_LIGHT_ACTIVE_HIGH = false;
 // System time runs on local time; this offset converts to UTC for Loki/Prometheus.
 const long RTC_TIMEZONE_OFFSET_SEC = 3 * 3600;  // UTC+3
 
-const int NUM_VALVES = 6;
-const int VALVE_PINS[NUM_VALVES] = {VALVE1_PIN, VALVE2_PIN, VALVE3_PIN,
-                                    VALVE4_PIN, VALVE5_PIN, VALVE6_PIN};
-const int RAIN_SENSOR_PINS[NUM_VALVES] = {RAIN_SENSOR1_PIN, RAIN_SENSOR2_PIN,
-                                          RAIN_SENSOR3_PIN, RAIN_SENSOR4_PIN,
-                                          RAIN_SENSOR5_PIN, RAIN_SENSOR6_PIN};
-
-// ============================================
-// Timing Constants
 // ============================================
-const unsigned long RAIN_CHECK_INTERVAL = 100; // Check rain sensor every 100ms
-const unsigned long VALVE_STABILIZATION_DELAY =
-    500; // Wait 500ms for valve to open
-const unsigned long STATE_PUBLISH_INTERVAL =
-    2000;                                      // Publish state every 2 seconds
-const unsigned long MAX_WATERING_TIME = 25000; // Maximum watering time (25s) - REDUCED FOR SAFETY
-const unsigned long ABSOLUTE_SAFETY_TIMEOUT = 30000; // Absolute hard limit (30s) - EMERGENCY CUTOFF
+// I/O Expanders (MCP23017 on the DS3231 I2C bus)
+// ============================================
+// Zone tables may name expander lines instead of ESP32 GPIOs: chip c
+// (address 0x20 + c), bit b (GPA0..7 = 0..7, GPB0..7 = 8..15). ZoneIO.h
+// routes every valve/rain sensor access to the right backend; a profile
+// without expander pins never touches the bus.
+#define IO_EXPANDER_PIN_BASE 100
+#define EXPANDER_PIN(chip, bit) (IO_EXPANDER_PIN_BASE + (chip) * 16 + (bit))
+const int IO_EXPANDER_INT_PIN = 8;                 // INTA of all chips (open-drain, wired-OR); -1 = poll
+const unsigned long IO_EXPANDER_SAMPLE_MAX_AGE_MS = 1000; // Re-sample even without INT after this
+const unsigned long IO_EXPANDER_VERIFY_INTERVAL_MS = 1000; // Read registers back, reconfigure a reset chip
+const uint32_t IO_EXPANDER_I2C_CLOCK_HZ = 400000;  // MCP23017 and DS3231 both support Fast-mode
+
+// ============================================
+// Zone Topology
+// ============================================
+// Valve pins, rain sensor pins and per-valve timeouts form one compile-time
+// table set, selected with -DWATERING_ZONES=<n> in platformio.ini
+// build_flags. NUM_VALVES is derived from VALVE_PINS and sizes every
+// per-valve array and loop in the firmware, so a new profile only lists its
+// tables here. Profiles: 6 (this board, default), 1 (single-zone mini build,
+// tray 1 wiring), 16 (two MCP23017s: 0x20 drives the valve relays, 0x21 reads
+// the rain sensors, so one 2-byte read samples every sensor).
+// MOISTURE_ADC_PINS adds an optional analog moisture probe per tray (ADC1
+// only: GPIO 1-10 on the S3, ADC2 is unusable with WiFi up); -1 = none.
+#ifndef WATERING_ZONES
+#define WATERING_ZONES 6
+#endif
+
+#if WATERING_ZONES == 6
+constexpr int VALVE_PINS[] = {VALVE1_PIN, VALVE2_PIN, VALVE3_PIN,
+                              VALVE4_PIN, VALVE5_PIN, VALVE6_PIN};
+constexpr int RAIN_SENSOR_PINS[] = {RAIN_SENSOR1_PIN, RAIN_SENSOR2_PIN,
+                                    RAIN_SENSOR3_PIN, RAIN_SENSOR4_PIN,
+                                    RAIN_SENSOR5_PIN, RAIN_SENSOR6_PIN};
+// Every ADC1 pin is taken on this board (battery, I2C, pump, valves, sensors)
+constexpr int MOISTURE_ADC_PINS[] = {-1, -1, -1, -1, -1, -1};
 
 // Per-valve timeout configuration (v1.16.0)
 // Valve 0 (Tray 1) has longer timeout due to slower flow rate
-constexpr unsigned long VALVE_NORMAL_TIMEOUTS[NUM_VALVES] = {
+constexpr unsigned long VALVE_NORMAL_TIMEOUTS[] = {
     33000,  // Valve 0: 33s
     31000,  // Valve 1: 31s
     27000,  // Valve 2: 27s
@@ -93,7 +114,7 @@ constexpr unsigned long VALVE_NORMAL_TIMEOUTS[NUM_VALVES] = {
 };
 
 // Emergency timeouts: 5 seconds higher than normal (safety margin)
-constexpr unsigned long VALVE_EMERGENCY_TIMEOUTS[NUM_VALVES] = {
+constexpr unsigned long VALVE_EMERGENCY_TIMEOUTS[] = {
     38000,  // Valve 0: 38s (5s margin)
     36000,  // Valve 1: 36s (5s margin)
     32000,  // Valve 2: 32s (5s margin)
@@ -101,13 +122,128 @@ constexpr unsigned long VALVE_EMERGENCY_TIMEOUTS[NUM_VALVES] = {
     30000,  // Valve 4: 30s (5s margin)
     30000   // Valve 5: 30s (5s margin)
 };
+#elif WATERING_ZONES == 1
+constexpr int VALVE_PINS[] = {VALVE1_PIN};
+constexpr int RAIN_SENSOR_PINS[] = {RAIN_SENSOR1_PIN};
+constexpr int MOISTURE_ADC_PINS[] = {9};  // Free: rain sensor 2 is not wired
+constexpr unsigned long VALVE_NORMAL_TIMEOUTS[] = {33000};
+constexpr unsigned long VALVE_EMERGENCY_TIMEOUTS[] = {38000};
+#elif WATERING_ZONES == 16
+constexpr int VALVE_PINS[] = {
+    EXPANDER_PIN(0, 0),  EXPANDER_PIN(0, 1),  EXPANDER_PIN(0, 2),  EXPANDER_PIN(0, 3),
+    EXPANDER_PIN(0, 4),  EXPANDER_PIN(0, 5),  EXPANDER_PIN(0, 6),  EXPANDER_PIN(0, 7),
+    EXPANDER_PIN(0, 8),  EXPANDER_PIN(0, 9),  EXPANDER_PIN(0, 10), EXPANDER_PIN(0, 11),
+    EXPANDER_PIN(0, 12), EXPANDER_PIN(0, 13), EXPANDER_PIN(0, 14), EXPANDER_PIN(0, 15)};
+constexpr int RAIN_SENSOR_PINS[] = {
+    EXPANDER_PIN(1, 0),  EXPANDER_PIN(1, 1),  EXPANDER_PIN(1, 2),  EXPANDER_PIN(1, 3),
+    EXPANDER_PIN(1, 4),  EXPANDER_PIN(1, 5),  EXPANDER_PIN(1, 6),  EXPANDER_PIN(1, 7),
+    EXPANDER_PIN(1, 8),  EXPANDER_PIN(1, 9),  EXPANDER_PIN(1, 10), EXPANDER_PIN(1, 11),
+    EXPANDER_PIN(1, 12), EXPANDER_PIN(1, 13), EXPANDER_PIN(1, 14), EXPANDER_PIN(1, 15)};
+// ADC1 pins freed by moving valves/sensors to the expanders (8 is the INT line)
+constexpr int MOISTURE_ADC_PINS[] = {5, 6, 7, 9, 10, -1, -1, -1,
+                                     -1, -1, -1, -1, -1, -1, -1, -1};
+constexpr unsigned long VALVE_NORMAL_TIMEOUTS[] = {
+    25000, 25000, 25000, 25000, 25000, 25000, 25000, 25000,
+    25000, 25000, 25000, 25000, 25000, 25000, 25000, 25000};
+constexpr unsigned long VALVE_EMERGENCY_TIMEOUTS[] = {
+    30000, 30000, 30000, 30000, 30000, 30000, 30000, 30000,
+    30000, 30000, 30000, 30000, 30000, 30000, 30000, 30000};
+#else
+#error "No zone topology for this WATERING_ZONES value - add one to config.h"
+#endif
+
+constexpr int NUM_VALVES = sizeof(VALVE_PINS) / sizeof(VALVE_PINS[0]);
+
+// Expanders in use: highest chip index named by the zone tables, plus one
+constexpr int expanderChipsFor(int pin) {
+    return pin >= IO_EXPANDER_PIN_BASE ? (pin - IO_EXPANDER_PIN_BASE) / 16 + 1 : 0;
+}
+constexpr int expanderChipsIn(const int *pins, int i) {
+    return i >= NUM_VALVES ? 0
+         : expanderChipsFor(pins[i]) > expanderChipsIn(pins, i + 1) ? expanderChipsFor(pins[i])
+                                                                    : expanderChipsIn(pins, i + 1);
+}
+constexpr int IO_EXPANDER_COUNT =
+    expanderChipsIn(VALVE_PINS, 0) > expanderChipsIn(RAIN_SENSOR_PINS, 0)
+        ? expanderChipsIn(VALVE_PINS, 0) : expanderChipsIn(RAIN_SENSOR_PINS, 0);
+
+// ============================================
+// Analog Moisture Sensing
+// ============================================
+// Trays with a MOISTURE_ADC_PINS entry are sampled from the Core 0 network
+// task: a burst of MOISTURE_OVERSAMPLE reads, trimmed mean, then a Q8 IIR
+// filter (time constant ~2^MOISTURE_IIR_SHIFT samples). The setpoint and the
+// dry/wet calibration points are per-tray runtime config; a setpoint of 0
+// leaves the fill to the rain sensor alone. Timeouts stay the safety stop.
+const int MOISTURE_OVERSAMPLE = 16;
+const unsigned long MOISTURE_SAMPLE_INTERVAL_MS = 200;
+const int MOISTURE_IIR_SHIFT = 3;                       // ~1.6s at 200ms sampling
+const unsigned long MOISTURE_STALE_MS = 2000;           // Older readings are ignored
+const float MOISTURE_LEVEL_CORRECTION_WEIGHT = 0.8f;    // Measured vs time-estimated level
+const uint32_t MOISTURE_DEFAULT_SETPOINT_PCT = 0;       // 0 = rain sensor only
+const uint32_t MOISTURE_DEFAULT_DRY_RAW = 3000;         // Capacitive v1.2 probe in air
+const uint32_t MOISTURE_DEFAULT_WET_RAW = 1300;         // Same probe in water
+
+// ============================================
+// Flow Meter (hall-effect sensor on the pump line)
+// ============================================
+// Counted by the PCNT peripheral (no interrupts, no CPU per pulse). Pulses
+// during PHASE_WATERING belong to the active valve. With no pulse for
+// FLOW_NO_FLOW_TIMEOUT_MS after the priming grace the fill stops (dry pump /
+// blocked line) instead of running into the valve timeout. -1 = not fitted.
+const int FLOW_METER_PIN = -1;                        // e.g. 40 (free, 5V-tolerant via divider)
+const float FLOW_METER_PULSES_PER_LITRE = 450.0f;     // YF-S201: F[Hz] = 7.5 * Q[L/min]
+const unsigned long FLOW_RATE_WINDOW_MS = 1000;
+const unsigned long FLOW_PRIME_GRACE_MS = 1500;       // Pump start to water at the meter
+const unsigned long FLOW_NO_FLOW_TIMEOUT_MS = 1000;
+
+// ============================================
+// Power Management (idle mode, DFS / light sleep, WiFi modem sleep)
+// ============================================
+// With nothing to water for POWER_IDLE_ENTER_MS the control loop drops from
+// 100Hz to POWER_IDLE_LOOP_PERIOD_MS and releases its CPU-frequency / no-
+// light-sleep lock. Overflow and tank level pin changes wake it at once.
+// Automatic light sleep additionally needs CONFIG_FREERTOS_USE_TICKLESS_IDLE
+// in the sdkconfig; without it idle runs at POWER_CPU_MIN_MHZ (DFS).
+const bool POWER_MANAGEMENT_ENABLED = true;
+const unsigned long POWER_IDLE_ENTER_MS = 30000;      // Quiet time before idle
+const unsigned long POWER_ACTIVE_LOOP_PERIOD_MS = 10; // 100Hz while watering
+const unsigned long POWER_IDLE_LOOP_PERIOD_MS = 250;  // Also bounds one light-sleep stretch
+const unsigned long POWER_ACTIVE_NET_POLL_MS = 100;
+const unsigned long POWER_IDLE_NET_POLL_MS = 250;
+const int POWER_CPU_MAX_MHZ = 240;
+const int POWER_CPU_MIN_MHZ = 80;                     // Lowest with WiFi up
+const bool POWER_LIGHT_SLEEP = true;
+// WiFi: full power while a client is talking to us, DTIM modem sleep after
+// WIFI_PS_TRAFFIC_HOLD_MS, listen-interval sleep after WIFI_PS_DEEP_AFTER_MS.
+const unsigned long WIFI_PS_TRAFFIC_HOLD_MS = 5000;
+const unsigned long WIFI_PS_DEEP_AFTER_MS = 60000;
+// Current model for the estimate in metrics (mA at 5V in). Typical ESP32-S3
+// module figures: replace with USB-meter readings from this board.
+const float POWER_MODEL_CPU_ACTIVE_MA = 45.0f;
+const float POWER_MODEL_CPU_IDLE_MA = 12.0f;
+const float POWER_MODEL_WIFI_NONE_MA = 80.0f;
+const float POWER_MODEL_WIFI_MIN_MODEM_MA = 22.0f;
+const float POWER_MODEL_WIFI_MAX_MODEM_MA = 9.0f;
+
+// ============================================
+// Timing Constants
+// ============================================
+const unsigned long RAIN_CHECK_INTERVAL = 100; // Check rain sensor every 100ms
+const unsigned long VALVE_STABILIZATION_DELAY =
+    500; // Wait 500ms for valve to open
+const unsigned long STATE_PUBLISH_INTERVAL =
+    2000;                                      // Publish state every 2 seconds
+const unsigned long MAX_WATERING_TIME = 25000; // Maximum watering time (25s) - REDUCED FOR SAFETY
+const unsigned long ABSOLUTE_SAFETY_TIMEOUT = 30000; // Absolute hard limit (30s) - EMERGENCY CUTOFF
 
 // Universal inter-valve gap — pause between finishing one valve and starting
 // the next queued valve. Gives the pump pressure and sensors time to settle so
 // every cycle sees the same flow rate (required for stable learning baselines).
 const unsigned long INTER_VALVE_GAP_MS = 30000;  // 30 seconds
 
-// Helper functions for safe timeout access
+// Helper functions for safe timeout access (compiled defaults; the firmware
+// reads the live values through RuntimeConfig::normalTimeout()/emergencyTimeout())
 inline unsigned long getValveNormalTimeout(int valveIndex) {
     if (valveIndex < 0 || valveIndex >= NUM_VALVES) {
         return MAX_WATERING_TIME;  // Fallback to global default
@@ -127,11 +263,16 @@ const unsigned long WATER_LEVEL_CHECK_INTERVAL = 100; // Check water level every
 const unsigned long WATER_LEVEL_LOW_DELAY = 11000; // Wait 11 seconds after detecting low water before blocking (allows watering to continue finishing cycle)
 const unsigned long PLANT_LIGHT_SCHEDULE_CHECK_INTERVAL_MS = 1000; // Check lamp schedule every second
 
-// Plant light schedule (local RTC/system time)
+// Plant light schedule (local RTC/system time). Default only: windows and
+// sunrise/sunset rules set through /api/lamp/schedule replace it and are kept
+// in PLANT_LIGHT_SCHEDULE_FILE.
 const int PLANT_LIGHT_SCHEDULE_ON_HOUR = 22;
 const int PLANT_LIGHT_SCHEDULE_ON_MINUTE = 0;
 const int PLANT_LIGHT_SCHEDULE_OFF_HOUR = 7;
 const int PLANT_LIGHT_SCHEDULE_OFF_MINUTE = 0;
+const float PLANT_LIGHT_LATITUDE = 55.75f;   // Sunrise/sunset anchors (Moscow)
+const float PLANT_LIGHT_LONGITUDE = 37.62f;
+const char *PLANT_LIGHT_SCHEDULE_FILE = "/light_schedule.json";
 
 // ============================================
 // Overflow Sensor Debouncing Constants
@@ -206,6 +347,11 @@ const float BATTERY_VOLTAGE_CALIBRATION = 1.0695;
 #define IS_DEBUG_TO_SERIAL_ENABLED false
 #define IS_DEBUG_TO_TELEGRAM_ENABLED true
 
+// Startup level for every DLOG_* subsystem (see LogLevelLogic.h).
+// 0=debug, 1=info, 2=warn, 3=error, 4=off. Change at runtime with
+// /api/log_level or the /log_level Telegram command (not persisted).
+const int LOG_DEFAULT_LEVEL = 1;
+
 // ============================================
 // Telegram Queue Configuration
 // ============================================
@@ -259,6 +405,111 @@ const unsigned long METRICS_PUSH_INTERVAL_ACTIVE_MS = 10000;  // 10s when wateri
 const unsigned long METRICS_PUSH_INTERVAL_IDLE_MS = 60000;    // 60s when idle
 const int METRICS_LOG_BUFFER_SIZE = 64;                        // Circular log buffer entries
 const unsigned long METRICS_HTTP_TIMEOUT_MS = 4000;            // HTTP timeout for proxy
+// Binary push (MetricsWireFormat.h): varint frames, deltas against the last
+// acknowledged push. Proxies without /v1/metrics/push-binary get JSON.
+const bool METRICS_BINARY_PUSH = true;
+// Full frame incl. schema ~1.3 KB + ~45 B per valve + ~30 B per deadline miss counter (up to 38)
+const size_t METRICS_WIRE_BUFFER_SIZE = 2560 + 128 * NUM_VALVES;
+// Upload compression (GzipLogic.h): bodies this large or larger are sent with
+// Content-Encoding: gzip. Proxies answering 400/415 get plain bodies.
+const bool UPLOAD_GZIP = true;
+const size_t UPLOAD_GZIP_MIN_BYTES = 256;                      // Below this, headers dominate
+
+// ============================================
+// DNS Cache (outbound Telegram / metrics proxy hosts)
+// ============================================
+// TTLs from the answer are clamped to [MIN, MAX]; entries are refreshed in the
+// background DNS_CACHE_PREFETCH_MS before expiry and served stale (last-known
+// IP) for up to DNS_CACHE_STALE_MAX_S while the resolver is unreachable.
+const int DNS_CACHE_SIZE = 4;                        // Telegram, proxy, spare
+const uint32_t DNS_CACHE_MIN_TTL_S = 30;
+const uint32_t DNS_CACHE_MAX_TTL_S = 3600;
+const unsigned long DNS_CACHE_PREFETCH_MS = 15000;   // < MIN_TTL
+const uint32_t DNS_CACHE_STALE_MAX_S = 86400;
+const unsigned long DNS_QUERY_TIMEOUT_MS = 800;      // One UDP round trip
+const unsigned long DNS_RETRY_BASE_MS = 5000;        // Failed refresh backoff
+const unsigned long DNS_RETRY_MAX_MS = 300000;
+
+// ============================================
+// Binary Log Ring (BLOG_* macros -> /v1/logs/push-binary)
+// ============================================
+// Records hold a format-string ID plus raw arguments; text is produced on the
+// host. Oldest records are overwritten when the ring is full.
+const uint32_t BINARY_LOG_RING_BYTES = 4096;  // ~250 typical records
+const int BINARY_LOG_MAX_FORMATS = 96;        // Format IDs remembered as known to the proxy
+
+// ============================================
+// Task Deadline Monitor
+// ============================================
+// Soft deadline: a pass slower than this is counted as a miss against its
+// slowest stage. Hard deadline: a task silent for longer gets a GPIO safe
+// shutdown (pump + valves LOW) and a restart, triggered by the peer task.
+const unsigned long CONTROL_LOOP_SOFT_DEADLINE_MS = 250;     // 10ms delay + sensor sampling + occasional flash write
+const unsigned long CONTROL_LOOP_HARD_DEADLINE_MS = 5000;    // Well below the shortest valve timeout (25s)
+const unsigned long NETWORK_TASK_SOFT_DEADLINE_MS = 5000;    // One HTTP call (4s timeout) per pass
+const unsigned long NETWORK_TASK_HARD_DEADLINE_MS = 60000;   // Several chained HTTP timeouts + WiFi retry
+const uint32_t TASK_WDT_TIMEOUT_S = 75;                      // IDF task watchdog backstop (> every hard deadline)
+const unsigned long DEADLINE_MISS_LOG_INTERVAL_MS = 10000;   // Rate limit for soft-miss log lines
+
+// ============================================
+// On-device History (round-robin archives in PSRAM)
+// ============================================
+// One sample every 10s feeds three archives (finest first). Sizes are rows per
+// archive; each row holds HISTORY_SERIES_COUNT int16 values (~150KB total).
+const unsigned long HISTORY_SAMPLE_INTERVAL_MS = 10000;       // Primary sample period
+const int HISTORY_ARCHIVE_COUNT = 3;
+const uint32_t HISTORY_ARCHIVE_STEP_SEC[HISTORY_ARCHIVE_COUNT] = {10, 60, 900};
+const uint16_t HISTORY_ARCHIVE_ROWS[HISTORY_ARCHIVE_COUNT] = {
+    360,   // 10s  x 360  = 1 hour
+    1440,  // 1min x 1440 = 1 day
+    2880   // 15min x 2880 = 30 days
+};
+const unsigned long HISTORY_CHECKPOINT_INTERVAL_MS = 3600000;  // LittleFS checkpoint every hour
+const char *HISTORY_CHECKPOINT_FILE = "/history.rrd";
+const char *HISTORY_CHECKPOINT_TMP_FILE = "/history.rrd.tmp";
+const int HISTORY_API_MAX_POINTS = 360;                        // Upper bound for /api/history?points=
+
+// ============================================
+// OTA Upload Pipeline
+// ============================================
+// The HTTP upload callback only copies chunks into a ring of buffers; a
+// separate writer task hashes them and writes them to flash, so TCP receive
+// keeps going while a sector is being erased.
+const int OTA_PIPELINE_BUFFER_COUNT = 4;                      // Ring depth (one being filled, rest in flight)
+const uint32_t OTA_PIPELINE_BUFFER_SIZE = 4096;               // One flash sector per buffer
+const uint32_t OTA_WRITER_TASK_STACK = 6144;                  // Update.write + delta decoder + SHA-256
+const int OTA_WRITER_TASK_PRIORITY = 2;                       // Above the network task, same core (0)
+const unsigned long OTA_PIPELINE_STALL_TIMEOUT_MS = 15000;    // Writer holding every buffer this long = failed
+const unsigned long OTA_PROGRESS_LOG_INTERVAL_MS = 2000;      // Progress line rate limit during an upload
+
+// ============================================
+// Sampling CPU Profiler (/profiler/*, OTA credentials)
+// ============================================
+// One hardware timer per core samples the interrupted PC (plus a shallow
+// backtrace) into PSRAM. 16384 samples x 40 bytes = 640KB, allocated on the
+// first run; at the default rate that is ~30s of both cores.
+const uint8_t PROFILER_TIMER_NUM[2] = {2, 3};                 // Group 1 timers, one per core
+const uint32_t PROFILER_DEFAULT_HZ = 250;
+const uint32_t PROFILER_MAX_HZ = 2000;
+const uint32_t PROFILER_MAX_SAMPLES = 16384;
+const uint32_t PROFILER_MAX_DURATION_S = 120;
+
+// ============================================
+// Chrome Trace Export (/trace/*, OTA credentials)
+// ============================================
+// Valve phases, pump, sensor polls, HTTP requests, Telegram sends and flash
+// writes, timestamped in microseconds on both cores. 24 bytes per event in
+// PSRAM; 8192 events hold several full watering cycles.
+const uint32_t TRACE_RING_EVENTS = 8192;
+const uint32_t TRACE_HTTP_MIN_US = 500;      // Drop handleClient() passes that served nothing
+
+// ============================================
+// Runtime Configuration (/api/config, OTA credentials)
+// ============================================
+// Timeouts, gap, debounce counts and push intervals above are the defaults;
+// overrides live in NVS and are applied without a reboot (RuntimeConfig.h).
+// The plant-light schedule has its own API (/api/lamp/schedule).
+const char *RUNTIME_CONFIG_NVS_NAMESPACE = "runtime_cfg";
 
 // ============================================
 // Serial Configuration
@@ -269,40 +520,84 @@ const unsigned long METRICS_HTTP_TIMEOUT_MS = 4000;            // HTTP timeout f
 // ============================================
 // WiFi Configuration
 // ============================================
-const int WIFI_MAX_RETRY_ATTEMPTS = 30;
-const int WIFI_RETRY_DELAY_MS = 500;
-
-// WiFi reconnection backoff (v1.17.3)
-const unsigned long WIFI_RECONNECT_BACKOFF_INITIAL_MS = 5000;   // Start with 5s between attempts
+// Event-driven reconnection (WifiLinkLogic.h): nothing waits for association
+const unsigned long WIFI_CONNECT_ATTEMPT_TIMEOUT_MS = 15000;    // begin() -> got IP, else reset and back off
+const unsigned long WIFI_DIRECTED_ATTEMPT_TIMEOUT_MS = 3000;    // Same with cached BSSID/channel, then scan
+const unsigned long WIFI_RECONNECT_SETTLE_MS = 250;             // First retry after a working link drops
+const unsigned long WIFI_RECONNECT_BACKOFF_INITIAL_MS = 5000;   // Wait after the first failed attempt
 const unsigned long WIFI_RECONNECT_BACKOFF_MAX_MS = 300000;     // Cap at 5 minutes
-const int WIFI_RECONNECT_MAX_ATTEMPTS = 5;                      // 5 retries per attempt (2.5s blocking)
+const unsigned long WIFI_BOOT_CONNECT_WAIT_MS = 15000;          // setup() only: link for the boot countdown
 const unsigned long WIFI_OUTAGE_NOTIFY_THRESHOLD_MS = 60000;    // 1 min before Telegram notification
 
+// Fast reconnect: last AP (BSSID/channel) and lease cached in NVS
+#define WIFI_CACHE_NVS_NAMESPACE "wifi_cache"
+const uint32_t WIFI_CACHE_REFRESH_S = 6 * 3600;                 // Re-save an unchanged lease at most this often
+// Reuse the cached DHCP address without asking DHCP. Only safe with a DHCP
+// reservation for this board on the router.
+const bool WIFI_REUSE_DHCP_LEASE = false;
+const uint32_t WIFI_LEASE_REUSE_MAX_AGE_S = 12 * 3600;
+// Optional static address (skips DHCP every time). Empty = DHCP.
+const char *WIFI_STATIC_IP = "";
+const char *WIFI_STATIC_GATEWAY = "";
+const char *WIFI_STATIC_SUBNET = "255.255.255.0";
+const char *WIFI_STATIC_DNS = "";
+
 // ============================================
 // OTA Configuration
 // ============================================
 const char *OTA_HOSTNAME = "esp32-watering";
 
 // ============================================
-// Compile-time Timeout Validation
+// Compile-time Topology Validation
 // ============================================
-// Ensures safety invariants: emergency timeout must be at least 5s higher than normal
+// Ensures the zone tables agree and the safety invariant holds for every
+// valve: emergency timeout must be at least 5s higher than normal.
 // Skipped in native tests where TestConfig.h uses static const (not constexpr)
 #ifndef NATIVE_TEST
-#define VALIDATE_TIMEOUT(idx) \
-    static_assert(VALVE_EMERGENCY_TIMEOUTS[idx] >= VALVE_NORMAL_TIMEOUTS[idx] + 5000, \
-        "Emergency timeout must be at least 5s higher than normal for valve " #idx)
+constexpr bool timeoutMarginsValid(int i) {
+    return i >= NUM_VALVES ||
+           (VALVE_EMERGENCY_TIMEOUTS[i] >= VALVE_NORMAL_TIMEOUTS[i] + 5000 &&
+            timeoutMarginsValid(i + 1));
+}
+
+constexpr bool valvePinsDistinct(int i, int j) {
+    return i >= NUM_VALVES ||
+           (j >= NUM_VALVES ? valvePinsDistinct(i + 1, i + 2)
+                            : VALVE_PINS[i] != VALVE_PINS[j] && valvePinsDistinct(i, j + 1));
+}
 
-VALIDATE_TIMEOUT(0);
-VALIDATE_TIMEOUT(1);
-VALIDATE_TIMEOUT(2);
-VALIDATE_TIMEOUT(3);
-VALIDATE_TIMEOUT(4);
-VALIDATE_TIMEOUT(5);
+constexpr bool moisturePinsOnAdc1(int i) {
+    return i >= NUM_VALVES ||
+           ((MOISTURE_ADC_PINS[i] == -1 || (MOISTURE_ADC_PINS[i] >= 1 && MOISTURE_ADC_PINS[i] <= 10)) &&
+            moisturePinsOnAdc1(i + 1));
+}
 
-#undef VALIDATE_TIMEOUT
+constexpr bool noFlowStopsBeforeTimeout(int i) {
+    return i >= NUM_VALVES ||
+           (FLOW_PRIME_GRACE_MS + FLOW_NO_FLOW_TIMEOUT_MS < VALVE_NORMAL_TIMEOUTS[i] &&
+            noFlowStopsBeforeTimeout(i + 1));
+}
 
-static_assert(NUM_VALVES == 6, "Timeout arrays must match NUM_VALVES");
+static_assert(NUM_VALVES == WATERING_ZONES, "VALVE_PINS must list WATERING_ZONES pins");
+static_assert(sizeof(RAIN_SENSOR_PINS) / sizeof(RAIN_SENSOR_PINS[0]) == NUM_VALVES,
+              "RAIN_SENSOR_PINS must match NUM_VALVES");
+static_assert(sizeof(VALVE_NORMAL_TIMEOUTS) / sizeof(VALVE_NORMAL_TIMEOUTS[0]) == NUM_VALVES,
+              "Timeout arrays must match NUM_VALVES");
+static_assert(sizeof(VALVE_EMERGENCY_TIMEOUTS) / sizeof(VALVE_EMERGENCY_TIMEOUTS[0]) == NUM_VALVES,
+              "Timeout arrays must match NUM_VALVES");
+static_assert(timeoutMarginsValid(0),
+              "Emergency timeout must be at least 5s higher than normal for every valve");
+static_assert(valvePinsDistinct(0, 1), "Two valves share a GPIO");
+static_assert(sizeof(MOISTURE_ADC_PINS) / sizeof(MOISTURE_ADC_PINS[0]) == NUM_VALVES,
+              "MOISTURE_ADC_PINS must match NUM_VALVES");
+static_assert(moisturePinsOnAdc1(0), "Moisture probes must be on ADC1 (GPIO 1-10) or -1");
+static_assert(noFlowStopsBeforeTimeout(0),
+              "Flow meter priming grace + no-flow timeout must be shorter than every valve timeout");
+static_assert(DNS_CACHE_PREFETCH_MS < DNS_CACHE_MIN_TTL_S * 1000UL,
+              "DNS prefetch window must be shorter than the shortest cached TTL");
+static_assert(POWER_IDLE_LOOP_PERIOD_MS < CONTROL_LOOP_HARD_DEADLINE_MS,
+              "Idle control loop must still check in before its hard deadline");
+static_assert(IO_EXPANDER_COUNT <= 8, "MCP23017 addresses 0x20-0x27 allow at most 8 expanders");
 #endif // !NATIVE_TEST
 
 #endif // CONFIG_H
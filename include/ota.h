@@ -9,6 +9,13 @@
 #include <Update.h>
 #include <LittleFS.h>
 #include "config.h"
+#include "LoopDeadlineMonitor.h"
+#include "HistoryStore.h"
+#include "DeltaOtaUpdater.h"
+#include "OtaPipeline.h"
+#include "WebAssetUpdater.h"
+#include "CpuProfiler.h"
+#include "TraceRecorder.h"
 #include <secret.h>
 
 // OTA configuration (hostname now in config.h)
@@ -24,6 +31,11 @@ class WateringSystem;
 // Global pointer - will be set by main.cpp
 WateringSystem* g_wateringSystem_ptr = nullptr;
 
+// Firmware/filesystem upload state (set by the upload callback, read by the completion handler)
+bool firmwareUploadStarted = false;
+bool firmwareUploadIsDelta = false;
+bool firmwareUploadFailed = false;
+
 // Forward declarations of functions
 void setupOta();
 void loopOta();
@@ -210,32 +222,57 @@ void setupOta() {
     httpServer.send(200, "text/html", firmwarePage);
   });
 
-  // Handle firmware upload
+  // Handle firmware upload. Accepts either a full image or a delta patch
+  // (tools/make_delta_patch.py), detected from the first bytes of the upload.
+  // A rejected patch answers 409 and leaves the running firmware untouched so
+  // the client can fall back to the full image. Flash writes run in the
+  // OtaPipeline writer task; an optional ?sha256= is checked over the upload.
   httpServer.on("/firmware", HTTP_POST, []() {
     if (!checkAuth()) return;
+    if (!firmwareUploadStarted || firmwareUploadFailed) {
+      String reason = !firmwareUploadStarted ? String("no data received")
+                      : OtaPipeline::getLastError();
+      int code = firmwareUploadIsDelta ? 409 : 500;
+      httpServer.send(code, "text/plain", "Update failed: " + reason +
+                      (firmwareUploadIsDelta ? " - upload the full firmware image instead" : ""));
+      return;
+    }
     httpServer.send(200, "text/html", updateSuccessPage);
+    // Keep the history written since the last hourly checkpoint
+    HistoryStore::checkpoint();
     delay(1000);
     ESP.restart();
   }, []() {
     HTTPUpload& upload = httpServer.upload();
+    // The whole upload runs inside one handleClient() call - keep the network
+    // task's deadline alive per chunk.
+    LoopDeadlineMonitor::heartbeat(DEADLINE_TASK_NETWORK);
 
     if (upload.status == UPLOAD_FILE_START) {
       Serial.printf("Firmware update: %s\n", upload.filename.c_str());
-      if (!Update.begin(UPDATE_SIZE_UNKNOWN, U_FLASH)) {
-        Update.printError(Serial);
-      }
+      firmwareUploadStarted = false;
+      firmwareUploadIsDelta = false;
+      firmwareUploadFailed = false;
     } else if (upload.status == UPLOAD_FILE_WRITE) {
-      if (Update.write(upload.buf, upload.currentSize) != upload.currentSize) {
-        Update.printError(Serial);
-      } else {
-        Serial.printf("Progress: %d%%\r", (Update.progress() * 100) / Update.size());
+      if (firmwareUploadFailed) return;
+
+      // Decide full image vs delta patch on the first chunk
+      if (!firmwareUploadStarted) {
+        firmwareUploadStarted = true;
+        firmwareUploadIsDelta = DeltaOtaUpdater::isPatch(upload.buf, upload.currentSize);
+        OtaTarget target = firmwareUploadIsDelta ? OTA_TARGET_DELTA : OTA_TARGET_FIRMWARE;
+        if (!OtaPipeline::begin(target, httpServer.clientContentLength())) {
+          firmwareUploadFailed = true;
+          return;
+        }
       }
+      firmwareUploadFailed = !OtaPipeline::push(upload.buf, upload.currentSize);
     } else if (upload.status == UPLOAD_FILE_END) {
-      if (Update.end(true)) {
-        Serial.printf("\nFirmware update success: %u bytes\n", upload.totalSize);
-      } else {
-        Update.printError(Serial);
-      }
+      if (!firmwareUploadStarted || firmwareUploadFailed) return;
+      firmwareUploadFailed = !OtaPipeline::finish(httpServer.arg("sha256"));
+    } else if (upload.status == UPLOAD_FILE_ABORTED) {
+      OtaPipeline::abort();
+      firmwareUploadFailed = true;
     }
   });
 
@@ -243,39 +280,63 @@ void setupOta() {
   // LittleFS is unmounted at UPLOAD_FILE_START so the flash write is safe.
   httpServer.on("/filesystem", HTTP_POST, []() {
     if (!checkAuth()) return;
+    if (!firmwareUploadStarted || firmwareUploadFailed) {
+      String reason = !firmwareUploadStarted ? String("no data received")
+                      : OtaPipeline::getLastError();
+      httpServer.send(500, "text/plain", "Update failed: " + reason);
+      return;
+    }
     httpServer.send(200, "text/html", updateSuccessPage);
     delay(1000);
     ESP.restart();
   }, []() {
     HTTPUpload& upload = httpServer.upload();
+    // The whole upload runs inside one handleClient() call - keep the network
+    // task's deadline alive per chunk.
+    LoopDeadlineMonitor::heartbeat(DEADLINE_TASK_NETWORK);
 
     if (upload.status == UPLOAD_FILE_START) {
       Serial.printf("Filesystem update: %s\n", upload.filename.c_str());
       LittleFS.end();
-      if (!Update.begin(UPDATE_SIZE_UNKNOWN, U_SPIFFS)) {
-        Update.printError(Serial);
-      }
+      firmwareUploadStarted = false;
+      firmwareUploadIsDelta = false;
+      firmwareUploadFailed = false;
     } else if (upload.status == UPLOAD_FILE_WRITE) {
-      if (Update.write(upload.buf, upload.currentSize) != upload.currentSize) {
-        Update.printError(Serial);
-      } else {
-        Serial.printf("Progress: %d%%\r", (Update.progress() * 100) / Update.size());
+      if (firmwareUploadFailed) return;
+      if (!firmwareUploadStarted) {
+        firmwareUploadStarted = true;
+        if (!OtaPipeline::begin(OTA_TARGET_FILESYSTEM, httpServer.clientContentLength())) {
+          firmwareUploadFailed = true;
+          return;
+        }
       }
+      firmwareUploadFailed = !OtaPipeline::push(upload.buf, upload.currentSize);
     } else if (upload.status == UPLOAD_FILE_END) {
-      if (Update.end(true)) {
-        Serial.printf("\nFilesystem update success: %u bytes\n", upload.totalSize);
-      } else {
-        Update.printError(Serial);
-      }
+      if (!firmwareUploadStarted || firmwareUploadFailed) return;
+      firmwareUploadFailed = !OtaPipeline::finish(httpServer.arg("sha256"));
+    } else if (upload.status == UPLOAD_FILE_ABORTED) {
+      OtaPipeline::abort();
+      firmwareUploadFailed = true;
     }
   });
 
+  // Per-file web UI updates (tools/sync_web_assets.py). Only touches /web/*,
+  // so learning data survives a UI release without a full filesystem flash.
+  WebAssetUpdater::registerHandlers();
+
+  // Sampling profiler (tools/profile_fold.py symbolizes the download)
+  CpuProfiler::registerHandlers();
+
+  // Event trace for ui.perfetto.dev (valve phases, pump, sensors, I/O)
+  TraceRecorder::registerHandlers();
+
   // Status endpoint
   httpServer.on("/status", HTTP_GET, []() {
     String json = "{";
     json += "\"free_heap\":" + String(ESP.getFreeHeap()) + ",";
     json += "\"chip_model\":\"" + String(ESP.getChipModel()) + "\",";
-    json += "\"cpu_freq\":" + String(ESP.getCpuFreqMHz());
+    json += "\"cpu_freq\":" + String(ESP.getCpuFreqMHz()) + ",";
+    json += "\"ota\":" + OtaPipeline::statusJson();
     json += "}";
     httpServer.send(200, "application/json", json);
   });
@@ -307,7 +368,11 @@ void setupOta() {
 }
 
 void loopOta() {
-  httpServer.handleClient();
+  {
+    TRACE_SCOPE(TraceEventFormat::TRACE_CAT_HTTP, "http_request", TraceEventFormat::NO_ARG, TRACE_HTTP_MIN_US);
+    httpServer.handleClient();
+  }
+  CpuProfiler::loop();
 }
 
 #endif // OTA_H
\ No newline at end of file
@@ -3,7 +3,8 @@
  * ESP32-S3-N8R2
  * Version: 1.15.0 - Multi-threaded Safety Architecture
  *
- * Controls 6 valves, 6 rain sensors, 1 water pump, and master overflow sensor
+ * Controls NUM_VALVES valves and rain sensors (zone topology in config.h),
+ * 1 water pump, and master overflow sensor
  * Features time-based learning algorithm with automatic watering
  * Persists learning data to flash storage
  * Uses DS3231 RTC as source of truth for time
@@ -32,6 +33,10 @@
 #include <api_handlers.h>
 #include <ota.h>
 #include <MetricsPusher.h>
+#include <LoopDeadlineMonitor.h>
+#include <HistoryStore.h>
+#include <PowerManager.h>
+#include <DnsCache.h>
 
 // ============================================
 // Global Objects
@@ -53,27 +58,51 @@ void loopOta();
 // Network operations task - runs independently on Core 0
 void networkTask(void* parameter) {
     DebugHelper::debug("🧵 Network task started on Core " + String(xPortGetCoreID()));
+    LoopDeadlineMonitor::subscribeCurrentTask(DEADLINE_TASK_NETWORK);
 
     while (true) {
+        LoopDeadlineMonitor::beginCycle(DEADLINE_TASK_NETWORK);
+
         // Always serve local web/API requests first. This must stay responsive even
         // when internet services (Telegram/MQTT) are unavailable.
+        LoopDeadlineMonitor::enterStage(DEADLINE_TASK_NETWORK, STAGE_NET_HTTP);
         loopOta();
 
         // Keep WiFi state machine running regardless of halt mode.
+        LoopDeadlineMonitor::enterStage(DEADLINE_TASK_NETWORK, STAGE_NET_WIFI);
         NetworkManager::loopWiFi();
+        PowerManager::loopNetwork(httpServer.client());
 
         if (NetworkManager::isWiFiConnected()) {
+            // Refresh outbound hostnames before they expire, off the request path.
+            LoopDeadlineMonitor::enterStage(DEADLINE_TASK_NETWORK, STAGE_NET_DNS);
+            DnsCache::loop();
+            LoopDeadlineMonitor::enterStage(DEADLINE_TASK_NETWORK, STAGE_NET_TELEGRAM);
             TelegramNotifier::ensureBotCommandsRegistered();
 
             // Keep Telegram command handling available in both normal and halt mode.
             checkTelegramCommands(0);
+            LoopDeadlineMonitor::enterStage(DEADLINE_TASK_NETWORK, STAGE_NET_NOTIFICATIONS);
             wateringSystem.processPendingNotifications();
+            LoopDeadlineMonitor::enterStage(DEADLINE_TASK_NETWORK, STAGE_NET_DEBUG);
             DebugHelper::loop();
+            LoopDeadlineMonitor::enterStage(DEADLINE_TASK_NETWORK, STAGE_NET_METRICS);
             MetricsPusher::loop();
         }
 
-        // Poll quickly so local API/UI and OTA remain responsive.
-        vTaskDelay(100 / portTICK_PERIOD_MS);
+        // History sampling must keep running while offline (that is the point).
+        LoopDeadlineMonitor::enterStage(DEADLINE_TASK_NETWORK, STAGE_NET_HISTORY);
+        HistoryStore::loop();
+
+        // Moisture probes feed the control loop, so they sample offline too.
+        LoopDeadlineMonitor::enterStage(DEADLINE_TASK_NETWORK, STAGE_NET_MOISTURE);
+        MoistureSensors::loop();
+
+        LoopDeadlineMonitor::endCycle(DEADLINE_TASK_NETWORK);
+
+        // Poll quickly so local API/UI and OTA remain responsive (a bit slower
+        // while the controller is idle).
+        vTaskDelay(PowerManager::networkPollMs() / portTICK_PERIOD_MS);
     }
 }
 
@@ -165,21 +194,21 @@ void checkTelegramCommands(int timeout) {
         numStr.replace("water ", "");
         numStr.trim();
         int valveNum = numStr.toInt();
-        if (valveNum >= 1 && valveNum <= 6) {
+        if (valveNum >= 1 && valveNum <= NUM_VALVES) {
             int valveIndex = valveNum - 1;
             DebugHelper::debugImportant("🚿 WATER VALVE " + String(valveNum) + " command received!");
             wateringSystem.startWatering(valveIndex, true);
             DebugHelper::flushBuffer();
             sendTelegramDebug("🚿 Watering tray " + String(valveNum) + " started");
         } else {
-            sendTelegramDebug("❌ Invalid tray number. Use /water 1-6");
+            sendTelegramDebug("❌ Invalid tray number. Use /water 1-" + String(NUM_VALVES));
         }
     } else if (command == "/start_all" || command == "start_all") {
         DebugHelper::debugImportant("🚿 START ALL command received!");
         wateringSystem.startSequentialWatering("Telegram");
 
         String message = "🚿 <b>SEQUENTIAL WATERING STARTED</b>\n\n";
-        message += "• Watering all trays (5→0)\n";
+        message += "• Watering all trays (" + String(NUM_VALVES - 1) + "→0)\n";
         message += "• Send /halt to stop";
         DebugHelper::flushBuffer();
         sendTelegramDebug(message);
@@ -245,6 +274,35 @@ void checkTelegramCommands(int timeout) {
         timeMessage += "\n\n💡 Use /settime to update";
 
         sendTelegramDebug(timeMessage);
+    } else if (command == "/log_level" || command == "log_level" ||
+               command.startsWith("/log_level ") || command.startsWith("log_level ")) {
+        // /log_level                    -> show levels
+        // /log_level <subsystem> <level> -> set (subsystem "all" for every one)
+        String args = command;
+        args.replace("/log_level", "");
+        args.replace("log_level", "");
+        args.trim();
+
+        String message;
+        if (args.length() > 0) {
+            int split = args.indexOf(' ');
+            String sysName = split > 0 ? args.substring(0, split) : args;
+            String levelName = split > 0 ? args.substring(split + 1) : "";
+            levelName.trim();
+            int subsystem = LogLevelLogic::parseSubsystem(sysName.c_str());
+            int level = LogLevelLogic::parseLevel(levelName.c_str());
+            if (subsystem < 0 || level < 0) {
+                message = "❌ Usage: /log_level &lt;subsystem&gt; &lt;level&gt;\n";
+                message += "Subsystems: system valve sensor queue learning network all\n";
+                message += "Levels: debug info warn error off\n\n";
+            } else {
+                DebugHelper::setLogLevel(subsystem, (LogLevel)level);
+                message = "✅ " + sysName + " → " + LogLevelLogic::levelName(level) + "\n\n";
+            }
+        }
+        message += "📝 <b>Log levels</b>\n<pre>" + DebugHelper::getLogLevelsText() + "</pre>";
+        DebugHelper::flushBuffer();
+        sendTelegramDebug(message);
     } else if (command == "/settime" || command == "settime" ||
                command.startsWith("/settime ") || command.startsWith("settime ")) {
 
@@ -403,7 +461,7 @@ void checkTelegramCommands(int timeout) {
 
         String message = "🤖 <b>PLANT LIGHT AUTO MODE</b>\n\n";
         message += "⏰ " + TelegramNotifier::getCurrentDateTime() + "\n";
-        message += "📅 Schedule: 22:00 -> 07:00\n";
+        message += "📅 Schedule: " + wateringSystem.getPlantLightScheduleText() + "\n";
         message += "🔄 Manual override cleared\n\n";
         message += wateringSystem.getPlantLightStatusMessage();
 
@@ -466,11 +524,17 @@ void registerApiHandlers() {
     httpServer.on("/api/status", HTTP_GET, handleStatusApi);
     Serial.println("  ✓ Registered /api/status");
     httpServer.on("/api/lamp", HTTP_GET, handlePlantLightApi);
+    httpServer.on("/api/lamp/schedule", HTTP_GET, handlePlantLightScheduleApi);
+    RuntimeConfig::registerHandlers();
     Serial.println("  ✓ Registered /api/lamp");
     httpServer.on("/api/reset_calibration", HTTP_GET, handleResetCalibrationApi);
     Serial.println("  ✓ Registered /api/reset_calibration");
     httpServer.on("/api/set_multiplier", HTTP_GET, handleSetMultiplierApi);
     Serial.println("  ✓ Registered /api/set_multiplier");
+    httpServer.on("/api/history", HTTP_GET, handleHistoryApi);
+    Serial.println("  ✓ Registered /api/history");
+    httpServer.on("/api/log_level", HTTP_GET, handleLogLevelApi);
+    Serial.println("  ✓ Registered /api/log_level");
 }
 
 // ============================================ 
@@ -561,17 +625,29 @@ void setup() {
         DebugHelper::debug("✓ LittleFS mounted successfully");
     }
 
+    // Runtime overrides of config.h tunables (NVS) - before anything reads them
+    RuntimeConfig::init();
+
     // Initialize watering system (will load learning data from LittleFS)
     wateringSystem.init();
 
+    // Idle CPU/WiFi power saving; sensor pin wakes target this (loop) task
+    PowerManager::init();
+
     // Initialize metrics pusher (sets g_metricsLog callback for Loki routing)
     MetricsPusher::init();
     MetricsPusher::logInfo("Boot start, version: " + String(VERSION));
 
+    // Task watchdog + per-task deadlines (reports a previous stall-reset, if any)
+    LoopDeadlineMonitor::init();
+
     // Initialize network manager
     NetworkManager::setWateringSystem(&wateringSystem);
     NetworkManager::init();
 
+    // Start associating now; it runs in the background during the rest of boot
+    NetworkManager::connectWiFi();
+
     // IDEMPOTENT MIGRATION: Delete old learning data file (if exists)
     if (LittleFS.exists(LEARNING_DATA_FILE_OLD)) {
         DebugHelper::debugImportant("🔄 MIGRATION: Deleting old learning data: " + String(LEARNING_DATA_FILE_OLD));
@@ -584,8 +660,17 @@ void setup() {
         DebugHelper::debugImportant("⚠️  No saved learning data found - will calibrate on first watering");
     }
 
-    // Connect to WiFi
-    NetworkManager::connectWiFi();
+    // On-device history (PSRAM archives, restored from the last LittleFS checkpoint)
+    HistoryStore::init();
+
+    // Chrome trace ring (PSRAM), downloadable from /trace/download
+    TraceRecorder::init();
+
+    // The boot countdown needs Telegram: give the connection started above
+    // a bounded chance to come up (the network task never waits like this)
+    if (!NetworkManager::waitForConnection(WIFI_BOOT_CONNECT_WAIT_MS)) {
+        DebugHelper::debugImportant("❌ WiFi not up yet - continuing, reconnecting in background");
+    }
 
     if (NetworkManager::isWiFiConnected()) {
         TelegramNotifier::ensureBotCommandsRegistered();
@@ -602,6 +687,10 @@ void setup() {
     // ============================================
     bootCountdown();
 
+    // setup() and loop() share the Arduino loop task: subscribe it now that the
+    // long blocking boot steps are done.
+    LoopDeadlineMonitor::subscribeCurrentTask(DEADLINE_TASK_CONTROL);
+
     // ============================================
     // Create Network Task on Core 0
     // ============================================
@@ -645,11 +734,14 @@ bool firstLoop = true;
 void loop() {
     // Halt mode blocks watering logic, but network task continues handling
     // OTA/local web and Telegram command checks.
+    LoopDeadlineMonitor::beginCycle(DEADLINE_TASK_CONTROL);
+
     if (wateringSystem.isHaltMode()) {
         // Fallback path if network task failed to start.
         if (networkTaskHandle == NULL) {
             checkTelegramCommands(0);
         }
+        LoopDeadlineMonitor::endCycle(DEADLINE_TASK_CONTROL);
         delay(100);
         return;
     }
@@ -686,13 +778,16 @@ void loop() {
     // ============================================
     // CRITICAL: Watering Control Loop (Core 1)
     // ============================================
-    // This loop runs every 10ms (100Hz) for responsive sensor monitoring.
+    // This loop runs every 10ms (100Hz) for responsive sensor monitoring
+    // while watering, slower when idle (see PowerManager).
     // Network operations (WiFi, MQTT, Telegram, OTA) run independently on
     // Core 0 and cannot block this loop, preventing overflow issues.
 
+    PowerManager::update(wateringSystem.needsFastLoop());
     wateringSystem.processWateringLoop();
+    LoopDeadlineMonitor::endCycle(DEADLINE_TASK_CONTROL);
 
-    // Small delay to prevent watchdog issues (10ms = 100Hz loop rate)
-    // This ensures sensors are checked every 100ms as designed
-    delay(10);
+    // 10ms (100Hz) while anything is watering; POWER_IDLE_LOOP_PERIOD_MS once
+    // idle, cut short by an overflow or tank level pin change.
+    PowerManager::waitForNextCycle();
 }
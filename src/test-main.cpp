@@ -7,6 +7,9 @@
 #include <LittleFS.h>
 #include <secret.h>
 #include <Adafruit_NeoPixel.h>
+#include <esp_timer.h>
+#include <soc/gpio_reg.h>
+#include "ScopeCaptureFormat.h"
 
 // Forward declarations
 void printMenu();
@@ -320,6 +323,11 @@ void printMenu() {
   Serial.println("  D - Read master overflow sensor (GPIO 42) - DEBOUNCED production logic");
   Serial.println("  V - Monitor master overflow sensor (continuous)");
   Serial.println();
+  Serial.println("LOGIC CAPTURE (dashboard view):");
+  Serial.println("  G - Capture all sensor pins at 1 kHz");
+  Serial.println("  G1-G6 - Capture at 1-6 kHz");
+  Serial.println("  S - Stop capture");
+  Serial.println();
   Serial.println("DS3231 RTC TESTS:");
   Serial.println("  T - Read RTC time and temperature");
   Serial.println("  I - Scan I2C bus for devices");
@@ -670,6 +678,174 @@ void monitorMasterOverflowSensor() {
   }
 }
 
+// ============================================
+// Logic-Analyzer Capture ('G' / 'G1'-'G6')
+// ============================================
+// A hardware timer samples every sensor pin (plus the pump and GPIO 18
+// output latches) straight from the GPIO registers and keeps only the
+// edges; loop() packs them into binary WebSocket frames every
+// SCOPE_FRAME_INTERVAL_MS (format: include/ScopeCaptureFormat.h). The
+// dashboard renders them as a logic-analyzer view. Capture is passive: power
+// the sensors (A / M) and switch the pump (P) while it runs to see relay EMI.
+const uint32_t SCOPE_DEFAULT_HZ = 1000;
+const int SCOPE_TIMER_NUM = 0;
+const size_t SCOPE_RING_EDGES = 2048;           // Power of two
+const size_t SCOPE_FRAME_MAX_EDGES = 256;
+const unsigned long SCOPE_FRAME_INTERVAL_MS = 50;
+
+using ScopeCaptureFormat::ScopeEdge;
+
+hw_timer_t* scopeTimer = nullptr;
+volatile bool scopeRunning = false;
+uint32_t scopeHz = SCOPE_DEFAULT_HZ;
+ScopeEdge scopeRing[SCOPE_RING_EDGES];
+volatile uint32_t scopeHead = 0;        // Written by the ISR
+volatile uint32_t scopeTail = 0;        // Written by loop()
+volatile uint32_t scopeSamples = 0;
+volatile uint32_t scopeDropped = 0;
+volatile uint16_t scopeLastMask = 0;
+volatile bool scopeHaveMask = false;
+uint32_t scopeFrameStartUs = 0;
+uint32_t scopeFrameSamples = 0;        // scopeSamples at frame start
+uint32_t scopeFrameDropped = 0;
+uint16_t scopeFrameStartMask = 0;
+uint32_t scopeTotalEdges = 0;
+unsigned long lastScopeFrameTime = 0;
+
+static inline uint16_t IRAM_ATTR scopeReadMask() {
+  uint32_t in0 = REG_READ(GPIO_IN_REG);
+  uint32_t in1 = REG_READ(GPIO_IN1_REG);    // GPIO 32-48
+  uint32_t out0 = REG_READ(GPIO_OUT_REG);
+  uint16_t mask = 0;
+  mask |= ((in0 >> RAIN_SENSOR1_PIN) & 1) << (ScopeCaptureFormat::SCOPE_CH_RAIN1 + 0);
+  mask |= ((in0 >> RAIN_SENSOR2_PIN) & 1) << (ScopeCaptureFormat::SCOPE_CH_RAIN1 + 1);
+  mask |= ((in0 >> RAIN_SENSOR3_PIN) & 1) << (ScopeCaptureFormat::SCOPE_CH_RAIN1 + 2);
+  mask |= ((in0 >> RAIN_SENSOR4_PIN) & 1) << (ScopeCaptureFormat::SCOPE_CH_RAIN1 + 3);
+  mask |= ((in0 >> RAIN_SENSOR5_PIN) & 1) << (ScopeCaptureFormat::SCOPE_CH_RAIN1 + 4);
+  mask |= ((in0 >> RAIN_SENSOR6_PIN) & 1) << (ScopeCaptureFormat::SCOPE_CH_RAIN1 + 5);
+  mask |= ((in0 >> WATER_LEVEL_SENSOR_PIN) & 1) << ScopeCaptureFormat::SCOPE_CH_WATER_LEVEL;
+  mask |= ((in1 >> (MASTER_OVERFLOW_SENSOR_PIN - 32)) & 1) << ScopeCaptureFormat::SCOPE_CH_OVERFLOW;
+  mask |= ((out0 >> PUMP_PIN) & 1) << ScopeCaptureFormat::SCOPE_CH_PUMP;
+  mask |= ((out0 >> RAIN_SENSOR_POWER_PIN) & 1) << ScopeCaptureFormat::SCOPE_CH_SENSOR_POWER;
+  return mask;
+}
+
+void IRAM_ATTR onScopeTimer() {
+  if (!scopeRunning) return;
+  uint16_t mask = scopeReadMask();
+  scopeSamples = scopeSamples + 1;
+  if (scopeHaveMask && mask == scopeLastMask) return;
+  scopeLastMask = mask;
+  scopeHaveMask = true;
+
+  uint32_t head = scopeHead;
+  if (head - scopeTail >= SCOPE_RING_EDGES) {
+    scopeDropped = scopeDropped + 1;
+    return;
+  }
+  ScopeEdge& e = scopeRing[head & (SCOPE_RING_EDGES - 1)];
+  e.tsUs = (uint32_t)esp_timer_get_time();
+  e.mask = mask;
+  scopeHead = head + 1;
+}
+
+// Send everything captured since the last frame (up to SCOPE_FRAME_MAX_EDGES;
+// the rest goes out on the next call).
+void sendScopeFrame() {
+  static ScopeEdge edges[SCOPE_FRAME_MAX_EDGES];
+  static uint8_t frame[ScopeCaptureFormat::SCOPE_HEADER_SIZE +
+                       SCOPE_FRAME_MAX_EDGES * ScopeCaptureFormat::SCOPE_MAX_EDGE_SIZE];
+
+  uint32_t endUs = (uint32_t)esp_timer_get_time();
+  uint32_t head = scopeHead;
+  uint32_t samples = scopeSamples;
+  uint32_t dropped = scopeDropped;
+  uint32_t tail = scopeTail;
+
+  size_t count = 0;
+  while (tail != head && count < SCOPE_FRAME_MAX_EDGES) {
+    edges[count++] = scopeRing[tail & (SCOPE_RING_EDGES - 1)];
+    tail++;
+  }
+  scopeTail = tail;
+
+  ScopeCaptureFormat::ScopeFrameHeader header;
+  header.intervalUs = (uint16_t)(1000000UL / scopeHz);
+  header.channelCount = ScopeCaptureFormat::SCOPE_CHANNEL_COUNT;
+  header.startUs = scopeFrameStartUs;
+  // More edges still queued: end this frame where the next one starts
+  header.endUs = (tail != head) ? scopeRing[tail & (SCOPE_RING_EDGES - 1)].tsUs : endUs;
+  header.samples = samples - scopeFrameSamples;
+  header.droppedEdges = (uint16_t)min(dropped - scopeFrameDropped, (uint32_t)0xFFFF);
+  header.startMask = scopeFrameStartMask;
+  size_t len = ScopeCaptureFormat::encodeFrame(header, edges, count, frame, sizeof(frame));
+  webSocket.broadcastBIN(frame, len);
+
+  scopeTotalEdges += count;
+  if (count > 0) scopeFrameStartMask = edges[count - 1].mask;
+  scopeFrameStartUs = header.endUs;
+  scopeFrameSamples = samples;
+  scopeFrameDropped = dropped;
+}
+
+void startScopeCapture(uint32_t hz) {
+  if (scopeRunning) {
+    webLog("⚠️ Capture already running - press 'S' to stop it first");
+    return;
+  }
+  if (scopeTimer == nullptr) {
+    scopeTimer = timerBegin(SCOPE_TIMER_NUM, 80, true);  // 1 MHz tick
+    if (scopeTimer == nullptr) {
+      webLog("❌ Capture: no hardware timer available");
+      return;
+    }
+    timerAttachInterrupt(scopeTimer, onScopeTimer, true);
+  }
+
+  scopeHz = hz;
+  scopeHead = 0;
+  scopeTail = 0;
+  scopeSamples = 0;
+  scopeDropped = 0;
+  scopeHaveMask = false;
+  scopeTotalEdges = 0;
+  scopeFrameSamples = 0;
+  scopeFrameDropped = 0;
+  scopeFrameStartMask = scopeReadMask();
+  scopeFrameStartUs = (uint32_t)esp_timer_get_time();
+  lastScopeFrameTime = millis();
+
+  webLog("→ Logic capture STARTED at " + String(hz) + " Hz (" +
+         String(1000000UL / hz) + " us/sample)");
+  webLog("  Channels: rain 1-6, water level, overflow, pump, GPIO 18");
+  webLog("  (Press 'S' to stop)");
+  printSeparator();
+
+  scopeRunning = true;
+  timerWrite(scopeTimer, 0);
+  timerAlarmWrite(scopeTimer, 1000000UL / hz, true);
+  timerAlarmEnable(scopeTimer);
+}
+
+void stopScopeCapture() {
+  if (!scopeRunning) return;
+  timerAlarmDisable(scopeTimer);
+  scopeRunning = false;
+  while (scopeTail != scopeHead) sendScopeFrame();
+  sendScopeFrame();
+  webLog("→ Logic capture STOPPED: " + String(scopeSamples) + " samples, " +
+         String(scopeTotalEdges) + " edges, " + String(scopeDropped) + " dropped");
+}
+
+void loopScopeCapture() {
+  if (!scopeRunning) return;
+  if (millis() - lastScopeFrameTime >= SCOPE_FRAME_INTERVAL_MS ||
+      scopeHead - scopeTail >= SCOPE_FRAME_MAX_EDGES) {
+    lastScopeFrameTime = millis();
+    sendScopeFrame();
+  }
+}
+
 // DS3231 Helper Functions
 uint8_t bcdToDec(uint8_t val) {
   return (val / 16 * 10) + (val % 16);
@@ -1163,6 +1339,7 @@ void loop() {
   if (overflowMonitorMode) {
     monitorMasterOverflowSensor();
   }
+  loopScopeCapture();
 
   // Process command from WebSocket or Serial
   char cmd = '\0';
@@ -1226,6 +1403,12 @@ void loop() {
         printSeparator();
         return;  // Skip the switch statement
       }
+
+      // Check for G1-G6 (logic capture at 1-6 kHz)
+      if ((firstChar == 'G' || firstChar == 'g') && secondChar >= '1' && secondChar <= '6') {
+        startScopeCapture((secondChar - '0') * 1000UL);
+        return;  // Skip the switch statement
+      }
     }
 
     switch (cmd) {
@@ -1289,8 +1472,14 @@ void loop() {
         printSeparator();
         break;
 
+      case 'G':
+      case 'g':
+        startScopeCapture(SCOPE_DEFAULT_HZ);
+        break;
+
       case 'S':
       case 's':
+        stopScopeCapture();
         monitorMode = false;
         monitorSensorIndex = -1;
         waterLevelMonitorMode = false;
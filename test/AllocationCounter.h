@@ -0,0 +1,207 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+// Heap allocation counting for the native test build.
+//
+// Include from exactly one translation unit (test_native_all.cpp): this header
+// replaces the global operator new/new[] and, on glibc, interposes
+// malloc/calloc/realloc so String's buffer management is seen as well.
+// Counting is off until start(); every allocation made while it is on is
+// attributed to the current scope label (a control-loop stage or a function
+// name), which is what the per-scope report prints.
+//
+// Only allocations are counted. Frees are not a fragmentation risk on their
+// own, and a tick that frees what an earlier tick allocated is still
+// reported against the earlier tick.
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#if defined(__GLIBC__)
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+#define ALLOCATION_COUNTER_HOOKS_MALLOC 1
+#else
+#define ALLOCATION_COUNTER_HOOKS_MALLOC 0
+#endif
+
+namespace AllocationCounter {
+
+const int MAX_SCOPES = 32;
+
+struct ScopeStats {
+  const char *name;
+  unsigned long allocations;
+  unsigned long bytes;
+};
+
+// Plain zero-initialized state: the hooks may run before main() and must never
+// allocate themselves.
+struct State {
+  bool enabled;
+  const char *scope;
+  unsigned long allocations;
+  unsigned long bytes;
+  int scopeCount;
+  ScopeStats scopes[MAX_SCOPES];
+};
+
+inline State &state() {
+  static State s;
+  return s;
+}
+
+inline void *rawMalloc(size_t size) {
+#if ALLOCATION_COUNTER_HOOKS_MALLOC
+  return __libc_malloc(size);
+#else
+  return malloc(size);
+#endif
+}
+
+inline ScopeStats *findScope(const char *name) {
+  State &s = state();
+  for (int i = 0; i < s.scopeCount; i++) {
+    if (s.scopes[i].name == name || strcmp(s.scopes[i].name, name) == 0) {
+      return &s.scopes[i];
+    }
+  }
+  if (s.scopeCount >= MAX_SCOPES) return &s.scopes[MAX_SCOPES - 1];
+  ScopeStats *slot = &s.scopes[s.scopeCount++];
+  slot->name = name;
+  slot->allocations = 0;
+  slot->bytes = 0;
+  return slot;
+}
+
+inline void record(size_t size) {
+  State &s = state();
+  if (!s.enabled) return;
+  s.allocations++;
+  s.bytes += size;
+  ScopeStats *scope = findScope(s.scope ? s.scope : "(unscoped)");
+  scope->allocations++;
+  scope->bytes += size;
+}
+
+inline void reset() {
+  State &s = state();
+  s.allocations = 0;
+  s.bytes = 0;
+  s.scopeCount = 0;
+  s.scope = nullptr;
+}
+
+inline void start() {
+  reset();
+  state().enabled = true;
+}
+
+inline void stop() { state().enabled = false; }
+
+inline unsigned long allocations() { return state().allocations; }
+inline unsigned long bytes() { return state().bytes; }
+
+// Label subsequent allocations. Returns the previous label.
+inline const char *setScope(const char *name) {
+  const char *previous = state().scope;
+  state().scope = name;
+  return previous;
+}
+
+inline unsigned long allocationsIn(const char *name) {
+  State &s = state();
+  for (int i = 0; i < s.scopeCount; i++) {
+    if (strcmp(s.scopes[i].name, name) == 0) return s.scopes[i].allocations;
+  }
+  return 0;
+}
+
+// Labels one function or block; restores the enclosing label on exit.
+class Scope {
+public:
+  explicit Scope(const char *name) : previous(setScope(name)) {}
+  ~Scope() { setScope(previous); }
+
+private:
+  const char *previous;
+  Scope(const Scope &);
+  Scope &operator=(const Scope &);
+};
+
+// Per-scope table, e.g. "queue: 2 allocs / 48 B; valves: 1 alloc / 16 B".
+// Written into a caller buffer so it can be used as a Unity failure message.
+inline const char *report(char *out, size_t outSize) {
+  State &s = state();
+  size_t used = 0;
+  out[0] = '\0';
+  for (int i = 0; i < s.scopeCount && used < outSize; i++) {
+    int n = snprintf(out + used, outSize - used, "%s%s: %lu alloc%s / %lu B",
+                     i == 0 ? "" : "; ", s.scopes[i].name,
+                     s.scopes[i].allocations,
+                     s.scopes[i].allocations == 1 ? "" : "s",
+                     s.scopes[i].bytes);
+    if (n < 0) break;
+    used += (size_t)n;
+  }
+  if (s.scopeCount == 0) snprintf(out, outSize, "no allocations");
+  return out;
+}
+
+} // namespace AllocationCounter
+
+// ============================================
+// Global hooks (replaceable allocation functions)
+// ============================================
+void *operator new(size_t size) {
+  AllocationCounter::record(size);
+  void *p = AllocationCounter::rawMalloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void *operator new[](size_t size) {
+  AllocationCounter::record(size);
+  void *p = AllocationCounter::rawMalloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void *operator new(size_t size, const std::nothrow_t &) throw() {
+  AllocationCounter::record(size);
+  return AllocationCounter::rawMalloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) throw() {
+  AllocationCounter::record(size);
+  return AllocationCounter::rawMalloc(size ? size : 1);
+}
+
+void operator delete(void *p) throw() { free(p); }
+void operator delete[](void *p) throw() { free(p); }
+void operator delete(void *p, const std::nothrow_t &) throw() { free(p); }
+void operator delete[](void *p, const std::nothrow_t &) throw() { free(p); }
+
+#if ALLOCATION_COUNTER_HOOKS_MALLOC
+extern "C" void *malloc(size_t size) {
+  AllocationCounter::record(size);
+  return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) {
+  AllocationCounter::record(count * size);
+  return __libc_calloc(count, size);
+}
+
+// Any realloc to a non-zero size counts: the allocator may move the block.
+extern "C" void *realloc(void *ptr, size_t size) {
+  if (size > 0) AllocationCounter::record(size);
+  return __libc_realloc(ptr, size);
+}
+#endif
+
+#endif // ALLOCATION_COUNTER_H
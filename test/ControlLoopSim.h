@@ -0,0 +1,435 @@
+#ifndef CONTROL_LOOP_SIM_H
+#define CONTROL_LOOP_SIM_H
+
+// Native stand-in for WateringSystem::processWateringLoop().
+//
+// The firmware method drags in GPIO, the NeoPixel, Telegram and logging, so
+// the simulator replays the same stage order over the pure pieces that method
+// is built from (SensorDebounce, ValveQueueLogic, StateMachineLogic,
+// shouldWaterNow, PlantLightController::isScheduleActive) with scripted sensor
+// inputs. The safety watchdog is the firmware's own
+// (StateMachineLogic::watchdogTrip), and valve timeouts come from a
+// RuntimeConfigLogic::Values that setConfig() changes the way /api/config
+// does. Stages are marked the way the firmware marks them for
+// LoopDeadlineMonitor and double as AllocationCounter scopes, so an allocation
+// regression is reported against the stage that introduced it.
+//
+// The valve stage runs StateMachineLogic::processValveLogic(), the pure
+// mirror of WateringSystem::processValve(), not the firmware method itself.
+// STAGE_PUBLISH rebuilds the status JSON every STATE_PUBLISH_INTERVAL the way
+// publishCurrentState() does (String concatenation, same fields where the
+// simulator has the state), so its allocations are real and budgeted.
+// Not modelled: the String log messages built on transitions (valve opened,
+// sensor dry, timeouts) and the Telegram notifications.
+
+#include "TestConfig.h"
+#include "ValveController.h"
+#include "StateMachineLogic.h"
+#include "ValveQueueLogic.h"
+#include "RuntimeConfigLogic.h"
+#include "SensorDebounce.h"
+#include "DeadlineMonitorLogic.h"
+#include "PlantLightController.h"
+#include "AllocationCounter.h"
+
+namespace ControlLoopSim {
+
+// Sensor state seen by the next tick (LOW sample counts out of a 7-sample
+// debounce window, as the firmware's readers produce them).
+struct Inputs {
+  int overflowLowReadings;
+  bool waterLevelOk;
+  int rainLowReadings[NUM_VALVES];
+  int hour;
+  int minute;
+};
+
+struct Sim {
+  ValveController *valves[NUM_VALVES];
+  ValveQueueLogic::QueueEntry queue[NUM_VALVES];
+  int queueLength;
+  int activeValve;
+  unsigned long nextValveReadyTime;
+  int overflowStreak;
+  bool overflowDetected;
+  bool waterLevelLow;
+  bool pumpOn;
+  bool lampOn;
+  unsigned long lastStatePublish;
+  unsigned long publishCount;
+  String lastStateJson;
+  bool buildStateJson;  // Off in the fuzzer, which never looks at it
+  int completedCycles;
+  int timeouts;
+  DeadlineMonitorLogic::TaskDeadlineState deadline;
+  RuntimeConfigLogic::Values config;
+  Inputs in;
+};
+
+// Allocates the valves; call before AllocationCounter::start().
+inline void init(Sim &sim, unsigned long now) {
+  for (int i = 0; i < NUM_VALVES; i++) {
+    sim.valves[i] = new ValveController(i);
+    sim.in.rainLowReadings[i] = 0;
+  }
+  sim.queueLength = 0;
+  sim.activeValve = -1;
+  sim.nextValveReadyTime = 0;
+  sim.overflowStreak = 0;
+  sim.overflowDetected = false;
+  sim.waterLevelLow = false;
+  sim.pumpOn = false;
+  sim.lampOn = false;
+  sim.lastStatePublish = now;
+  sim.publishCount = 0;
+  sim.buildStateJson = true;
+  sim.completedCycles = 0;
+  sim.timeouts = 0;
+  sim.in.overflowLowReadings = 0;
+  sim.in.waterLevelOk = true;
+  sim.in.hour = 12;
+  sim.in.minute = 0;
+  sim.config = RuntimeConfigLogic::defaults();
+  DeadlineMonitorLogic::reset(sim.deadline, 250, 5000, now);
+}
+
+inline void destroy(Sim &sim) {
+  for (int i = 0; i < NUM_VALVES; i++) {
+    delete sim.valves[i];
+    sim.valves[i] = nullptr;
+  }
+}
+
+// Mirrors WateringSystem::requestWatering() -> enqueueValve(); called from
+// the network core in the firmware, so it is not part of a control tick.
+inline bool request(Sim &sim, int valveIndex, const String &triggerType,
+                    bool force) {
+  ValveQueueLogic::QueueEntry entry{valveIndex, triggerType, force};
+  return ValveQueueLogic::enqueue(sim.queue, sim.queueLength, NUM_VALVES, entry);
+}
+
+inline void enterStage(Sim &sim, LoopStage stage, unsigned long now) {
+  DeadlineMonitorLogic::enterStage(sim.deadline, stage, now);
+  AllocationCounter::setScope(loopStageToString(stage));
+}
+
+inline bool anyWatering(const Sim &sim) {
+  for (int i = 0; i < NUM_VALVES; i++) {
+    if (sim.valves[i]->phase == PHASE_WATERING) return true;
+  }
+  return false;
+}
+
+// Mirrors the gates of WateringSystem::requestWatering() and enqueueValve()
+// for manual/forced requests (the learning skip only applies to calibrated
+// auto requests, which checkAutoWatering() already gates).
+inline bool requestWatering(Sim &sim, int valveIndex, const String &triggerType,
+                            bool force) {
+  if (sim.overflowDetected || sim.waterLevelLow) return false;
+  if (valveIndex < 0 || valveIndex >= NUM_VALVES) return false;
+  if (sim.valves[valveIndex]->phase != PHASE_IDLE) return false;
+  if (valveIndex == sim.activeValve) return false;
+  return request(sim, valveIndex, triggerType, force);
+}
+
+// Mirrors WateringSystem::stopWatering(): a queued valve is just dropped,
+// otherwise the valve is closed and the pump re-evaluated.
+inline void stopWatering(Sim &sim, int valveIndex) {
+  if (valveIndex < 0 || valveIndex >= NUM_VALVES) return;
+  if (ValveQueueLogic::remove(sim.queue, sim.queueLength, valveIndex)) return;
+  ValveController *valve = sim.valves[valveIndex];
+  valve->wateringRequested = false;
+  valve->state = VALVE_CLOSED;
+  valve->phase = PHASE_IDLE;
+  sim.pumpOn = anyWatering(sim);
+}
+
+// Mirrors RuntimeConfig::set(): the whole candidate is validated and a
+// rejected change leaves the running values alone.
+inline bool setConfig(Sim &sim, const char *name, uint32_t value) {
+  RuntimeConfigLogic::Values candidate = sim.config;
+  char text[12];
+  char why[128];
+  snprintf(text, sizeof(text), "%lu", (unsigned long)value);
+  if (!RuntimeConfigLogic::setField(candidate, name, text, why, sizeof(why)) ||
+      !RuntimeConfigLogic::validate(candidate, why, sizeof(why))) {
+    return false;
+  }
+  sim.config = candidate;
+  return true;
+}
+
+// Mirrors WateringSystem::resetOverflowFlag().
+inline void resetOverflow(Sim &sim) {
+  sim.overflowDetected = false;
+  sim.overflowStreak = 0;
+}
+
+// Mirrors WateringSystem::emergencyStopAll() (overflow).
+inline void forceCloseAll(Sim &sim) {
+  for (int i = 0; i < NUM_VALVES; i++) {
+    sim.valves[i]->state = VALVE_CLOSED;
+    sim.valves[i]->phase = PHASE_IDLE;
+    sim.valves[i]->wateringRequested = false;
+    sim.valves[i]->wateringStartTime = 0;
+  }
+  sim.pumpOn = false;
+  ValveQueueLogic::clear(sim.queueLength);
+}
+
+inline void checkOverflow(Sim &sim) {
+  bool wet = SensorDebounce::isWet(sim.in.overflowLowReadings,
+                                   OVERFLOW_DEBOUNCE_THRESHOLD);
+  sim.overflowStreak = SensorDebounce::nextWetStreak(sim.overflowStreak, wet);
+  if (!sim.overflowDetected &&
+      SensorDebounce::fillConfirmed(sim.overflowStreak,
+                                    OVERFLOW_CONFIRMATION_CHECKS)) {
+    sim.overflowDetected = true;
+    forceCloseAll(sim);
+  }
+}
+
+// Mirrors WateringSystem::globalSafetyWatchdog().
+inline void safetyWatchdog(Sim &sim, unsigned long now) {
+  for (int i = 0; i < NUM_VALVES; i++) {
+    if (!StateMachineLogic::watchdogTrip(*sim.valves[i], now,
+                                         sim.config.emergencyTimeoutMs[i])) {
+      continue;
+    }
+    sim.timeouts++;
+    if (!StateMachineLogic::otherValveWatering(sim.valves, NUM_VALVES, i)) {
+      sim.pumpOn = false;
+    }
+  }
+}
+
+inline void updatePlantLight(Sim &sim) {
+  tm timeInfo = {};
+  timeInfo.tm_hour = sim.in.hour;
+  timeInfo.tm_min = sim.in.minute;
+  sim.lampOn = PlantLightController::isScheduleActive(timeInfo);
+}
+
+inline void checkAutoWatering(Sim &sim, unsigned long now) {
+  for (int i = 0; i < NUM_VALVES; i++) {
+    ValveController *valve = sim.valves[i];
+    if (valve->phase != PHASE_IDLE || i == sim.activeValve ||
+        ValveQueueLogic::contains(sim.queue, sim.queueLength, i)) {
+      continue;
+    }
+    if (shouldWaterNow(valve, now)) {
+      AllocationCounter::Scope scope("auto_watering:enqueue");
+      request(sim, i, "Auto", false);
+    }
+  }
+}
+
+inline void processQueue(Sim &sim, unsigned long now) {
+  if (sim.activeValve != -1 &&
+      sim.valves[sim.activeValve]->phase == PHASE_IDLE) {
+    sim.activeValve = -1;
+    sim.nextValveReadyTime = now + INTER_VALVE_GAP_MS;
+  }
+  if (!ValveQueueLogic::canDequeue(now, sim.nextValveReadyTime,
+                                   sim.activeValve, sim.queueLength) ||
+      sim.overflowDetected || sim.waterLevelLow) {
+    return;
+  }
+  // Same shape as the firmware: a fresh local entry per pop.
+  ValveQueueLogic::QueueEntry entry;
+  {
+    AllocationCounter::Scope scope("queue:dequeue");
+    ValveQueueLogic::dequeue(sim.queue, sim.queueLength, entry);
+  }
+  ValveController *valve = sim.valves[entry.valveIndex];
+  valve->wateringRequested = true;
+  valve->lastWateringAttemptTime = now;
+  valve->phase = PHASE_OPENING_VALVE;
+  sim.activeValve = entry.valveIndex;
+}
+
+inline void processValve(Sim &sim, int i, unsigned long now) {
+  ValveController *valve = sim.valves[i];
+  bool sensorDue = (valve->phase == PHASE_CHECKING_INITIAL_RAIN ||
+                    valve->phase == PHASE_WATERING) &&
+                   now - valve->lastRainCheck >= RAIN_CHECK_INTERVAL;
+  if (sensorDue) {
+    bool wet = SensorDebounce::isWet(sim.in.rainLowReadings[i],
+                                     RAIN_SENSOR_DEBOUNCE_THRESHOLD);
+    valve->rainWetStreak = SensorDebounce::nextWetStreak(valve->rainWetStreak, wet);
+  }
+  bool confirmedWet = SensorDebounce::fillConfirmed(
+      valve->rainWetStreak, RAIN_SENSOR_CONFIRMATION_CHECKS);
+
+  WateringPhase before = valve->phase;
+  StateMachineLogic::ProcessResult result = StateMachineLogic::processValveLogic(
+      valve->phase, now, valve->valveOpenTime, valve->wateringStartTime,
+      valve->lastRainCheck, confirmedWet, valve->wateringRequested,
+      VALVE_STABILIZATION_DELAY, RAIN_CHECK_INTERVAL,
+      sim.config.normalTimeoutMs[i], sim.config.emergencyTimeoutMs[i]);
+
+  // An unconfirmed wet read keeps the valve where it is, like the firmware's
+  // "break; // not yet confirmed" paths.
+  if (sensorDue && !confirmedWet && valve->rainWetStreak > 0 &&
+      before == PHASE_CHECKING_INITIAL_RAIN) {
+    valve->lastRainCheck = now;
+    return;
+  }
+
+  if (before == PHASE_WATERING && result.newPhase == PHASE_CLOSING_VALVE) {
+    if (result.timeoutOccurred) {
+      valve->consecutiveTimeouts++;
+      sim.timeouts++;
+    } else {
+      valve->lastFillDuration = now - valve->wateringStartTime;
+      valve->lastWateringCompleteTime = now;
+      valve->consecutiveTimeouts = 0;
+      valve->totalWateringCycles++;
+      sim.completedCycles++;
+    }
+  }
+  if (before == PHASE_WAITING_STABILIZATION &&
+      result.newPhase == PHASE_CHECKING_INITIAL_RAIN) {
+    valve->rainWetStreak = 0;
+  }
+  if (result.newPhase == PHASE_WATERING && before != PHASE_WATERING) {
+    valve->rainWetStreak = 0;
+  }
+
+  valve->phase = result.newPhase;
+  valve->valveOpenTime = result.newValveOpenTime;
+  valve->wateringStartTime = result.newWateringStartTime;
+  valve->lastRainCheck = result.newLastRainCheck;
+  valve->timeoutOccurred = result.timeoutOccurred;
+
+  switch (result.action) {
+  case StateMachineLogic::ACTION_OPEN_VALVE:
+    valve->state = VALVE_OPEN;
+    break;
+  case StateMachineLogic::ACTION_CLOSE_VALVE:
+  case StateMachineLogic::ACTION_EMERGENCY_STOP:
+    valve->state = VALVE_CLOSED;
+    if (valve->phase == PHASE_IDLE) valve->wateringRequested = false;
+    sim.pumpOn = anyWatering(sim);
+    break;
+  case StateMachineLogic::ACTION_TURN_PUMP_ON:
+    sim.pumpOn = true;
+    break;
+  default:
+    break;
+  }
+}
+
+// Mirrors WateringSystem::publishCurrentState(): the same String building
+// over the fields the simulator has, cached like lastStateJson.
+inline void publishState(Sim &sim, unsigned long now) {
+  String stateJson = "{";
+  stateJson += "\"pump\":\"" + String(sim.pumpOn ? "on" : "off") + "\",";
+  stateJson += "\"queue\":[";
+  for (int i = 0; i < sim.queueLength; i++) {
+    stateJson += String(sim.queue[i].valveIndex + 1);
+    if (i < sim.queueLength - 1) stateJson += ",";
+  }
+  stateJson += "]";
+  stateJson += ",\"active_valve\":" +
+               String(sim.activeValve == -1 ? 0 : sim.activeValve + 1);
+  unsigned long gapRemaining = 0;
+  if (sim.nextValveReadyTime > now && sim.activeValve == -1) {
+    gapRemaining = sim.nextValveReadyTime - now;
+  }
+  stateJson += ",\"inter_valve_gap_remaining_ms\":" + String(gapRemaining);
+  stateJson += ",\"sequential_mode\":" +
+               String((sim.queueLength > 0 || sim.activeValve != -1) ? "true" : "false");
+
+  stateJson += ",\"water_level\":{";
+  stateJson += "\"status\":\"" + String(sim.waterLevelLow ? "low" : "ok") + "\"";
+  stateJson += ",\"blocked\":" + String(sim.waterLevelLow ? "true" : "false");
+  stateJson += ",\"raw_value\":" + String(sim.in.waterLevelOk ? 1 : 0);
+  stateJson += "}";
+
+  stateJson += ",\"overflow\":{";
+  stateJson += "\"detected\":" + String(sim.overflowDetected ? "true" : "false");
+  stateJson += ",\"trigger_streak\":" + String(sim.overflowStreak);
+  stateJson += ",\"trigger_streak_required\":" + String(OVERFLOW_CONFIRMATION_CHECKS);
+  stateJson += "}";
+
+  stateJson += ",\"plant_light\":{";
+  stateJson += "\"state\":\"" + String(sim.lampOn ? "on" : "off") + "\"";
+  stateJson += ",\"mode\":\"auto\"";
+  stateJson += "}";
+
+  stateJson += ",\"valves\":[";
+  for (int i = 0; i < NUM_VALVES; i++) {
+    ValveController *valve = sim.valves[i];
+    stateJson += "{";
+    stateJson += "\"id\":" + String(i);
+    stateJson += ",\"state\":\"" + String(valve->state == VALVE_OPEN ? "open" : "closed") + "\"";
+    stateJson += ",\"phase\":\"" + String(phaseToString(valve->phase)) + "\"";
+    stateJson += ",\"rain\":" + String(valve->rainDetected ? "true" : "false");
+    stateJson += ",\"timeout\":" + String(valve->timeoutOccurred ? "true" : "false");
+    if (valve->phase == PHASE_WATERING && valve->wateringStartTime > 0) {
+      unsigned long elapsed = now - valve->wateringStartTime;
+      int remainingSeconds = (int)((long)(sim.config.normalTimeoutMs[i] - elapsed) / 1000);
+      if (remainingSeconds < 0) remainingSeconds = 0;
+      stateJson += ",\"watering_seconds\":" + String(elapsed / 1000);
+      stateJson += ",\"remaining_seconds\":" + String(remainingSeconds);
+    }
+    stateJson += ",\"learning\":{";
+    stateJson += "\"calibrated\":" + String(valve->isCalibrated ? "true" : "false");
+    stateJson += ",\"auto_watering\":" + String(valve->autoWateringEnabled ? "true" : "false");
+    if (valve->isCalibrated) {
+      stateJson += ",\"baseline_fill_ms\":" + String(valve->baselineFillDuration);
+      stateJson += ",\"last_fill_ms\":" + String(valve->lastFillDuration);
+      stateJson += ",\"empty_duration_ms\":" + String(valve->emptyToFullDuration);
+      stateJson += ",\"total_cycles\":" + String(valve->totalWateringCycles);
+    }
+    stateJson += "}";
+    stateJson += "}";
+    if (i < NUM_VALVES - 1) stateJson += ",";
+  }
+  stateJson += "]}";
+
+  sim.lastStateJson = stateJson;
+}
+
+// One pass of processWateringLoop(), same stage order as the firmware.
+inline DeadlineVerdict tick(Sim &sim, unsigned long now) {
+  DeadlineMonitorLogic::beginCycle(sim.deadline, now);
+
+  enterStage(sim, STAGE_OVERFLOW_SENSOR, now);
+  checkOverflow(sim);
+
+  enterStage(sim, STAGE_WATER_LEVEL, now);
+  sim.waterLevelLow = !sim.in.waterLevelOk;
+
+  enterStage(sim, STAGE_SAFETY_WATCHDOG, now);
+  safetyWatchdog(sim, now);
+
+  enterStage(sim, STAGE_PLANT_LIGHT, now);
+  updatePlantLight(sim);
+
+  enterStage(sim, STAGE_AUTO_WATERING, now);
+  checkAutoWatering(sim, now);
+
+  enterStage(sim, STAGE_QUEUE, now);
+  processQueue(sim, now);
+
+  enterStage(sim, STAGE_VALVES, now);
+  for (int i = 0; i < NUM_VALVES; i++) {
+    processValve(sim, i, now);
+  }
+
+  if (now - sim.lastStatePublish >= STATE_PUBLISH_INTERVAL) {
+    enterStage(sim, STAGE_PUBLISH, now);
+    if (sim.buildStateJson) publishState(sim, now);
+    sim.publishCount++;
+    sim.lastStatePublish = now;
+  }
+
+  AllocationCounter::setScope(nullptr);
+  return DeadlineMonitorLogic::endCycle(sim.deadline, now);
+}
+
+} // namespace ControlLoopSim
+
+#endif // CONTROL_LOOP_SIM_H
@@ -0,0 +1,135 @@
+#ifndef MCP23017_STUB_H
+#define MCP23017_STUB_H
+
+// Register-level stand-in for up to IoExpanderLogic::MAX_CHIPS MCP23017s on
+// one I2C bus, implementing the IoExpanderLogic Bus concept. Models what the
+// driver relies on: IOCON.BANK = 0 sequential access, IODIR/GPPU/OLAT, GPIO
+// reads that merge input pins with latched outputs, and interrupt-on-change
+// (INTCON = 0) with INTF/INTCAP and a mirrored INT line that reading GPIO or
+// INTCAP clears. Counts transactions so tests can pin the bus cost.
+
+#include <stdint.h>
+#include <string.h>
+#include "IoExpanderLogic.h"
+
+namespace Mcp23017Stub {
+
+const int REGISTER_COUNT = 0x16;
+
+struct Device {
+  bool present;
+  uint8_t regs[REGISTER_COUNT];
+  uint16_t pinLevels;   // What the outside world drives onto input pins
+
+  uint16_t pair(uint8_t reg) const { return (uint16_t)(regs[reg] | (regs[reg + 1] << 8)); }
+  void setPair(uint8_t reg, uint16_t v) {
+    regs[reg] = (uint8_t)(v & 0xFF);
+    regs[reg + 1] = (uint8_t)(v >> 8);
+  }
+  uint16_t gpioValue() const {
+    uint16_t dir = pair(IoExpanderLogic::REG_IODIR);
+    uint16_t levels = (uint16_t)((pinLevels & dir) | (pair(IoExpanderLogic::REG_OLAT) & ~dir));
+    return (uint16_t)(levels ^ (pair(IoExpanderLogic::REG_IPOL) & dir));
+  }
+};
+
+struct Bus {
+  Device devices[IoExpanderLogic::MAX_CHIPS];
+  unsigned long reads;
+  unsigned long writes;
+
+  Bus() : reads(0), writes(0) {
+    for (int c = 0; c < IoExpanderLogic::MAX_CHIPS; c++) {
+      Device &d = devices[c];
+      d.present = false;
+      memset(d.regs, 0, sizeof(d.regs));
+      d.regs[IoExpanderLogic::REG_IODIR] = 0xFF;       // Power-on: all inputs
+      d.regs[IoExpanderLogic::REG_IODIR + 1] = 0xFF;
+      d.pinLevels = 0xFFFF;
+    }
+  }
+
+  void attach(int chip) { devices[chip].present = true; }
+
+  Device *find(uint8_t address) {
+    int chip = address - IoExpanderLogic::BASE_ADDRESS;
+    if (chip < 0 || chip >= IoExpanderLogic::MAX_CHIPS || !devices[chip].present) return NULL;
+    return &devices[chip];
+  }
+
+  bool write(uint8_t address, uint8_t reg, const uint8_t *data, size_t n) {
+    writes++;
+    Device *d = find(address);
+    if (!d) return false;
+    for (size_t i = 0; i < n; i++, reg++) {
+      if (reg >= REGISTER_COUNT) return false;
+      if (reg == IoExpanderLogic::REG_INTF || reg == IoExpanderLogic::REG_INTF + 1 ||
+          reg == IoExpanderLogic::REG_INTCAP || reg == IoExpanderLogic::REG_INTCAP + 1) {
+        continue;  // Read-only
+      }
+      uint8_t target = reg;
+      if (reg == IoExpanderLogic::REG_GPIO || reg == IoExpanderLogic::REG_GPIO + 1) {
+        target = (uint8_t)(reg + 2);  // Writing GPIO writes OLAT
+      }
+      d->regs[target] = data[i];
+    }
+    return true;
+  }
+
+  bool read(uint8_t address, uint8_t reg, uint8_t *data, size_t n) {
+    reads++;
+    Device *d = find(address);
+    if (!d) return false;
+    uint16_t gpio = d->gpioValue();
+    bool clears = false;
+    for (size_t i = 0; i < n; i++, reg++) {
+      if (reg >= REGISTER_COUNT) return false;
+      if (reg == IoExpanderLogic::REG_GPIO || reg == IoExpanderLogic::REG_GPIO + 1) {
+        data[i] = reg == IoExpanderLogic::REG_GPIO ? (uint8_t)(gpio & 0xFF) : (uint8_t)(gpio >> 8);
+        clears = true;
+      } else {
+        data[i] = d->regs[reg];
+        if (reg == IoExpanderLogic::REG_INTCAP || reg == IoExpanderLogic::REG_INTCAP + 1) clears = true;
+      }
+    }
+    if (clears) d->setPair(IoExpanderLogic::REG_INTF, 0);
+    return true;
+  }
+
+  // World side: drive an input pin. Enabled lines latch INTF/INTCAP like the
+  // chip (capture only on the first flag, until cleared).
+  void setPin(int chip, int bit, bool high) {
+    Device &d = devices[chip];
+    uint16_t mask = (uint16_t)(1u << bit);
+    uint16_t before = d.gpioValue();
+    d.pinLevels = high ? (uint16_t)(d.pinLevels | mask) : (uint16_t)(d.pinLevels & ~mask);
+    uint16_t changed = (uint16_t)(before ^ d.gpioValue());
+    uint16_t armed = (uint16_t)(d.pair(IoExpanderLogic::REG_GPINTEN) & d.pair(IoExpanderLogic::REG_IODIR) &
+                                ~d.pair(IoExpanderLogic::REG_INTCON));
+    if (changed & armed) {
+      if (d.pair(IoExpanderLogic::REG_INTF) == 0) d.setPair(IoExpanderLogic::REG_INTCAP, d.gpioValue());
+      d.setPair(IoExpanderLogic::REG_INTF, (uint16_t)(d.pair(IoExpanderLogic::REG_INTF) | (changed & armed)));
+    }
+  }
+
+  // Level the chip drives on an output pin (false while it is an input)
+  bool output(int chip, int bit) const {
+    const Device &d = devices[chip];
+    uint16_t mask = (uint16_t)(1u << bit);
+    return !(d.pair(IoExpanderLogic::REG_IODIR) & mask) && (d.pair(IoExpanderLogic::REG_OLAT) & mask);
+  }
+
+  // Shared open-drain INT line (IOCON.MIRROR): low while any chip has a flag
+  bool intAsserted() const {
+    for (int c = 0; c < IoExpanderLogic::MAX_CHIPS; c++) {
+      if (devices[c].present && devices[c].pair(IoExpanderLogic::REG_INTF) != 0) return true;
+    }
+    return false;
+  }
+
+  unsigned long transactions() const { return reads + writes; }
+};
+
+}  // namespace Mcp23017Stub
+
+#endif  // MCP23017_STUB_H
@@ -0,0 +1,40 @@
+#ifndef PULSE_COUNTER_STUB_H
+#define PULSE_COUNTER_STUB_H
+
+// Stand-in for one ESP32 PCNT unit counting flow meter edges, implementing
+// the FlowMeterLogic Counter concept. Like the hardware it wraps to 0 on
+// reaching its high limit; tests feed it a flow rate per simulated tick.
+
+#include <stdint.h>
+
+namespace PulseCounterStub {
+
+struct Counter {
+  int16_t limit;
+  int16_t count;
+  unsigned long reads;
+  float carry;  // Fractional pulses between ticks
+
+  explicit Counter(int16_t highLimit) : limit(highLimit), count(0), reads(0), carry(0.0f) {}
+
+  void pulse(uint32_t n) {
+    count = (int16_t)((count + n) % (uint32_t)limit);
+  }
+
+  // Water flowing at `lpm` for `ms` through a meter with `pulsesPerLitre`
+  void flow(float lpm, unsigned long ms, float pulsesPerLitre) {
+    carry += lpm * pulsesPerLitre * (float)ms / 60000.0f;
+    uint32_t whole = (uint32_t)carry;
+    carry -= (float)whole;
+    pulse(whole);
+  }
+
+  int16_t read() {
+    reads++;
+    return count;
+  }
+};
+
+}  // namespace PulseCounterStub
+
+#endif  // PULSE_COUNTER_STUB_H
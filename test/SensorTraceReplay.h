@@ -0,0 +1,264 @@
+#ifndef SENSOR_TRACE_REPLAY_H
+#define SENSOR_TRACE_REPLAY_H
+
+// Native replay of recorded sensor traces through the firmware's decision
+// logic (SensorDebounce + StateMachineLogic::processValveLogic).
+//
+// Traces come from the hardware-test firmware's logic capture ('G' command,
+// saved from the test dashboard with "Save"): a .wsc file is a sequence of
+// [u32 length][ScopeCaptureFormat frame] records. The replay re-creates the
+// firmware's sensor read -- `samples` pin reads `sampleDelayMs` apart every
+// poll, debounced against `threshold`, then `confirmations` consecutive wet
+// polls -- against the recorded pin, so any parameter set can be scored
+// against the same real-world noise in milliseconds of host time.
+//
+// Ground truth is the first moment the pin goes wet (LOW) and stays wet for
+// truthHoldMs. A decision before that is a false positive; a decision after
+// it is scored by its latency.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+#include "TestConfig.h"
+#include "ValveController.h"
+#include "StateMachineLogic.h"
+#include "SensorDebounce.h"
+#include "ScopeCaptureFormat.h"
+
+namespace SensorTraceReplay {
+
+struct Trace {
+  uint16_t startMask;
+  uint16_t intervalUs;
+  uint64_t durationUs;
+  uint32_t droppedEdges;
+  std::vector<uint64_t> edgeUs;     // Relative to the start of the first frame
+  std::vector<uint16_t> edgeMask;
+};
+
+// Parses a .wsc buffer. Returns false on a malformed or empty file.
+inline bool loadTrace(const uint8_t *data, size_t len, Trace &trace) {
+  using namespace ScopeCaptureFormat;
+  trace.edgeUs.clear();
+  trace.edgeMask.clear();
+  trace.durationUs = 0;
+  trace.droppedEdges = 0;
+  std::vector<ScopeEdge> edges(0xFFFF);
+
+  bool first = true;
+  uint32_t lastRaw = 0;
+  uint64_t now = 0;
+  size_t pos = 0;
+  while (pos + 4 <= len) {
+    uint32_t frameLen = getU32(data + pos);
+    pos += 4;
+    if (frameLen > len - pos) return false;
+    ScopeFrameHeader h;
+    int count = decodeFrame(data + pos, frameLen, h, edges.data(), (int)edges.size());
+    pos += frameLen;
+    if (count < 0) return false;
+
+    if (first) {
+      trace.startMask = h.startMask;
+      trace.intervalUs = h.intervalUs;
+      lastRaw = h.startUs;
+      first = false;
+    }
+    // Frames are contiguous; deltas are u32 so the device timer may wrap.
+    now += (uint32_t)(h.startUs - lastRaw);
+    lastRaw = h.startUs;
+    for (int i = 0; i < count; i++) {
+      now += (uint32_t)(edges[i].tsUs - lastRaw);
+      lastRaw = edges[i].tsUs;
+      trace.edgeUs.push_back(now);
+      trace.edgeMask.push_back(edges[i].mask);
+    }
+    now += (uint32_t)(h.endUs - lastRaw);
+    lastRaw = h.endUs;
+    trace.droppedEdges += h.droppedEdges;
+  }
+  trace.durationUs = now;
+  return !first && pos == len;
+}
+
+inline bool loadTraceFile(const char *path, Trace &trace) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return false;
+  std::vector<uint8_t> data;
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+    data.insert(data.end(), chunk, chunk + n);
+  }
+  fclose(f);
+  return loadTrace(data.data(), data.size(), trace);
+}
+
+// Pin level (1 = HIGH) of `channel` at time t.
+inline int levelAt(const Trace &trace, int channel, uint64_t tUs) {
+  std::vector<uint64_t>::const_iterator it =
+      std::upper_bound(trace.edgeUs.begin(), trace.edgeUs.end(), tUs);
+  uint16_t mask = it == trace.edgeUs.begin()
+                      ? trace.startMask
+                      : trace.edgeMask[(it - trace.edgeUs.begin()) - 1];
+  return (mask >> channel) & 1;
+}
+
+// First time the channel is LOW and stays LOW for holdMs; -1 if never.
+inline long truthWetOnsetMs(const Trace &trace, int channel, unsigned long holdMs) {
+  uint64_t holdUs = (uint64_t)holdMs * 1000;
+  bool low = ((trace.startMask >> channel) & 1) == 0;
+  uint64_t lowSince = 0;
+  for (size_t i = 0; i < trace.edgeUs.size(); i++) {
+    bool nowLow = ((trace.edgeMask[i] >> channel) & 1) == 0;
+    if (nowLow == low) continue;
+    if (low && trace.edgeUs[i] - lowSince >= holdUs) return (long)(lowSince / 1000);
+    low = nowLow;
+    if (low) lowSince = trace.edgeUs[i];
+  }
+  if (low && trace.durationUs - lowSince >= holdUs) return (long)(lowSince / 1000);
+  return -1;
+}
+
+// The firmware's sensor read, parameterised.
+struct Params {
+  int samples;                  // RAIN_SENSOR_DEBOUNCE_SAMPLES
+  unsigned long sampleDelayMs;  // RAIN_SENSOR_DEBOUNCE_DELAY_MS
+  int threshold;                // RAIN_SENSOR_DEBOUNCE_THRESHOLD
+  int confirmations;            // RAIN_SENSOR_CONFIRMATION_CHECKS
+  unsigned long pollIntervalMs; // RAIN_CHECK_INTERVAL
+};
+
+inline Params firmwareRainParams() {
+  Params p = {RAIN_SENSOR_DEBOUNCE_SAMPLES, RAIN_SENSOR_DEBOUNCE_DELAY_MS,
+              RAIN_SENSOR_DEBOUNCE_THRESHOLD, RAIN_SENSOR_CONFIRMATION_CHECKS,
+              RAIN_CHECK_INTERVAL};
+  return p;
+}
+
+inline Params firmwareOverflowParams() {
+  Params p = {OVERFLOW_DEBOUNCE_SAMPLES, 5, OVERFLOW_DEBOUNCE_THRESHOLD,
+              OVERFLOW_CONFIRMATION_CHECKS, 100};
+  return p;
+}
+
+struct Result {
+  bool decided;             // Fill complete / overflow confirmed
+  long decisionMs;          // When the last sample of the deciding poll was taken
+  long truthOnsetMs;        // -1: pin never wet for truthHoldMs
+  bool falsePositive;       // Decided before the truth onset (or without one)
+  long latencyMs;           // decisionMs - truthOnsetMs when both exist
+  int dryPolls;             // Polls taken before the truth onset
+  int wetPollsWhileDry;     // ...that the debounce still judged wet
+};
+
+// LOW samples in one debounced read starting at tMs.
+inline int lowReadings(const Trace &trace, int channel, const Params &p, unsigned long tMs) {
+  int low = 0;
+  for (int k = 0; k < p.samples; k++) {
+    uint64_t t = ((uint64_t)tMs + (uint64_t)k * p.sampleDelayMs) * 1000;
+    if (levelAt(trace, channel, t) == 0) low++;
+  }
+  return low;
+}
+
+inline void scorePoll(Result &r, unsigned long tMs, bool wet) {
+  if (r.truthOnsetMs < 0 || (long)tMs < r.truthOnsetMs) {
+    r.dryPolls++;
+    if (wet) r.wetPollsWhileDry++;
+  }
+}
+
+inline void scoreDecision(Result &r, long decisionMs) {
+  r.decided = true;
+  r.decisionMs = decisionMs;
+  r.falsePositive = r.truthOnsetMs < 0 || decisionMs < r.truthOnsetMs;
+  if (r.truthOnsetMs >= 0) r.latencyMs = decisionMs - r.truthOnsetMs;
+}
+
+inline Result initResult(const Trace &trace, int channel, unsigned long truthHoldMs) {
+  Result r = {false, -1, truthWetOnsetMs(trace, channel, truthHoldMs), false, -1, 0, 0};
+  return r;
+}
+
+// Rain sensor: a valve cycle that starts at the beginning of the trace and
+// runs the real state machine until the fill is confirmed (or the trace ends).
+inline Result replayValveCycle(const Trace &trace, int channel, const Params &p,
+                               unsigned long truthHoldMs, unsigned long tickMs = 10) {
+  Result r = initResult(trace, channel, truthHoldMs);
+  unsigned long endMs = (unsigned long)(trace.durationUs / 1000);
+  WateringPhase phase = PHASE_OPENING_VALVE;
+  unsigned long valveOpenTime = 0, wateringStartTime = 0, lastRainCheck = 0;
+  int streak = 0;
+
+  for (unsigned long now = 0; now + (p.samples - 1) * p.sampleDelayMs <= endMs; now += tickMs) {
+    bool sensorDue = (phase == PHASE_CHECKING_INITIAL_RAIN || phase == PHASE_WATERING) &&
+                     now - lastRainCheck >= p.pollIntervalMs;
+    if (sensorDue) {
+      bool wet = SensorDebounce::isWet(lowReadings(trace, channel, p, now), p.threshold);
+      scorePoll(r, now, wet);
+      streak = SensorDebounce::nextWetStreak(streak, wet);
+    }
+    bool confirmed = SensorDebounce::fillConfirmed(streak, p.confirmations);
+
+    WateringPhase before = phase;
+    StateMachineLogic::ProcessResult result = StateMachineLogic::processValveLogic(
+        phase, now, valveOpenTime, wateringStartTime, lastRainCheck, confirmed, true,
+        VALVE_STABILIZATION_DELAY, p.pollIntervalMs, endMs + 1, endMs + 2);
+
+    // Unconfirmed wet read: stay put, like the firmware's "not yet confirmed"
+    if (sensorDue && !confirmed && streak > 0 && before == PHASE_CHECKING_INITIAL_RAIN) {
+      lastRainCheck = now;
+      continue;
+    }
+    if (result.newPhase != before &&
+        (before == PHASE_WAITING_STABILIZATION || result.newPhase == PHASE_WATERING)) {
+      streak = 0;
+    }
+    phase = result.newPhase;
+    valveOpenTime = result.newValveOpenTime;
+    wateringStartTime = result.newWateringStartTime;
+    lastRainCheck = result.newLastRainCheck;
+
+    if (result.newPhase == PHASE_CLOSING_VALVE && !result.timeoutOccurred) {
+      scoreDecision(r, (long)(now + (p.samples - 1) * p.sampleDelayMs));
+      break;
+    }
+  }
+  return r;
+}
+
+// Overflow sensor: polled from the start of the trace until confirmed.
+inline Result replayOverflow(const Trace &trace, int channel, const Params &p,
+                             unsigned long truthHoldMs) {
+  Result r = initResult(trace, channel, truthHoldMs);
+  unsigned long endMs = (unsigned long)(trace.durationUs / 1000);
+  int streak = 0;
+  for (unsigned long now = 0; now + (p.samples - 1) * p.sampleDelayMs <= endMs;
+       now += p.pollIntervalMs) {
+    bool wet = SensorDebounce::isWet(lowReadings(trace, channel, p, now), p.threshold);
+    scorePoll(r, now, wet);
+    streak = SensorDebounce::nextWetStreak(streak, wet);
+    if (SensorDebounce::fillConfirmed(streak, p.confirmations)) {
+      scoreDecision(r, (long)(now + (p.samples - 1) * p.sampleDelayMs));
+      break;
+    }
+  }
+  return r;
+}
+
+// One report line: "samples=7 delay=5 thr=5 conf=3 | ...".
+inline void formatResult(const Params &p, const Result &r, char *out, size_t outSize) {
+  double fpRate = r.dryPolls > 0 ? (double)r.wetPollsWhileDry / r.dryPolls : 0.0;
+  snprintf(out, outSize,
+           "samples=%d delay=%lums thr=%d conf=%d poll=%lums | decided=%s at %ldms"
+           " truth=%ldms latency=%ldms false_positive=%s wet_reads_while_dry=%d/%d (%.1f%%)",
+           p.samples, p.sampleDelayMs, p.threshold, p.confirmations, p.pollIntervalMs,
+           r.decided ? "yes" : "no", r.decisionMs, r.truthOnsetMs, r.latencyMs,
+           r.falsePositive ? "YES" : "no", r.wetPollsWhileDry, r.dryPolls, fpRate * 100.0);
+}
+
+} // namespace SensorTraceReplay
+
+#endif // SENSOR_TRACE_REPLAY_H
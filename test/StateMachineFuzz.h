@@ -0,0 +1,461 @@
+#ifndef STATE_MACHINE_FUZZ_H
+#define STATE_MACHINE_FUZZ_H
+
+// Property-based fuzzing of the control loop (ControlLoopSim: queue, valve
+// state machine, overflow handling and the firmware's safety watchdog, with
+// valve timeouts changed at runtime like /api/config changes them).
+//
+// A sequence is a list of ops applied the way the firmware sees them: sensor
+// changes and web/Telegram commands land between control ticks, and only
+// OP_ADVANCE moves the clock and runs a tick. After every tick the safety
+// invariants are checked. A failing sequence is shrunk (chunks of ops
+// removed, then values simplified) while it keeps breaking the same
+// invariant, so the report is a handful of ops rather than hundreds.
+//
+// Generation is a seeded xorshift, so "seed S, sequence N" always replays
+// the same ops.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "ControlLoopSim.h"
+
+namespace StateMachineFuzz {
+
+enum OpType {
+  OP_ADVANCE = 0,      // value = ms to advance, then one tick
+  OP_RAIN,             // valve's rain sensor reads `value` LOW of 7
+  OP_OVERFLOW,         // overflow sensor reads `value` LOW of 7
+  OP_WATER_LEVEL,      // value = 1 ok, 0 tank empty
+  OP_REQUEST,          // requestWatering(valve), value = force
+  OP_STOP,             // stopWatering(valve)
+  OP_RESET_OVERFLOW,   // resetOverflowFlag()
+  OP_NORMAL_TIMEOUT,   // normal_timeout_ms.valve = value (rejected if invalid)
+  OP_EMERGENCY_TIMEOUT, // emergency_timeout_ms.valve = value (rejected if invalid)
+  OP_COUNT
+};
+
+struct Op {
+  uint8_t type;
+  uint8_t valve;
+  uint32_t value;
+};
+
+// Invariant ids (0 = all hold)
+enum Violation {
+  INV_OK = 0,
+  INV_PUMP_WITHOUT_WATERING,
+  INV_EMERGENCY_TIMEOUT_EXCEEDED,
+  INV_MULTIPLE_ACTIVE_VALVES,
+  INV_QUEUE_DUPLICATE,
+  INV_OPEN_WHILE_IDLE,
+  INV_ACTIVE_AFTER_OVERFLOW
+};
+
+// A property returns a Violation (or any non-zero id) and a description.
+typedef int (*Property)(const ControlLoopSim::Sim &sim, unsigned long now,
+                        char *why, size_t whySize);
+
+inline int checkInvariants(const ControlLoopSim::Sim &sim, unsigned long now,
+                           char *why, size_t whySize) {
+  if (sim.pumpOn && !ControlLoopSim::anyWatering(sim)) {
+    snprintf(why, whySize, "pump on with no valve in PHASE_WATERING");
+    return INV_PUMP_WITHOUT_WATERING;
+  }
+
+  int active = -1;
+  for (int i = 0; i < NUM_VALVES; i++) {
+    const ValveController *valve = sim.valves[i];
+    if (valve->phase == PHASE_WATERING &&
+        now - valve->wateringStartTime >= sim.config.emergencyTimeoutMs[i]) {
+      snprintf(why, whySize, "valve %d watering for %lums (emergency timeout %lums)",
+               i, now - valve->wateringStartTime,
+               (unsigned long)sim.config.emergencyTimeoutMs[i]);
+      return INV_EMERGENCY_TIMEOUT_EXCEEDED;
+    }
+    if (valve->state == VALVE_OPEN && valve->phase == PHASE_IDLE) {
+      snprintf(why, whySize, "valve %d open while its phase is idle", i);
+      return INV_OPEN_WHILE_IDLE;
+    }
+    if (valve->phase == PHASE_IDLE) continue;
+    if (active != -1 || (sim.activeValve != -1 && sim.activeValve != i)) {
+      snprintf(why, whySize, "valves %d and %d active at once", active != -1 ? active : sim.activeValve, i);
+      return INV_MULTIPLE_ACTIVE_VALVES;
+    }
+    active = i;
+  }
+  if (sim.overflowDetected && (active != -1 || sim.pumpOn)) {
+    snprintf(why, whySize, "valve %d / pump still running after overflow", active);
+    return INV_ACTIVE_AFTER_OVERFLOW;
+  }
+
+  for (int i = 0; i < sim.queueLength; i++) {
+    int valveIndex = sim.queue[i].valveIndex;
+    if (valveIndex == active) {
+      snprintf(why, whySize, "active valve %d is also queued", valveIndex);
+      return INV_QUEUE_DUPLICATE;
+    }
+    for (int j = i + 1; j < sim.queueLength; j++) {
+      if (sim.queue[j].valveIndex == valveIndex) {
+        snprintf(why, whySize, "valve %d queued twice", valveIndex);
+        return INV_QUEUE_DUPLICATE;
+      }
+    }
+  }
+  return INV_OK;
+}
+
+// ============================================
+// Generation
+// ============================================
+
+struct Rng {
+  uint64_t state;
+};
+
+inline void seed(Rng &rng, uint64_t value) {
+  rng.state = value ? value : 0x9E3779B97F4A7C15ULL;
+}
+
+inline uint32_t next(Rng &rng) {
+  rng.state ^= rng.state >> 12;
+  rng.state ^= rng.state << 25;
+  rng.state ^= rng.state >> 27;
+  return (uint32_t)((rng.state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+inline uint32_t below(Rng &rng, uint32_t n) { return next(rng) % n; }
+
+// Mostly loop-rate steps, sometimes seconds (stabilization, inter-valve gap)
+// and occasionally a stall longer than any emergency timeout.
+inline uint32_t randomStep(Rng &rng) {
+  uint32_t bucket = below(rng, 100);
+  if (bucket < 60) return 1 + below(rng, 2 * RAIN_CHECK_INTERVAL);
+  if (bucket < 92) return 1 + below(rng, 5000);
+  return 1 + below(rng, 2 * ABSOLUTE_SAFETY_TIMEOUT);
+}
+
+// Sensor reads cluster at the edges (clean dry / clean wet) with some noise
+// around the debounce threshold.
+inline uint32_t randomLowReadings(Rng &rng) {
+  uint32_t bucket = below(rng, 4);
+  if (bucket == 0) return 0;
+  if (bucket == 1) return 7;
+  return below(rng, 8);
+}
+
+inline Op randomOp(Rng &rng) {
+  Op op;
+  op.valve = (uint8_t)below(rng, NUM_VALVES);
+  uint32_t pick = below(rng, 100);
+  if (pick < 55) {
+    op.type = OP_ADVANCE;
+    op.value = randomStep(rng);
+  } else if (pick < 70) {
+    op.type = OP_RAIN;
+    op.value = randomLowReadings(rng);
+  } else if (pick < 75) {
+    op.type = OP_OVERFLOW;
+    op.value = below(rng, 3) == 0 ? randomLowReadings(rng) : 0;
+  } else if (pick < 79) {
+    op.type = OP_WATER_LEVEL;
+    op.value = below(rng, 3) != 0;
+  } else if (pick < 92) {
+    op.type = OP_REQUEST;
+    op.value = below(rng, 2);
+  } else if (pick < 94) {
+    // Anywhere in the fields' ranges; the validator rejects pairs that leave
+    // less than the emergency margin, like the API does.
+    op.type = below(rng, 2) ? OP_NORMAL_TIMEOUT : OP_EMERGENCY_TIMEOUT;
+    op.value = 10000 + below(rng, 170001);
+  } else if (pick < 98) {
+    op.type = OP_STOP;
+    op.value = 0;
+  } else {
+    op.type = OP_RESET_OVERFLOW;
+    op.value = 0;
+  }
+  return op;
+}
+
+inline void generate(Rng &rng, std::vector<Op> &ops, size_t length) {
+  ops.resize(length);
+  for (size_t i = 0; i < length; i++) ops[i] = randomOp(rng);
+}
+
+// ============================================
+// Execution
+// ============================================
+
+struct Failure {
+  int violation;           // 0: sequence passed
+  size_t opIndex;          // Op after which the property broke
+  unsigned long timeMs;    // Sim time of that tick
+  char why[128];
+};
+
+const unsigned long FUZZ_START_MS = 1000;  // Non-zero: the watchdog treats 0 as "not started"
+
+inline void apply(ControlLoopSim::Sim &sim, const Op &op, unsigned long &now) {
+  static const String trigger("Fuzz");
+  switch (op.type) {
+  case OP_ADVANCE:
+    now += op.value;
+    ControlLoopSim::tick(sim, now);
+    break;
+  case OP_RAIN:
+    sim.in.rainLowReadings[op.valve] = (int)op.value;
+    break;
+  case OP_OVERFLOW:
+    sim.in.overflowLowReadings = (int)op.value;
+    break;
+  case OP_WATER_LEVEL:
+    sim.in.waterLevelOk = op.value != 0;
+    break;
+  case OP_REQUEST:
+    ControlLoopSim::requestWatering(sim, op.valve, trigger, op.value != 0);
+    break;
+  case OP_STOP:
+    ControlLoopSim::stopWatering(sim, op.valve);
+    break;
+  case OP_RESET_OVERFLOW:
+    ControlLoopSim::resetOverflow(sim);
+    break;
+  case OP_NORMAL_TIMEOUT:
+  case OP_EMERGENCY_TIMEOUT: {
+    char name[32];
+    snprintf(name, sizeof(name), "%s.%d",
+             op.type == OP_NORMAL_TIMEOUT ? "normal_timeout_ms" : "emergency_timeout_ms",
+             op.valve + 1);
+    ControlLoopSim::setConfig(sim, name, op.value);
+    break;
+  }
+  }
+}
+
+// Runs one sequence from a fresh system; stops at the first violation.
+inline Failure run(const Op *ops, size_t count, Property property = checkInvariants) {
+  Failure failure = {INV_OK, 0, 0, ""};
+  ControlLoopSim::Sim sim;
+  unsigned long now = FUZZ_START_MS;
+  ControlLoopSim::init(sim, now);
+  sim.buildStateJson = false;  // Invariants don't read it; keeps throughput up
+  for (size_t i = 0; i < count; i++) {
+    apply(sim, ops[i], now);
+    if (ops[i].type != OP_ADVANCE) continue;
+    int violation = property(sim, now, failure.why, sizeof(failure.why));
+    if (violation != INV_OK) {
+      failure.violation = violation;
+      failure.opIndex = i;
+      failure.timeMs = now - FUZZ_START_MS;
+      break;
+    }
+  }
+  ControlLoopSim::destroy(sim);
+  return failure;
+}
+
+// ============================================
+// Shrinking
+// ============================================
+
+inline bool stillFails(const std::vector<Op> &ops, int violation, Property property) {
+  return run(ops.data(), ops.size(), property).violation == violation;
+}
+
+// Smaller candidate values for one op, simplest first.
+inline int simplerValues(const Op &op, uint32_t *out) {
+  int n = 0;
+  switch (op.type) {
+  case OP_ADVANCE:
+    if (op.value > 1) out[n++] = 1;
+    if (op.value > RAIN_CHECK_INTERVAL) out[n++] = RAIN_CHECK_INTERVAL;
+    if (op.value > 2) out[n++] = op.value / 2;
+    break;
+  case OP_RAIN:
+  case OP_OVERFLOW:
+    if (op.value != 0) out[n++] = 0;
+    if (op.value != 0 && op.value != 7) out[n++] = 7;
+    break;
+  case OP_WATER_LEVEL:
+  case OP_REQUEST:
+    if (op.value != 0) out[n++] = 0;
+    break;
+  case OP_NORMAL_TIMEOUT:
+    if (op.value != 10000) out[n++] = 10000;
+    break;
+  case OP_EMERGENCY_TIMEOUT:
+    if (op.value != 15000) out[n++] = 15000;
+    break;
+  default:
+    break;
+  }
+  return n;
+}
+
+// Delta-debugging style: drop everything after the failure, remove ever
+// smaller chunks, then simplify values, until no single step helps.
+// `maxRuns` bounds the work on a pathological case.
+inline void shrink(std::vector<Op> &ops, int violation, Property property = checkInvariants,
+                   int maxRuns = 20000) {
+  Failure first = run(ops.data(), ops.size(), property);
+  if (first.violation != violation) return;
+  ops.resize(first.opIndex + 1);
+
+  int runs = 0;
+  bool progress = true;
+  while (progress && runs < maxRuns) {
+    progress = false;
+
+    for (size_t chunk = ops.size() / 2; chunk >= 1 && runs < maxRuns; chunk /= 2) {
+      size_t i = 0;
+      while (i < ops.size() && runs < maxRuns) {
+        std::vector<Op> candidate(ops.begin(), ops.begin() + i);
+        size_t end = i + chunk < ops.size() ? i + chunk : ops.size();
+        candidate.insert(candidate.end(), ops.begin() + end, ops.end());
+        runs++;
+        if (!candidate.empty() && stillFails(candidate, violation, property)) {
+          ops.swap(candidate);
+          progress = true;
+        } else {
+          i += chunk;
+        }
+      }
+    }
+
+    for (size_t i = 0; i < ops.size() && runs < maxRuns; i++) {
+      uint32_t values[4];
+      int n = simplerValues(ops[i], values);
+      for (int k = 0; k < n; k++) {
+        Op saved = ops[i];
+        ops[i].value = values[k];
+        runs++;
+        if (stillFails(ops, violation, property)) {
+          progress = true;
+          break;
+        }
+        ops[i] = saved;
+      }
+      if (ops[i].type != OP_ADVANCE && ops[i].type != OP_OVERFLOW &&
+          ops[i].type != OP_WATER_LEVEL && ops[i].type != OP_RESET_OVERFLOW &&
+          ops[i].valve != 0) {
+        uint8_t saved = ops[i].valve;
+        ops[i].valve = 0;
+        runs++;
+        if (stillFails(ops, violation, property)) {
+          progress = true;
+        } else {
+          ops[i].valve = saved;
+        }
+      }
+    }
+  }
+}
+
+inline void formatOp(const Op &op, char *out, size_t outSize) {
+  switch (op.type) {
+  case OP_ADVANCE:
+    snprintf(out, outSize, "advance %lums + tick", (unsigned long)op.value);
+    break;
+  case OP_RAIN:
+    snprintf(out, outSize, "rain[%d] = %lu/7 LOW", op.valve, (unsigned long)op.value);
+    break;
+  case OP_OVERFLOW:
+    snprintf(out, outSize, "overflow = %lu/7 LOW", (unsigned long)op.value);
+    break;
+  case OP_WATER_LEVEL:
+    snprintf(out, outSize, "water level %s", op.value ? "ok" : "LOW");
+    break;
+  case OP_REQUEST:
+    snprintf(out, outSize, "request valve %d%s", op.valve, op.value ? " (force)" : "");
+    break;
+  case OP_STOP:
+    snprintf(out, outSize, "stop valve %d", op.valve);
+    break;
+  case OP_RESET_OVERFLOW:
+    snprintf(out, outSize, "reset overflow");
+    break;
+  case OP_NORMAL_TIMEOUT:
+    snprintf(out, outSize, "normal_timeout_ms.%d = %lu", op.valve + 1, (unsigned long)op.value);
+    break;
+  case OP_EMERGENCY_TIMEOUT:
+    snprintf(out, outSize, "emergency_timeout_ms.%d = %lu", op.valve + 1, (unsigned long)op.value);
+    break;
+  default:
+    snprintf(out, outSize, "op %d", op.type);
+    break;
+  }
+}
+
+// Multi-line repro: one op per line, then the violation.
+inline size_t formatRepro(const std::vector<Op> &ops, const Failure &failure,
+                          char *out, size_t outSize) {
+  size_t len = 0;
+  char line[64];
+  for (size_t i = 0; i < ops.size() && len < outSize; i++) {
+    formatOp(ops[i], line, sizeof(line));
+    int n = snprintf(out + len, outSize - len, "  %2u. %s\n", (unsigned)(i + 1), line);
+    if (n < 0) break;
+    len += (size_t)n;
+  }
+  if (len < outSize) {
+    int n = snprintf(out + len, outSize - len, "  => t+%lums: %s", failure.timeMs, failure.why);
+    if (n > 0) len += (size_t)n;
+  }
+  return len < outSize ? len : outSize - 1;
+}
+
+// ============================================
+// Campaign
+// ============================================
+
+struct Report {
+  unsigned long sequences;
+  unsigned long ops;
+  unsigned long ticks;
+  bool failed;
+  unsigned long failingSequence;
+  Failure failure;
+  std::vector<Op> repro;   // Shrunk
+};
+
+// Runs `sequences` random sequences of `length` ops. Sequence k uses seed
+// (baseSeed + k), so a failure can be regenerated on its own.
+inline Report campaign(uint64_t baseSeed, unsigned long sequences, size_t length,
+                       Property property = checkInvariants) {
+  Report report;
+  report.sequences = 0;
+  report.ops = 0;
+  report.ticks = 0;
+  report.failed = false;
+  report.failingSequence = 0;
+  report.failure.violation = INV_OK;
+
+  std::vector<Op> ops;
+  for (unsigned long k = 0; k < sequences; k++) {
+    Rng rng;
+    seed(rng, baseSeed + k);
+    generate(rng, ops, length);
+    Failure failure = run(ops.data(), ops.size(), property);
+    report.sequences++;
+    report.ops += failure.violation ? failure.opIndex + 1 : ops.size();
+    for (size_t i = 0; i < ops.size(); i++) {
+      if (failure.violation && i > failure.opIndex) break;
+      if (ops[i].type == OP_ADVANCE) report.ticks++;
+    }
+    if (failure.violation != INV_OK) {
+      shrink(ops, failure.violation, property);
+      report.failed = true;
+      report.failingSequence = k;
+      report.failure = run(ops.data(), ops.size(), property);
+      report.repro = ops;
+      break;
+    }
+  }
+  return report;
+}
+
+} // namespace StateMachineFuzz
+
+#endif // STATE_MACHINE_FUZZ_H
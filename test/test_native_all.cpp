@@ -4,11 +4,37 @@
 #include <ArduinoFake.h>
 #include "LearningAlgorithm.h"
 #include "PlantLightController.h"
+#include "LightScheduleLogic.h"
+#include "RuntimeConfigLogic.h"
+#include "IoExpanderLogic.h"
+#include "Mcp23017Stub.h"
+#include "FlowMeterLogic.h"
+#include "PulseCounterStub.h"
+#include "PowerLogic.h"
+#include "WifiLinkLogic.h"
+#include "WifiFastConnectLogic.h"
+#include "DnsCacheLogic.h"
+#include "MetricsWireFormat.h"
+#include "GzipLogic.h"
 #include "StateMachineLogic.h"
 #include "ValveController.h"
 #include "TestConfig.h"
 #include "ValveQueueLogic.h"
 #include "SensorDebounce.h"
+#include "DeadlineMonitorLogic.h"
+#include "HistoryStoreLogic.h"
+#include "DeltaPatchLogic.h"
+#include "WebAssetLogic.h"
+#include "OtaProgressLogic.h"
+#include "CpuProfileFormat.h"
+#include "BinaryLogFormat.h"
+#include "LogLevelLogic.h"
+#include "TraceEventFormat.h"
+#include "ScopeCaptureFormat.h"
+#include "AllocationCounter.h"
+#include "ControlLoopSim.h"
+#include "SensorTraceReplay.h"
+#include "StateMachineFuzz.h"
 
 using namespace fakeit;
 using namespace StateMachineLogic;
@@ -215,6 +241,123 @@ void test_plant_light_schedule_is_off_during_day(void) {
     TEST_ASSERT_FALSE(PlantLightController::isScheduleActive(timeInfo));
 }
 
+static LightScheduleLogic::Schedule lightSchedule(const char *text) {
+    LightScheduleLogic::Schedule s = PlantLightController::defaultSchedule();
+    TEST_ASSERT_TRUE(LightScheduleLogic::parse(text, s));
+    return s;
+}
+
+void test_light_schedule_parse_and_format_round_trip(void) {
+    char text[128];
+    LightScheduleLogic::Schedule s = lightSchedule("sunset-30..23:00, 05:30..sunrise+15");
+    TEST_ASSERT_EQUAL(2, s.windowCount);
+    TEST_ASSERT_EQUAL(LightScheduleLogic::ANCHOR_SUNSET, s.windows[0].on.anchor);
+    TEST_ASSERT_EQUAL(-30, s.windows[0].on.minutes);
+    TEST_ASSERT_EQUAL(23 * 60, s.windows[0].off.minutes);
+    LightScheduleLogic::format(s, text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("sunset-30..23:00,05:30..sunrise+15", text);
+
+    LightScheduleLogic::format(PlantLightController::defaultSchedule(), text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("22:00..07:00", text);
+    LightScheduleLogic::format(lightSchedule("off"), text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("off", text);
+
+    // Rejected input leaves the schedule untouched
+    const char *bad[] = {"24:00..07:00", "22:00-07:00", "noon..sunset", "sunset+721..23:00",
+                         "sunrise+..08:00", "1:00..2:00", "00:00..01:00,02:00..03:00,04:00..05:00,"
+                         "06:00..07:00,08:00..09:00", "22:00..07:00,"};
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        TEST_ASSERT_FALSE_MESSAGE(LightScheduleLogic::parse(bad[i], s), bad[i]);
+    }
+    TEST_ASSERT_EQUAL(2, s.windowCount);
+}
+
+void test_light_schedule_sun_times(void) {
+    // Moscow (UTC+3): ~03:45/21:18 at the June solstice, ~09:00/15:58 in December
+    LightScheduleLogic::SunTimes june = LightScheduleLogic::sunTimes(172, 55.75f, 37.62f, 180);
+    LightScheduleLogic::SunTimes december = LightScheduleLogic::sunTimes(355, 55.75f, 37.62f, 180);
+    TEST_ASSERT_INT_WITHIN(5, 3 * 60 + 45, june.sunrise);
+    TEST_ASSERT_INT_WITHIN(5, 21 * 60 + 18, june.sunset);
+    TEST_ASSERT_INT_WITHIN(5, 9 * 60, december.sunrise);
+    TEST_ASSERT_INT_WITHIN(5, 15 * 60 + 58, december.sunset);
+
+    // Svalbard: midnight sun lights "sunrise..sunset" all day, polar night never
+    LightScheduleLogic::Schedule s = lightSchedule("sunrise..sunset");
+    s.latitude = 78.2f;
+    s.longitude = 15.6f;
+    LightScheduleLogic::SunTimes sun[4];
+    LightScheduleLogic::sunWindow(171, s.latitude, s.longitude, 60, sun);
+    TEST_ASSERT_TRUE(LightScheduleLogic::isOnAt(s, sun, 0));
+    TEST_ASSERT_TRUE(LightScheduleLogic::isOnAt(s, sun, 12 * 60));
+    LightScheduleLogic::sunWindow(354, s.latitude, s.longitude, 60, sun);
+    TEST_ASSERT_EQUAL(sun[1].sunrise, sun[1].sunset);
+    TEST_ASSERT_FALSE(LightScheduleLogic::isOnAt(s, sun, 12 * 60));
+    TEST_ASSERT_FALSE(LightScheduleLogic::decide(s, sun, 12 * 60).changes);
+}
+
+void test_light_schedule_next_transition(void) {
+    LightScheduleLogic::SunTimes sun[4];
+    LightScheduleLogic::Schedule s = lightSchedule("06:00..08:00,18:00..23:30");
+    LightScheduleLogic::sunWindow(100, s.latitude, s.longitude, 180, sun);
+
+    LightScheduleLogic::Decision d = LightScheduleLogic::decide(s, sun, 7 * 60);
+    TEST_ASSERT_TRUE(d.on);
+    TEST_ASSERT_EQUAL(8 * 60, d.nextMinute);
+    d = LightScheduleLogic::decide(s, sun, 9 * 60);
+    TEST_ASSERT_FALSE(d.on);
+    TEST_ASSERT_EQUAL(18 * 60, d.nextMinute);
+    d = LightScheduleLogic::decide(s, sun, 23 * 60 + 45);  // Next flip is tomorrow
+    TEST_ASSERT_FALSE(d.on);
+    TEST_ASSERT_FALSE(d.changes);
+    TEST_ASSERT_EQUAL(LightScheduleLogic::MINUTES_PER_DAY, d.nextMinute);
+
+    // Overnight window: yesterday's 22:00 window is still on after midnight
+    s = PlantLightController::defaultSchedule();
+    d = LightScheduleLogic::decide(s, sun, 90);
+    TEST_ASSERT_TRUE(d.on);
+    TEST_ASSERT_EQUAL(7 * 60, d.nextMinute);
+    d = LightScheduleLogic::decide(s, sun, 12 * 60);
+    TEST_ASSERT_FALSE(d.on);
+    TEST_ASSERT_EQUAL(22 * 60, d.nextMinute);
+
+    // Overlapping windows merge: no flip at the inner edges
+    s = lightSchedule("sunset-30..23:00,20:00..21:00");
+    d = LightScheduleLogic::decide(s, sun, 12 * 60);
+    TEST_ASSERT_FALSE(d.on);
+    TEST_ASSERT_EQUAL(sun[1].sunset - 30, d.nextMinute);
+    d = LightScheduleLogic::decide(s, sun, sun[1].sunset);
+    TEST_ASSERT_TRUE(d.on);
+    TEST_ASSERT_EQUAL(23 * 60, d.nextMinute);
+}
+
+// A schedule set from the API task is visible to readers at once and adopted
+// by the control loop at its next shouldBeOnNow(), even though the cached
+// decision (off until 22:00) had not expired.
+void test_plant_light_schedule_handed_to_control_loop(void) {
+    tm noonInfo = {};
+    noonInfo.tm_year = 125;
+    noonInfo.tm_mon = 5;
+    noonInfo.tm_mday = 1;
+    noonInfo.tm_hour = 12;
+    noonInfo.tm_isdst = -1;
+    time_t noon = mktime(&noonInfo);
+
+    PlantLightController light;
+    TEST_ASSERT_FALSE(light.shouldBeOnNow(noon));  // Default 22:00..07:00
+
+    TEST_ASSERT_TRUE(light.setSchedule(lightSchedule("11:00..13:00")));
+    char text[64];
+    light.getScheduleText(text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("11:00..13:00", text);  // API sees the request at once
+    TEST_ASSERT_TRUE(light.autoWantsOn(noon));
+    TEST_ASSERT_TRUE(light.shouldBeOnNow(noon + 1));  // Adopted on the next control pass
+
+    LightScheduleLogic::Schedule invalid = lightSchedule("11:00..13:00");
+    invalid.latitude = 91.0f;
+    TEST_ASSERT_FALSE(light.setSchedule(invalid));
+    TEST_ASSERT_TRUE(light.shouldBeOnNow(noon + 2));
+}
+
 void test_get_time_since_last_attempt_uses_realtime_fallback(void) {
     ValveController valve(0);
     valve.realTimeSinceLastWateringAttempt = 23UL * 3600UL * 1000UL;
@@ -292,6 +435,23 @@ void test_decrement_on_timeout_caps_input_too(void) {
         LearningAlgorithm::decrementMultiplierOnTimeout(10.0f));
 }
 
+void test_moisture_setpoint_stop_is_not_learned_as_a_fill(void) {
+    using namespace LearningAlgorithm;
+    // Pump ran, rain sensor went wet: a real fill
+    TEST_ASSERT_EQUAL(CYCLE_FILLED, classifyCycle(false, false, false, true, true));
+    // Pump ran, the setpoint stopped it with the rain sensor dry: no
+    // baseline / fill-duration update
+    TEST_ASSERT_EQUAL(CYCLE_SETPOINT, classifyCycle(false, false, true, true, true));
+    // Setpoint already reached before the pump started: not "already full",
+    // so no ×2 interval
+    TEST_ASSERT_EQUAL(CYCLE_SETPOINT, classifyCycle(false, false, true, false, true));
+    TEST_ASSERT_EQUAL(CYCLE_ALREADY_FULL, classifyCycle(false, false, false, false, true));
+    // Safety stops still win over the setpoint
+    TEST_ASSERT_EQUAL(CYCLE_NO_FLOW, classifyCycle(true, false, true, true, true));
+    TEST_ASSERT_EQUAL(CYCLE_TIMEOUT, classifyCycle(false, true, true, true, true));
+    TEST_ASSERT_EQUAL(CYCLE_NONE, classifyCycle(false, false, false, true, false));
+}
+
 // ========== Interval-Multiplier Cap (runaway safety belt) ==========
 
 void test_max_interval_multiplier_is_five_days(void) {
@@ -921,6 +1081,2085 @@ void test_per_valve_emergency_timeout(void) {
     TEST_ASSERT_EQUAL(ACTION_EMERGENCY_STOP, result.action);
 }
 
+// ============================================
+// DEADLINE MONITOR TESTS
+// ============================================
+
+void test_deadline_classify_elapsed(void) {
+    TEST_ASSERT_EQUAL(DEADLINE_OK, DeadlineMonitorLogic::classifyElapsed(250, 250, 5000));
+    TEST_ASSERT_EQUAL(DEADLINE_SOFT_MISS, DeadlineMonitorLogic::classifyElapsed(251, 250, 5000));
+    TEST_ASSERT_EQUAL(DEADLINE_HARD_MISS, DeadlineMonitorLogic::classifyElapsed(5001, 250, 5000));
+}
+
+void test_deadline_fast_cycle_counts_no_miss(void) {
+    DeadlineMonitorLogic::TaskDeadlineState s;
+    DeadlineMonitorLogic::reset(s, 250, 5000, 1000);
+    DeadlineMonitorLogic::beginCycle(s, 1000);
+    DeadlineMonitorLogic::enterStage(s, STAGE_OVERFLOW_SENSOR, 1000);
+    DeadlineMonitorLogic::enterStage(s, STAGE_VALVES, 1020);
+    TEST_ASSERT_EQUAL(DEADLINE_OK, DeadlineMonitorLogic::endCycle(s, 1060));
+    TEST_ASSERT_EQUAL(0, s.softMisses);
+    TEST_ASSERT_EQUAL(60, s.lastCycleMs);
+    TEST_ASSERT_EQUAL(1, s.cycles);
+}
+
+void test_deadline_miss_charged_to_slowest_stage(void) {
+    DeadlineMonitorLogic::TaskDeadlineState s;
+    DeadlineMonitorLogic::reset(s, 250, 5000, 0);
+    DeadlineMonitorLogic::beginCycle(s, 0);
+    DeadlineMonitorLogic::enterStage(s, STAGE_OVERFLOW_SENSOR, 0);
+    DeadlineMonitorLogic::enterStage(s, STAGE_VALVES, 40);      // overflow: 40ms
+    DeadlineMonitorLogic::enterStage(s, STAGE_PUBLISH, 90);     // valves: 50ms
+    TEST_ASSERT_EQUAL(DEADLINE_SOFT_MISS, DeadlineMonitorLogic::endCycle(s, 900)); // publish: 810ms
+    TEST_ASSERT_EQUAL(1, s.softMisses);
+    TEST_ASSERT_EQUAL(1, s.missesByStage[STAGE_PUBLISH]);
+    TEST_ASSERT_EQUAL(0, s.missesByStage[STAGE_VALVES]);
+    TEST_ASSERT_EQUAL(900, s.maxCycleMs);
+}
+
+void test_deadline_new_cycle_resets_culprit(void) {
+    DeadlineMonitorLogic::TaskDeadlineState s;
+    DeadlineMonitorLogic::reset(s, 250, 5000, 0);
+    DeadlineMonitorLogic::beginCycle(s, 0);
+    DeadlineMonitorLogic::enterStage(s, STAGE_PUBLISH, 0);
+    DeadlineMonitorLogic::endCycle(s, 800);
+
+    DeadlineMonitorLogic::beginCycle(s, 1000);
+    DeadlineMonitorLogic::enterStage(s, STAGE_SAFETY_WATCHDOG, 1000);
+    DeadlineMonitorLogic::enterStage(s, STAGE_VALVES, 1300);
+    DeadlineMonitorLogic::endCycle(s, 1310);
+    TEST_ASSERT_EQUAL(2, s.softMisses);
+    TEST_ASSERT_EQUAL(1, s.missesByStage[STAGE_PUBLISH]);
+    TEST_ASSERT_EQUAL(1, s.missesByStage[STAGE_SAFETY_WATCHDOG]);
+}
+
+void test_deadline_stall_detected_after_hard_deadline(void) {
+    DeadlineMonitorLogic::TaskDeadlineState s;
+    DeadlineMonitorLogic::reset(s, 250, 5000, 0);
+    DeadlineMonitorLogic::beginCycle(s, 100);
+    DeadlineMonitorLogic::enterStage(s, STAGE_PUBLISH, 200);
+    TEST_ASSERT_FALSE(DeadlineMonitorLogic::isStalled(s, 5200));
+    TEST_ASSERT_TRUE(DeadlineMonitorLogic::isStalled(s, 5201));
+    TEST_ASSERT_EQUAL(STAGE_PUBLISH, s.currentStage);
+}
+
+void test_deadline_stall_check_survives_millis_rollover(void) {
+    DeadlineMonitorLogic::TaskDeadlineState s;
+    unsigned long start = ULONG_MAX - 1000;
+    DeadlineMonitorLogic::reset(s, 250, 5000, start);
+    DeadlineMonitorLogic::enterStage(s, STAGE_VALVES, start);
+    TEST_ASSERT_FALSE(DeadlineMonitorLogic::isStalled(s, 2000));  // 3001ms later
+    TEST_ASSERT_TRUE(DeadlineMonitorLogic::isStalled(s, 5000));   // 6001ms later
+}
+
+void test_loop_stage_names(void) {
+    TEST_ASSERT_EQUAL_STRING("valves", loopStageToString(STAGE_VALVES));
+    TEST_ASSERT_EQUAL_STRING("net_metrics", loopStageToString(STAGE_NET_METRICS));
+    TEST_ASSERT_EQUAL_STRING("unknown", loopStageToString(LOOP_STAGE_COUNT));
+}
+
+// ============================================
+// HISTORY STORE (ROUND-ROBIN ARCHIVE) TESTS
+// ============================================
+
+using HistoryStoreLogic::HISTORY_UNKNOWN;
+
+static const int HIST_SERIES = 2;
+static const uint16_t HIST_ROWS = 6;
+static const uint32_t HIST_T0 = 1699999980UL; // Multiple of 10 and 60
+
+struct TestArchive {
+    int16_t data[HIST_ROWS * HIST_SERIES];
+    int32_t sums[HIST_SERIES];
+    uint16_t counts[HIST_SERIES];
+    HistoryStoreLogic::Archive a;
+
+    explicit TestArchive(uint32_t step) {
+        a.stepSec = step;
+        a.rows = HIST_ROWS;
+        a.data = data;
+        a.sums = sums;
+        a.counts = counts;
+        HistoryStoreLogic::clearArchive(a, HIST_SERIES);
+    }
+
+    int16_t at(uint32_t epoch, int series) {
+        return HistoryStoreLogic::rowFor(a, HIST_SERIES, epoch / a.stepSec)[series];
+    }
+};
+
+void test_history_average_within_bucket(void) {
+    TestArchive t(60);
+    int16_t s1[HIST_SERIES] = {10, -70};
+    int16_t s2[HIST_SERIES] = {21, -60};
+    HistoryStoreLogic::addSample(t.a, HIST_SERIES, HIST_T0, s1);
+    HistoryStoreLogic::addSample(t.a, HIST_SERIES, HIST_T0 + 10, s2);
+    TEST_ASSERT_EQUAL(16, t.at(HIST_T0, 0));   // (10+21)/2 rounded
+    TEST_ASSERT_EQUAL(-65, t.at(HIST_T0, 1));
+}
+
+void test_history_unknown_values_are_skipped(void) {
+    TestArchive t(60);
+    int16_t s1[HIST_SERIES] = {HISTORY_UNKNOWN, 40};
+    int16_t s2[HIST_SERIES] = {30, HISTORY_UNKNOWN};
+    HistoryStoreLogic::addSample(t.a, HIST_SERIES, HIST_T0, s1);
+    TEST_ASSERT_EQUAL(HISTORY_UNKNOWN, t.at(HIST_T0, 0));
+    HistoryStoreLogic::addSample(t.a, HIST_SERIES, HIST_T0 + 10, s2);
+    TEST_ASSERT_EQUAL(30, t.at(HIST_T0, 0));
+    TEST_ASSERT_EQUAL(40, t.at(HIST_T0, 1));
+}
+
+void test_history_gap_rows_are_cleared(void) {
+    TestArchive t(10);
+    int16_t v[HIST_SERIES] = {5, 5};
+    // Fill the whole ring, then jump 3 buckets ahead
+    for (uint32_t i = 0; i < HIST_ROWS; i++) {
+        HistoryStoreLogic::addSample(t.a, HIST_SERIES, HIST_T0 + i * 10, v);
+    }
+    int16_t w[HIST_SERIES] = {9, 9};
+    uint32_t later = HIST_T0 + (HIST_ROWS - 1) * 10 + 30;
+    HistoryStoreLogic::addSample(t.a, HIST_SERIES, later, w);
+    TEST_ASSERT_EQUAL(9, t.at(later, 0));
+    TEST_ASSERT_EQUAL(HISTORY_UNKNOWN, t.at(later - 10, 0));
+    TEST_ASSERT_EQUAL(HISTORY_UNKNOWN, t.at(later - 20, 0));
+    TEST_ASSERT_EQUAL(5, t.at(later - 30, 0));
+}
+
+void test_history_small_clock_step_back_is_dropped(void) {
+    TestArchive t(10);
+    int16_t v[HIST_SERIES] = {5, 5};
+    int16_t w[HIST_SERIES] = {99, 99};
+    HistoryStoreLogic::addSample(t.a, HIST_SERIES, HIST_T0 + 50, v);
+    TEST_ASSERT_FALSE(HistoryStoreLogic::addSample(t.a, HIST_SERIES, HIST_T0 + 20, w));
+    TEST_ASSERT_EQUAL(5, t.at(HIST_T0 + 50, 0));
+    TEST_ASSERT_EQUAL((HIST_T0 + 50) / 10, t.a.lastBucket);
+}
+
+void test_history_choose_finest_covering_archive(void) {
+    TestArchive fine(10), mid(60), coarse(900);
+    HistoryStoreLogic::Archive archives[3] = {fine.a, mid.a, coarse.a};
+    TEST_ASSERT_EQUAL(0, HistoryStoreLogic::chooseArchive(archives, 3, 60));
+    TEST_ASSERT_EQUAL(1, HistoryStoreLogic::chooseArchive(archives, 3, 61));
+    TEST_ASSERT_EQUAL(2, HistoryStoreLogic::chooseArchive(archives, 3, 3600));
+    TEST_ASSERT_EQUAL(2, HistoryStoreLogic::chooseArchive(archives, 3, 999999));
+}
+
+void test_history_downsample_groups_rows(void) {
+    TestArchive t(10);
+    for (uint32_t i = 0; i < HIST_ROWS; i++) {
+        int16_t v[HIST_SERIES] = {(int16_t)(i * 10), HISTORY_UNKNOWN};
+        HistoryStoreLogic::addSample(t.a, HIST_SERIES, HIST_T0 + i * 10, v);
+    }
+    HistoryStoreLogic::DownsampleWindow w = HistoryStoreLogic::planWindow(t.a, 60, 3);
+    TEST_ASSERT_EQUAL(3, w.points);
+    TEST_ASSERT_EQUAL(2, w.rowsPerPoint);
+    TEST_ASSERT_EQUAL(20, w.stepSec);
+    TEST_ASSERT_EQUAL(HIST_T0, w.startEpoch);
+    TEST_ASSERT_EQUAL(5, HistoryStoreLogic::downsamplePoint(t.a, HIST_SERIES, 0, w, 0));
+    TEST_ASSERT_EQUAL(25, HistoryStoreLogic::downsamplePoint(t.a, HIST_SERIES, 0, w, 1));
+    TEST_ASSERT_EQUAL(45, HistoryStoreLogic::downsamplePoint(t.a, HIST_SERIES, 0, w, 2));
+    TEST_ASSERT_EQUAL(HISTORY_UNKNOWN, HistoryStoreLogic::downsamplePoint(t.a, HIST_SERIES, 1, w, 0));
+}
+
+void test_history_empty_archive_has_no_points(void) {
+    TestArchive t(10);
+    HistoryStoreLogic::DownsampleWindow w = HistoryStoreLogic::planWindow(t.a, 3600, 100);
+    TEST_ASSERT_EQUAL(0, w.points);
+}
+
+// ============================================
+// DELTA PATCH DECODER TESTS
+// ============================================
+
+static const uint8_t DP_SOURCE[8] = {'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h'};
+static uint8_t dpOutput[64];
+static size_t dpOutputLen = 0;
+
+static bool dpReadSource(void*, uint32_t offset, uint8_t* buf, size_t len) {
+    if (offset + len > sizeof(DP_SOURCE)) return false;
+    memcpy(buf, DP_SOURCE + offset, len);
+    return true;
+}
+
+static bool dpWriteOutput(void*, const uint8_t* buf, size_t len) {
+    if (dpOutputLen + len > sizeof(dpOutput)) return false;
+    memcpy(dpOutput + dpOutputLen, buf, len);
+    dpOutputLen += len;
+    return true;
+}
+
+// Header for a target of `targetSize` bytes built from the 8-byte source
+// (hashes are checked by the caller, not the decoder, so they stay zero).
+static size_t dpBuildHeader(uint8_t* out, uint32_t targetSize) {
+    memset(out, 0, DeltaPatchLogic::PATCH_HEADER_SIZE);
+    memcpy(out, "WDP1", 4);
+    out[4] = targetSize & 0xFF;
+    out[8] = sizeof(DP_SOURCE);
+    return DeltaPatchLogic::PATCH_HEADER_SIZE;
+}
+
+static bool dpApply(const uint8_t* patch, size_t len, size_t chunk, DeltaPatchLogic::PatchDecoder& d) {
+    dpOutputLen = 0;
+    DeltaPatchLogic::begin(d, dpReadSource, dpWriteOutput, nullptr);
+    for (size_t i = 0; i < len; i += chunk) {
+        size_t n = (len - i) < chunk ? (len - i) : chunk;
+        if (!DeltaPatchLogic::feed(d, patch + i, n)) return false;
+    }
+    return true;
+}
+
+void test_delta_patch_copy_diff_and_insert(void) {
+    // Target "abXdeZZfgh": COPY src[0..5) with diff at index 2 ('c'-11='X'),
+    // INSERT "ZZ", COPY src[5..8) unchanged.
+    uint8_t patch[128];
+    size_t n = dpBuildHeader(patch, 10);
+    const uint8_t body[] = {
+        0x01, 0, 5, 2, 1, 245, 2, 0,   // COPY 0,5: zero 2, lit 1 (-11), zero 2, lit 0
+        0x02, 2, 'Z', 'Z',              // INSERT "ZZ"
+        0x01, 5, 3, 3, 0,               // COPY 5,3: zero 3, lit 0
+        0x00                            // END
+    };
+    memcpy(patch + n, body, sizeof(body));
+    n += sizeof(body);
+
+    const size_t chunks[] = {1, 3, 200};
+    for (int c = 0; c < 3; c++) {
+        DeltaPatchLogic::PatchDecoder d;
+        TEST_ASSERT_TRUE(dpApply(patch, n, chunks[c], d));
+        TEST_ASSERT_TRUE(DeltaPatchLogic::isComplete(d));
+        TEST_ASSERT_EQUAL(10, dpOutputLen);
+        TEST_ASSERT_EQUAL_MEMORY("abXdeZZfgh", dpOutput, 10);
+    }
+}
+
+void test_delta_patch_rejects_copy_outside_source(void) {
+    uint8_t patch[128];
+    size_t n = dpBuildHeader(patch, 4);
+    const uint8_t body[] = {0x01, 6, 4, 4, 0, 0x00};   // src[6..10) > 8-byte source
+    memcpy(patch + n, body, sizeof(body));
+    DeltaPatchLogic::PatchDecoder d;
+    TEST_ASSERT_FALSE(dpApply(patch, n + sizeof(body), 64, d));
+    TEST_ASSERT_EQUAL(DeltaPatchLogic::DP_ERROR, d.state);
+}
+
+void test_delta_patch_rejects_short_output(void) {
+    uint8_t patch[128];
+    size_t n = dpBuildHeader(patch, 6);
+    const uint8_t body[] = {0x02, 2, 'x', 'y', 0x00};  // Only 2 of 6 bytes
+    memcpy(patch + n, body, sizeof(body));
+    DeltaPatchLogic::PatchDecoder d;
+    TEST_ASSERT_FALSE(dpApply(patch, n + sizeof(body), 64, d));
+    TEST_ASSERT_FALSE(DeltaPatchLogic::isComplete(d));
+}
+
+void test_delta_patch_rejects_bad_magic(void) {
+    uint8_t patch[DeltaPatchLogic::PATCH_HEADER_SIZE];
+    dpBuildHeader(patch, 4);
+    patch[0] = 0xE9;  // ESP app image magic: a full image, not a patch
+    TEST_ASSERT_FALSE(DeltaPatchLogic::hasPatchMagic(patch, sizeof(patch)));
+    DeltaPatchLogic::PatchDecoder d;
+    TEST_ASSERT_FALSE(dpApply(patch, sizeof(patch), 64, d));
+}
+
+// ============================================
+// WEB ASSET UPDATE PATH/HASH TESTS
+// ============================================
+
+void test_web_asset_accepts_web_paths(void) {
+    TEST_ASSERT_TRUE(WebAssetLogic::isAllowedAssetPath("/web/prod/index.html"));
+    TEST_ASSERT_TRUE(WebAssetLogic::isAllowedAssetPath("/web/prod/js/app.js"));
+    TEST_ASSERT_TRUE(WebAssetLogic::isAllowedAssetPath("/web/test/dashboard.html"));
+}
+
+void test_web_asset_rejects_learning_data_and_root_files(void) {
+    TEST_ASSERT_FALSE(WebAssetLogic::isAllowedAssetPath("/learning_data_v1.19.12.json"));
+    TEST_ASSERT_FALSE(WebAssetLogic::isAllowedAssetPath("/history.rrd"));
+    TEST_ASSERT_FALSE(WebAssetLogic::isAllowedAssetPath("/web"));
+    TEST_ASSERT_FALSE(WebAssetLogic::isAllowedAssetPath("/web/"));
+    TEST_ASSERT_FALSE(WebAssetLogic::isAllowedAssetPath("/webx/index.html"));
+    TEST_ASSERT_FALSE(WebAssetLogic::isAllowedAssetPath(nullptr));
+}
+
+void test_web_asset_rejects_traversal_and_odd_names(void) {
+    TEST_ASSERT_FALSE(WebAssetLogic::isAllowedAssetPath("/web/../learning_data_v1.19.12.json"));
+    TEST_ASSERT_FALSE(WebAssetLogic::isAllowedAssetPath("/web/prod/./index.html"));
+    TEST_ASSERT_FALSE(WebAssetLogic::isAllowedAssetPath("/web//index.html"));
+    TEST_ASSERT_FALSE(WebAssetLogic::isAllowedAssetPath("/web/prod/"));
+    TEST_ASSERT_FALSE(WebAssetLogic::isAllowedAssetPath("/web/prod/index.html.part"));
+    TEST_ASSERT_FALSE(WebAssetLogic::isAllowedAssetPath("/web/prod/in dex.html"));
+    TEST_ASSERT_FALSE(WebAssetLogic::isAllowedAssetPath(
+        "/web/prod/a-very-long-directory-name/another-long-name/file.html"));
+}
+
+void test_web_asset_hex_digest_matching(void) {
+    const uint8_t digest[4] = {0x00, 0xAB, 0x7F, 0xFF};
+    char hex[9];
+    WebAssetLogic::toHex(digest, 4, hex);
+    TEST_ASSERT_EQUAL_STRING("00ab7fff", hex);
+    TEST_ASSERT_TRUE(WebAssetLogic::hexMatches("00ab7fff", digest, 4));
+    TEST_ASSERT_TRUE(WebAssetLogic::hexMatches("00AB7FFF", digest, 4));
+    TEST_ASSERT_FALSE(WebAssetLogic::hexMatches("00ab7ffe", digest, 4));
+    TEST_ASSERT_FALSE(WebAssetLogic::hexMatches("00ab7f", digest, 4));
+    TEST_ASSERT_FALSE(WebAssetLogic::hexMatches("", digest, 4));
+}
+
+// ============================================
+// OTA PIPELINE PROGRESS TESTS
+// ============================================
+
+void test_ota_progress_percent(void) {
+    TEST_ASSERT_EQUAL(-1, OtaProgressLogic::percent(1000, 0));       // Unknown total
+    TEST_ASSERT_EQUAL(0, OtaProgressLogic::percent(0, 1000));
+    TEST_ASSERT_EQUAL(49, OtaProgressLogic::percent(499, 1000));     // Rounds down
+    TEST_ASSERT_EQUAL(100, OtaProgressLogic::percent(1200, 1000));   // Clamped
+    // 4 GB-range intermediate must not overflow 32 bits
+    TEST_ASSERT_EQUAL(50, OtaProgressLogic::percent(2000000000UL, 4000000000UL));
+}
+
+void test_ota_progress_throughput_and_eta(void) {
+    TEST_ASSERT_EQUAL_UINT32(0, OtaProgressLogic::throughputBps(4096, 0));
+    TEST_ASSERT_EQUAL_UINT32(100000, OtaProgressLogic::throughputBps(500000, 5000));
+    TEST_ASSERT_EQUAL(-1, OtaProgressLogic::etaSeconds(100, 0, 1000));     // Unknown total
+    TEST_ASSERT_EQUAL(-1, OtaProgressLogic::etaSeconds(100, 1000, 0));     // No rate yet
+    TEST_ASSERT_EQUAL(10, OtaProgressLogic::etaSeconds(500000, 1500000, 100000));
+    TEST_ASSERT_EQUAL(1, OtaProgressLogic::etaSeconds(999, 1000, 100000));  // Rounds up
+    TEST_ASSERT_EQUAL(0, OtaProgressLogic::etaSeconds(1000, 1000, 100));
+}
+
+void test_ota_progress_fill_buffer_splits_chunks(void) {
+    uint8_t ring[8];
+    uint32_t fill = 0;
+    const uint8_t chunk[5] = {1, 2, 3, 4, 5};
+    TEST_ASSERT_EQUAL_UINT32(5, OtaProgressLogic::fillBuffer(ring, fill, sizeof(ring), chunk, 5));
+    TEST_ASSERT_EQUAL_UINT32(5, fill);
+    // Only 3 bytes of room left: the rest of the chunk goes to the next slot
+    TEST_ASSERT_EQUAL_UINT32(3, OtaProgressLogic::fillBuffer(ring, fill, sizeof(ring), chunk, 5));
+    TEST_ASSERT_EQUAL_UINT32(8, fill);
+    TEST_ASSERT_EQUAL_UINT8(3, ring[7]);
+    TEST_ASSERT_EQUAL_UINT32(0, OtaProgressLogic::fillBuffer(ring, fill, sizeof(ring), chunk, 5));
+}
+
+// ============================================
+// CPU PROFILE DUMP FORMAT TESTS
+// ============================================
+
+void test_profile_format_round_trip(void) {
+    using namespace CpuProfileFormat;
+    uint8_t dump[PROFILE_HEADER_SIZE + PROFILE_TASK_ENTRY_SIZE + PROFILE_SAMPLE_SIZE];
+
+    ProfileHeader header = {PROFILE_VERSION, PROFILE_MAX_DEPTH, 250, 1, 3, 1, 30000};
+    writeHeader(header, dump);
+    writeTask(0x3FC9A000, "networkTaskWithALongName", dump + PROFILE_HEADER_SIZE);
+    ProfileSample sample = {0x3FC9A000, 1, 3, 0, {0x42001000, 0x42002000, 0x40380000}};
+    writeSample(sample, dump + PROFILE_HEADER_SIZE + PROFILE_TASK_ENTRY_SIZE);
+
+    ProfileHeader parsed;
+    TEST_ASSERT_TRUE(readHeader(dump, sizeof(dump), parsed));
+    TEST_ASSERT_EQUAL_UINT32(250, parsed.sampleHz);
+    TEST_ASSERT_EQUAL_UINT32(3, parsed.droppedSamples);
+    TEST_ASSERT_EQUAL_UINT32(30000, parsed.durationMs);
+    // Task names are truncated and always NUL-terminated
+    const char *name = (const char *)(dump + PROFILE_HEADER_SIZE + 4);
+    TEST_ASSERT_EQUAL(PROFILE_TASK_NAME_LEN - 1, (int)strlen(name));
+
+    ProfileSample back;
+    readSample(dump + PROFILE_HEADER_SIZE + PROFILE_TASK_ENTRY_SIZE, back);
+    TEST_ASSERT_EQUAL_UINT32(0x3FC9A000, back.task);
+    TEST_ASSERT_EQUAL_UINT8(1, back.core);
+    TEST_ASSERT_EQUAL_UINT8(3, back.depth);
+    TEST_ASSERT_EQUAL_UINT32(0x40380000, back.pc[2]);
+    TEST_ASSERT_EQUAL_UINT32(0, back.pc[3]);
+}
+
+void test_profile_format_rejects_bad_input(void) {
+    using namespace CpuProfileFormat;
+    uint8_t dump[PROFILE_HEADER_SIZE + PROFILE_SAMPLE_SIZE];
+    ProfileHeader header = {PROFILE_VERSION, PROFILE_MAX_DEPTH, 250, 2, 0, 0, 1000};
+    ProfileHeader parsed;
+
+    writeHeader(header, dump);
+    TEST_ASSERT_FALSE(readHeader(dump, sizeof(dump), parsed));  // 2 samples declared, 1 present
+    header.sampleCount = 1;
+    writeHeader(header, dump);
+    TEST_ASSERT_TRUE(readHeader(dump, sizeof(dump), parsed));
+    TEST_ASSERT_FALSE(readHeader(dump, PROFILE_HEADER_SIZE - 1, parsed));
+    dump[0] = 'X';
+    TEST_ASSERT_FALSE(readHeader(dump, sizeof(dump), parsed));
+    writeHeader(header, dump);
+    putU16(dump + 4, PROFILE_VERSION + 1);
+    TEST_ASSERT_FALSE(readHeader(dump, sizeof(dump), parsed));
+
+    // A corrupt depth byte cannot index past pc[]
+    ProfileSample sample = {0, 0, 0, 0, {0}};
+    writeSample(sample, dump + PROFILE_HEADER_SIZE);
+    dump[PROFILE_HEADER_SIZE + 5] = 200;
+    readSample(dump + PROFILE_HEADER_SIZE, sample);
+    TEST_ASSERT_EQUAL_UINT8(PROFILE_MAX_DEPTH, sample.depth);
+}
+
+// ============================================
+// BINARY LOG FORMAT TESTS
+// ============================================
+
+static const char *renderRecord(const char *format, const uint8_t *record, char *out, size_t outSize) {
+    BinaryLogFormat::formatRecord(format, record + BinaryLogFormat::RECORD_HEADER_SIZE,
+                                  record[0] - BinaryLogFormat::RECORD_HEADER_SIZE, out, outSize);
+    return out;
+}
+
+void test_binlog_record_round_trip(void) {
+    uint8_t record[BinaryLogFormat::MAX_RECORD_SIZE];
+    char text[128];
+    const char *format = "Valve %d: closing, duration=%lus%s";
+    size_t len = BinaryLogFormat::encodeRecord(record, BinaryLogFormat::LEVEL_INFO, 0x3C0123A0,
+                                               123456, 3, 27UL, " TIMEOUT");
+    // Header + two 4-byte ints + 1-byte length + 8 chars
+    TEST_ASSERT_EQUAL(BinaryLogFormat::RECORD_HEADER_SIZE + 4 + 4 + 1 + 8, (int)len);
+    TEST_ASSERT_EQUAL_UINT8(len, record[0]);
+    TEST_ASSERT_EQUAL_UINT8(BinaryLogFormat::LEVEL_INFO, record[1]);
+    TEST_ASSERT_EQUAL_UINT32(0x3C0123A0, BinaryLogFormat::getU32(record + 2));
+    TEST_ASSERT_EQUAL_UINT32(123456, BinaryLogFormat::getU32(record + 6));
+    TEST_ASSERT_EQUAL_STRING("Valve 3: closing, duration=27s TIMEOUT",
+                             renderRecord(format, record, text, sizeof(text)));
+
+    BinaryLogFormat::encodeRecord(record, BinaryLogFormat::LEVEL_WARN, 1, 0,
+                                  -5, 0xBEEFu, 1.5f, 1234567890123LL, 'x');
+    TEST_ASSERT_EQUAL_STRING("[-5] 0000beef 1.50 100% 1234567890123 x",
+                             renderRecord("[%d] %08x %.2f 100%% %lld %c", record, text, sizeof(text)));
+}
+
+void test_binlog_strings_are_truncated_and_missing_args_marked(void) {
+    uint8_t record[BinaryLogFormat::MAX_RECORD_SIZE];
+    char text[128];
+    const char *longName = "this-trigger-name-is-much-longer-than-the-limit";
+    BinaryLogFormat::encodeRecord(record, BinaryLogFormat::LEVEL_INFO, 1, 0, longName);
+    TEST_ASSERT_EQUAL(BinaryLogFormat::MAX_STRING_ARG, (int)strlen(renderRecord("%s", record, text, sizeof(text))));
+
+    // Format asks for more than the record carries
+    BinaryLogFormat::encodeRecord(record, BinaryLogFormat::LEVEL_INFO, 1, 0, 7);
+    TEST_ASSERT_EQUAL_STRING("7 <?> <?>", renderRecord("%d %s %u", record, text, sizeof(text)));
+
+    // Output buffer smaller than the text: truncated, still terminated
+    BinaryLogFormat::encodeRecord(record, BinaryLogFormat::LEVEL_INFO, 1, 0, 123456);
+    TEST_ASSERT_EQUAL_STRING("value=12", renderRecord("value=%d", record, text, 9));
+}
+
+void test_binlog_oversized_arguments_are_dropped_whole(void) {
+    uint8_t record[BinaryLogFormat::MAX_RECORD_SIZE];
+    const char *s = "0123456789012345678901234567890123456789";
+    // 10 + 7 x 33 = 241; the eighth string would pass 255 and is left out
+    size_t len = BinaryLogFormat::encodeRecord(record, BinaryLogFormat::LEVEL_INFO, 1, 0,
+                                               s, s, s, s, s, s, s, s, 42);
+    TEST_ASSERT_EQUAL(241, (int)len);
+    TEST_ASSERT_EQUAL_UINT8(241, record[0]);
+}
+
+void test_binlog_collect_new_formats(void) {
+    uint8_t records[3 * BinaryLogFormat::MAX_RECORD_SIZE];
+    size_t len = 0;
+    len += BinaryLogFormat::encodeRecord(records + len, 1, 100, 0, 1);
+    len += BinaryLogFormat::encodeRecord(records + len, 1, 200, 0);
+    len += BinaryLogFormat::encodeRecord(records + len, 1, 100, 0, 2);
+    len += BinaryLogFormat::encodeRecord(records + len, 1, 300, 0, "x");
+
+    const uint32_t known[1] = {200};
+    uint32_t found[4];
+    int count = BinaryLogFormat::collectNewFormats(records, len, known, 1, found, 4);
+    TEST_ASSERT_EQUAL(2, count);
+    TEST_ASSERT_EQUAL_UINT32(100, found[0]);
+    TEST_ASSERT_EQUAL_UINT32(300, found[1]);
+    TEST_ASSERT_EQUAL(1, BinaryLogFormat::collectNewFormats(records, len, known, 1, found, 1));
+}
+
+// ============================================
+// LOG LEVEL TESTS
+// ============================================
+
+void test_log_level_parse_names(void) {
+    TEST_ASSERT_EQUAL(LOG_SYS_VALVE, LogLevelLogic::parseSubsystem("valve"));
+    TEST_ASSERT_EQUAL(LOG_SYS_NETWORK, LogLevelLogic::parseSubsystem("network"));
+    TEST_ASSERT_EQUAL(LOG_SYS_COUNT, LogLevelLogic::parseSubsystem("all"));
+    TEST_ASSERT_EQUAL(-1, LogLevelLogic::parseSubsystem("Valve"));
+    TEST_ASSERT_EQUAL(-1, LogLevelLogic::parseSubsystem(""));
+
+    TEST_ASSERT_EQUAL(LOG_LEVEL_DEBUG, LogLevelLogic::parseLevel("debug"));
+    TEST_ASSERT_EQUAL(LOG_LEVEL_WARN, LogLevelLogic::parseLevel("warning"));
+    TEST_ASSERT_EQUAL(LOG_LEVEL_OFF, LogLevelLogic::parseLevel("off"));
+    TEST_ASSERT_EQUAL(-1, LogLevelLogic::parseLevel("verbose"));
+
+    for (int s = 0; s < LOG_SYS_COUNT; s++) {
+        TEST_ASSERT_EQUAL(s, LogLevelLogic::parseSubsystem(LogLevelLogic::subsystemName(s)));
+    }
+}
+
+void test_log_rate_limit_counts_suppressed_calls(void) {
+    LogLevelLogic::RateLimit limit = {0, 0, false};
+    uint32_t suppressed = 99;
+
+    // First call always passes, even at t=0
+    TEST_ASSERT_TRUE(LogLevelLogic::allow(limit, 0, 5000, suppressed));
+    TEST_ASSERT_EQUAL_UINT32(0, suppressed);
+
+    for (unsigned long t = 100; t < 5000; t += 100) {
+        TEST_ASSERT_FALSE(LogLevelLogic::allow(limit, t, 5000, suppressed));
+    }
+    TEST_ASSERT_TRUE(LogLevelLogic::allow(limit, 5000, 5000, suppressed));
+    TEST_ASSERT_EQUAL_UINT32(49, suppressed);
+
+    TEST_ASSERT_TRUE(LogLevelLogic::allow(limit, 20000, 5000, suppressed));
+    TEST_ASSERT_EQUAL_UINT32(0, suppressed);
+}
+
+void test_log_rate_limit_survives_millis_rollover(void) {
+    LogLevelLogic::RateLimit limit = {0, 0, false};
+    uint32_t suppressed = 0;
+    unsigned long start = ~0UL - 1000;
+
+    TEST_ASSERT_TRUE(LogLevelLogic::allow(limit, start, 5000, suppressed));
+    TEST_ASSERT_FALSE(LogLevelLogic::allow(limit, start + 3000, 5000, suppressed));
+    TEST_ASSERT_TRUE(LogLevelLogic::allow(limit, start + 5000, 5000, suppressed));
+    TEST_ASSERT_EQUAL_UINT32(1, suppressed);
+}
+
+// ============================================
+// CHROME TRACE FORMAT TESTS
+// ============================================
+
+void test_trace_format_event_phases(void) {
+    char out[256];
+    TraceEventFormat::TraceEvent e = {3000123ULL, "rain_sensor", 1850, 2,
+                                      TraceEventFormat::PH_COMPLETE,
+                                      TraceEventFormat::TRACE_CAT_SENSOR, 1};
+    TEST_ASSERT_TRUE(TraceEventFormat::formatEvent(e, out, sizeof(out)) > 0);
+    TEST_ASSERT_EQUAL_STRING("{\"name\":\"rain_sensor\",\"cat\":\"sensor\",\"ph\":\"X\",\"ts\":3000123,"
+                             "\"pid\":1,\"tid\":1,\"dur\":1850,\"args\":{\"arg\":2}}", out);
+
+    e.value = TraceEventFormat::NO_ARG;
+    TraceEventFormat::formatEvent(e, out, sizeof(out));
+    TEST_ASSERT_NULL(strstr(out, "args"));
+
+    TraceEventFormat::TraceEvent phase = {42, "watering", 0, 5,
+                                          TraceEventFormat::PH_ASYNC_BEGIN,
+                                          TraceEventFormat::TRACE_CAT_VALVE, 1};
+    TraceEventFormat::formatEvent(phase, out, sizeof(out));
+    TEST_ASSERT_EQUAL_STRING("{\"name\":\"watering\",\"cat\":\"valve\",\"ph\":\"b\",\"ts\":42,"
+                             "\"pid\":1,\"tid\":1,\"id\":5}", out);
+
+    TraceEventFormat::TraceEvent pump = {1000000ULL, "pump", 0, 1,
+                                         TraceEventFormat::PH_COUNTER,
+                                         TraceEventFormat::TRACE_CAT_PUMP, 1};
+    TraceEventFormat::formatEvent(pump, out, sizeof(out));
+    TEST_ASSERT_EQUAL_STRING("{\"name\":\"pump\",\"cat\":\"pump\",\"ph\":\"C\",\"ts\":1000000,"
+                             "\"pid\":1,\"tid\":1,\"args\":{\"value\":1}}", out);
+}
+
+void test_trace_format_truncation_and_ring_window(void) {
+    char out[40];
+    TraceEventFormat::TraceEvent e = {1, "http_request", 10, TraceEventFormat::NO_ARG,
+                                      TraceEventFormat::PH_COMPLETE,
+                                      TraceEventFormat::TRACE_CAT_HTTP, 0};
+    TEST_ASSERT_EQUAL(0, (int)TraceEventFormat::formatEvent(e, out, sizeof(out)));
+
+    // Hours of uptime stay exact past 2^32 microseconds
+    char ts[24];
+    TraceEventFormat::formatMicros(7200000005ULL, ts, sizeof(ts));
+    TEST_ASSERT_EQUAL_STRING("7200000005", ts);
+
+    TEST_ASSERT_EQUAL_UINT32(0, TraceEventFormat::oldestIndex(100, 8192));
+    TEST_ASSERT_EQUAL_UINT32(0, TraceEventFormat::oldestIndex(8192, 8192));
+    TEST_ASSERT_EQUAL_UINT32(1808, TraceEventFormat::oldestIndex(10000, 8192));
+}
+
+// ============================================
+// LOGIC CAPTURE FRAME TESTS
+// ============================================
+
+void test_scope_frame_round_trip(void) {
+    using namespace ScopeCaptureFormat;
+    ScopeEdge edges[3] = {{1000100, 0x0001}, {1000300, 0x0101}, {1200300, 0x0100}};
+    ScopeFrameHeader h = {1000, SCOPE_CHANNEL_COUNT, 1000000, 1250000, 250, 2, 0x0000, 0};
+    uint8_t frame[SCOPE_HEADER_SIZE + 3 * SCOPE_MAX_EDGE_SIZE];
+    size_t len = encodeFrame(h, edges, 3, frame, sizeof(frame));
+    TEST_ASSERT_EQUAL(3, h.edgeCount);
+    // Deltas 100/200/200000 take 1/2/3 varint bytes, plus 2 mask bytes each
+    TEST_ASSERT_EQUAL((int)(SCOPE_HEADER_SIZE + 3 + 4 + 5), (int)len);
+
+    ScopeFrameHeader d;
+    ScopeEdge out[4];
+    TEST_ASSERT_EQUAL(3, decodeFrame(frame, len, d, out, 4));
+    TEST_ASSERT_EQUAL_UINT32(1000000, d.startUs);
+    TEST_ASSERT_EQUAL_UINT32(1250000, d.endUs);
+    TEST_ASSERT_EQUAL_UINT32(250, d.samples);
+    TEST_ASSERT_EQUAL_UINT16(2, d.droppedEdges);
+    TEST_ASSERT_EQUAL_UINT16(1000, d.intervalUs);
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_UINT32(edges[i].tsUs, out[i].tsUs);
+        TEST_ASSERT_EQUAL_UINT16(edges[i].mask, out[i].mask);
+    }
+
+    TEST_ASSERT_EQUAL(-1, decodeFrame(frame, len - 1, d, out, 4));
+    TEST_ASSERT_EQUAL(-1, decodeFrame(frame, len, d, out, 2));
+}
+
+void test_scope_frame_splits_and_handles_timer_wrap(void) {
+    using namespace ScopeCaptureFormat;
+    // Timestamps cross the u32 microsecond wrap (~71 min of uptime)
+    ScopeEdge edges[3] = {{0xFFFFFF00UL, 1}, {0x00000010UL, 0}, {0x00000020UL, 1}};
+    ScopeFrameHeader h = {500, SCOPE_CHANNEL_COUNT, 0xFFFFFE00UL, 0x100, 10, 0, 0, 0};
+    uint8_t frame[SCOPE_HEADER_SIZE + 2 * SCOPE_MAX_EDGE_SIZE];
+    size_t len = encodeFrame(h, edges, 3, frame, sizeof(frame));
+    TEST_ASSERT_EQUAL(2, h.edgeCount);  // Third edge left for the next frame
+
+    ScopeFrameHeader d;
+    ScopeEdge out[2];
+    TEST_ASSERT_EQUAL(2, decodeFrame(frame, len, d, out, 2));
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFF00UL, out[0].tsUs);
+    TEST_ASSERT_EQUAL_UINT32(0x00000010UL, out[1].tsUs);
+}
+
+// ============================================
+// SENSOR TRACE REPLAY TESTS
+// ============================================
+// Synthetic .wsc captures stand in for recorded ones here. Point
+// SENSOR_TRACE_FILE at a real capture to get a parameter sweep report.
+
+// Rain sensor 1 (channel 0): dry, one 150 ms LOW spike at 3 s (pump relay
+// EMI), then wet for good from 8 s. Written as several frames with the
+// device timer about to wrap.
+static std::vector<uint8_t> buildSpikeThenWetTrace() {
+    using namespace ScopeCaptureFormat;
+    const uint32_t t0 = 0xFFFFFFFFUL - 2000000UL;
+    const uint32_t ms = 1000;
+    ScopeEdge edges[3] = {{t0 + 3000 * ms, 0x3FE}, {t0 + 3150 * ms, 0x3FF},
+                          {t0 + 8000 * ms, 0x3FE}};
+    // Frames: [0,2.5s) no edges, [2.5s,5s) spike, [5s,12s) wet onset
+    const uint32_t bounds[4] = {t0, t0 + 2500 * ms, t0 + 5000 * ms, t0 + 12000 * ms};
+    const int first[3] = {0, 0, 2};
+    const int count[3] = {0, 2, 1};
+    const uint16_t startMask[3] = {0x3FF, 0x3FF, 0x3FF};
+
+    std::vector<uint8_t> file;
+    uint8_t frame[SCOPE_HEADER_SIZE + 4 * SCOPE_MAX_EDGE_SIZE];
+    for (int f = 0; f < 3; f++) {
+        ScopeFrameHeader h = {1000, SCOPE_CHANNEL_COUNT, bounds[f], bounds[f + 1],
+                              (bounds[f + 1] - bounds[f]) / 1000, 0, startMask[f], 0};
+        size_t len = encodeFrame(h, edges + first[f], count[f], frame, sizeof(frame));
+        uint8_t prefix[4];
+        putU32(prefix, (uint32_t)len);
+        file.insert(file.end(), prefix, prefix + 4);
+        file.insert(file.end(), frame, frame + len);
+    }
+    return file;
+}
+
+void test_trace_replay_loads_capture_across_timer_wrap(void) {
+    std::vector<uint8_t> file = buildSpikeThenWetTrace();
+    SensorTraceReplay::Trace trace;
+    TEST_ASSERT_TRUE(SensorTraceReplay::loadTrace(file.data(), file.size(), trace));
+    TEST_ASSERT_EQUAL(3, (int)trace.edgeUs.size());
+    TEST_ASSERT_EQUAL_UINT64(12000000ULL, trace.durationUs);
+    TEST_ASSERT_EQUAL_UINT64(8000000ULL, trace.edgeUs[2]);
+
+    TEST_ASSERT_EQUAL(1, SensorTraceReplay::levelAt(trace, 0, 2999000));
+    TEST_ASSERT_EQUAL(0, SensorTraceReplay::levelAt(trace, 0, 3100000));
+    TEST_ASSERT_EQUAL(1, SensorTraceReplay::levelAt(trace, 0, 3150000));
+    TEST_ASSERT_EQUAL(1, SensorTraceReplay::levelAt(trace, 1, 9000000));
+    // The 150 ms spike is not ground truth; the sustained LOW at 8 s is
+    TEST_ASSERT_EQUAL(8000, SensorTraceReplay::truthWetOnsetMs(trace, 0, 1000));
+
+    file.pop_back();
+    TEST_ASSERT_FALSE(SensorTraceReplay::loadTrace(file.data(), file.size(), trace));
+}
+
+void test_trace_replay_scores_parameter_sets(void) {
+    std::vector<uint8_t> file = buildSpikeThenWetTrace();
+    SensorTraceReplay::Trace trace;
+    TEST_ASSERT_TRUE(SensorTraceReplay::loadTrace(file.data(), file.size(), trace));
+
+    // Firmware constants ride out the spike and confirm within ~3 polls
+    SensorTraceReplay::Params firmware = SensorTraceReplay::firmwareRainParams();
+    SensorTraceReplay::Result r = SensorTraceReplay::replayValveCycle(trace, 0, firmware, 1000);
+    TEST_ASSERT_TRUE(r.decided);
+    TEST_ASSERT_FALSE(r.falsePositive);
+    TEST_ASSERT_TRUE(r.latencyMs >= 200 && r.latencyMs <= 400);
+    TEST_ASSERT_TRUE(r.wetPollsWhileDry >= 1);  // The spike is seen, just not confirmed
+
+    // Single read, no confirmation: the spike ends the fill at ~3 s
+    SensorTraceReplay::Params naive = {1, 0, 1, 1, 100};
+    r = SensorTraceReplay::replayValveCycle(trace, 0, naive, 1000);
+    TEST_ASSERT_TRUE(r.decided);
+    TEST_ASSERT_TRUE(r.falsePositive);
+    TEST_ASSERT_TRUE(r.decisionMs >= 3000 && r.decisionMs < 3150);
+
+    // Overflow channel never goes LOW: nothing to decide
+    r = SensorTraceReplay::replayOverflow(trace, ScopeCaptureFormat::SCOPE_CH_OVERFLOW,
+                                          SensorTraceReplay::firmwareOverflowParams(), 1000);
+    TEST_ASSERT_FALSE(r.decided);
+    TEST_ASSERT_EQUAL(-1, r.truthOnsetMs);
+    TEST_ASSERT_EQUAL(0, r.wetPollsWhileDry);
+}
+
+// SENSOR_TRACE_FILE=capture.wsc [SENSOR_TRACE_CHANNEL=0]: sweep threshold and
+// confirmation counts over a real capture and print one line per set.
+void test_trace_replay_report_for_recorded_file(void) {
+    const char *path = getenv("SENSOR_TRACE_FILE");
+    if (path == NULL) return;
+    const char *channelArg = getenv("SENSOR_TRACE_CHANNEL");
+    int channel = channelArg ? atoi(channelArg) : 0;
+
+    SensorTraceReplay::Trace trace;
+    TEST_ASSERT_TRUE_MESSAGE(SensorTraceReplay::loadTraceFile(path, trace),
+                             "SENSOR_TRACE_FILE is not a readable .wsc capture");
+    char line[256];
+    snprintf(line, sizeof(line), "trace %s: %.1fs, %u edges, %u dropped, channel %d",
+             path, trace.durationUs / 1e6, (unsigned)trace.edgeUs.size(),
+             (unsigned)trace.droppedEdges, channel);
+    TEST_MESSAGE(line);
+
+    bool overflow = channel == ScopeCaptureFormat::SCOPE_CH_OVERFLOW;
+    SensorTraceReplay::Params base = overflow ? SensorTraceReplay::firmwareOverflowParams()
+                                              : SensorTraceReplay::firmwareRainParams();
+    for (int threshold = 1; threshold <= base.samples; threshold++) {
+        for (int confirmations = 1; confirmations <= 5; confirmations++) {
+            SensorTraceReplay::Params p = base;
+            p.threshold = threshold;
+            p.confirmations = confirmations;
+            SensorTraceReplay::Result r =
+                overflow ? SensorTraceReplay::replayOverflow(trace, channel, p, 1000)
+                         : SensorTraceReplay::replayValveCycle(trace, channel, p, 1000);
+            SensorTraceReplay::formatResult(p, r, line, sizeof(line));
+            TEST_MESSAGE(line);
+        }
+    }
+}
+
+// ============================================
+// CONTROL TICK ALLOCATION BUDGET TESTS
+// ============================================
+// Long uptime depends on the control path not fragmenting the heap: outside
+// the publish stage a steady-state tick must not allocate at all, and the
+// only budgeted allocation there is the trigger String of an auto-watering
+// enqueue. The publish stage (every STATE_PUBLISH_INTERVAL) still builds the
+// status JSON as a String; PUBLISH_ALLOC_BUDGET is its cost for NUM_VALVES
+// valves, so growing it is a visible change to this number.
+
+static const unsigned long CONTROL_TICK_ALLOC_BUDGET = 0;
+static const unsigned long AUTO_ENQUEUE_ALLOC_BUDGET = 1;
+static const unsigned long PUBLISH_ALLOC_BUDGET = 40 + 35 * NUM_VALVES;
+static const unsigned long SIM_TICK_MS = 10;  // loop() delay(10)
+
+struct TickAllocStats {
+    unsigned long ticks;
+    unsigned long publishes;
+    unsigned long worstTickAllocs;     // Outside the publish stage
+    unsigned long worstTickAt;
+    unsigned long worstPublishAllocs;
+    char worstTickReport[256];
+};
+
+// Run ticks until `done` holds (or maxMs elapses), recording the tick that
+// allocated most outside the publish stage (with its per-scope report) and
+// the most expensive publish.
+static void simRun(ControlLoopSim::Sim& sim, unsigned long& now, unsigned long maxMs,
+                   bool (*done)(const ControlLoopSim::Sim&), TickAllocStats& stats) {
+    unsigned long end = now + maxMs;
+    stats.ticks = 0;
+    stats.publishes = 0;
+    stats.worstTickAllocs = 0;
+    stats.worstTickAt = 0;
+    stats.worstPublishAllocs = 0;
+    strcpy(stats.worstTickReport, "no allocations");
+    while (now < end && !(done && done(sim))) {
+        unsigned long publishCount = sim.publishCount;
+        AllocationCounter::start();
+        ControlLoopSim::tick(sim, now);
+        AllocationCounter::stop();
+        unsigned long publishAllocs = AllocationCounter::allocationsIn("publish");
+        unsigned long tickAllocs = AllocationCounter::allocations() - publishAllocs;
+        if (sim.publishCount != publishCount) stats.publishes++;
+        if (publishAllocs > stats.worstPublishAllocs) stats.worstPublishAllocs = publishAllocs;
+        if (tickAllocs > stats.worstTickAllocs) {
+            stats.worstTickAllocs = tickAllocs;
+            stats.worstTickAt = now;
+            AllocationCounter::report(stats.worstTickReport, sizeof(stats.worstTickReport));
+        }
+        stats.ticks++;
+        now += SIM_TICK_MS;
+    }
+}
+
+static bool simCycleFinished(const ControlLoopSim::Sim& sim) {
+    return sim.completedCycles + sim.timeouts > 0 && sim.activeValve == -1;
+}
+
+void test_alloc_counter_attributes_allocations_to_scope(void) {
+    AllocationCounter::start();
+    {
+        AllocationCounter::Scope scope("test:new");
+        int* value = new int(7);
+        delete value;
+    }
+    {
+        AllocationCounter::Scope scope("test:string");
+        String text("a trigger label longer than any small-string buffer");
+        TEST_ASSERT_TRUE(text.length() > 0);
+    }
+    AllocationCounter::stop();
+    int* untracked = new int(8);  // Counting is off again
+    delete untracked;
+
+    TEST_ASSERT_EQUAL_UINT32(1, AllocationCounter::allocationsIn("test:new"));
+    TEST_ASSERT_TRUE(AllocationCounter::allocationsIn("test:string") >= 1);
+    TEST_ASSERT_EQUAL_UINT32(AllocationCounter::allocationsIn("test:new") +
+                             AllocationCounter::allocationsIn("test:string"),
+                             AllocationCounter::allocations());
+    char report[128];
+    TEST_ASSERT_NOT_NULL(strstr(AllocationCounter::report(report, sizeof(report)), "test:new: 1 alloc"));
+}
+
+void test_alloc_idle_control_ticks_allocate_nothing(void) {
+    ControlLoopSim::Sim sim;
+    unsigned long now = 1000;
+    ControlLoopSim::init(sim, now);
+    TickAllocStats stats;
+    simRun(sim, now, 600000, nullptr, stats);  // 10 minutes, lamp + publish stages included
+    ControlLoopSim::destroy(sim);
+
+    TEST_ASSERT_EQUAL_UINT32(60000, stats.ticks);
+    TEST_ASSERT_EQUAL_UINT32(600000 / STATE_PUBLISH_INTERVAL - 1, stats.publishes);  // First one an interval in
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(CONTROL_TICK_ALLOC_BUDGET, stats.worstTickAllocs, stats.worstTickReport);
+    TEST_ASSERT_TRUE(stats.worstPublishAllocs > 0);
+    TEST_ASSERT_TRUE(stats.worstPublishAllocs <= PUBLISH_ALLOC_BUDGET);
+}
+
+// Worst case for the publish stage: every valve calibrated and watering adds
+// the optional learning and progress fields.
+void test_alloc_publish_with_every_field_stays_in_budget(void) {
+    ControlLoopSim::Sim sim;
+    unsigned long now = 1000;
+    ControlLoopSim::init(sim, now);
+    for (int i = 0; i < NUM_VALVES; i++) {
+        ValveController* valve = sim.valves[i];
+        valve->isCalibrated = true;
+        valve->baselineFillDuration = 123456;
+        valve->lastFillDuration = 123456;
+        valve->emptyToFullDuration = 86400000;
+        valve->totalWateringCycles = 1234;
+        valve->phase = PHASE_WATERING;
+        valve->wateringStartTime = 500;
+    }
+    AllocationCounter::start();
+    {
+        AllocationCounter::Scope scope("publish");
+        ControlLoopSim::publishState(sim, now + 19500);
+    }
+    AllocationCounter::stop();
+    ControlLoopSim::destroy(sim);
+
+    char report[128];
+    AllocationCounter::report(report, sizeof(report));
+    TEST_ASSERT_NOT_NULL(strstr(sim.lastStateJson.c_str(), "\"remaining_seconds\":5"));
+    TEST_ASSERT_TRUE_MESSAGE(AllocationCounter::allocations() <= PUBLISH_ALLOC_BUDGET, report);
+}
+
+void test_alloc_manual_watering_cycle_stays_in_budget(void) {
+    ControlLoopSim::Sim sim;
+    unsigned long now = 1000;
+    ControlLoopSim::init(sim, now);
+    // Enqueued from the network core in the firmware, i.e. outside any tick.
+    // The label is deliberately longer than any String SSO buffer, so a copy
+    // anywhere in the dequeue path shows up as an allocation.
+    TEST_ASSERT_TRUE(ControlLoopSim::request(sim, 2, "Manual (web dashboard, tray 3)", true));
+
+    // Dry until 8s into the cycle, then the tray reads wet
+    TickAllocStats stats;
+    simRun(sim, now, 8000, nullptr, stats);
+    TEST_ASSERT_EQUAL(PHASE_WATERING, sim.valves[2]->phase);
+    TEST_ASSERT_TRUE(sim.pumpOn);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(CONTROL_TICK_ALLOC_BUDGET, stats.worstTickAllocs, stats.worstTickReport);
+
+    sim.in.rainLowReadings[2] = 7;
+    simRun(sim, now, 60000, simCycleFinished, stats);
+    ControlLoopSim::destroy(sim);
+
+    TEST_ASSERT_EQUAL(1, sim.completedCycles);
+    TEST_ASSERT_EQUAL(0, sim.timeouts);
+    TEST_ASSERT_FALSE(sim.pumpOn);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(CONTROL_TICK_ALLOC_BUDGET, stats.worstTickAllocs, stats.worstTickReport);
+    TEST_ASSERT_TRUE(stats.worstPublishAllocs <= PUBLISH_ALLOC_BUDGET);
+}
+
+void test_alloc_auto_watering_cycle_only_pays_for_enqueue(void) {
+    ControlLoopSim::Sim sim;
+    unsigned long now = 200000;
+    ControlLoopSim::init(sim, now);
+    ValveController* valve = sim.valves[4];
+    valve->isCalibrated = true;
+    valve->emptyToFullDuration = 100000;
+    valve->lastWateringCompleteTime = 50000;  // Due: 150s since the last fill
+    sim.in.rainLowReadings[4] = 0;
+
+    AllocationCounter::start();
+    unsigned long tickAllocMax = 0;
+    unsigned long wetAt = now + 6000;
+    while (!simCycleFinished(sim) && now < 300000) {
+        if (now >= wetAt) sim.in.rainLowReadings[4] = 6;
+        unsigned long before = AllocationCounter::allocations() - AllocationCounter::allocationsIn("publish");
+        ControlLoopSim::tick(sim, now);
+        unsigned long spent = AllocationCounter::allocations() - AllocationCounter::allocationsIn("publish") - before;
+        if (spent > tickAllocMax) tickAllocMax = spent;
+        now += SIM_TICK_MS;
+    }
+    AllocationCounter::stop();
+    ControlLoopSim::destroy(sim);
+
+    char report[256];
+    AllocationCounter::report(report, sizeof(report));
+    unsigned long outsidePublish = AllocationCounter::allocations() - AllocationCounter::allocationsIn("publish");
+    TEST_ASSERT_EQUAL(1, sim.completedCycles);
+    TEST_ASSERT_TRUE_MESSAGE(outsidePublish <= AUTO_ENQUEUE_ALLOC_BUDGET, report);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(outsidePublish,
+                                     AllocationCounter::allocationsIn("auto_watering:enqueue"), report);
+    TEST_ASSERT_TRUE_MESSAGE(tickAllocMax <= AUTO_ENQUEUE_ALLOC_BUDGET, report);
+}
+
+void test_alloc_overflow_emergency_stop_allocates_nothing(void) {
+    ControlLoopSim::Sim sim;
+    unsigned long now = 1000;
+    ControlLoopSim::init(sim, now);
+    ControlLoopSim::request(sim, 0, "Manual (web dashboard, tray 1)", true);
+    ControlLoopSim::request(sim, 1, "Manual (web dashboard, tray 2)", true);
+    TickAllocStats stats;
+    simRun(sim, now, 3000, nullptr, stats);
+    TEST_ASSERT_TRUE(sim.pumpOn);
+
+    sim.in.overflowLowReadings = 7;
+    simRun(sim, now, 1000, nullptr, stats);
+    ControlLoopSim::destroy(sim);
+
+    TEST_ASSERT_TRUE(sim.overflowDetected);
+    TEST_ASSERT_FALSE(sim.pumpOn);
+    TEST_ASSERT_EQUAL(0, sim.queueLength);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(CONTROL_TICK_ALLOC_BUDGET, stats.worstTickAllocs, stats.worstTickReport);
+}
+
+// ============================================
+// CONTROL LOOP FUZZ TESTS
+// ============================================
+// Random sensor/time/command sequences through ControlLoopSim with the safety
+// invariants checked after every tick. FUZZ_SEED and FUZZ_SEQUENCES override
+// the defaults (e.g. FUZZ_SEQUENCES=1000000 for a long soak); a failure prints
+// the shrunk repro.
+
+static const unsigned long FUZZ_DEFAULT_SEQUENCES = 3000;
+static const size_t FUZZ_SEQUENCE_LENGTH = 200;
+
+void test_fuzz_control_loop_invariants(void) {
+    const char *seedArg = getenv("FUZZ_SEED");
+    const char *countArg = getenv("FUZZ_SEQUENCES");
+    uint64_t seed = seedArg ? strtoull(seedArg, NULL, 0) : 0x5EEDULL;
+    unsigned long sequences = countArg ? strtoul(countArg, NULL, 0) : FUZZ_DEFAULT_SEQUENCES;
+
+    clock_t start = clock();
+    StateMachineFuzz::Report report =
+        StateMachineFuzz::campaign(seed, sequences, FUZZ_SEQUENCE_LENGTH);
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    char line[160];
+    snprintf(line, sizeof(line), "fuzz: seed 0x%llx, %lu sequences, %lu ops, %lu ticks in %.2fs (%.0f ops/s)",
+             (unsigned long long)seed, report.sequences, report.ops, report.ticks, seconds,
+             seconds > 0 ? report.ops / seconds : 0.0);
+    TEST_MESSAGE(line);
+
+    if (report.failed) {
+        char repro[4096];
+        StateMachineFuzz::formatRepro(report.repro, report.failure, repro, sizeof(repro));
+        snprintf(line, sizeof(line), "fuzz: invariant %d broken by sequence %lu (FUZZ_SEED=0x%llx), shrunk to %u ops:",
+                 report.failure.violation, report.failingSequence,
+                 (unsigned long long)(seed + report.failingSequence), (unsigned)report.repro.size());
+        TEST_MESSAGE(line);
+        TEST_MESSAGE(repro);
+        TEST_FAIL_MESSAGE(report.failure.why);
+    }
+}
+
+// Deliberately false property: no valve may ever start watering.
+static int fuzzNeverWaters(const ControlLoopSim::Sim &sim, unsigned long now,
+                           char *why, size_t whySize) {
+    (void)now;
+    if (!ControlLoopSim::anyWatering(sim)) return StateMachineFuzz::INV_OK;
+    snprintf(why, whySize, "a valve reached PHASE_WATERING");
+    return 99;
+}
+
+void test_fuzz_shrinks_failure_to_minimal_repro(void) {
+    StateMachineFuzz::Report report =
+        StateMachineFuzz::campaign(1, 100, FUZZ_SEQUENCE_LENGTH, fuzzNeverWaters);
+    TEST_ASSERT_TRUE(report.failed);
+    TEST_ASSERT_EQUAL(99, report.failure.violation);
+
+    // Request, then enough ticks to open, stabilize, check the sensor and
+    // start the pump: a handful of ops out of 200.
+    TEST_ASSERT_TRUE(report.repro.size() <= 5);
+    TEST_ASSERT_EQUAL(StateMachineFuzz::OP_REQUEST, report.repro[0].type);
+    TEST_ASSERT_EQUAL(StateMachineFuzz::OP_ADVANCE, report.repro.back().type);
+
+    // The repro replays on its own, and the same seed regenerates the same case
+    StateMachineFuzz::Failure replay = StateMachineFuzz::run(
+        report.repro.data(), report.repro.size(), fuzzNeverWaters);
+    TEST_ASSERT_EQUAL(99, replay.violation);
+    StateMachineFuzz::Report again =
+        StateMachineFuzz::campaign(1, 100, FUZZ_SEQUENCE_LENGTH, fuzzNeverWaters);
+    TEST_ASSERT_EQUAL_UINT32(report.failingSequence, again.failingSequence);
+    TEST_ASSERT_EQUAL_UINT32(report.repro.size(), again.repro.size());
+}
+
+// The simulator runs the firmware's watchdog against runtime timeouts: a
+// lowered emergency timeout trips it, and the pump stays on while another
+// valve still waters.
+void test_watchdog_uses_runtime_emergency_timeout(void) {
+    ControlLoopSim::Sim sim;
+    ControlLoopSim::init(sim, 1000);
+    TEST_ASSERT_TRUE(ControlLoopSim::setConfig(sim, "normal_timeout_ms.2", 10000));
+    TEST_ASSERT_TRUE(ControlLoopSim::setConfig(sim, "emergency_timeout_ms.2", 15000));
+    TEST_ASSERT_FALSE(ControlLoopSim::setConfig(sim, "emergency_timeout_ms.2", 14000));  // Margin
+    for (int i = 0; i < 2; i++) {
+        sim.valves[i]->phase = PHASE_WATERING;
+        sim.valves[i]->state = VALVE_OPEN;
+        sim.valves[i]->wateringStartTime = 1000;
+    }
+    sim.pumpOn = true;
+
+    ControlLoopSim::safetyWatchdog(sim, 15999);
+    TEST_ASSERT_EQUAL(PHASE_WATERING, sim.valves[1]->phase);
+    ControlLoopSim::safetyWatchdog(sim, 16000);
+    TEST_ASSERT_EQUAL(PHASE_CLOSING_VALVE, sim.valves[1]->phase);
+    TEST_ASSERT_EQUAL(VALVE_CLOSED, sim.valves[1]->state);
+    TEST_ASSERT_TRUE(sim.valves[1]->timeoutOccurred);
+    TEST_ASSERT_EQUAL(PHASE_WATERING, sim.valves[0]->phase);  // Compiled default still applies
+    TEST_ASSERT_TRUE(sim.pumpOn);
+    TEST_ASSERT_EQUAL(1, sim.timeouts);
+
+    ControlLoopSim::safetyWatchdog(sim, 1000 + getValveEmergencyTimeout(0));
+    TEST_ASSERT_EQUAL(PHASE_CLOSING_VALVE, sim.valves[0]->phase);
+    TEST_ASSERT_FALSE(sim.pumpOn);
+    ControlLoopSim::destroy(sim);
+}
+
+// ============================================
+// RUNTIME CONFIG TESTS
+// ============================================
+
+void test_runtime_config_defaults_are_valid(void) {
+    char why[128] = "";
+    RuntimeConfigLogic::Values v = RuntimeConfigLogic::defaults();
+    TEST_ASSERT_TRUE_MESSAGE(RuntimeConfigLogic::validate(v, why, sizeof(why)), why);
+    TEST_ASSERT_EQUAL_UINT32(getValveEmergencyTimeout(0), v.emergencyTimeoutMs[0]);
+    TEST_ASSERT_EQUAL_UINT32(INTER_VALVE_GAP_MS, v.interValveGapMs);
+
+    // Every NVS key (with its valve digit) fits the 15-character limit
+    char key[32];
+    for (int i = 0; i < RuntimeConfigLogic::FIELD_COUNT; i++) {
+        const RuntimeConfigLogic::Field &f = RuntimeConfigLogic::FIELDS[i];
+        RuntimeConfigLogic::nvsKey(f, f.count - 1, key, sizeof(key));
+        TEST_ASSERT_TRUE(strlen(key) <= 15);
+    }
+}
+
+void test_runtime_config_set_checks_ranges_and_invariants(void) {
+    char why[128];
+    RuntimeConfigLogic::Values v = RuntimeConfigLogic::defaults();
+
+    TEST_ASSERT_TRUE(RuntimeConfigLogic::setField(v, "inter_valve_gap_ms", "45000", why, sizeof(why)));
+    TEST_ASSERT_EQUAL_UINT32(45000, v.interValveGapMs);
+    TEST_ASSERT_TRUE(RuntimeConfigLogic::setField(v, "normal_timeout_ms.6", "20000", why, sizeof(why)));
+    TEST_ASSERT_EQUAL_UINT32(20000, v.normalTimeoutMs[5]);
+    TEST_ASSERT_TRUE(RuntimeConfigLogic::validate(v, why, sizeof(why)));
+
+    // Parse and range errors
+    TEST_ASSERT_FALSE(RuntimeConfigLogic::setField(v, "inter_valve_gap", "1", why, sizeof(why)));
+    TEST_ASSERT_FALSE(RuntimeConfigLogic::setField(v, "normal_timeout_ms", "20000", why, sizeof(why)));
+    TEST_ASSERT_FALSE(RuntimeConfigLogic::setField(v, "normal_timeout_ms.7", "20000", why, sizeof(why)));
+    TEST_ASSERT_FALSE(RuntimeConfigLogic::setField(v, "normal_timeout_ms.06", "20000", why, sizeof(why)));
+    TEST_ASSERT_FALSE(RuntimeConfigLogic::setField(v, "normal_timeout_ms.16", "20000", why, sizeof(why)));
+    TEST_ASSERT_FALSE(RuntimeConfigLogic::setField(v, "inter_valve_gap_ms.1", "1", why, sizeof(why)));
+    TEST_ASSERT_FALSE(RuntimeConfigLogic::setField(v, "rain_confirmations", "0", why, sizeof(why)));
+    TEST_ASSERT_FALSE(RuntimeConfigLogic::setField(v, "rain_confirmations", "-1", why, sizeof(why)));
+    TEST_ASSERT_FALSE(RuntimeConfigLogic::setField(v, "rain_confirmations", "3x", why, sizeof(why)));
+    TEST_ASSERT_FALSE(RuntimeConfigLogic::setField(v, "rain_debounce_threshold", "8", why, sizeof(why)));
+    TEST_ASSERT_EQUAL_UINT32(45000, v.interValveGapMs);
+
+    // In range on its own, but breaks the VALIDATE_TIMEOUT margin
+    TEST_ASSERT_TRUE(RuntimeConfigLogic::setField(v, "normal_timeout_ms.2", "28000", why, sizeof(why)));
+    TEST_ASSERT_FALSE(RuntimeConfigLogic::validate(v, why, sizeof(why)));
+    TEST_ASSERT_NOT_NULL(strstr(why, "emergency_timeout_ms.2"));
+    TEST_ASSERT_TRUE(RuntimeConfigLogic::setField(v, "emergency_timeout_ms.2", "33000", why, sizeof(why)));
+    TEST_ASSERT_TRUE(RuntimeConfigLogic::validate(v, why, sizeof(why)));
+
+    TEST_ASSERT_TRUE(RuntimeConfigLogic::setField(v, "metrics_push_idle_ms", "5000", why, sizeof(why)));
+    TEST_ASSERT_FALSE(RuntimeConfigLogic::validate(v, why, sizeof(why)));
+}
+
+void test_runtime_config_json_lists_values_and_defaults(void) {
+    char why[128];
+    char json[2048];
+    RuntimeConfigLogic::Values v = RuntimeConfigLogic::defaults();
+    RuntimeConfigLogic::setField(v, "rain_confirmations", "4", why, sizeof(why));
+    TEST_ASSERT_TRUE(RuntimeConfigLogic::formatJson(v, json, sizeof(json)) > 0);
+    TEST_ASSERT_NOT_NULL(strstr(json, "\"rain_confirmations\":{\"min\":1,\"max\":10,\"value\":4,\"default\":3}"));
+    TEST_ASSERT_NOT_NULL(strstr(json, "\"normal_timeout_ms\":{\"min\":10000,\"max\":120000,\"value\":[40000,25000,"));
+    TEST_ASSERT_EQUAL('}', json[strlen(json) - 1]);
+
+    char small[64];
+    TEST_ASSERT_EQUAL(0, RuntimeConfigLogic::formatJson(v, small, sizeof(small)));
+}
+
+void test_runtime_config_slot_reused_only_after_a_control_pass(void) {
+    using namespace RuntimeConfigLogic;
+    SnapshotSlots s;
+    resetSlots(s);
+
+    // Two publishes within control pass 7: both go to never-used slots
+    int a = freeSlot(s, 7);
+    TEST_ASSERT_TRUE(a >= 0 && a != 0);
+    retire(s, a, 7);
+    int b = freeSlot(s, 7);
+    TEST_ASSERT_TRUE(b >= 0 && b != 0 && b != a);
+    retire(s, b, 7);
+
+    // A third in the same pass would overwrite a snapshot that pass may hold
+    TEST_ASSERT_EQUAL(-1, freeSlot(s, 7));
+
+    // Once the pass has closed, the older retired slots are free again
+    int c = freeSlot(s, 8);
+    TEST_ASSERT_TRUE(c == 0 || c == a);
+    retire(s, c, 8);
+    TEST_ASSERT_EQUAL(c, s.current);
+    int d = freeSlot(s, 8);
+    TEST_ASSERT_TRUE(d >= 0 && d != c);
+    retire(s, d, 8);
+    TEST_ASSERT_EQUAL(-1, freeSlot(s, 8));
+}
+
+// ============================================
+// I/O EXPANDER TESTS
+// ============================================
+
+void test_io_expander_configures_chip_and_samples_in_one_read(void) {
+    using namespace IoExpanderLogic;
+    Mcp23017Stub::Bus bus;
+    bus.attach(0);
+    int valvePins[2] = {EXPANDER_PIN_BASE + 0, EXPANDER_PIN_BASE + 1};
+    int sensorPins[2] = {EXPANDER_PIN_BASE + 8, EXPANDER_PIN_BASE + 15};
+    Chip chip;
+    planChips(valvePins, sensorPins, 2, &chip, 1, true);
+    TEST_ASSERT_EQUAL_UINT16(0xFFFC, chip.direction);
+    TEST_ASSERT_EQUAL_UINT16(0x8100, chip.pullups);
+
+    TEST_ASSERT_TRUE(configure(bus, chip));
+    const Mcp23017Stub::Device &d = bus.devices[0];
+    TEST_ASSERT_EQUAL_UINT8(IOCON_MIRROR | IOCON_ODR, d.regs[REG_IOCON]);
+    TEST_ASSERT_EQUAL_UINT16(0xFFFC, d.pair(REG_IODIR));
+    TEST_ASSERT_EQUAL_UINT16(0x8100, d.pair(REG_GPPU));
+    TEST_ASSERT_EQUAL_UINT16(0xFFFC, d.pair(REG_GPINTEN));
+    TEST_ASSERT_FALSE(bus.output(0, 0));
+
+    // Valve on/off: one OLAT write each; re-asserting a level or mode is free
+    unsigned long before = bus.transactions();
+    TEST_ASSERT_TRUE(writeBit(bus, chip, 1, true));
+    TEST_ASSERT_TRUE(writeBit(bus, chip, 1, true));
+    TEST_ASSERT_TRUE(setMode(bus, chip, 1, false, false));
+    TEST_ASSERT_TRUE(setMode(bus, chip, 8, true, true));
+    TEST_ASSERT_EQUAL(1, bus.transactions() - before);
+    TEST_ASSERT_TRUE(bus.output(0, 1));
+    TEST_ASSERT_FALSE(bus.output(0, 0));
+
+    // All 16 lines in one read transaction
+    bus.setPin(0, 8, false);
+    bus.setPin(0, 15, false);
+    before = bus.reads;
+    TEST_ASSERT_TRUE(sample(bus, chip));
+    TEST_ASSERT_EQUAL(1, bus.reads - before);
+    TEST_ASSERT_FALSE(inputBit(chip, 8));
+    TEST_ASSERT_FALSE(inputBit(chip, 15));
+    TEST_ASSERT_TRUE(inputBit(chip, 9));
+    TEST_ASSERT_TRUE(inputBit(chip, 1));  // Output reads back its latch
+
+    // Brown-out: the chip reverts to power-on defaults, configure() restores it
+    bus.devices[0].setPair(REG_IODIR, 0xFFFF);
+    bus.devices[0].setPair(REG_OLAT, 0);
+    TEST_ASSERT_TRUE(configure(bus, chip));
+    TEST_ASSERT_TRUE(bus.output(0, 1));
+}
+
+void test_io_expander_interrupt_on_change_and_bus_errors(void) {
+    using namespace IoExpanderLogic;
+    Mcp23017Stub::Bus bus;
+    bus.attach(1);
+    Chip chip = makeChip(1, true);
+    chip.pullups = 0xFFFF;
+    TEST_ASSERT_TRUE(configure(bus, chip));
+    TEST_ASSERT_FALSE(bus.intAsserted());
+
+    // Quiet line: cached sample trusted until it ages out
+    TEST_ASSERT_FALSE(needsSample(true, false, 1000, 1500, 1000));
+    TEST_ASSERT_TRUE(needsSample(true, false, 1000, 2000, 1000));
+    TEST_ASSERT_TRUE(needsSample(false, false, 1000, 1001, 1000));
+
+    bus.setPin(1, 3, false);
+    TEST_ASSERT_TRUE(bus.intAsserted());
+    TEST_ASSERT_EQUAL_UINT16(0x0008, bus.devices[1].pair(REG_INTF));
+    bus.setPin(1, 4, false);
+    TEST_ASSERT_EQUAL_UINT16(0xFFF7, bus.devices[1].pair(REG_INTCAP));  // First edge captured
+    TEST_ASSERT_TRUE(needsSample(true, true, 1000, 1001, 1000));
+    TEST_ASSERT_TRUE(sample(bus, chip));
+    TEST_ASSERT_FALSE(bus.intAsserted());  // Reading GPIO clears the interrupt
+    TEST_ASSERT_EQUAL_UINT16(0xFFE7, chip.inputs);
+
+    // Chip gone: errors counted, last good sample kept
+    bus.devices[1].present = false;
+    TEST_ASSERT_FALSE(sample(bus, chip));
+    TEST_ASSERT_FALSE(writeBit(bus, chip, 0, true));
+    TEST_ASSERT_EQUAL(2, chip.busErrors);
+    TEST_ASSERT_EQUAL_UINT16(0xFFE7, chip.inputs);
+    TEST_ASSERT_EQUAL_UINT16(0, chip.outputs);
+}
+
+void test_io_expander_detects_reset_chip_and_forces_closes(void) {
+    using namespace IoExpanderLogic;
+    Mcp23017Stub::Bus bus;
+    bus.attach(0);
+    int valvePins[2] = {EXPANDER_PIN_BASE + 0, EXPANDER_PIN_BASE + 1};
+    int sensorPins[2] = {EXPANDER_PIN_BASE + 8, EXPANDER_PIN_BASE + 9};
+    Chip chip;
+    planChips(valvePins, sensorPins, 2, &chip, 1, true);
+    TEST_ASSERT_TRUE(configure(bus, chip));
+    TEST_ASSERT_TRUE(writeBit(bus, chip, 0, true));
+    TEST_ASSERT_EQUAL(CHECK_OK, check(bus, chip));
+
+    // Brown-out while valve 0 is open: the chip is back at power-on defaults
+    Mcp23017Stub::Device &d = bus.devices[0];
+    memset(d.regs, 0, sizeof(d.regs));
+    d.setPair(REG_IODIR, 0xFFFF);
+    TEST_ASSERT_EQUAL(CHECK_MISMATCH, check(bus, chip));
+
+    // Cache says valve 1 is already LOW; a forced close still reaches the chip
+    unsigned long before = bus.writes;
+    TEST_ASSERT_TRUE(writeBit(bus, chip, 1, false));
+    TEST_ASSERT_EQUAL(0, bus.writes - before);
+    TEST_ASSERT_TRUE(writeBit(bus, chip, 0, false, true));
+    TEST_ASSERT_EQUAL_UINT16(chip.direction, d.pair(REG_IODIR));
+    TEST_ASSERT_FALSE(bus.output(0, 0));
+
+    // Reconfiguring restores every register from the cache
+    TEST_ASSERT_TRUE(writeBit(bus, chip, 1, true));
+    d.setPair(REG_GPPU, 0);
+    TEST_ASSERT_EQUAL(CHECK_MISMATCH, check(bus, chip));
+    TEST_ASSERT_TRUE(configure(bus, chip));
+    TEST_ASSERT_EQUAL(CHECK_OK, check(bus, chip));
+    TEST_ASSERT_TRUE(bus.output(0, 1));
+
+    bus.devices[0].present = false;
+    TEST_ASSERT_EQUAL(CHECK_BUS_ERROR, check(bus, chip));
+}
+
+// 24 trays on three expanders: valves on chip 0 + half of chip 1, sensors on
+// the rest. Every tray must drive its own relay and read its own sensor, and a
+// full sensor scan costs one read per input chip.
+void test_io_expander_scales_to_24_trays(void) {
+    using namespace IoExpanderLogic;
+    const int TRAYS = 24;
+    const int CHIPS = 3;
+    int valvePins[TRAYS];
+    int sensorPins[TRAYS];
+    for (int i = 0; i < TRAYS; i++) {
+        valvePins[i] = EXPANDER_PIN_BASE + i;          // 0.0 .. 1.7
+        sensorPins[i] = EXPANDER_PIN_BASE + 24 + i;    // 1.8 .. 2.15
+    }
+    Mcp23017Stub::Bus bus;
+    Chip chips[CHIPS];
+    for (int c = 0; c < CHIPS; c++) bus.attach(c);
+    planChips(valvePins, sensorPins, TRAYS, chips, CHIPS, true);
+    TEST_ASSERT_EQUAL_UINT16(0x0000, chips[0].direction);
+    TEST_ASSERT_EQUAL_UINT16(0xFF00, chips[1].direction);
+    TEST_ASSERT_TRUE(hasInputs(chips[1]));
+    TEST_ASSERT_FALSE(hasInputs(chips[0]));
+    for (int c = 0; c < CHIPS; c++) TEST_ASSERT_TRUE(configure(bus, chips[c]));
+
+    for (int tray = 0; tray < TRAYS; tray++) {
+        int v = valvePins[tray];
+        TEST_ASSERT_TRUE(writeBit(bus, chips[chipOf(v)], bitOf(v), true));
+        for (int other = 0; other < TRAYS; other++) {
+            int o = valvePins[other];
+            TEST_ASSERT_EQUAL(other == tray, bus.output(chipOf(o), bitOf(o)));
+        }
+        TEST_ASSERT_TRUE(writeBit(bus, chips[chipOf(v)], bitOf(v), false));
+
+        int s = sensorPins[tray];
+        bus.setPin(chipOf(s), bitOf(s), false);  // Tray wet
+        unsigned long before = bus.reads;
+        for (int c = 0; c < CHIPS; c++) {
+            if (hasInputs(chips[c])) TEST_ASSERT_TRUE(sample(bus, chips[c]));
+        }
+        TEST_ASSERT_EQUAL(2, bus.reads - before);
+        for (int other = 0; other < TRAYS; other++) {
+            int o = sensorPins[other];
+            TEST_ASSERT_EQUAL(other != tray, inputBit(chips[chipOf(o)], bitOf(o)));
+        }
+        bus.setPin(chipOf(s), bitOf(s), true);
+    }
+    TEST_ASSERT_EQUAL(0, chips[0].busErrors + chips[1].busErrors + chips[2].busErrors);
+}
+
+// ============================================
+// ANALOG MOISTURE TESTS
+// ============================================
+
+void test_moisture_oversampling_rejects_spikes_and_filter_converges(void) {
+    // Two relay-switching spikes in a 16-read burst do not move the mean
+    uint16_t burst[MOISTURE_OVERSAMPLE];
+    for (int i = 0; i < MOISTURE_OVERSAMPLE; i++) burst[i] = (uint16_t)(2000 + (i % 2));
+    burst[3] = 4095;
+    burst[9] = 0;
+    uint16_t mean = MoistureLogic::trimmedMean(burst, MOISTURE_OVERSAMPLE);
+    TEST_ASSERT_TRUE(mean >= 2000 && mean <= 2001);
+
+    // First sample seeds the filter; a step then settles within ~6 time constants
+    MoistureLogic::Filter f = MoistureLogic::makeFilter();
+    TEST_ASSERT_FALSE(MoistureLogic::fresh(f, 0, MOISTURE_STALE_MS));
+    MoistureLogic::update(f, 3000, MOISTURE_IIR_SHIFT, 100);
+    TEST_ASSERT_EQUAL_UINT16(3000, MoistureLogic::value(f));
+    MoistureLogic::update(f, 1300, MOISTURE_IIR_SHIFT, 300);
+    TEST_ASSERT_TRUE(MoistureLogic::value(f) > 2700);  // One step moves ~1/8 of the way
+    for (int i = 0; i < 6 << MOISTURE_IIR_SHIFT; i++) {
+        MoistureLogic::update(f, 1300, MOISTURE_IIR_SHIFT, 500 + i * 200);
+    }
+    TEST_ASSERT_UINT32_WITHIN(2, 1300, MoistureLogic::value(f));
+
+    unsigned long last = f.updatedAt;
+    TEST_ASSERT_TRUE(MoistureLogic::fresh(f, last + MOISTURE_STALE_MS - 1, MOISTURE_STALE_MS));
+    TEST_ASSERT_FALSE(MoistureLogic::fresh(f, last + MOISTURE_STALE_MS, MOISTURE_STALE_MS));
+}
+
+void test_moisture_percent_and_setpoint(void) {
+    // Capacitive probe: lower counts = wetter
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, MoistureLogic::percent(3200, 3000, 1300));
+    TEST_ASSERT_EQUAL_FLOAT(50.0f, MoistureLogic::percent(2150, 3000, 1300));
+    TEST_ASSERT_EQUAL_FLOAT(100.0f, MoistureLogic::percent(900, 3000, 1300));
+    // Resistive probe: higher counts = wetter
+    TEST_ASSERT_EQUAL_FLOAT(25.0f, MoistureLogic::percent(1500, 1000, 3000));
+
+    TEST_ASSERT_FALSE(MoistureLogic::setpointReached(95.0f, 0));   // Disabled
+    TEST_ASSERT_FALSE(MoistureLogic::setpointReached(-1.0f, 60));  // No / stale probe
+    TEST_ASSERT_FALSE(MoistureLogic::setpointReached(59.5f, 60));
+    TEST_ASSERT_TRUE(MoistureLogic::setpointReached(60.0f, 60));
+
+    // Calibration points must be far enough apart to mean anything
+    char why[128];
+    RuntimeConfigLogic::Values v = RuntimeConfigLogic::defaults();
+    TEST_ASSERT_TRUE(RuntimeConfigLogic::setField(v, "moisture_setpoint_pct.2", "70", why, sizeof(why)));
+    TEST_ASSERT_EQUAL_UINT32(70, v.moistureSetpointPct[1]);
+    TEST_ASSERT_FALSE(RuntimeConfigLogic::setField(v, "moisture_setpoint_pct.2", "101", why, sizeof(why)));
+    TEST_ASSERT_TRUE(RuntimeConfigLogic::setField(v, "moisture_wet_raw.2", "2950", why, sizeof(why)));
+    TEST_ASSERT_FALSE(RuntimeConfigLogic::validate(v, why, sizeof(why)));
+    TEST_ASSERT_TRUE(RuntimeConfigLogic::setField(v, "moisture_wet_raw.2", "3900", why, sizeof(why)));
+    TEST_ASSERT_TRUE_MESSAGE(RuntimeConfigLogic::validate(v, why, sizeof(why)), why);
+}
+
+void test_moisture_reading_corrects_time_based_water_level(void) {
+    ValveController valve(0);
+    valve.isCalibrated = true;
+    valve.emptyToFullDuration = 100000;
+    valve.lastWateringCompleteTime = 1000;
+    unsigned long now = 1000 + 25000;  // Time model says 75%
+
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 75.0f, calculateCurrentWaterLevel(&valve, now));
+
+    // Tray drank faster than learned: the probe pulls the estimate down
+    valve.moisturePercent = 30.0f;
+    float corrected = calculateCurrentWaterLevel(&valve, now);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, MOISTURE_LEVEL_CORRECTION_WEIGHT * 30.0f +
+                                        (1.0f - MOISTURE_LEVEL_CORRECTION_WEIGHT) * 75.0f,
+                             corrected);
+
+    // Uncalibrated tray: the measurement is all there is
+    ValveController fresh(1);
+    fresh.moisturePercent = 42.0f;
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 42.0f, calculateCurrentWaterLevel(&fresh, now));
+}
+
+// ============================================
+// FLOW METER TESTS
+// ============================================
+
+void test_flow_meter_counts_across_counter_wrap(void) {
+    PulseCounterStub::Counter counter(100);
+    FlowMeterLogic::Meter meter = FlowMeterLogic::makeMeter(counter.limit, counter.read());
+
+    counter.pulse(70);
+    TEST_ASSERT_EQUAL_UINT32(70, FlowMeterLogic::poll(counter, meter));
+    counter.pulse(50);  // 70 -> 120 wraps to 20
+    TEST_ASSERT_EQUAL(20, counter.count);
+    TEST_ASSERT_EQUAL_UINT32(50, FlowMeterLogic::poll(counter, meter));
+    TEST_ASSERT_EQUAL_UINT32(0, FlowMeterLogic::poll(counter, meter));
+    TEST_ASSERT_EQUAL_UINT32(120, meter.totalPulses);
+}
+
+void test_flow_meter_cycle_volume_and_rate(void) {
+    PulseCounterStub::Counter counter(32767);
+    FlowMeterLogic::Meter meter = FlowMeterLogic::makeMeter(counter.limit, counter.read());
+    FlowMeterLogic::Cycle cycle = FlowMeterLogic::startCycle(0);
+
+    // 2 L/min for 15s, polled every 10ms like the control loop
+    for (unsigned long t = 10; t <= 15000; t += 10) {
+        counter.flow(2.0f, 10, FLOW_METER_PULSES_PER_LITRE);
+        FlowMeterLogic::addPulses(cycle, FlowMeterLogic::poll(counter, meter), t,
+                                  FLOW_RATE_WINDOW_MS, FLOW_METER_PULSES_PER_LITRE);
+        TEST_ASSERT_FALSE(FlowMeterLogic::noFlow(cycle, t, FLOW_PRIME_GRACE_MS, FLOW_NO_FLOW_TIMEOUT_MS));
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.5f, FlowMeterLogic::litres(cycle.pulses, FLOW_METER_PULSES_PER_LITRE));
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 2.0f, cycle.rateLpm);
+}
+
+void test_flow_meter_detects_dry_pump_and_blocked_line(void) {
+    // Dry pump: no pulse at all -> stop as soon as both windows have passed
+    FlowMeterLogic::Cycle dry = FlowMeterLogic::startCycle(1000);
+    unsigned long stopAfter = FLOW_PRIME_GRACE_MS > FLOW_NO_FLOW_TIMEOUT_MS ? FLOW_PRIME_GRACE_MS
+                                                                           : FLOW_NO_FLOW_TIMEOUT_MS;
+    TEST_ASSERT_FALSE(FlowMeterLogic::noFlow(dry, 1000 + stopAfter - 1, FLOW_PRIME_GRACE_MS,
+                                             FLOW_NO_FLOW_TIMEOUT_MS));
+    TEST_ASSERT_TRUE(FlowMeterLogic::noFlow(dry, 1000 + stopAfter, FLOW_PRIME_GRACE_MS,
+                                            FLOW_NO_FLOW_TIMEOUT_MS));
+    TEST_ASSERT_TRUE(stopAfter < VALVE_NORMAL_TIMEOUTS[1]);  // Long before the valve timeout
+
+    // Blocked line: flowing, then nothing -> caught one timeout after the last pulse
+    FlowMeterLogic::Cycle c = FlowMeterLogic::startCycle(0);
+    FlowMeterLogic::addPulses(c, 30, 5000, FLOW_RATE_WINDOW_MS, FLOW_METER_PULSES_PER_LITRE);
+    TEST_ASSERT_FALSE(FlowMeterLogic::noFlow(c, 5000 + FLOW_NO_FLOW_TIMEOUT_MS - 1, FLOW_PRIME_GRACE_MS,
+                                             FLOW_NO_FLOW_TIMEOUT_MS));
+    TEST_ASSERT_TRUE(FlowMeterLogic::noFlow(c, 5000 + FLOW_NO_FLOW_TIMEOUT_MS, FLOW_PRIME_GRACE_MS,
+                                            FLOW_NO_FLOW_TIMEOUT_MS));
+}
+
+// ============================================
+// POWER MANAGEMENT TESTS
+// ============================================
+
+void test_power_mode_idles_only_after_quiet_period(void) {
+    unsigned long lastBusyAt = 10000;
+    TEST_ASSERT_EQUAL(PowerLogic::MODE_ACTIVE, PowerLogic::nextMode(true, 50000, lastBusyAt, POWER_IDLE_ENTER_MS));
+    TEST_ASSERT_EQUAL(PowerLogic::MODE_ACTIVE,
+                      PowerLogic::nextMode(false, lastBusyAt + POWER_IDLE_ENTER_MS - 1, lastBusyAt, POWER_IDLE_ENTER_MS));
+    TEST_ASSERT_EQUAL(PowerLogic::MODE_IDLE,
+                      PowerLogic::nextMode(false, lastBusyAt + POWER_IDLE_ENTER_MS, lastBusyAt, POWER_IDLE_ENTER_MS));
+
+    // Idle polling is slower but still a sensor edge is seen within one period
+    TEST_ASSERT_EQUAL_UINT32(POWER_ACTIVE_LOOP_PERIOD_MS,
+                             PowerLogic::loopPeriodMs(PowerLogic::MODE_ACTIVE, POWER_ACTIVE_LOOP_PERIOD_MS,
+                                                      POWER_IDLE_LOOP_PERIOD_MS));
+    TEST_ASSERT_EQUAL_UINT32(POWER_IDLE_LOOP_PERIOD_MS,
+                             PowerLogic::loopPeriodMs(PowerLogic::MODE_IDLE, POWER_ACTIVE_LOOP_PERIOD_MS,
+                                                      POWER_IDLE_LOOP_PERIOD_MS));
+
+    // Level interrupt always armed for the opposite of the current level
+    TEST_ASSERT_TRUE(PowerLogic::wakeOnHighLevel(false));
+    TEST_ASSERT_FALSE(PowerLogic::wakeOnHighLevel(true));
+}
+
+void test_wifi_power_save_follows_traffic(void) {
+    unsigned long traffic = 1000;
+    TEST_ASSERT_EQUAL(PowerLogic::WIFI_SAVE_NONE,
+                      PowerLogic::wifiSaveFor(traffic, traffic, WIFI_PS_TRAFFIC_HOLD_MS, WIFI_PS_DEEP_AFTER_MS));
+    TEST_ASSERT_EQUAL(PowerLogic::WIFI_SAVE_MIN,
+                      PowerLogic::wifiSaveFor(traffic + WIFI_PS_TRAFFIC_HOLD_MS, traffic, WIFI_PS_TRAFFIC_HOLD_MS,
+                                              WIFI_PS_DEEP_AFTER_MS));
+    TEST_ASSERT_EQUAL(PowerLogic::WIFI_SAVE_MAX,
+                      PowerLogic::wifiSaveFor(traffic + WIFI_PS_DEEP_AFTER_MS, traffic, WIFI_PS_TRAFFIC_HOLD_MS,
+                                              WIFI_PS_DEEP_AFTER_MS));
+    // millis() wrap between the request and now
+    TEST_ASSERT_EQUAL(PowerLogic::WIFI_SAVE_NONE,
+                      PowerLogic::wifiSaveFor(100, ~0UL - 255, WIFI_PS_TRAFFIC_HOLD_MS, WIFI_PS_DEEP_AFTER_MS));
+}
+
+void test_power_stats_account_time_current_and_wake_latency(void) {
+    PowerLogic::CurrentModel model = {
+        {POWER_MODEL_CPU_ACTIVE_MA, POWER_MODEL_CPU_IDLE_MA},
+        {POWER_MODEL_WIFI_NONE_MA, POWER_MODEL_WIFI_MIN_MODEM_MA, POWER_MODEL_WIFI_MAX_MODEM_MA}};
+    PowerLogic::Stats s = PowerLogic::makeStats(0);
+
+    // 1s active with WiFi awake, then 3s idle in max modem sleep
+    PowerLogic::setMode(s, PowerLogic::MODE_IDLE, 1000);
+    PowerLogic::setWifi(s, PowerLogic::WIFI_SAVE_MAX, 1000);
+    PowerLogic::account(s, 4000);
+    TEST_ASSERT_EQUAL_UINT32(1000, (uint32_t)s.modeMs[PowerLogic::MODE_ACTIVE]);
+    TEST_ASSERT_EQUAL_UINT32(3000, (uint32_t)s.modeMs[PowerLogic::MODE_IDLE]);
+    TEST_ASSERT_EQUAL_UINT32(1, s.modeChanges);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.75f, PowerLogic::idleFraction(s));
+
+    float expected = (POWER_MODEL_CPU_ACTIVE_MA + POWER_MODEL_WIFI_NONE_MA) * 0.25f +
+                     (POWER_MODEL_CPU_IDLE_MA + POWER_MODEL_WIFI_MAX_MODEM_MA) * 0.75f;
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, expected, PowerLogic::averageCurrentMa(s, model));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, POWER_MODEL_CPU_IDLE_MA + POWER_MODEL_WIFI_MAX_MODEM_MA,
+                             PowerLogic::currentMa(model, s.mode, s.wifi));
+
+    PowerLogic::recordWake(s, 120);
+    PowerLogic::recordWake(s, 900);
+    PowerLogic::recordWake(s, 300);
+    TEST_ASSERT_EQUAL_UINT32(3, s.wakes);
+    TEST_ASSERT_EQUAL_UINT32(300, s.lastWakeLatencyUs);
+    TEST_ASSERT_EQUAL_UINT32(900, s.maxWakeLatencyUs);
+    TEST_ASSERT_EQUAL_UINT32(440, PowerLogic::meanWakeLatencyUs(s));
+}
+
+// ============================================
+// WIFI LINK STATE MACHINE TESTS
+// ============================================
+
+static const WifiLinkLogic::Config kLinkConfig = {15000, 3000, 1000, 5000, 300000};
+
+void test_wifi_link_boot_connect_is_not_a_reconnect(void) {
+    WifiLinkLogic::Link link = WifiLinkLogic::makeLink(kLinkConfig);
+    TEST_ASSERT_EQUAL(WifiLinkLogic::ACTION_BEGIN, WifiLinkLogic::start(link, 100));
+    TEST_ASSERT_EQUAL(WifiLinkLogic::LINK_CONNECTING, link.state);
+    // Nothing to do while associating: the caller never waits
+    TEST_ASSERT_EQUAL(WifiLinkLogic::ACTION_NONE, WifiLinkLogic::tick(link, 5000, kLinkConfig));
+
+    WifiLinkLogic::onEvent(link, WifiLinkLogic::EVENT_GOT_IP, 0, link.generation, 2600, kLinkConfig);
+    TEST_ASSERT_EQUAL(WifiLinkLogic::LINK_UP, link.state);
+    TEST_ASSERT_EQUAL_UINT32(2500, link.lastConnectMs);
+    TEST_ASSERT_EQUAL_UINT32(1, link.attempts);
+    TEST_ASSERT_EQUAL_UINT32(0, link.reconnects);
+    TEST_ASSERT_EQUAL_UINT32(0, link.downSince);
+}
+
+void test_wifi_link_outage_backs_off_and_records_reconnect(void) {
+    WifiLinkLogic::Link link = WifiLinkLogic::makeLink(kLinkConfig);
+    WifiLinkLogic::start(link, 0);
+    WifiLinkLogic::onEvent(link, WifiLinkLogic::EVENT_GOT_IP, 0, link.generation, 3000, kLinkConfig);
+
+    // AP goes away: reset right away, first retry after the settle time
+    TEST_ASSERT_EQUAL(WifiLinkLogic::ACTION_RESET,
+                      WifiLinkLogic::onEvent(link, WifiLinkLogic::EVENT_DISCONNECTED, 200, link.generation, 10000, kLinkConfig));
+    TEST_ASSERT_EQUAL_UINT8(200, link.lastDisconnectReason);
+    TEST_ASSERT_EQUAL(WifiLinkLogic::ACTION_NONE, WifiLinkLogic::tick(link, 10999, kLinkConfig));
+    TEST_ASSERT_EQUAL(WifiLinkLogic::ACTION_BEGIN, WifiLinkLogic::tick(link, 11000, kLinkConfig));
+
+    // Attempt times out -> 5s wait; next one fails fast -> 10s wait
+    TEST_ASSERT_EQUAL(WifiLinkLogic::ACTION_RESET, WifiLinkLogic::tick(link, 26000, kLinkConfig));
+    TEST_ASSERT_EQUAL_UINT32(5000, WifiLinkLogic::retryInMs(link, 26000));
+    TEST_ASSERT_EQUAL(WifiLinkLogic::ACTION_BEGIN, WifiLinkLogic::tick(link, 31000, kLinkConfig));
+    TEST_ASSERT_EQUAL(WifiLinkLogic::ACTION_RESET,
+                      WifiLinkLogic::onEvent(link, WifiLinkLogic::EVENT_DISCONNECTED, 201, link.generation, 33000, kLinkConfig));
+    TEST_ASSERT_EQUAL_UINT32(10000, WifiLinkLogic::retryInMs(link, 33000));
+    TEST_ASSERT_EQUAL(WifiLinkLogic::ACTION_BEGIN, WifiLinkLogic::tick(link, 43000, kLinkConfig));
+
+    WifiLinkLogic::onEvent(link, WifiLinkLogic::EVENT_GOT_IP, 0, link.generation, 45000, kLinkConfig);
+    TEST_ASSERT_EQUAL(WifiLinkLogic::LINK_UP, link.state);
+    TEST_ASSERT_EQUAL_UINT32(1, link.reconnects);
+    TEST_ASSERT_EQUAL_UINT32(35000, link.lastOutageMs);
+    TEST_ASSERT_EQUAL_UINT32(3, link.lastOutageAttempts);
+    TEST_ASSERT_EQUAL_UINT32(2000, link.lastConnectMs);
+    TEST_ASSERT_EQUAL_UINT32(kLinkConfig.backoffInitialMs, link.backoffMs);
+
+    // Backoff is capped
+    WifiLinkLogic::onEvent(link, WifiLinkLogic::EVENT_LOST_IP, 0, link.generation, 50000, kLinkConfig);
+    unsigned long t = 50000 + kLinkConfig.settleMs;
+    for (int i = 0; i < 12; i++) {
+        TEST_ASSERT_EQUAL(WifiLinkLogic::ACTION_BEGIN, WifiLinkLogic::tick(link, t, kLinkConfig));
+        t += kLinkConfig.attemptTimeoutMs;
+        WifiLinkLogic::tick(link, t, kLinkConfig);
+        t += link.waitMs;
+    }
+    TEST_ASSERT_EQUAL_UINT32(kLinkConfig.backoffMaxMs, link.waitMs);
+}
+
+void test_wifi_link_ignores_stale_events_and_queue_keeps_latest(void) {
+    WifiLinkLogic::Link link = WifiLinkLogic::makeLink(kLinkConfig);
+    WifiLinkLogic::start(link, 0);
+    uint32_t timedOut = link.generation;
+    WifiLinkLogic::tick(link, 15000, kLinkConfig);                 // Timed out, reset
+    WifiLinkLogic::tick(link, 20000, kLinkConfig);                 // Next attempt
+    // The disconnect caused by the reset is drained only now: not a failure
+    TEST_ASSERT_EQUAL(WifiLinkLogic::ACTION_NONE,
+                      WifiLinkLogic::onEvent(link, WifiLinkLogic::EVENT_DISCONNECTED, 8, timedOut, 15001, kLinkConfig));
+    TEST_ASSERT_EQUAL(WifiLinkLogic::LINK_CONNECTING, link.state);
+    // An address while backing off belongs to an abandoned attempt
+    uint32_t abandoned = link.generation;
+    WifiLinkLogic::tick(link, 35000, kLinkConfig);
+    TEST_ASSERT_EQUAL(WifiLinkLogic::ACTION_NONE,
+                      WifiLinkLogic::onEvent(link, WifiLinkLogic::EVENT_GOT_IP, 0, abandoned, 35050, kLinkConfig));
+    TEST_ASSERT_EQUAL(WifiLinkLogic::LINK_BACKOFF, link.state);
+
+    // Directed attempt fails and the scan starts in the same millisecond: the
+    // reset's disconnect, drained after that, must not fail the scan
+    WifiLinkLogic::tick(link, 45000, kLinkConfig);
+    WifiLinkLogic::markDirected(link);
+    uint32_t directed = link.generation;
+    unsigned long backoff = link.backoffMs;
+    TEST_ASSERT_EQUAL(WifiLinkLogic::ACTION_RESET, WifiLinkLogic::tick(link, 48000, kLinkConfig));
+    TEST_ASSERT_EQUAL(WifiLinkLogic::ACTION_BEGIN, WifiLinkLogic::tick(link, 48000, kLinkConfig));
+    TEST_ASSERT_EQUAL(WifiLinkLogic::ACTION_NONE,
+                      WifiLinkLogic::onEvent(link, WifiLinkLogic::EVENT_DISCONNECTED, 8, directed, 48000, kLinkConfig));
+    TEST_ASSERT_EQUAL(WifiLinkLogic::LINK_CONNECTING, link.state);
+    TEST_ASSERT_EQUAL_UINT32(backoff, link.backoffMs);
+
+    WifiLinkLogic::EventQueue q;
+    WifiLinkLogic::clear(q);
+    for (int i = 0; i < WifiLinkLogic::EVENT_QUEUE_SIZE + 2; i++) {
+        WifiLinkLogic::push(q, WifiLinkLogic::EVENT_DISCONNECTED, (uint8_t)i, 1, (unsigned long)i);
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, q.dropped);
+    WifiLinkLogic::Event e;
+    TEST_ASSERT_TRUE(WifiLinkLogic::pop(q, e));
+    TEST_ASSERT_EQUAL_UINT8(2, e.reason);
+    int remaining = 1;
+    while (WifiLinkLogic::pop(q, e)) remaining++;
+    TEST_ASSERT_EQUAL(WifiLinkLogic::EVENT_QUEUE_SIZE, remaining);
+    TEST_ASSERT_EQUAL_UINT8(WifiLinkLogic::EVENT_QUEUE_SIZE + 1, e.reason);
+}
+
+void test_wifi_directed_attempt_falls_back_to_scan_without_backoff(void) {
+    WifiLinkLogic::Link link = WifiLinkLogic::makeLink(kLinkConfig);
+    WifiLinkLogic::start(link, 0);
+    WifiLinkLogic::markDirected(link);
+    // Directed attempt has the short timeout
+    TEST_ASSERT_EQUAL(WifiLinkLogic::ACTION_NONE,
+                      WifiLinkLogic::tick(link, kLinkConfig.directedTimeoutMs - 1, kLinkConfig));
+    TEST_ASSERT_EQUAL(WifiLinkLogic::ACTION_RESET,
+                      WifiLinkLogic::tick(link, kLinkConfig.directedTimeoutMs, kLinkConfig));
+    TEST_ASSERT_EQUAL_UINT32(1, link.directedFailures);
+    TEST_ASSERT_EQUAL_UINT32(kLinkConfig.backoffInitialMs, link.backoffMs);
+    // Scanning attempt follows on the next tick
+    TEST_ASSERT_EQUAL(WifiLinkLogic::ACTION_BEGIN,
+                      WifiLinkLogic::tick(link, kLinkConfig.directedTimeoutMs, kLinkConfig));
+    TEST_ASSERT_FALSE(link.directed);
+
+    WifiLinkLogic::onEvent(link, WifiLinkLogic::EVENT_CONNECTED, 0, link.generation, 5000, kLinkConfig);
+    WifiLinkLogic::onEvent(link, WifiLinkLogic::EVENT_GOT_IP, 0, link.generation, 5400, kLinkConfig);
+    TEST_ASSERT_EQUAL_UINT32(400, link.lastAssocToIpMs);
+    TEST_ASSERT_FALSE(link.lastConnectDirected);
+
+    // Warm reconnect on the cached AP
+    WifiLinkLogic::onEvent(link, WifiLinkLogic::EVENT_DISCONNECTED, 200, link.generation, 60000, kLinkConfig);
+    TEST_ASSERT_EQUAL(WifiLinkLogic::ACTION_BEGIN,
+                      WifiLinkLogic::tick(link, 60000 + kLinkConfig.settleMs, kLinkConfig));
+    WifiLinkLogic::markDirected(link);
+    WifiLinkLogic::onEvent(link, WifiLinkLogic::EVENT_CONNECTED, 0, link.generation, 61450, kLinkConfig);
+    WifiLinkLogic::onEvent(link, WifiLinkLogic::EVENT_GOT_IP, 0, link.generation, 61480, kLinkConfig);
+    TEST_ASSERT_TRUE(link.lastConnectDirected);
+    TEST_ASSERT_EQUAL_UINT32(30, link.lastAssocToIpMs);
+    TEST_ASSERT_EQUAL_UINT32(1, link.lastOutageAttempts);
+    // A later drop of the directed link is not a directed failure
+    TEST_ASSERT_FALSE(link.directed);
+}
+
+void test_wifi_fast_connect_cache_rules(void) {
+    const uint8_t bssid[6] = {0x10, 0x20, 0x30, 0x40, 0x50, 0x60};
+    uint32_t home = WifiFastConnectLogic::ssidHash("home");
+    TEST_ASSERT_NOT_EQUAL(home, WifiFastConnectLogic::ssidHash("home2"));
+
+    WifiFastConnectLogic::Cache empty = WifiFastConnectLogic::emptyCache();
+    TEST_ASSERT_FALSE(WifiFastConnectLogic::useDirected(empty, home, 1));
+
+    WifiFastConnectLogic::Cache c =
+        WifiFastConnectLogic::remember(home, bssid, 6, 0x0A01A8C0, 0x0101A8C0, 0x00FFFFFF, 0x0101A8C0, 1700000000);
+    TEST_ASSERT_TRUE(WifiFastConnectLogic::useDirected(c, home, 1));
+    TEST_ASSERT_FALSE(WifiFastConnectLogic::useDirected(c, home, 2));  // Retries scan
+    TEST_ASSERT_FALSE(WifiFastConnectLogic::useDirected(c, WifiFastConnectLogic::ssidHash("other"), 1));
+
+    // Lease reuse: opt-in, recent, clock known
+    TEST_ASSERT_FALSE(WifiFastConnectLogic::reuseLease(c, home, false, 1700000100, 3600));
+    TEST_ASSERT_TRUE(WifiFastConnectLogic::reuseLease(c, home, true, 1700003600, 3600));
+    TEST_ASSERT_FALSE(WifiFastConnectLogic::reuseLease(c, home, true, 1700003601, 3600));
+    TEST_ASSERT_FALSE(WifiFastConnectLogic::reuseLease(c, home, true, 0, 3600));
+
+    // NVS writes: only on change or when the lease timestamp gets old
+    WifiFastConnectLogic::Cache same =
+        WifiFastConnectLogic::remember(home, bssid, 6, 0x0A01A8C0, 0x0101A8C0, 0x00FFFFFF, 0x0101A8C0, 1700000500);
+    TEST_ASSERT_FALSE(WifiFastConnectLogic::needsSave(c, same, 3600));
+    same.savedAt = 1700003600;
+    TEST_ASSERT_TRUE(WifiFastConnectLogic::needsSave(c, same, 3600));
+    WifiFastConnectLogic::Cache moved =
+        WifiFastConnectLogic::remember(home, bssid, 11, 0x0A01A8C0, 0x0101A8C0, 0x00FFFFFF, 0x0101A8C0, 1700000500);
+    TEST_ASSERT_TRUE(WifiFastConnectLogic::needsSave(c, moved, 3600));
+    TEST_ASSERT_TRUE(WifiFastConnectLogic::needsSave(empty, c, 3600));
+}
+
+void test_dns_build_query_and_parse_cname_chain(void) {
+    uint8_t q[DnsCacheLogic::MAX_MESSAGE_SIZE];
+    int len = DnsCacheLogic::buildQuery(0xBEEF, "api.telegram.org", q, sizeof(q));
+    TEST_ASSERT_EQUAL_INT(12 + 18 + 4, len);
+    TEST_ASSERT_EQUAL_UINT8(0xBE, q[0]);
+    TEST_ASSERT_EQUAL_UINT8(0x01, q[2]);  // RD
+    TEST_ASSERT_EQUAL_UINT8(3, q[12]);
+    TEST_ASSERT_EQUAL_INT(0, memcmp(q + 13, "api", 3));
+    TEST_ASSERT_EQUAL_UINT8(8, q[16]);
+
+    uint8_t r[DnsCacheLogic::MAX_MESSAGE_SIZE];
+    TEST_ASSERT_EQUAL_INT(0, DnsCacheLogic::buildQuery(1, "", r, sizeof(r)));
+    TEST_ASSERT_EQUAL_INT(0, DnsCacheLogic::buildQuery(1, "a..b", r, sizeof(r)));
+    TEST_ASSERT_EQUAL_INT(0, DnsCacheLogic::buildQuery(1, "api.telegram.org", r, 20));
+
+    // Response: question echoed, CNAME (TTL 300) -> A (TTL 60), compressed names
+    memcpy(r, q, len);
+    r[2] = 0x81; r[3] = 0x80;  // QR RD RA, NOERROR
+    r[7] = 2;                  // ANCOUNT
+    int pos = len;
+    const uint8_t cname[] = {0xC0, 0x0C, 0, 5, 0, 1, 0, 0, 0x01, 0x2C, 0, 2, 0xC0, 0x0C};
+    memcpy(r + pos, cname, sizeof(cname));
+    pos += sizeof(cname);
+    const uint8_t a[] = {0xC0, 0x0C, 0, 1, 0, 1, 0, 0, 0, 60, 0, 4, 149, 154, 167, 220};
+    memcpy(r + pos, a, sizeof(a));
+    pos += sizeof(a);
+
+    uint32_t ip = 0;
+    uint32_t ttl = 0;
+    TEST_ASSERT_EQUAL_INT(DnsCacheLogic::PARSE_OK, DnsCacheLogic::parseResponse(r, pos, 0xBEEF, ip, ttl));
+    TEST_ASSERT_EQUAL_INT(0, memcmp(&ip, a + 12, 4));  // Network byte order in memory
+    TEST_ASSERT_EQUAL_UINT32(60, ttl);
+
+    TEST_ASSERT_EQUAL_INT(DnsCacheLogic::PARSE_BAD, DnsCacheLogic::parseResponse(r, pos, 0xBEEE, ip, ttl));
+    TEST_ASSERT_EQUAL_INT(DnsCacheLogic::PARSE_BAD, DnsCacheLogic::parseResponse(r, pos - 3, 0xBEEF, ip, ttl));
+    r[2] |= 0x02;  // TC: truncated
+    TEST_ASSERT_EQUAL_INT(DnsCacheLogic::PARSE_BAD, DnsCacheLogic::parseResponse(r, pos, 0xBEEF, ip, ttl));
+    r[2] = 0x81; r[3] = 0x83;  // NXDOMAIN
+    TEST_ASSERT_EQUAL_INT(DnsCacheLogic::PARSE_NO_ADDRESS, DnsCacheLogic::parseResponse(r, pos, 0xBEEF, ip, ttl));
+}
+
+static const DnsCacheLogic::Policy kDnsPolicy = {30000, 3600000, 15000, 86400000, 5000, 300000};
+
+void test_dns_entry_freshness_prefetch_and_stale(void) {
+    DnsCacheLogic::Entry e;
+    memset(&e, 0, sizeof(e));
+    TEST_ASSERT_EQUAL_INT(DnsCacheLogic::DEAD, DnsCacheLogic::freshness(e, 0, kDnsPolicy));
+
+    DnsCacheLogic::onResolved(e, 0x01020304, 5, 1000, kDnsPolicy);  // TTL clamped up to 30 s
+    TEST_ASSERT_EQUAL_UINT32(30000, e.ttlMs);
+    DnsCacheLogic::onResolved(e, 0x01020304, 100000, 1000, kDnsPolicy);  // ...and down to 1 h
+    TEST_ASSERT_EQUAL_UINT32(3600000, e.ttlMs);
+    DnsCacheLogic::onResolved(e, 0x01020304, 60, 1000, kDnsPolicy);
+    e.lastUsedAt = 1000;
+
+    TEST_ASSERT_EQUAL_INT(DnsCacheLogic::FRESH, DnsCacheLogic::freshness(e, 45999, kDnsPolicy));
+    TEST_ASSERT_FALSE(DnsCacheLogic::refreshDue(e, 45999, kDnsPolicy));
+    TEST_ASSERT_EQUAL_INT(DnsCacheLogic::PREFETCH, DnsCacheLogic::freshness(e, 46000, kDnsPolicy));
+    TEST_ASSERT_TRUE(DnsCacheLogic::refreshDue(e, 46000, kDnsPolicy));
+
+    // Resolver down: past expiry the entry is stale but still served
+    DnsCacheLogic::onFailed(e, 46000);
+    TEST_ASSERT_FALSE(DnsCacheLogic::refreshDue(e, 50999, kDnsPolicy));  // 5 s backoff
+    TEST_ASSERT_TRUE(DnsCacheLogic::refreshDue(e, 51000, kDnsPolicy));
+    DnsCacheLogic::onFailed(e, 51000);
+    TEST_ASSERT_FALSE(DnsCacheLogic::refreshDue(e, 60999, kDnsPolicy));  // 10 s
+    TEST_ASSERT_EQUAL_INT(DnsCacheLogic::STALE, DnsCacheLogic::freshness(e, 61000, kDnsPolicy));
+    TEST_ASSERT_TRUE(DnsCacheLogic::refreshDue(e, 61000, kDnsPolicy));
+    TEST_ASSERT_EQUAL_INT(DnsCacheLogic::DEAD, DnsCacheLogic::freshness(e, 61000 + 86400000, kDnsPolicy));
+
+    // Nobody used it for a TTL: left to expire
+    TEST_ASSERT_FALSE(DnsCacheLogic::refreshDue(e, 61001 + 60000, kDnsPolicy));
+
+    DnsCacheLogic::onResolved(e, 0x05060708, 60, 70000, kDnsPolicy);
+    TEST_ASSERT_EQUAL_UINT16(0, e.failures);
+    TEST_ASSERT_EQUAL_INT(DnsCacheLogic::FRESH, DnsCacheLogic::freshness(e, 70000, kDnsPolicy));
+}
+
+void test_dns_slot_reuse_and_lru_eviction(void) {
+    DnsCacheLogic::Entry entries[2];
+    memset(entries, 0, sizeof(entries));
+    int a = DnsCacheLogic::slotFor(entries, 2, "api.telegram.org", 100);
+    int b = DnsCacheLogic::slotFor(entries, 2, "proxy.local", 200);
+    TEST_ASSERT_NOT_EQUAL(a, b);
+    TEST_ASSERT_EQUAL_INT(a, DnsCacheLogic::slotFor(entries, 2, "api.telegram.org", 300));
+    TEST_ASSERT_EQUAL_INT(b, DnsCacheLogic::find(entries, 2, "proxy.local"));
+
+    entries[a].lastUsedAt = 400;  // Telegram used recently, proxy at 200
+    int c = DnsCacheLogic::slotFor(entries, 2, "other.example", 500);
+    TEST_ASSERT_EQUAL_INT(b, c);
+    TEST_ASSERT_EQUAL_INT(-1, DnsCacheLogic::find(entries, 2, "proxy.local"));
+    TEST_ASSERT_FALSE(entries[c].valid);
+
+    char longHost[80];
+    memset(longHost, 'a', sizeof(longHost) - 1);
+    longHost[sizeof(longHost) - 1] = '\0';
+    TEST_ASSERT_EQUAL_INT(-1, DnsCacheLogic::slotFor(entries, 2, longHost, 600));
+}
+
+static void buildSmallMetricsSnapshot(MetricsWireFormat::Snapshot &s) {
+    using namespace MetricsWireFormat;
+    clear(s);
+    set(s, SYS_UPTIME_S, 300);
+    set(s, SYS_WIFI_RSSI, -60);
+    setFloat(s, SYS_POWER_EST_MA, 42.5f);
+    Valve *v = addValve(s, 0);
+    set(*v, VALVE_STATE, 1);
+    setFloat(*v, VALVE_INTERVAL_MULT, 1.25f);
+    addMiss(s, "control", "valves", 3);
+}
+
+void test_metrics_wire_full_frame_vector(void) {
+    using namespace MetricsWireFormat;
+    Snapshot s;
+    buildSmallMetricsSnapshot(s);
+
+    uint8_t frame[2048];
+    size_t len = encode(s, nullptr, 1, 0, false, frame, sizeof(frame));
+    // Header: magic, schema id, seq 1, base 0, no flags
+    TEST_ASSERT_EQUAL_INT(0, memcmp(frame, "WMB1", 4));
+    uint32_t id = schemaId();
+    TEST_ASSERT_EQUAL_UINT8((uint8_t)id, frame[4]);
+    TEST_ASSERT_EQUAL_UINT8((uint8_t)(id >> 24), frame[7]);
+    const uint8_t header[] = {0x01, 0x00, 0x00, 0x00, 0x00};
+    TEST_ASSERT_EQUAL_INT(0, memcmp(frame + 8, header, sizeof(header)));
+    // Body: mask bits 0/2/38, 300, zigzag(-60), zigzag(425); valve 0 bits 0/11,
+    // 1, zigzag(125); one miss control/valves x3
+    const uint8_t body[] = {0x85, 0x80, 0x80, 0x80, 0x80, 0x08, 0xAC, 0x02, 0x77, 0xD2, 0x06, 0x01,
+                            0x00, 0x81, 0x10, 0x01, 0xFA, 0x01, 0x01, 0x07, 0x63, 0x6F, 0x6E, 0x74,
+                            0x72, 0x6F, 0x6C, 0x06, 0x76, 0x61, 0x6C, 0x76, 0x65, 0x73, 0x03};
+    TEST_ASSERT_EQUAL_UINT32(HEADER_SIZE + sizeof(body), len);
+    TEST_ASSERT_EQUAL_INT(0, memcmp(frame + HEADER_SIZE, body, sizeof(body)));
+
+    // A decoder without the schema asks for a full frame; with it, round trip
+    Decoder *d = new Decoder;
+    resetDecoder(*d);
+    TEST_ASSERT_EQUAL_INT(DECODE_NEED_FULL, decode(*d, frame, len));
+    size_t withSchema = encode(s, nullptr, 1, 0, true, frame, sizeof(frame));
+    TEST_ASSERT_EQUAL_INT(DECODE_OK, decode(*d, frame, withSchema));
+    char expected[512];
+    char actual[512];
+    toJson(s, expected, sizeof(expected));
+    toJson(d->state, actual, sizeof(actual));
+    TEST_ASSERT_EQUAL_STRING("{\"uptime_s\":300,\"wifi_rssi\":-60,\"power_est_ma\":42.5,"
+                             "\"valves\":[{\"id\":0,\"state\":1,\"interval_mult\":1.25}],"
+                             "\"deadline_misses\":[{\"task\":\"control\",\"stage\":\"valves\",\"count\":3}]}",
+                             expected);
+    TEST_ASSERT_EQUAL_STRING(expected, actual);
+
+    // Truncated or corrupted frames are rejected, not half-applied
+    TEST_ASSERT_EQUAL_INT(DECODE_BAD, decode(*d, frame, withSchema - 1));
+    TEST_ASSERT_EQUAL_INT(0, encode(s, nullptr, 1, 0, true, frame, 64));
+    delete d;
+}
+
+void test_metrics_wire_delta_carries_only_changes(void) {
+    using namespace MetricsWireFormat;
+    Snapshot base;
+    buildSmallMetricsSnapshot(base);
+    Decoder *d = new Decoder;
+    resetDecoder(*d);
+    uint8_t frame[2048];
+    size_t len = encode(base, nullptr, 7, 0, true, frame, sizeof(frame));
+    TEST_ASSERT_EQUAL_INT(DECODE_OK, decode(*d, frame, len));
+
+    Snapshot cur = base;
+    set(cur, SYS_UPTIME_S, 310);
+    cur.missCount = 0;
+    TEST_ASSERT_TRUE(canDelta(cur, base));
+    len = encode(cur, &base, 8, 7, false, frame, sizeof(frame));
+    // Header + system mask/value + zero valves + zero misses
+    TEST_ASSERT_EQUAL_UINT32(HEADER_SIZE + 1 + 2 + 1 + 1, len);
+    TEST_ASSERT_EQUAL_INT(DECODE_OK, decode(*d, frame, len));
+    TEST_ASSERT_EQUAL_INT64(310, d->state.values[SYS_UPTIME_S]);
+    TEST_ASSERT_EQUAL_INT64(-60, d->state.values[SYS_WIFI_RSSI]);  // Unchanged, kept
+    TEST_ASSERT_EQUAL_INT64(125, d->state.valves[0].values[VALVE_INTERVAL_MULT]);
+    TEST_ASSERT_EQUAL_UINT8(0, d->state.missCount);
+
+    // A delta against a frame the decoder never saw needs a full frame
+    len = encode(cur, &base, 9, 5, false, frame, sizeof(frame));
+    TEST_ASSERT_EQUAL_INT(DECODE_NEED_FULL, decode(*d, frame, len));
+
+    // Losing a field can't be expressed as a delta
+    Snapshot fewer = cur;
+    fewer.present &= ~((uint64_t)1 << SYS_WIFI_RSSI);
+    TEST_ASSERT_FALSE(canDelta(fewer, cur));
+    delete d;
+}
+
+void test_metrics_wire_size_against_json(void) {
+    using namespace MetricsWireFormat;
+    // Six calibrated valves, numbers of the size a running controller reports
+    Snapshot s;
+    clear(s);
+    for (int f = 0; f < SYS_FIELD_COUNT; f++) set(s, (SystemField)f, 1000 + f * 37);
+    set(s, SYS_UPTIME_S, 864000);
+    set(s, SYS_FREE_HEAP, 187432);
+    set(s, SYS_WIFI_RSSI, -67);
+    for (int i = 0; i < 6; i++) {
+        Valve *v = addValve(s, (uint8_t)i);
+        for (int f = 0; f < VALVE_FIELD_COUNT; f++) set(*v, (ValveField)f, f < 13 ? f : 40000000 + i * 1234567);
+        setFloat(*v, VALVE_INTERVAL_MULT, 1.15f);
+    }
+
+    char *json = new char[4096];
+    size_t jsonLen = toJson(s, json, 4096);
+    TEST_ASSERT_TRUE(jsonLen < 4096);
+    TEST_ASSERT_EQUAL_UINT32(jsonLen, toJson(s, nullptr, 0));  // Measuring pass
+
+    uint8_t frame[2048];
+    size_t full = encode(s, nullptr, 1, 0, false, frame, sizeof(frame));
+    size_t withSchema = encode(s, nullptr, 1, 0, true, frame, sizeof(frame));
+    TEST_ASSERT_TRUE(withSchema < 2048);
+
+    // Typical idle push: uptime, heap and the per-valve clocks moved
+    Snapshot next = s;
+    set(next, SYS_UPTIME_S, 864060);
+    set(next, SYS_FREE_HEAP, 187120);
+    for (int i = 0; i < 6; i++) {
+        set(next.valves[i], VALVE_TIME_SINCE_MS, next.valves[i].values[VALVE_TIME_SINCE_MS] + 60000);
+        set(next.valves[i], VALVE_TIME_SINCE_ATTEMPT_MS, next.valves[i].values[VALVE_TIME_SINCE_ATTEMPT_MS] + 60000);
+    }
+    size_t delta = encode(next, &s, 2, 1, false, frame, sizeof(frame));
+
+    TEST_ASSERT_TRUE(full * 5 < jsonLen);
+    TEST_ASSERT_TRUE(delta * 10 < jsonLen);
+    delete[] json;
+}
+
+// ============================================
+// GZIP UPLOAD TESTS
+// ============================================
+
+// Minimal inflater for the single fixed-Huffman block GzipLogic emits
+struct GzipTestReader {
+    const uint8_t *p;
+    size_t len;
+    size_t pos;
+    int bit;
+};
+
+static int gzipTestBits(GzipTestReader &r, int n) {
+    int v = 0;
+    for (int i = 0; i < n; i++) {
+        if (r.pos >= r.len) return -1;
+        v |= ((r.p[r.pos] >> r.bit) & 1) << i;
+        if (++r.bit == 8) {
+            r.bit = 0;
+            r.pos++;
+        }
+    }
+    return v;
+}
+
+// Huffman codes arrive most significant bit first
+static int gzipTestCode(GzipTestReader &r, int n) {
+    int v = 0;
+    for (int i = 0; i < n; i++) v = (v << 1) | gzipTestBits(r, 1);
+    return v;
+}
+
+static int gzipTestSymbol(GzipTestReader &r) {
+    int code = gzipTestCode(r, 7);
+    if (code <= 0x17) return 256 + code;
+    code = (code << 1) | gzipTestBits(r, 1);
+    if (code >= 0x30 && code <= 0xBF) return code - 0x30;
+    if (code >= 0xC0 && code <= 0xC7) return 280 + code - 0xC0;
+    code = (code << 1) | gzipTestBits(r, 1);
+    return 144 + code - 0x190;
+}
+
+// Returns the inflated length, or -1 on a malformed member / bad trailer
+static long gzipTestInflate(const uint8_t *gz, size_t len, uint8_t *out, size_t cap) {
+    static const uint16_t lengthBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                            31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const uint8_t lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                            2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    if (len < GzipLogic::HEADER_SIZE + GzipLogic::TRAILER_SIZE || gz[0] != 0x1F || gz[1] != 0x8B) return -1;
+    GzipTestReader r = {gz, len - GzipLogic::TRAILER_SIZE, GzipLogic::HEADER_SIZE, 0};
+    if (gzipTestBits(r, 1) != 1 || gzipTestBits(r, 2) != 1) return -1;
+    size_t n = 0;
+    for (;;) {
+        int sym = gzipTestSymbol(r);
+        if (sym < 0 || sym > 285) return -1;
+        if (sym == 256) break;
+        if (sym < 256) {
+            if (n >= cap) return -1;
+            out[n++] = (uint8_t)sym;
+            continue;
+        }
+        int length = lengthBase[sym - 257] + gzipTestBits(r, lengthExtra[sym - 257]);
+        int d = gzipTestCode(r, 5);
+        int distance = 1;
+        for (int k = 0; k < d; k++) distance += 1 << (k < 2 ? 0 : (k - 2) / 2);
+        distance += gzipTestBits(r, d < 4 ? 0 : (d - 2) / 2);
+        if ((size_t)distance > n || n + length > cap) return -1;
+        for (int k = 0; k < length; k++, n++) out[n] = out[n - distance];
+    }
+    const uint8_t *t = gz + len - GzipLogic::TRAILER_SIZE;
+    uint32_t crc = t[0] | (t[1] << 8) | (t[2] << 16) | ((uint32_t)t[3] << 24);
+    uint32_t size = t[4] | (t[5] << 8) | (t[6] << 16) | ((uint32_t)t[7] << 24);
+    if (crc != GzipLogic::crc32Update(0, out, n) || size != n) return -1;
+    return (long)n;
+}
+
+void test_gzip_known_vector(void) {
+    TEST_ASSERT_EQUAL_UINT32(0xCBF43926, GzipLogic::crc32Update(0, (const uint8_t *)"123456789", 9));
+
+    GzipLogic::Compressor *c = new GzipLogic::Compressor;
+    uint8_t out[64];
+    GzipLogic::begin(*c, out, sizeof(out));
+    GzipLogic::write(*c, (const uint8_t *)"hello", 5);
+    size_t len = GzipLogic::finish(*c);
+    delete c;
+    // Same deflate stream as zlib; trailer = CRC32 0x3610A686, size 5
+    const uint8_t expected[] = {0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xCB, 0x48, 0xCD,
+                                0xC9, 0xC9, 0x07, 0x00, 0x86, 0xA6, 0x10, 0x36, 0x05, 0x00, 0x00, 0x00};
+    TEST_ASSERT_EQUAL_UINT32(sizeof(expected), len);
+    TEST_ASSERT_EQUAL_INT(0, memcmp(out, expected, sizeof(expected)));
+}
+
+void test_gzip_log_batch_round_trip_in_chunks(void) {
+    // A log push body well past the 2 KB window, so matches cross slides
+    static char body[16384];
+    size_t size = snprintf(body, sizeof(body), "{\"streams\":[{\"stream\":{\"job\":\"esp32\"},\"values\":[");
+    for (int i = 0; i < 120; i++) {
+        size += snprintf(body + size, sizeof(body) - size,
+                         "%s[\"17%08d000000000\",\"Valve %d: phase %s, water level %d%%, rain=%d\"]", i ? "," : "",
+                         1000 + i * 7, i % 6, (i % 3) ? "CHECKING_RAIN" : "WATERING", (i * 13) % 100, i & 1);
+    }
+    size += snprintf(body + size, sizeof(body) - size, "]}]}");
+    const uint8_t *raw = (const uint8_t *)body;
+
+    GzipLogic::Compressor *c = new GzipLogic::Compressor;
+    uint8_t *gz = new uint8_t[size];
+    GzipLogic::begin(*c, gz, size);
+    // Uneven writes exercise the lookahead / slide boundaries
+    size_t off = 0;
+    for (size_t step = 1; off < size; step = step * 3 + 1) {
+        size_t n = step % 997;
+        if (n > size - off) n = size - off;
+        GzipLogic::write(*c, raw + off, n);
+        off += n;
+    }
+    size_t len = GzipLogic::finish(*c);
+    delete c;
+
+    TEST_ASSERT_TRUE(len > 0);
+    TEST_ASSERT_TRUE(len * 4 < size);
+    uint8_t *back = new uint8_t[size];
+    long n = gzipTestInflate(gz, len, back, size);
+    TEST_ASSERT_EQUAL_INT((long)size, n);
+    TEST_ASSERT_EQUAL_INT(0, memcmp(back, raw, size));
+    delete[] back;
+    delete[] gz;
+}
+
+void test_gzip_overflow_reports_zero(void) {
+    // Incompressible input in a buffer sized to the input: caller sends it plain
+    uint8_t raw[600];
+    uint32_t x = 2463534242u;
+    for (size_t i = 0; i < sizeof(raw); i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        raw[i] = (uint8_t)x;
+    }
+    GzipLogic::Compressor *c = new GzipLogic::Compressor;
+    uint8_t out[sizeof(raw)];
+    GzipLogic::begin(*c, out, sizeof(out));
+    GzipLogic::write(*c, raw, sizeof(raw));
+    TEST_ASSERT_EQUAL_UINT32(0, GzipLogic::finish(*c));
+    delete c;
+}
+
 // ========== Main Test Runner ==========
 
 int main(int argc, char **argv) {
@@ -948,6 +3187,10 @@ int main(int argc, char **argv) {
     RUN_TEST(test_plant_light_schedule_stays_on_after_midnight);
     RUN_TEST(test_plant_light_schedule_turns_off_at_07_00);
     RUN_TEST(test_plant_light_schedule_is_off_during_day);
+    RUN_TEST(test_light_schedule_parse_and_format_round_trip);
+    RUN_TEST(test_light_schedule_sun_times);
+    RUN_TEST(test_light_schedule_next_transition);
+    RUN_TEST(test_plant_light_schedule_handed_to_control_loop);
     RUN_TEST(test_get_time_since_last_attempt_uses_realtime_fallback);
     RUN_TEST(test_should_water_now_blocks_retry_until_realtime_min_interval_passes);
 
@@ -1006,6 +3249,7 @@ int main(int argc, char **argv) {
     RUN_TEST(test_decrement_on_timeout_subtracts_quarter);
     RUN_TEST(test_decrement_on_timeout_floors_at_one);
     RUN_TEST(test_decrement_on_timeout_caps_input_too);
+    RUN_TEST(test_moisture_setpoint_stop_is_not_learned_as_a_fill);
     RUN_TEST(test_max_interval_multiplier_is_five_days);
     RUN_TEST(test_rain_debounce_single_stray_low_reads_dry);
     RUN_TEST(test_rain_debounce_just_below_threshold_reads_dry);
@@ -1014,6 +3258,131 @@ int main(int argc, char **argv) {
     RUN_TEST(test_wet_confirm_consecutive_reads_confirm);
     RUN_TEST(test_wet_confirm_dry_read_resets_streak);
 
+    // Deadline Monitor Tests
+    RUN_TEST(test_deadline_classify_elapsed);
+    RUN_TEST(test_deadline_fast_cycle_counts_no_miss);
+    RUN_TEST(test_deadline_miss_charged_to_slowest_stage);
+    RUN_TEST(test_deadline_new_cycle_resets_culprit);
+    RUN_TEST(test_deadline_stall_detected_after_hard_deadline);
+    RUN_TEST(test_deadline_stall_check_survives_millis_rollover);
+    RUN_TEST(test_loop_stage_names);
+
+    // History Store Tests
+    RUN_TEST(test_history_average_within_bucket);
+    RUN_TEST(test_history_unknown_values_are_skipped);
+    RUN_TEST(test_history_gap_rows_are_cleared);
+    RUN_TEST(test_history_small_clock_step_back_is_dropped);
+    RUN_TEST(test_history_choose_finest_covering_archive);
+    RUN_TEST(test_history_downsample_groups_rows);
+    RUN_TEST(test_history_empty_archive_has_no_points);
+
+    // Delta Patch Decoder Tests
+    RUN_TEST(test_delta_patch_copy_diff_and_insert);
+    RUN_TEST(test_delta_patch_rejects_copy_outside_source);
+    RUN_TEST(test_delta_patch_rejects_short_output);
+    RUN_TEST(test_delta_patch_rejects_bad_magic);
+
+    // Web Asset Update Tests
+    RUN_TEST(test_web_asset_accepts_web_paths);
+    RUN_TEST(test_web_asset_rejects_learning_data_and_root_files);
+    RUN_TEST(test_web_asset_rejects_traversal_and_odd_names);
+    RUN_TEST(test_web_asset_hex_digest_matching);
+
+    // OTA Pipeline Progress Tests
+    RUN_TEST(test_ota_progress_percent);
+    RUN_TEST(test_ota_progress_throughput_and_eta);
+    RUN_TEST(test_ota_progress_fill_buffer_splits_chunks);
+
+    // CPU Profile Dump Format Tests
+    RUN_TEST(test_profile_format_round_trip);
+    RUN_TEST(test_profile_format_rejects_bad_input);
+
+    // Binary Log Format Tests
+    RUN_TEST(test_binlog_record_round_trip);
+    RUN_TEST(test_binlog_strings_are_truncated_and_missing_args_marked);
+    RUN_TEST(test_binlog_oversized_arguments_are_dropped_whole);
+    RUN_TEST(test_binlog_collect_new_formats);
+
+    // Log Level Tests
+    RUN_TEST(test_log_level_parse_names);
+    RUN_TEST(test_log_rate_limit_counts_suppressed_calls);
+    RUN_TEST(test_log_rate_limit_survives_millis_rollover);
+
+    // Chrome Trace Format Tests
+    RUN_TEST(test_trace_format_event_phases);
+    RUN_TEST(test_trace_format_truncation_and_ring_window);
+
+    // Logic Capture Frame Tests
+    RUN_TEST(test_scope_frame_round_trip);
+    RUN_TEST(test_scope_frame_splits_and_handles_timer_wrap);
+
+    // Sensor Trace Replay Tests
+    RUN_TEST(test_trace_replay_loads_capture_across_timer_wrap);
+    RUN_TEST(test_trace_replay_scores_parameter_sets);
+    RUN_TEST(test_trace_replay_report_for_recorded_file);
+
+    // Control Tick Allocation Budget Tests
+    RUN_TEST(test_alloc_counter_attributes_allocations_to_scope);
+    RUN_TEST(test_alloc_idle_control_ticks_allocate_nothing);
+    RUN_TEST(test_alloc_publish_with_every_field_stays_in_budget);
+    RUN_TEST(test_alloc_manual_watering_cycle_stays_in_budget);
+    RUN_TEST(test_alloc_auto_watering_cycle_only_pays_for_enqueue);
+    RUN_TEST(test_alloc_overflow_emergency_stop_allocates_nothing);
+
+    // Runtime Config Tests
+    RUN_TEST(test_runtime_config_defaults_are_valid);
+    RUN_TEST(test_runtime_config_set_checks_ranges_and_invariants);
+    RUN_TEST(test_runtime_config_json_lists_values_and_defaults);
+    RUN_TEST(test_runtime_config_slot_reused_only_after_a_control_pass);
+
+    // I/O Expander Tests
+    RUN_TEST(test_io_expander_configures_chip_and_samples_in_one_read);
+    RUN_TEST(test_io_expander_interrupt_on_change_and_bus_errors);
+    RUN_TEST(test_io_expander_detects_reset_chip_and_forces_closes);
+    RUN_TEST(test_io_expander_scales_to_24_trays);
+
+    // Analog Moisture Tests
+    RUN_TEST(test_moisture_oversampling_rejects_spikes_and_filter_converges);
+    RUN_TEST(test_moisture_percent_and_setpoint);
+    RUN_TEST(test_moisture_reading_corrects_time_based_water_level);
+
+    // Flow Meter Tests
+    RUN_TEST(test_flow_meter_counts_across_counter_wrap);
+    RUN_TEST(test_flow_meter_cycle_volume_and_rate);
+    RUN_TEST(test_flow_meter_detects_dry_pump_and_blocked_line);
+
+    // Power Management Tests
+    RUN_TEST(test_power_mode_idles_only_after_quiet_period);
+    RUN_TEST(test_wifi_power_save_follows_traffic);
+    RUN_TEST(test_power_stats_account_time_current_and_wake_latency);
+
+    // WiFi Link State Machine Tests
+    RUN_TEST(test_wifi_link_boot_connect_is_not_a_reconnect);
+    RUN_TEST(test_wifi_link_outage_backs_off_and_records_reconnect);
+    RUN_TEST(test_wifi_link_ignores_stale_events_and_queue_keeps_latest);
+    RUN_TEST(test_wifi_directed_attempt_falls_back_to_scan_without_backoff);
+    RUN_TEST(test_wifi_fast_connect_cache_rules);
+
+    // DNS Cache Tests
+    RUN_TEST(test_dns_build_query_and_parse_cname_chain);
+    RUN_TEST(test_dns_entry_freshness_prefetch_and_stale);
+    RUN_TEST(test_dns_slot_reuse_and_lru_eviction);
+
+    // Metrics Wire Format Tests
+    RUN_TEST(test_metrics_wire_full_frame_vector);
+    RUN_TEST(test_metrics_wire_delta_carries_only_changes);
+    RUN_TEST(test_metrics_wire_size_against_json);
+
+    // Gzip Upload Tests
+    RUN_TEST(test_gzip_known_vector);
+    RUN_TEST(test_gzip_log_batch_round_trip_in_chunks);
+    RUN_TEST(test_gzip_overflow_reports_zero);
+
+    // Control Loop Fuzz Tests
+    RUN_TEST(test_fuzz_control_loop_invariants);
+    RUN_TEST(test_fuzz_shrinks_failure_to_minimal_repro);
+    RUN_TEST(test_watchdog_uses_runtime_emergency_timeout);
+
     return UNITY_END();
 }
 
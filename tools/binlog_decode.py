@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+"""
+Decoder for the device's binary log batches (POST /v1/logs/push-binary).
+
+The format is defined by include/BinaryLogFormat.h:
+
+  batch header (28 bytes, little-endian)
+    "WLB1" | build_id[8] | epoch_s u32 | millis_now u32 | dropped u32 |
+    format_count u16 | record_count u16
+  formats  format_count x (id u32, length u16, text)
+  records  record_count x (len u8, level u8, format_id u32, millis u32, args)
+
+Arguments are untagged; the printf format string says how to read them
+(4-byte ints, 8-byte for "ll", float32 for %f/%e/%g, u8-length strings for
+%s). Format IDs are flash addresses, so they are cached per build id.
+
+Used by tools/esp32_metrics_proxy.py. Standalone, it prints a saved batch:
+
+  binlog_decode.py batch.bin
+"""
+
+from __future__ import annotations
+
+import re
+import struct
+import sys
+from collections import defaultdict
+
+
+MAGIC = b"WLB1"
+BATCH_HEADER_SIZE = 28
+RECORD_HEADER_SIZE = 10
+LEVELS = {0: "debug", 1: "info", 2: "warn", 3: "error"}
+
+_SPEC = re.compile(r"%(?P<flags>[-+ #0]*)(?P<width>\d*)(?:\.(?P<prec>\d*))?(?P<length>[hlzjtL]*)(?P<conv>[a-zA-Z%])")
+
+
+def format_record(fmt: str, args: bytes) -> str:
+    """printf-style rendering, mirroring BinaryLogFormat::formatRecord."""
+    out = []
+    pos = 0
+    last = 0
+    for m in _SPEC.finditer(fmt):
+        out.append(fmt[last:m.start()])
+        last = m.end()
+        conv = m.group("conv")
+        if conv == "%":
+            out.append("%")
+            continue
+        prec = m.group("prec")
+        spec = "%" + m.group("flags") + m.group("width") + ("." + prec if prec is not None else "")
+        text = "<?>"
+        if conv in "diuxXoc":
+            if m.group("length").count("l") >= 2:
+                if pos + 8 <= len(args):
+                    value = struct.unpack_from("<q" if conv in "di" else "<Q", args, pos)[0]
+                    text = (spec + ("d" if conv == "u" else conv)) % value
+                pos += 8
+            else:
+                if pos + 4 <= len(args):
+                    value = struct.unpack_from("<i" if conv in "dic" else "<I", args, pos)[0]
+                    if conv == "c":
+                        text = (spec + "s") % chr(value & 0xFF)
+                    else:
+                        text = (spec + ("d" if conv in "iu" else conv)) % value
+                pos += 4
+        elif conv == "p":
+            if pos + 4 <= len(args):
+                text = "0x%08x" % struct.unpack_from("<I", args, pos)[0]
+            pos += 4
+        elif conv in "fFeEgGaA":
+            if pos + 4 <= len(args):
+                value = struct.unpack_from("<f", args, pos)[0]
+                text = (spec + {"a": "e", "A": "E"}.get(conv, conv)) % value
+            pos += 4
+        elif conv == "s":
+            if pos < len(args) and pos + 1 + args[pos] <= len(args):
+                n = args[pos]
+                text = (spec + "s") % args[pos + 1:pos + 1 + n].decode("utf-8", "replace")
+                pos += 1 + n
+            else:
+                pos = len(args) + 1
+        else:
+            text = m.group(0)
+        out.append(text)
+    out.append(fmt[last:])
+    return "".join(out)
+
+
+class FormatCache:
+    """Format strings by (build id, format id), filled from batch tables."""
+
+    def __init__(self):
+        self.formats: dict = {}
+
+    def decode(self, body: bytes):
+        """Returns (entries, unknown_ids, dropped).
+
+        entries are (timestamp_ns, level, text). If unknown_ids is non-empty
+        the batch referenced formats this cache has never seen and the device
+        must resend it with its full table.
+        """
+        if len(body) < BATCH_HEADER_SIZE or body[:4] != MAGIC:
+            raise ValueError("not a binary log batch")
+        build = body[4:12].hex()
+        epoch_s, millis_now, dropped, format_count, record_count = struct.unpack_from("<IIIHH", body, 12)
+
+        pos = BATCH_HEADER_SIZE
+        for _ in range(format_count):
+            if pos + 6 > len(body):
+                raise ValueError("truncated format table")
+            fmt_id, length = struct.unpack_from("<IH", body, pos)
+            self.formats[(build, fmt_id)] = body[pos + 6:pos + 6 + length].decode("utf-8", "replace")
+            pos += 6 + length
+
+        entries = []
+        unknown = set()
+        base_ms = epoch_s * 1000
+        for _ in range(record_count):
+            if pos + RECORD_HEADER_SIZE > len(body) or body[pos] < RECORD_HEADER_SIZE:
+                raise ValueError("truncated record")
+            length, level, fmt_id, rec_ms = struct.unpack_from("<BBII", body, pos)
+            args = body[pos + RECORD_HEADER_SIZE:pos + length]
+            pos += length
+            fmt = self.formats.get((build, fmt_id))
+            if fmt is None:
+                unknown.add(fmt_id)
+                continue
+            age_ms = (millis_now - rec_ms) & 0xFFFFFFFF
+            ts_ns = (base_ms - age_ms) * 1_000_000
+            entries.append((ts_ns, LEVELS.get(level, "info"), format_record(fmt, args)))
+        return entries, sorted(unknown), dropped
+
+
+def to_loki_streams(entries) -> dict:
+    """Loki push body, one stream per level (same labels as the JSON path)."""
+    by_level = defaultdict(list)
+    for ts_ns, level, text in entries:
+        by_level[level].append([str(ts_ns), text])
+    return {"streams": [
+        {"stream": {"job": "esp32", "device": "watering-system", "level": level}, "values": values}
+        for level, values in by_level.items()
+    ]}
+
+
+def main() -> int:
+    if len(sys.argv) != 2:
+        print(__doc__, file=sys.stderr)
+        return 2
+    with open(sys.argv[1], "rb") as f:
+        body = f.read()
+    try:
+        entries, unknown, dropped = FormatCache().decode(body)
+    except ValueError as e:
+        print(f"error: {e}", file=sys.stderr)
+        return 1
+    for ts_ns, level, text in entries:
+        print(f"{ts_ns // 1_000_000} {level:5} {text}")
+    if unknown:
+        print(f"{len(unknown)} format id(s) not in this batch's table", file=sys.stderr)
+    if dropped:
+        print(f"device dropped {dropped} record(s) since boot", file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -5,10 +5,16 @@ and forwards Loki log streams to a Loki HTTP API.
 
 Endpoints:
   POST /v1/metrics/push  — receive ESP32 JSON, store latest values in memory
+  POST /v1/metrics/push-binary — receive a WMB1 metrics frame, decode to the same values
+                              (409 on unknown schema / delta base -> device sends a full frame)
   POST /v1/logs/push     — receive Loki-format JSON, forward to Loki API
+  POST /v1/logs/push-binary — receive BLOG_* binary batch, decode, forward to Loki
+                              (409 + unknown format ids -> device resends formats)
   GET  /metrics          — Prometheus text exposition (no auth)
   GET  /health           — health check (no auth)
 
+Any POST body may be sent with Content-Encoding: gzip (400 if it does not inflate).
+
 Auth (POST only):
   METRICS_PROXY_AUTH_TOKEN=<token>
   Header: Authorization: Bearer <token>
@@ -22,6 +28,7 @@ Env vars:
 
 from __future__ import annotations
 
+import gzip
 import json
 import os
 import threading
@@ -31,6 +38,9 @@ from urllib.parse import urlparse
 from urllib.request import Request, urlopen
 from urllib.error import URLError
 
+from binlog_decode import FormatCache, to_loki_streams
+from metrics_decode import MetricsDecoder, NeedFull
+
 
 HOST = os.getenv("METRICS_PROXY_HOST", "0.0.0.0")
 PORT = int(os.getenv("METRICS_PROXY_PORT", "18086"))
@@ -43,6 +53,13 @@ _metrics_lock = threading.Lock()
 _latest_metrics: dict = {}
 _last_push_timestamp: float = 0.0
 
+# Binary log format strings, learned from the device's batch tables
+_formats_lock = threading.Lock()
+_format_cache = FormatCache()
+
+# Binary metrics schema and last snapshot (delta frames build on it)
+_metrics_decoder = MetricsDecoder()
+
 
 def _json_response(handler: BaseHTTPRequestHandler, code: int, payload: dict) -> None:
     raw = json.dumps(payload, ensure_ascii=False).encode("utf-8")
@@ -121,6 +138,36 @@ def _build_prometheus_metrics() -> str:
           data.get("free_heap", 0))
     gauge("esp32_wifi_rssi_dbm", "ESP32 WiFi RSSI in dBm",
           data.get("wifi_rssi", 0))
+    counter("esp32_wifi_connect_attempts_total", "WiFi connection attempts since boot",
+            data.get("wifi_connect_attempts", 0))
+    counter("esp32_wifi_reconnects_total", "WiFi outages that ended in a reconnect since boot",
+            data.get("wifi_reconnects", 0))
+    gauge("esp32_wifi_last_connect_ms", "Association + DHCP time of the last successful attempt in ms",
+          data.get("wifi_last_connect_ms", 0))
+    gauge("esp32_wifi_last_outage_ms", "Link loss to reconnect time of the last outage in ms",
+          data.get("wifi_last_outage_ms", 0))
+    gauge("esp32_wifi_last_outage_attempts", "Connection attempts needed to end the last outage",
+          data.get("wifi_last_outage_attempts", 0))
+    gauge("esp32_wifi_disconnect_reason", "ESP-IDF reason code of the last WiFi disconnect",
+          data.get("wifi_disconnect_reason", 0))
+    gauge("esp32_wifi_assoc_to_ip_ms", "Association to IP address time of the last successful attempt in ms",
+          data.get("wifi_assoc_to_ip_ms", 0))
+    gauge("esp32_wifi_last_connect_directed", "1 if the last connection used the cached BSSID/channel",
+          data.get("wifi_last_connect_directed", 0))
+    counter("esp32_wifi_directed_attempts_total", "Connection attempts using the cached BSSID/channel",
+            data.get("wifi_directed_attempts", 0))
+    counter("esp32_wifi_directed_failures_total", "Directed attempts that fell back to a scan",
+            data.get("wifi_directed_failures", 0))
+    counter("esp32_dns_hits_total", "Outbound host lookups served from the DNS cache",
+            data.get("dns_hits", 0))
+    counter("esp32_dns_misses_total", "Outbound host lookups that had to query the resolver",
+            data.get("dns_misses", 0))
+    counter("esp32_dns_prefetches_total", "Background DNS refreshes before expiry",
+            data.get("dns_prefetches", 0))
+    counter("esp32_dns_stale_served_total", "Lookups answered with a last-known IP past its TTL",
+            data.get("dns_stale_served", 0))
+    counter("esp32_dns_failures_total", "DNS queries that got no usable answer",
+            data.get("dns_failures", 0))
     gauge("esp32_last_push_timestamp", "Unix timestamp of the last metrics push from ESP32",
           last_push)
 
@@ -140,6 +187,63 @@ def _build_prometheus_metrics() -> str:
     counter("esp32_telegram_failures_total", "Total number of Telegram send failures",
             data.get("telegram_failures", 0))
 
+    # --- Task deadline monitor ---
+    gauge("esp32_loop_last_ms", "Duration of the last control loop pass in ms",
+          data.get("loop_last_ms", 0))
+    gauge("esp32_loop_max_ms", "Longest control loop pass since boot in ms",
+          data.get("loop_max_ms", 0))
+    gauge("esp32_network_loop_max_ms", "Longest network task pass since boot in ms",
+          data.get("net_loop_max_ms", 0))
+    counter("esp32_deadline_hard_resets_total", "Resets caused by a hard deadline miss since power-on",
+            data.get("deadline_hard_resets", 0))
+    misses = data.get("deadline_misses", [])
+    lines.append("# HELP esp32_deadline_misses_total Soft deadline misses by task and culprit stage")
+    lines.append("# TYPE esp32_deadline_misses_total counter")
+    for miss in misses:
+        lines.append(
+            f'esp32_deadline_misses_total{{task="{miss.get("task", "?")}",stage="{miss.get("stage", "?")}"}} '
+            f'{miss.get("count", 0)}'
+        )
+
+    # --- OTA pipeline ---
+    gauge("esp32_ota_last_bytes", "Upload size of the update that installed the running firmware",
+          data.get("ota_last_bytes", 0))
+    gauge("esp32_ota_last_duration_ms", "Duration of the update that installed the running firmware in ms",
+          data.get("ota_last_duration_ms", 0))
+    gauge("esp32_ota_last_throughput_bps", "Upload throughput of that update in bytes per second",
+          data.get("ota_last_throughput_bps", 0))
+    counter("esp32_ota_failures_total", "Failed OTA uploads since boot",
+            data.get("ota_failures", 0))
+
+    # --- I/O expanders ---
+    counter("esp32_io_expander_bus_errors_total", "Failed MCP23017 I2C transfers since boot",
+            data.get("io_expander_bus_errors", 0))
+
+    # --- Flow meter (absent when not fitted) ---
+    if "flow_meter_pulses" in data:
+        counter("esp32_flow_meter_pulses_total", "Flow meter pulses counted since boot",
+                data["flow_meter_pulses"])
+
+    # --- Power management ---
+    gauge("esp32_power_mode", "Control loop power mode (0=active, 1=idle)",
+          data.get("power_mode", 0))
+    counter("esp32_power_idle_seconds_total", "Time spent in idle power mode since boot",
+            data.get("power_idle_s", 0))
+    counter("esp32_power_active_seconds_total", "Time spent in active power mode since boot",
+            data.get("power_active_s", 0))
+    gauge("esp32_wifi_power_save", "WiFi power save level (0=none, 1=min modem, 2=max modem)",
+          data.get("wifi_ps", 0))
+    gauge("esp32_power_estimated_ma", "Modelled supply current for the current mode in mA",
+          data.get("power_est_ma", 0))
+    gauge("esp32_power_average_ma", "Modelled supply current averaged since boot in mA",
+          data.get("power_avg_ma", 0))
+    counter("esp32_wake_total", "Sensor pin changes that woke the control loop since boot",
+            data.get("wake_count", 0))
+    gauge("esp32_wake_latency_last_us", "Sensor pin change to control loop pass, last wake, in us",
+          data.get("wake_latency_last_us", 0))
+    gauge("esp32_wake_latency_max_us", "Sensor pin change to control loop pass, worst since boot, in us",
+          data.get("wake_latency_max_us", 0))
+
     # --- Log push diagnostics ---
     gauge("esp32_log_buffer_count", "Number of log entries in circular buffer",
           data.get("log_buffer_count", 0))
@@ -149,6 +253,18 @@ def _build_prometheus_metrics() -> str:
             data.get("log_push_attempts", 0))
     counter("esp32_log_push_successes_total", "Total successful log pushes",
             data.get("log_push_successes", 0))
+    gauge("esp32_metrics_payload_bytes", "Body size of the previous metrics push in bytes",
+          data.get("metrics_payload_bytes", 0))
+    gauge("esp32_metrics_encode_us", "Time to collect and serialize the previous metrics push in us",
+          data.get("metrics_encode_us", 0))
+    counter("esp32_upload_raw_bytes_total", "Proxy upload bytes before compression",
+            data.get("upload_raw_bytes", 0))
+    counter("esp32_upload_wire_bytes_total", "Proxy upload bytes actually sent (after gzip)",
+            data.get("upload_wire_bytes", 0))
+    gauge("esp32_blog_pending_records", "Binary log records waiting to be pushed",
+          data.get("blog_pending", 0))
+    counter("esp32_blog_dropped_total", "Binary log records overwritten before they were pushed",
+            data.get("blog_dropped", 0))
 
     # --- Per-valve metrics ---
     valves = data.get("valves", [])
@@ -179,6 +295,25 @@ def _build_prometheus_metrics() -> str:
             value = valve.get(field, 0)
             lines.append(f'{metric_name}{{valve="{valve_id}"}} {value}')
 
+    # Optional hardware (moisture probes, flow meter): only valves that report
+    # the field get a sample, so missing hardware never reads as zero.
+    optional_per_valve_defs = [
+        ("esp32_valve_moisture_pct",       "gauge",   "Filtered analog moisture reading for this tray",     "moisture_pct"),
+        ("esp32_valve_last_cycle_litres",  "gauge",   "Water delivered by the last pump run (flow meter)",  "last_cycle_l"),
+        ("esp32_valve_flow_rate_lpm",      "gauge",   "Flow rate of the last pump run in litres per minute", "flow_lpm"),
+        ("esp32_valve_no_flow",            "gauge",   "1 if the last pump run stopped on no flow",          "no_flow"),
+    ]
+
+    for metric_name, metric_type, help_text, field in optional_per_valve_defs:
+        reporting = [v for v in valves if field in v]
+        if not reporting:
+            continue
+        lines.append(f"# HELP {metric_name} {help_text}")
+        lines.append(f"# TYPE {metric_name} {metric_type}")
+        for valve in reporting:
+            valve_id = str(valve.get("id", "?"))
+            lines.append(f'{metric_name}{{valve="{valve_id}"}} {valve[field]}')
+
     return "\n".join(lines) + "\n"
 
 
@@ -188,7 +323,8 @@ class Handler(BaseHTTPRequestHandler):
 
         parsed = urlparse(self.path)
 
-        if parsed.path not in ("/v1/metrics/push", "/v1/logs/push"):
+        if parsed.path not in ("/v1/metrics/push", "/v1/metrics/push-binary", "/v1/logs/push",
+                               "/v1/logs/push-binary"):
             _json_response(self, 404, {"ok": False, "error": "Not found"})
             return
 
@@ -198,6 +334,12 @@ class Handler(BaseHTTPRequestHandler):
 
         content_length = int(self.headers.get("Content-Length", "0"))
         body = self.rfile.read(content_length)
+        if self.headers.get("Content-Encoding", "").strip().lower() == "gzip":
+            try:
+                body = gzip.decompress(body)
+            except (OSError, EOFError) as exc:
+                _json_response(self, 400, {"ok": False, "error": f"Invalid gzip body: {exc}"})
+                return
 
         if parsed.path == "/v1/metrics/push":
             try:
@@ -212,6 +354,45 @@ class Handler(BaseHTTPRequestHandler):
 
             _json_response(self, 200, {"ok": True})
 
+        elif parsed.path == "/v1/metrics/push-binary":
+            with _metrics_lock:
+                try:
+                    payload = _metrics_decoder.decode(body)
+                except NeedFull as exc:
+                    # Proxy restarted or missed the delta's base frame
+                    _json_response(self, 409, {"ok": False, "error": str(exc)})
+                    return
+                except ValueError as exc:
+                    _json_response(self, 400, {"ok": False, "error": str(exc)})
+                    return
+                _latest_metrics = payload
+                _last_push_timestamp = time.time()
+
+            _json_response(self, 200, {"ok": True})
+
+        elif parsed.path == "/v1/logs/push-binary":
+            try:
+                with _formats_lock:
+                    entries, unknown, dropped = _format_cache.decode(body)
+            except ValueError as exc:
+                _json_response(self, 400, {"ok": False, "error": str(exc)})
+                return
+            if unknown:
+                # Proxy restarted since the device sent these formats
+                _json_response(self, 409, {"ok": False, "unknown": unknown})
+                return
+            print(f"[esp32-metrics-proxy] Received binary log push ({len(body)} bytes, "
+                  f"{len(entries)} entries, {dropped} dropped since boot)")
+            if not entries:
+                _json_response(self, 200, {"ok": True})
+                return
+            status, err = _forward_to_loki(json.dumps(to_loki_streams(entries)).encode("utf-8"))
+            if err:
+                print(f"[esp32-metrics-proxy] Loki forward FAILED: {status} {err}")
+                _json_response(self, status, {"ok": False, "error": f"Loki error: {err}"})
+            else:
+                _json_response(self, 200, {"ok": True})
+
         else:  # /v1/logs/push
             print(f"[esp32-metrics-proxy] Received log push ({len(body)} bytes)")
             status, err = _forward_to_loki(body)
@@ -0,0 +1,231 @@
+#!/usr/bin/env python3
+"""
+Firmware delta patch builder (and optional uploader) for the /firmware endpoint.
+
+Builds a WDP1 patch that turns the firmware currently running on the device
+(OLD) into the new build (NEW). The format is decoded on the device by
+include/DeltaPatchLogic.h:
+
+  header (80 bytes, little-endian)
+    "WDP1" | target_size u32 | source_size u32 | sha256(OLD) | sha256(NEW) | 0 u32
+  records
+    0x01 COPY   varint src_offset, varint length, diff runs:
+                (varint zero_run, varint lit_count, lit bytes) ... covering length
+    0x02 INSERT varint length, raw bytes
+    0x00 END
+
+Matching is bsdiff-like: exact 8-byte seeds from OLD are extended with
+mismatches allowed, so relocated addresses become a few sparse diff bytes
+instead of a literal copy of the whole region.
+
+Usage:
+  make_delta_patch.py OLD.bin NEW.bin -o patch.wdp
+  make_delta_patch.py OLD.bin NEW.bin -o patch.wdp \\
+      --upload http://<device-ip>/firmware --user admin --password secret
+
+With --upload the patch is posted first; if the device rejects it (409, e.g.
+OLD is not what is actually running) NEW.bin is uploaded in full instead.
+Each upload carries ?sha256= of the posted bytes, which the device checks
+before marking the new image bootable.
+"""
+
+from __future__ import annotations
+
+import argparse
+import base64
+import hashlib
+import struct
+import sys
+import uuid
+from urllib.error import HTTPError, URLError
+from urllib.request import Request, urlopen
+
+
+MAGIC = b"WDP1"
+OP_END = 0x00
+OP_COPY = 0x01
+OP_INSERT = 0x02
+
+SEED_LEN = 8            # Exact match needed to start a COPY
+MAX_CANDIDATES = 8      # Old positions remembered per seed
+MIN_COPY_LEN = 24       # Shorter matches are cheaper as INSERT
+WINDOW = 16             # Extension window for approximate matching
+WINDOW_MIN_MATCHES = 8  # Keep extending while >= half the window matches
+ZERO_RUN_BREAK = 3      # Zero diff bytes needed to end a literal run
+
+
+def varint(value: int) -> bytes:
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def build_index(old: bytes) -> dict:
+    index: dict = {}
+    for pos in range(0, len(old) - SEED_LEN + 1):
+        key = old[pos:pos + SEED_LEN]
+        slot = index.get(key)
+        if slot is None:
+            index[key] = [pos]
+        elif len(slot) < MAX_CANDIDATES:
+            slot.append(pos)
+    return index
+
+
+def extend(old: bytes, new: bytes, old_pos: int, new_pos: int) -> tuple[int, int]:
+    """Approximate forward extension. Returns (length, matching_bytes).
+
+    Extends while at least WINDOW_MIN_MATCHES of the last WINDOW bytes match,
+    then trims trailing mismatches.
+    """
+    limit = min(len(old) - old_pos, len(new) - new_pos)
+    hits = []
+    window_matches = 0
+    total = 0
+    best_len = 0
+    best_matches = 0
+    for k in range(limit):
+        hit = old[old_pos + k] == new[new_pos + k]
+        hits.append(hit)
+        window_matches += hit
+        if k >= WINDOW:
+            window_matches -= hits[k - WINDOW]
+            if window_matches < WINDOW_MIN_MATCHES:
+                break
+        if hit:
+            total += 1
+            best_len = k + 1
+            best_matches = total
+    return best_len, best_matches
+
+
+def encode_diff(old: bytes, new: bytes, old_pos: int, new_pos: int, length: int) -> bytes:
+    diff = bytes((new[new_pos + k] - old[old_pos + k]) & 0xFF for k in range(length))
+    out = bytearray()
+    k = 0
+    while k < length:
+        zero_start = k
+        while k < length and diff[k] == 0:
+            k += 1
+        zero_run = k - zero_start
+        lit_start = k
+        while k < length:
+            if diff[k] == 0 and diff[k:k + ZERO_RUN_BREAK] == b"\x00" * min(ZERO_RUN_BREAK, length - k):
+                break
+            k += 1
+        out += varint(zero_run) + varint(k - lit_start) + diff[lit_start:k]
+    return bytes(out)
+
+
+def make_patch(old: bytes, new: bytes) -> bytes:
+    index = build_index(old)
+    body = bytearray()
+    literal_start = 0
+    predicted_delta = 0
+    i = 0
+
+    def flush_literal(end: int) -> None:
+        if end > literal_start:
+            body.append(OP_INSERT)
+            body.extend(varint(end - literal_start))
+            body.extend(new[literal_start:end])
+
+    while i < len(new):
+        candidates = []
+        predicted = i + predicted_delta
+        if 0 <= predicted < len(old):
+            candidates.append(predicted)
+        if i + SEED_LEN <= len(new):
+            candidates.extend(index.get(new[i:i + SEED_LEN], ()))
+
+        best_pos, best_len, best_matches = -1, 0, 0
+        for old_pos in candidates:
+            length, matches = extend(old, new, old_pos, i)
+            if matches > best_matches:
+                best_pos, best_len, best_matches = old_pos, length, matches
+
+        if best_len >= MIN_COPY_LEN and best_matches * 2 >= best_len:
+            flush_literal(i)
+            body.append(OP_COPY)
+            body.extend(varint(best_pos))
+            body.extend(varint(best_len))
+            body.extend(encode_diff(old, new, best_pos, i, best_len))
+            predicted_delta = best_pos - i
+            i += best_len
+            literal_start = i
+        else:
+            i += 1
+
+    flush_literal(len(new))
+    body.append(OP_END)
+
+    header = MAGIC + struct.pack("<II", len(new), len(old))
+    header += hashlib.sha256(old).digest() + hashlib.sha256(new).digest()
+    header += struct.pack("<I", 0)
+    return header + bytes(body)
+
+
+def upload(url: str, user: str, password: str, name: str, payload: bytes) -> tuple[int, str]:
+    boundary = uuid.uuid4().hex
+    body = (
+        f"--{boundary}\r\n"
+        f'Content-Disposition: form-data; name="update"; filename="{name}"\r\n'
+        "Content-Type: application/octet-stream\r\n\r\n"
+    ).encode() + payload + f"\r\n--{boundary}--\r\n".encode()
+    request = Request(f"{url}?sha256={hashlib.sha256(payload).hexdigest()}", data=body, method="POST")
+    request.add_header("Content-Type", f"multipart/form-data; boundary={boundary}")
+    token = base64.b64encode(f"{user}:{password}".encode()).decode()
+    request.add_header("Authorization", f"Basic {token}")
+    try:
+        with urlopen(request, timeout=300) as response:
+            return response.status, response.read().decode(errors="replace")
+    except HTTPError as exc:
+        return exc.code, exc.read().decode(errors="replace")
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("old", help="firmware.bin currently running on the device")
+    parser.add_argument("new", help="new firmware.bin")
+    parser.add_argument("-o", "--output", required=True, help="patch file to write")
+    parser.add_argument("--upload", help="device /firmware URL (uploads patch, falls back to full image)")
+    parser.add_argument("--user", default="admin")
+    parser.add_argument("--password", default="")
+    args = parser.parse_args()
+
+    with open(args.old, "rb") as f:
+        old = f.read()
+    with open(args.new, "rb") as f:
+        new = f.read()
+
+    patch = make_patch(old, new)
+    with open(args.output, "wb") as f:
+        f.write(patch)
+    print(f"patch: {len(patch)} bytes ({100.0 * len(patch) / len(new):.1f}% of {len(new)} byte image)")
+
+    if not args.upload:
+        return 0
+
+    try:
+        status, text = upload(args.upload, args.user, args.password, "firmware.wdp", patch)
+        print(f"delta upload: HTTP {status}")
+        if status == 200:
+            return 0
+        print(f"  {text.strip()}")
+        print("falling back to full image upload")
+        status, text = upload(args.upload, args.user, args.password, "firmware.bin", new)
+        print(f"full upload: HTTP {status}")
+        return 0 if status == 200 else 1
+    except URLError as exc:
+        print(f"upload failed: {exc}", file=sys.stderr)
+        return 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
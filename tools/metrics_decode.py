@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+"""
+Decoder for the device's binary metrics frames (POST /v1/metrics/push-binary).
+
+The format is defined by include/MetricsWireFormat.h:
+
+  header (13 bytes, little-endian)
+    "WMB1" | schema_id u32 | seq u16 | base_seq u16 | flags u8
+  schema   if flags & 1: 2 x (varint count, count x (kind u8, len u8, name))
+  system   varint presence mask, one varint per set bit
+  valves   varint count, count x (varint id, varint mask, varints)
+  misses   varint count, count x (len u8 task, len u8 stage, varint count)
+
+Values are LEB128 varints; kinds 1..3 (int, tenths, hundredths) are zigzag.
+A delta frame (flags & 2) only carries what changed since base_seq, so the
+decoder keeps the last snapshot it accepted. The result is the same dict the
+JSON push (/v1/metrics/push) produces.
+
+Used by tools/esp32_metrics_proxy.py. Standalone, it prints saved frames,
+applied in order, as JSON:
+
+  metrics_decode.py full.bin [delta.bin ...]
+"""
+
+from __future__ import annotations
+
+import json
+import struct
+import sys
+
+
+MAGIC = b"WMB1"
+HEADER_SIZE = 13
+FLAG_SCHEMA = 0x01
+FLAG_DELTA = 0x02
+KIND_UINT, KIND_INT, KIND_FIXED1, KIND_FIXED2 = 0, 1, 2, 3
+
+
+class NeedFull(Exception):
+    """Unknown schema or missing delta base: the device must send a full frame."""
+
+
+class _Reader:
+    def __init__(self, body: bytes, pos: int) -> None:
+        self.body = body
+        self.pos = pos
+
+    def byte(self) -> int:
+        if self.pos >= len(self.body):
+            raise ValueError("truncated frame")
+        b = self.body[self.pos]
+        self.pos += 1
+        return b
+
+    def varint(self) -> int:
+        value = 0
+        for shift in range(0, 64, 7):
+            b = self.byte()
+            value |= (b & 0x7F) << shift
+            if not b & 0x80:
+                return value
+        raise ValueError("varint too long")
+
+    def value(self, kind: int):
+        v = self.varint()
+        if kind == KIND_UINT:
+            return v
+        v = (v >> 1) ^ -(v & 1)
+        if kind == KIND_FIXED1:
+            return round(v / 10, 1)
+        if kind == KIND_FIXED2:
+            return round(v / 100, 2)
+        return v
+
+    def name(self) -> str:
+        n = self.byte()
+        if self.pos + n > len(self.body):
+            raise ValueError("truncated name")
+        text = self.body[self.pos:self.pos + n].decode("utf-8", errors="replace")
+        self.pos += n
+        return text
+
+
+class MetricsDecoder:
+    """Keeps the device's schema and last snapshot between pushes."""
+
+    def __init__(self) -> None:
+        self.schema_id = None
+        self.fields = ([], [])  # (name, kind) per table: system, valve
+        self.seq = None
+        self.state = None       # {"system": {...}, "valves": {id: {...}}, "misses": [...]}
+
+    def _fields(self, r: _Reader, table: int, target: dict) -> None:
+        fields = self.fields[table]
+        mask = r.varint()
+        if mask >> len(fields):
+            raise ValueError("presence bits beyond schema")
+        for i, (name, kind) in enumerate(fields):
+            if mask & (1 << i):
+                target[name] = r.value(kind)
+
+    def decode(self, body: bytes) -> dict:
+        if len(body) < HEADER_SIZE or body[:4] != MAGIC:
+            raise ValueError("not a WMB1 frame")
+        schema_id, seq, base_seq, flags = struct.unpack_from("<IHHB", body, 4)
+        r = _Reader(body, HEADER_SIZE)
+
+        if flags & FLAG_SCHEMA:
+            tables = []
+            for _ in range(2):
+                count = r.varint()
+                if count > 64:
+                    raise ValueError("schema too large")
+                tables.append([(None, None)] * count)
+                for i in range(count):
+                    kind = r.byte()
+                    tables[-1][i] = (r.name(), kind)
+            self.fields = (tables[0], tables[1])
+            self.schema_id = schema_id
+        elif schema_id != self.schema_id:
+            raise NeedFull("unknown schema")
+
+        delta = bool(flags & FLAG_DELTA)
+        if delta and (self.state is None or self.seq != base_seq):
+            raise NeedFull("missing delta base")
+
+        if delta:
+            state = {
+                "system": dict(self.state["system"]),
+                "valves": {k: dict(v) for k, v in self.state["valves"].items()},
+            }
+        else:
+            state = {"system": {}, "valves": {}}
+
+        self._fields(r, 0, state["system"])
+        for _ in range(r.varint()):
+            valve_id = r.varint()
+            if delta and valve_id not in state["valves"]:
+                raise ValueError("delta adds a valve")
+            self._fields(r, 1, state["valves"].setdefault(valve_id, {}))
+
+        misses = []
+        for _ in range(r.varint()):
+            task = r.name()
+            stage = r.name()
+            misses.append({"task": task, "stage": stage, "count": r.varint()})
+        state["misses"] = misses
+        if r.pos != len(body):
+            raise ValueError("trailing bytes")
+
+        self.state = state
+        self.seq = seq
+        return self.to_dict()
+
+    def to_dict(self) -> dict:
+        """Latest snapshot in the JSON push layout."""
+        data = dict(self.state["system"])
+        data["valves"] = [dict({"id": vid}, **fields) for vid, fields in self.state["valves"].items()]
+        data["deadline_misses"] = list(self.state["misses"])
+        return data
+
+
+def main() -> int:
+    if len(sys.argv) < 2:
+        print(__doc__, file=sys.stderr)
+        return 2
+    decoder = MetricsDecoder()
+    data = None
+    for path in sys.argv[1:]:
+        with open(path, "rb") as f:
+            body = f.read()
+        try:
+            data = decoder.decode(body)
+        except NeedFull as e:
+            print(f"{path}: needs a full frame first ({e})", file=sys.stderr)
+            return 1
+        except ValueError as e:
+            print(f"{path}: error: {e}", file=sys.stderr)
+            return 1
+    print(json.dumps(data, indent=2))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,190 @@
+#!/usr/bin/env python3
+"""
+Turn a /profiler/download dump into folded stacks for flamegraph.pl or
+speedscope (https://www.speedscope.app, "Brendan Gregg folded" import).
+
+The dump format is defined by include/CpuProfileFormat.h:
+
+  header (32 bytes, little-endian)
+    "WPRF" | version u16 | max_depth u16 | hz u32 | samples u32 |
+    dropped u32 | tasks u32 | duration_ms u32 | 4 reserved
+  tasks    tasks x (handle u32, name[16])
+  samples  samples x (task u32, core u8, depth u8, flags u16, pc[max_depth] u32)
+
+PCs are symbolized against the firmware ELF's symbol table (no toolchain
+needed); names are demangled with c++filt when it is on PATH.
+
+Usage:
+  curl -u admin:secret -X POST 'http://<device-ip>/profiler/start?hz=250&seconds=30'
+  curl -u admin:secret -o profile.wprf http://<device-ip>/profiler/download
+  profile_fold.py profile.wprf .pio/build/esp32-s3-devkitc-1/firmware.elf > out.folded
+  flamegraph.pl out.folded > flame.svg
+
+Each output line is "task;outermost;...;leaf count". --per-core prefixes the
+core ("core0;task;..."); samples taken inside another ISR fold to "task;[isr]".
+"""
+
+from __future__ import annotations
+
+import argparse
+import bisect
+import shutil
+import struct
+import subprocess
+import sys
+from collections import Counter
+
+
+MAGIC = b"WPRF"
+VERSION = 1
+HEADER_SIZE = 32
+TASK_NAME_LEN = 16
+SAMPLE_IN_ISR = 0x0001
+
+STT_FUNC = 2
+
+
+class SymbolTable:
+    """Function symbols of an ELF32/ELF64 little-endian file, by address."""
+
+    def __init__(self, path: str):
+        with open(path, "rb") as f:
+            data = f.read()
+        if data[:4] != b"\x7fELF" or data[5] != 1:
+            raise ValueError(f"{path}: not a little-endian ELF file")
+        is64 = data[4] == 2
+        if is64:
+            shoff, = struct.unpack_from("<Q", data, 0x28)
+            shentsize, shnum = struct.unpack_from("<HH", data, 0x3A)
+        else:
+            shoff, = struct.unpack_from("<I", data, 0x20)
+            shentsize, shnum = struct.unpack_from("<HH", data, 0x2E)
+
+        sections = []
+        for i in range(shnum):
+            base = shoff + i * shentsize
+            if is64:
+                _, sh_type, _, _, offset, size, link, _, _, entsize = struct.unpack_from("<IIQQQQIIQQ", data, base)
+            else:
+                _, sh_type, _, _, offset, size, link, _, _, entsize = struct.unpack_from("<IIIIIIIIII", data, base)
+            sections.append((sh_type, offset, size, link, entsize))
+
+        symbols = {}
+        for sh_type, offset, size, link, entsize in sections:
+            if sh_type != 2 or entsize == 0:  # SHT_SYMTAB
+                continue
+            str_offset = sections[link][1]
+            for pos in range(offset, offset + size, entsize):
+                if is64:
+                    name, info, _, _, value, sym_size = struct.unpack_from("<IBBHQQ", data, pos)
+                else:
+                    name, value, sym_size, info, _, _ = struct.unpack_from("<IIIBBH", data, pos)
+                if info & 0xF != STT_FUNC or value == 0:
+                    continue
+                end = data.index(b"\0", str_offset + name)
+                symbols[value] = (sym_size, data[str_offset + name:end].decode("utf-8", "replace"))
+
+        self.addresses = sorted(symbols)
+        self.entries = [symbols[a] for a in self.addresses]
+
+    def lookup(self, pc: int) -> str | None:
+        i = bisect.bisect_right(self.addresses, pc) - 1
+        if i < 0:
+            return None
+        size, name = self.entries[i]
+        if size and pc >= self.addresses[i] + size:
+            return None
+        return name
+
+
+def demangle(names: set) -> dict:
+    tool = shutil.which("c++filt") or shutil.which("xtensa-esp32s3-elf-c++filt")
+    ordered = sorted(names)
+    if not tool or not ordered:
+        return {n: n for n in ordered}
+    result = subprocess.run([tool], input="\n".join(ordered), capture_output=True, text=True)
+    lines = result.stdout.splitlines()
+    if result.returncode != 0 or len(lines) != len(ordered):
+        return {n: n for n in ordered}
+    return dict(zip(ordered, lines))
+
+
+def read_dump(path: str):
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) < HEADER_SIZE or data[:4] != MAGIC:
+        raise ValueError(f"{path}: not a profiler dump")
+    version, depth, hz, count, dropped, task_count, duration_ms = struct.unpack_from("<HHIIIII", data, 4)
+    if version != VERSION:
+        raise ValueError(f"{path}: unsupported dump version {version}")
+    sample_size = 8 + 4 * depth
+    if HEADER_SIZE + task_count * (4 + TASK_NAME_LEN) + count * sample_size > len(data):
+        raise ValueError(f"{path}: truncated dump")
+
+    pos = HEADER_SIZE
+    tasks = {}
+    for _ in range(task_count):
+        handle, = struct.unpack_from("<I", data, pos)
+        tasks[handle] = data[pos + 4:pos + 4 + TASK_NAME_LEN].split(b"\0")[0].decode("ascii", "replace")
+        pos += 4 + TASK_NAME_LEN
+
+    samples = []
+    for _ in range(count):
+        task, core, used, flags = struct.unpack_from("<IBBH", data, pos)
+        pcs = struct.unpack_from(f"<{depth}I", data, pos + 8)[:min(used, depth)]
+        samples.append((task, core, flags, pcs))
+        pos += sample_size
+
+    meta = {"hz": hz, "samples": count, "dropped": dropped, "duration_ms": duration_ms}
+    return meta, tasks, samples
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("dump", help="profile.wprf from /profiler/download")
+    parser.add_argument("elf", help="firmware.elf of the build that was running")
+    parser.add_argument("--per-core", action="store_true", help="prefix each stack with its core")
+    args = parser.parse_args()
+
+    try:
+        meta, tasks, samples = read_dump(args.dump)
+        symbols = SymbolTable(args.elf)
+    except (OSError, ValueError) as e:
+        print(f"error: {e}", file=sys.stderr)
+        return 1
+
+    raw_names = set()
+    resolved = []
+    for task, core, flags, pcs in samples:
+        frames = []
+        for pc in reversed(pcs):  # pc[0] is the leaf
+            name = symbols.lookup(pc)
+            if name is None:
+                name = f"0x{pc:08x}"
+            else:
+                raw_names.add(name)
+            frames.append(name)
+        if flags & SAMPLE_IN_ISR:
+            frames.append("[isr]")
+        resolved.append((task, core, frames))
+
+    pretty = demangle(raw_names)
+    stacks = Counter()
+    for task, core, frames in resolved:
+        parts = [tasks.get(task, f"task@0x{task:08x}")]
+        if args.per_core:
+            parts.insert(0, f"core{core}")
+        # ';' separates frames in the folded format
+        parts.extend(pretty.get(f, f).replace(";", ":") for f in frames)
+        stacks[";".join(parts)] += 1
+
+    for stack, count in sorted(stacks.items()):
+        print(f"{stack} {count}")
+
+    print(f"{meta['samples']} samples at {meta['hz']} Hz over {meta['duration_ms']} ms, "
+          f"{meta['dropped']} dropped, {len(stacks)} distinct stacks", file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+"""
+Incremental web UI deploy: uploads only the files under data/web/ whose
+content differs from what is on the device, instead of flashing a whole
+LittleFS image through /filesystem.
+
+Flow:
+  1. GET  /assets/manifest           -> path, size, sha256 of every /web/* file
+  2. POST /assets/upload?path&sha256 -> each new or changed local file
+                                        (device verifies sha256, then renames
+                                        the temp file into place)
+  3. POST /assets/delete?path        -> with --delete, device files that no
+                                        longer exist locally (same subtree only)
+
+Learning data and other files in the LittleFS root are never listed or
+touched: the device only accepts paths below /web/.
+
+Usage:
+  sync_web_assets.py --url http://<device-ip> --user admin --password secret
+  sync_web_assets.py --url http://<device-ip> --local data/web/prod --remote /web/prod --delete
+  sync_web_assets.py ... --dry-run
+"""
+
+from __future__ import annotations
+
+import argparse
+import base64
+import hashlib
+import json
+import os
+import sys
+import uuid
+from urllib.error import HTTPError, URLError
+from urllib.parse import urlencode
+from urllib.request import Request, urlopen
+
+
+TIMEOUT_SEC = 30
+
+
+def _auth_header(user: str, password: str) -> str:
+    return "Basic " + base64.b64encode(f"{user}:{password}".encode()).decode()
+
+
+def _request(url: str, auth: str, method: str = "GET", body: bytes | None = None,
+             content_type: str | None = None) -> tuple[int, str]:
+    request = Request(url, data=body, method=method)
+    request.add_header("Authorization", auth)
+    if content_type:
+        request.add_header("Content-Type", content_type)
+    try:
+        with urlopen(request, timeout=TIMEOUT_SEC) as response:
+            return response.status, response.read().decode(errors="replace")
+    except HTTPError as exc:
+        return exc.code, exc.read().decode(errors="replace")
+
+
+def local_manifest(local_root: str, remote_root: str) -> dict[str, tuple[str, bytes]]:
+    """Map device path -> (sha256 hex, content) for every file below local_root."""
+    files: dict[str, tuple[str, bytes]] = {}
+    for dirpath, _dirnames, filenames in os.walk(local_root):
+        for name in sorted(filenames):
+            full = os.path.join(dirpath, name)
+            rel = os.path.relpath(full, local_root).replace(os.sep, "/")
+            with open(full, "rb") as f:
+                content = f.read()
+            files[f"{remote_root}/{rel}"] = (hashlib.sha256(content).hexdigest(), content)
+    return files
+
+
+def device_manifest(base_url: str, auth: str) -> dict[str, str]:
+    status, text = _request(f"{base_url}/assets/manifest", auth)
+    if status != 200:
+        raise RuntimeError(f"manifest request failed: HTTP {status} {text.strip()}")
+    return {entry["path"]: entry["sha256"] for entry in json.loads(text).get("files", [])}
+
+
+def upload_file(base_url: str, auth: str, path: str, sha256: str, content: bytes) -> tuple[int, str]:
+    boundary = uuid.uuid4().hex
+    body = (
+        f"--{boundary}\r\n"
+        f'Content-Disposition: form-data; name="file"; filename="{os.path.basename(path)}"\r\n'
+        "Content-Type: application/octet-stream\r\n\r\n"
+    ).encode() + content + f"\r\n--{boundary}--\r\n".encode()
+    query = urlencode({"path": path, "sha256": sha256})
+    return _request(f"{base_url}/assets/upload?{query}", auth, "POST", body,
+                    f"multipart/form-data; boundary={boundary}")
+
+
+def delete_file(base_url: str, auth: str, path: str) -> tuple[int, str]:
+    return _request(f"{base_url}/assets/delete?{urlencode({'path': path})}", auth, "POST", b"")
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--url", required=True, help="device base URL, e.g. http://192.168.1.50")
+    parser.add_argument("--user", default="admin")
+    parser.add_argument("--password", default="")
+    parser.add_argument("--local", default="data/web", help="local directory to mirror (default: data/web)")
+    parser.add_argument("--remote", default="/web", help="device directory it maps to (default: /web)")
+    parser.add_argument("--delete", action="store_true", help="remove device files missing locally")
+    parser.add_argument("--dry-run", action="store_true", help="only print the plan")
+    args = parser.parse_args()
+
+    base_url = args.url.rstrip("/")
+    remote_root = "/" + args.remote.strip("/")
+    auth = _auth_header(args.user, args.password)
+
+    try:
+        local = local_manifest(args.local, remote_root)
+        remote = device_manifest(base_url, auth)
+    except (RuntimeError, URLError, OSError) as exc:
+        print(f"error: {exc}", file=sys.stderr)
+        return 1
+
+    changed = [p for p, (sha, _) in sorted(local.items()) if remote.get(p) != sha]
+    stale = [p for p in sorted(remote) if p.startswith(remote_root + "/") and p not in local] if args.delete else []
+
+    unchanged = len(local) - len(changed)
+    print(f"{len(changed)} to upload, {len(stale)} to delete, {unchanged} unchanged")
+    for path in changed:
+        print(f"  upload {path} ({len(local[path][1])} bytes)")
+    for path in stale:
+        print(f"  delete {path}")
+    if args.dry_run:
+        return 0
+
+    failures = 0
+    for path in changed:
+        sha, content = local[path]
+        status, text = upload_file(base_url, auth, path, sha, content)
+        if status != 200:
+            failures += 1
+            print(f"  FAILED {path}: HTTP {status} {text.strip()}")
+    for path in stale:
+        status, text = delete_file(base_url, auth, path)
+        if status != 200:
+            failures += 1
+            print(f"  FAILED delete {path}: HTTP {status} {text.strip()}")
+
+    uploaded = sum(len(local[p][1]) for p in changed)
+    print(f"done: {uploaded} bytes written, {failures} failure(s)")
+    return 0 if failures == 0 else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())